@@ -7,14 +7,20 @@
 
 #include <lamure/types.h>
 #include <lamure/prov/aux.h>
+#include <lamure/prov/aux_stream.h>
 #include <lamure/prov/octree.h>
 
 #include <scm/core/math.h>
 #include <scm/gl_core/math.h>
 
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
 
 using namespace std;
 
@@ -111,6 +117,61 @@ struct feature {
 
 
 
+typedef std::chrono::high_resolution_clock timer;
+
+double elapsed_ms(const timer::time_point& start) {
+    return std::chrono::duration<double, std::milli>(timer::now() - start).count();
+}
+
+//reads the lines of a text file in chunks and parses every chunk in parallel,
+//comment lines are skipped and the records keep the order of the lines
+template <typename record_t>
+void parse_records(const std::string& filepath, uint32_t chunk_size,
+  const std::function<void(std::istringstream&, record_t&)>& parse, std::vector<record_t>& records) {
+
+    std::ifstream file(filepath, std::ios::in);
+    if(file.is_open()) {
+      std::cout << filepath << std::endl;
+    }
+    else {
+      std::cout << "File not found: " << filepath << std::endl;
+      exit(0);
+    }
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (file.good()) {
+      lines.clear();
+      while (lines.size() < chunk_size && std::getline(file, line)) {
+        if (line.length() > 1) {
+          if (line[0] == '/' && line[1] == '/') {
+            continue;
+          }
+          lines.push_back(line);
+        }
+      }
+
+      uint64_t first = records.size();
+      records.resize(first + lines.size());
+
+      #pragma omp parallel for schedule(dynamic, 256)
+      for (int64_t i = 0; i < (int64_t)lines.size(); ++i) {
+        std::istringstream line_ss(lines[i]);
+        parse(line_ss, records[first + i]);
+      }
+    }
+    file.close();
+}
+
+//sorts by key, later lines overwrite earlier lines with the same key
+template <typename record_t, typename less_t>
+void sort_records(std::vector<record_t>& records, less_t less) {
+    std::stable_sort(records.begin(), records.end(), less);
+    auto last = std::unique(records.rbegin(), records.rend(), 
+      [&](const record_t& l, const record_t& r) { return !less(l, r) && !less(r, l); });
+    records.erase(records.begin(), last.base());
+}
+
 int main(int argc, char *argv[]) {
     if (argc == 1 || 
       cmd_option_exists(argv, argv+argc, "-h") ||
@@ -119,6 +180,7 @@ int main(int argc, char *argv[]) {
          "INFO: aux_import " << std::endl <<
          "\t-f input folder (required)" << std::endl <<
          "\t-a aux output file (default: default.aux)" << std::endl <<
+         "\t-c lines parsed at once (default: 65536)" << std::endl <<
          std::endl;
       return 0;
     }
@@ -133,58 +195,35 @@ int main(int argc, char *argv[]) {
       aux_file = input_folder + std::string(get_cmd_option(argv, argv + argc, "-a"));
     }
 
-    //parse cameraNames.txt
-    std::map<int32_t, cameraName> cameraNames;
-    std::string cameraNames_filepath = input_folder + "cameraNames.txt";
-    
-    std::ifstream cameraNames_file(cameraNames_filepath, std::ios::in);
-    if(cameraNames_file.is_open()) {
-      std::cout << cameraNames_filepath << std::endl;
-    }
-    else {
-      std::cout << "File not found: " << cameraNames_filepath << std::endl;
-      exit(0);
+    uint32_t chunk_size = 1 << 16;
+    if (cmd_option_exists(argv, argv+argc, "-c")) {
+      chunk_size = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-c")));
     }
 
-    std::string line;
-    while (std::getline(cameraNames_file, line)) {
-      if (line.length() > 1) {
-        if (line[0] == '/' && line[1] == '/') {
-          continue;
-        }
-        cameraName cN;
-        std::istringstream line_ss(line);
+    auto total_start = timer::now();
+    auto start = timer::now();
+
+    //parse cameraNames.txt
+    std::vector<cameraName> cameraName_records;
+    parse_records<cameraName>(input_folder + "cameraNames.txt", chunk_size,
+      [](std::istringstream& line_ss, cameraName& cN) {
         line_ss >> cN.cameraId_;
         line_ss >> cN.cameraName_;
-        cameraNames[cN.cameraId_] = cN;
-      }
+      }, cameraName_records);
+
+    std::map<int32_t, cameraName> cameraNames;
+    for (const auto& cN : cameraName_records) {
+      cameraNames[cN.cameraId_] = cN;
     }
-    cameraNames_file.close();
 
     uint64_t num_views = cameraNames.size();
     std::cout << "cameraNames.txt " << num_views << " cameras found" << std::endl; 
 
 
     //parse cameraIntrinsics.txt
-    std::map<int32_t, cameraIntrinsic> cameraIntrinsics;
-    std::string cameraIntrinsics_filepath = input_folder + "cameraIntrinsics.txt";
-    
-    std::ifstream cameraIntrinsics_file(cameraIntrinsics_filepath, std::ios::in);
-    if(cameraIntrinsics_file.is_open()) {
-      std::cout << cameraIntrinsics_filepath << std::endl;
-    }
-    else {
-      std::cout << "File not found: " << cameraIntrinsics_filepath << std::endl;
-      exit(0);
-    }
-
-    while (std::getline(cameraIntrinsics_file, line)) {
-      if (line.length() > 1) {
-        if (line[0] == '/' && line[1] == '/') {
-          continue;
-        }
-        cameraIntrinsic cI;
-        std::istringstream line_ss(line);
+    std::vector<cameraIntrinsic> cameraIntrinsic_records;
+    parse_records<cameraIntrinsic>(input_folder + "cameraIntrinsics.txt", chunk_size,
+      [](std::istringstream& line_ss, cameraIntrinsic& cI) {
         line_ss >> cI.cameraId_;
         line_ss >> cI.focalValueH_;
         line_ss >> cI.reserved_0_;
@@ -197,70 +236,42 @@ int main(int argc, char *argv[]) {
         line_ss >> cI.reserved_4_;
         line_ss >> cI.imageWidth_;
         line_ss >> cI.imageHeight_;
-        cameraIntrinsics[cI.cameraId_] = cI;
-      }
+      }, cameraIntrinsic_records);
+
+    std::map<int32_t, cameraIntrinsic> cameraIntrinsics;
+    for (const auto& cI : cameraIntrinsic_records) {
+      cameraIntrinsics[cI.cameraId_] = cI;
     }
-    cameraIntrinsics_file.close();
 
     std::cout << "cameraIntrinsics.txt " << cameraIntrinsics.size() << " cameras found" << std::endl; 
 
 
 
     //parse cameraDistortions.txt
-    std::map<int32_t, cameraDistortion> cameraDistortions;
-    std::string cameraDistortions_filepath = input_folder + "cameraDistortions.txt";
-    
-    std::ifstream cameraDistortions_file(cameraDistortions_filepath, std::ios::in);
-    if(cameraDistortions_file.is_open()) {
-      std::cout << cameraDistortions_filepath << std::endl;
-    }
-    else {
-      std::cout << "File not found: " << cameraDistortions_filepath << std::endl;
-      exit(0);
-    }
-
-    while (std::getline(cameraDistortions_file, line)) {
-      if (line.length() > 1) {
-        if (line[0] == '/' && line[1] == '/') {
-          continue;
-        }
-        cameraDistortion cD;
-        std::istringstream line_ss(line);
+    std::vector<cameraDistortion> cameraDistortion_records;
+    parse_records<cameraDistortion>(input_folder + "cameraDistortions.txt", chunk_size,
+      [](std::istringstream& line_ss, cameraDistortion& cD) {
         line_ss >> cD.cameraId_;
         line_ss >> cD.radial1_;
         line_ss >> cD.radial2_;
         line_ss >> cD.radial3_;
         line_ss >> cD.tangential1_;
         line_ss >> cD.tangential2_;
-        cameraDistortions[cD.cameraId_] = cD;
-      }
+      }, cameraDistortion_records);
+
+    std::map<int32_t, cameraDistortion> cameraDistortions;
+    for (const auto& cD : cameraDistortion_records) {
+      cameraDistortions[cD.cameraId_] = cD;
     }
-    cameraDistortions_file.close();
 
     std::cout << "cameraDistortions.txt " << cameraDistortions.size() << " cameras found" << std::endl; 
 
 
 
     //parse cameraPoses.txt
-    std::map<int32_t, cameraPose> cameraPoses;
-    std::string cameraPoses_filepath = input_folder + "cameraPoses.txt";
-    
-    std::ifstream cameraPoses_file(cameraPoses_filepath, std::ios::in);
-    if(cameraPoses_file.is_open()) {
-      std::cout << cameraPoses_filepath << std::endl;
-    }
-    else {
-      std::cout << "File not found: " << cameraPoses_filepath << std::endl;
-      exit(0);
-    }
-
-    while (std::getline(cameraPoses_file, line)) {
-      if (line.length() > 1) {
-        if (line[0] == '/' && line[1] == '/') {
-          continue;
-        }
-        cameraPose cP;
-        std::istringstream line_ss(line);
+    std::vector<cameraPose> cameraPose_records;
+    parse_records<cameraPose>(input_folder + "cameraPoses.txt", chunk_size,
+      [](std::istringstream& line_ss, cameraPose& cP) {
         line_ss >> cP.cameraId_;
         line_ss >> cP.positionX_;
         line_ss >> cP.positionY_;
@@ -274,104 +285,67 @@ int main(int argc, char *argv[]) {
         line_ss >> cP.rot31_;
         line_ss >> cP.rot32_;
         line_ss >> cP.rot33_;
-        cameraPoses[cP.cameraId_] = cP;
-      }
+      }, cameraPose_records);
+
+    std::map<int32_t, cameraPose> cameraPoses;
+    for (const auto& cP : cameraPose_records) {
+      cameraPoses[cP.cameraId_] = cP;
     }
-    cameraPoses_file.close();
 
     std::cout << "cameraPoses.txt " << cameraPoses.size() << " cameras found" << std::endl; 
 
+    std::cout << "Parsing cameras took " << elapsed_ms(start) << " ms" << std::endl;
+    start = timer::now();
 
 
-    //parse worldPoints.txt
-    std::map<int32_t, worldPoint> worldPoints;
-    std::string worldPoints_filepath = input_folder + "worldPoints.txt";
-    
-    std::ifstream worldPoints_file(worldPoints_filepath, std::ios::in);
-    if(worldPoints_file.is_open()) {
-      std::cout << worldPoints_filepath << std::endl;
-    }
-    else {
-      std::cout << "File not found: " << worldPoints_filepath << std::endl;
-      exit(0);
-    }
-
-    while (std::getline(worldPoints_file, line)) {
-      if (line.length() > 1) {
-        if (line[0] == '/' && line[1] == '/') {
-          continue;
-        }
-        worldPoint wP;
-        std::istringstream line_ss(line);
+    //parse worldPoints.txt, sorted by id
+    std::vector<worldPoint> worldPoints;
+    parse_records<worldPoint>(input_folder + "worldPoints.txt", chunk_size,
+      [](std::istringstream& line_ss, worldPoint& wP) {
         line_ss >> wP.worldPointId_;
         line_ss >> wP.worldPointX_;
         line_ss >> wP.worldPointY_;
         line_ss >> wP.worldPointZ_;
-        worldPoints[wP.worldPointId_] = wP;
-      }
-    }
-    worldPoints_file.close();
+      }, worldPoints);
+    sort_records(worldPoints, [](const worldPoint& l, const worldPoint& r) {
+      return l.worldPointId_ < r.worldPointId_;
+    });
 
     uint64_t num_points = worldPoints.size();
     std::cout << "worldPoints.txt " << num_points << " points found" << std::endl; 
 
 
 
-    //parse worldPointDetectionError.txt
-    std::map<int32_t, std::map<int32_t, std::map<int32_t, worldPointDetectionError>>> worldPointDetectionErrors;
-    std::string worldPointDetectionError_filepath = input_folder + "worldPointDetectionError.txt";
-    
-    std::ifstream worldPointDetectionError_file(worldPointDetectionError_filepath, std::ios::in);
-    if(worldPointDetectionError_file.is_open()) {
-      std::cout << worldPointDetectionError_filepath << std::endl;
-    }
-    else {
-      std::cout << "File not found: " << worldPointDetectionError_filepath << std::endl;
-      exit(0);
-    }
-
-    while (std::getline(worldPointDetectionError_file, line)) {
-      if (line.length() > 1) {
-        if (line[0] == '/' && line[1] == '/') {
-          continue;
-        }
-        worldPointDetectionError wPDE;
-        std::istringstream line_ss(line);
+    //parse worldPointDetectionError.txt, sorted by point, camera and feature
+    auto wPDE_less = [](const worldPointDetectionError& l, const worldPointDetectionError& r) {
+      if (l.worldPointId_ != r.worldPointId_) return l.worldPointId_ < r.worldPointId_;
+      if (l.cameraId_ != r.cameraId_) return l.cameraId_ < r.cameraId_;
+      return l.featureId_ < r.featureId_;
+    };
+    std::vector<worldPointDetectionError> worldPointDetectionErrors;
+    parse_records<worldPointDetectionError>(input_folder + "worldPointDetectionError.txt", chunk_size,
+      [](std::istringstream& line_ss, worldPointDetectionError& wPDE) {
         line_ss >> wPDE.worldPointId_;
         line_ss >> wPDE.cameraId_;
         line_ss >> wPDE.featureId_;
         line_ss >> wPDE.projectErrorX_;
         line_ss >> wPDE.projectErrorY_;
         line_ss >> wPDE.projectErrorLen_;
-        worldPointDetectionErrors[wPDE.worldPointId_][wPDE.cameraId_][wPDE.featureId_] = wPDE;
-      }
-    }
-    worldPointDetectionError_file.close();
+      }, worldPointDetectionErrors);
+    sort_records(worldPointDetectionErrors, wPDE_less);
 
     std::cout << "worldPointDetectionError.txt " << worldPointDetectionErrors.size() << " entries found" << std::endl; 
 
 
 
-    //parse features.txt
-    std::map<int32_t, std::map<int32_t, feature>> features;
-    std::string features_filepath = input_folder + "features.txt";
-    
-    std::ifstream features_file(features_filepath, std::ios::in);
-    if(features_file.is_open()) {
-      std::cout << features_filepath << std::endl;
-    }
-    else {
-      std::cout << "File not found: " << features_filepath << std::endl;
-      exit(0);
-    }
-
-    while (std::getline(features_file, line)) {
-      if (line.length() > 1) {
-        if (line[0] == '/' && line[1] == '/') {
-          continue;
-        }
-        feature f;
-        std::istringstream line_ss(line);
+    //parse features.txt, sorted by camera and feature
+    auto feature_less = [](const feature& l, const feature& r) {
+      if (l.cameraId_ != r.cameraId_) return l.cameraId_ < r.cameraId_;
+      return l.featureId_ < r.featureId_;
+    };
+    std::vector<feature> features;
+    parse_records<feature>(input_folder + "features.txt", chunk_size,
+      [](std::istringstream& line_ss, feature& f) {
         line_ss >> f.cameraId_;
         line_ss >> f.featureId_;
         line_ss >> f.usingCount_;
@@ -379,17 +353,25 @@ int main(int argc, char *argv[]) {
         line_ss >> f.featureY_;
         line_ss >> f.featureSize_;
         line_ss >> f.featureAngle_;
-        features[f.cameraId_][f.featureId_] = f;
-      }
-    }
-    features_file.close();
+      }, features);
+    sort_records(features, feature_less);
 
     std::cout << "features.txt " << features.size() << " entries found" << std::endl; 
 
+    std::cout << "Parsing points and features took " << elapsed_ms(start) << " ms" << std::endl;
+    start = timer::now();
 
 
-    //write aux object
-    lamure::prov::aux aux;
+    //checked before anything is written, so no truncated aux file is left behind
+    lamure::prov::octree octree;
+    if (num_points < octree.get_min_num_points()) {
+      std::cout << "Too few points, at least " << octree.get_min_num_points() << " are needed for the octree" << std::endl;
+      exit(-1);
+    }
+
+    //write aux file
+    lamure::prov::aux_stream aux_stream;
+    aux_stream.begin_aux(aux_file);
 
     for (auto it : cameraNames) {
       auto& cN = it.second;
@@ -421,57 +403,105 @@ int main(int argc, char *argv[]) {
       v.image_height_ = cI.imageHeight_;
       v.atlas_tile_id_ = 0;    
       
-      aux.add_view(v);
+      aux_stream.write_view(v);
     }
 
-    for (auto it : worldPoints) {
-      auto& wP = it.second;
-
-      int32_t id = wP.worldPointId_;
-      auto& wPDE_maps = worldPointDetectionErrors.find(id)->second;
-      
-      lamure::prov::aux::sparse_point p;
-
-      p.pos_ = scm::math::vec3f(wP.worldPointX_, wP.worldPointY_, wP.worldPointZ_);
-      p.r_ = (uint8_t)255;
-      p.g_ = (uint8_t)255;
-      p.b_ = (uint8_t)255;
-      p.a_ = (uint8_t)255;
-      
-      auto aux_features = std::vector<lamure::prov::aux::feature>();
-      for (const auto& wPDE_map : wPDE_maps) {
-        for (const auto& wPDE : wPDE_map.second) {
-          auto& feature = features[wPDE.second.cameraId_][wPDE.second.featureId_];
+    //points are assembled in parallel chunks and written right away, only
+    //positions and camera ids are kept for the octree
+    std::vector<scm::math::vec3f> positions(num_points);
+    std::vector<uint64_t> camera_offsets(num_points+1, 0);
+    std::vector<uint32_t> camera_ids;
+
+    std::vector<std::pair<uint64_t, uint64_t>> wPDE_ranges(num_points);
+    #pragma omp parallel for
+    for (int64_t i = 0; i < (int64_t)num_points; ++i) {
+      worldPointDetectionError key;
+      key.worldPointId_ = worldPoints[i].worldPointId_;
+      auto first = std::lower_bound(worldPointDetectionErrors.begin(), worldPointDetectionErrors.end(), key,
+        [](const worldPointDetectionError& l, const worldPointDetectionError& r) { return l.worldPointId_ < r.worldPointId_; });
+      auto last = std::upper_bound(first, worldPointDetectionErrors.end(), key,
+        [](const worldPointDetectionError& l, const worldPointDetectionError& r) { return l.worldPointId_ < r.worldPointId_; });
+      wPDE_ranges[i] = std::make_pair(first - worldPointDetectionErrors.begin(), last - worldPointDetectionErrors.begin());
+    }
+    for (uint64_t i = 0; i < num_points; ++i) {
+      camera_offsets[i+1] = camera_offsets[i] + wPDE_ranges[i].second - wPDE_ranges[i].first;
+    }
+    camera_ids.resize(camera_offsets.back());
+
+    aux_stream.begin_sparse_points();
+
+    lamure::prov::aux::sparse_chunk chunk;
+    for (uint64_t first = 0; first < num_points; first += chunk_size) {
+      uint64_t last = std::min(first + chunk_size, num_points);
+
+      chunk.first_point_id_ = first;
+      chunk.points_.resize(last - first);
+      chunk.features_.resize(camera_offsets[last] - camera_offsets[first]);
+
+      #pragma omp parallel for
+      for (int64_t i = first; i < (int64_t)last; ++i) {
+        auto& wP = worldPoints[i];
+        auto& p = chunk.points_[i - first];
+
+        p.pos_ = scm::math::vec3f(wP.worldPointX_, wP.worldPointY_, wP.worldPointZ_);
+        p.r_ = (uint8_t)255;
+        p.g_ = (uint8_t)255;
+        p.b_ = (uint8_t)255;
+        p.a_ = (uint8_t)255;
+        p.features_offset_ = camera_offsets[i] - camera_offsets[first];
+        p.num_features_ = camera_offsets[i+1] - camera_offsets[i];
+        positions[i] = p.pos_;
+
+        for (uint64_t j = wPDE_ranges[i].first; j < wPDE_ranges[i].second; ++j) {
+          const auto& wPDE = worldPointDetectionErrors[j];
+
+          feature key;
+          key.cameraId_ = wPDE.cameraId_;
+          key.featureId_ = wPDE.featureId_;
+          auto feature_it = std::lower_bound(features.begin(), features.end(), key, feature_less);
           
           lamure::prov::aux::feature f;
-          f.camera_id_ = wPDE.second.cameraId_;
-          f.using_count_ = feature.usingCount_;
-          f.coords_ = scm::math::vec2f(feature.featureX_, feature.featureY_);
-          f.error_ = scm::math::vec2f(wPDE.second.projectErrorX_, wPDE.second.projectErrorY_);
-
-          aux_features.push_back(f);
+          f.camera_id_ = wPDE.cameraId_;
+          f.using_count_ = 0;
+          f.coords_ = scm::math::vec2f(0.f, 0.f);
+          if (feature_it != features.end() && !feature_less(key, *feature_it)) {
+            f.using_count_ = feature_it->usingCount_;
+            f.coords_ = scm::math::vec2f(feature_it->featureX_, feature_it->featureY_);
+          }
+          f.error_ = scm::math::vec2f(wPDE.projectErrorX_, wPDE.projectErrorY_);
+
+          uint64_t k = j - wPDE_ranges[i].first;
+          chunk.features_[p.features_offset_ + k] = f;
+          camera_ids[camera_offsets[i] + k] = f.camera_id_;
         }
       }
-      
-      p.features_ = aux_features;
 
-      aux.add_sparse_point(p);
-      
+      aux_stream.write_sparse_points(chunk);
     }
 
+    aux_stream.end_sparse_points();
+
+    std::cout << "Assembling and writing points took " << elapsed_ms(start) << " ms" << std::endl;
+    start = timer::now();
+
 
     std::cout << "create octree " << std::endl;
 
     //create octree
-    auto octree = std::make_shared<lamure::prov::octree>();
-    octree->create(aux.get_sparse_points());
-    aux.set_octree(octree);
+    octree.create(positions, camera_offsets, camera_ids);
+
+    std::cout << "Creating octree took " << elapsed_ms(start) << " ms" << std::endl;
+    start = timer::now();
 
     std::cout << "Write aux to file..." << std::endl;
-    aux.write_aux_file(aux_file);
+    aux_stream.write_octree(octree);
+    aux_stream.end_aux();
+
+    std::cout << "Writing octree took " << elapsed_ms(start) << " ms" << std::endl;
+    std::cout << "Import took " << elapsed_ms(total_start) << " ms" << std::endl;
 
-    std::cout << "Num views: " << aux.get_num_views() << std::endl;
-    std::cout << "Num points: " << aux.get_num_sparse_points() << std::endl;
+    std::cout << "Num views: " << num_views << std::endl;
+    std::cout << "Num points: " << num_points << std::endl;
     std::cout << "Done" << std::endl;
 
     return 0;
@@ -398,7 +398,7 @@ int main(int argc, char *argv[]) {
         }
 #endif
         
-        in_access->read((char*)&surfels[0], node_idx * size_of_node, size_of_node);
+        in_access->read((char*)&surfels[0], bvh->get_file_index(node_idx) * size_of_node, size_of_node);
 
 
    
@@ -616,6 +616,8 @@ int main(int argc, char *argv[]) {
 
     bvh->set_size_of_primitive( sizeof(lamure::ren::dataset::serialized_surfel_qz) );
     bvh->set_primitive(lamure::ren::bvh::primitive_type::POINTCLOUD_QZ);
+    //the quantized nodes were written in bfs order
+    bvh->set_file_indices(std::vector<lamure::node_t>());
 
     lamure::ren::bvh_stream bvh_ofstream;
     bvh_ofstream.write_bvh(out_bvhqz_file, *bvh);
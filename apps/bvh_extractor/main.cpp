@@ -147,7 +147,7 @@ int main(int argc, char *argv[]) {
         }
 #endif
         
-        in_access->read((char*)surfels, leaf_id * size_of_node, size_of_node);
+        in_access->read((char*)surfels, bvh->get_file_index(leaf_id) * size_of_node, size_of_node);
 
         std::ios::openmode mode = std::ios::out | std::ios::app;
         out_stream.open(xyz_filename, mode);
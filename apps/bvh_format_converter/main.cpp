@@ -0,0 +1,91 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include <lamure/types.h>
+#include <lamure/bvh_v3.h>
+#include <lamure/ren/bvh.h>
+#include <lamure/ren/bvh_stream.h>
+
+// converts serialized .bvh files between the segment based format
+// and the version 3 layout with one section per node attribute.
+// reduction errors and node layouts are carried over, the .lod and
+// .prov files are not touched.
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+size_t file_size(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file.is_open() ? (size_t)file.tellg() : 0;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 1 ||
+      cmd_option_exists(argv, argv+argc, "-h") ||
+      !cmd_option_exists(argv, argv+argc, "-f") ||
+      !cmd_option_exists(argv, argv+argc, "-o")) {
+
+      std::cout << "Usage: " << argv[0] << " <flags> -f <input_file> -o <output_file>" << std::endl <<
+         "INFO: bvh_format_converter" << std::endl <<
+         "\t-f: selects .bvh input file (any version)" << std::endl <<
+         "\t-o: selects .bvh output file" << std::endl <<
+         "\t    (-f and -o flags are required) " << std::endl <<
+         "\t-c: compress node sections (lz4)" << std::endl <<
+         "\t-l: write the segment based format instead of version 3" << std::endl <<
+         std::endl;
+      return 0;
+    }
+
+    std::string in_filename = std::string(get_cmd_option(argv, argv + argc, "-f"));
+    std::string out_filename = std::string(get_cmd_option(argv, argv + argc, "-o"));
+
+    if (in_filename == out_filename) {
+        std::cout << "input and output must differ" << std::endl;
+        return 0;
+    }
+
+    bool compress = cmd_option_exists(argv, argv+argc, "-c");
+    bool legacy = cmd_option_exists(argv, argv+argc, "-l");
+
+    std::cout << "input: " << in_filename << (lamure::bvh_v3::is_bvh_v3(in_filename) ? " (version 3)" : "") << std::endl;
+    std::cout << "output: " << out_filename << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    lamure::ren::bvh* bvh = new lamure::ren::bvh(in_filename);
+    double read_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    lamure::ren::bvh_stream bvh_ofstream;
+    if (legacy) {
+        bvh_ofstream.write_bvh(out_filename, *bvh);
+    }
+    else {
+        bvh_ofstream.write_bvh_v3(out_filename, *bvh, compress);
+    }
+
+    std::cout << "nodes: " << bvh->get_num_nodes() << std::endl;
+    std::cout << "read: " << read_ms << " ms" << std::endl;
+    std::cout << "size: " << file_size(in_filename) << " -> " << file_size(out_filename) << " bytes" << std::endl;
+
+    delete bvh;
+
+    return 0;
+}
@@ -259,7 +259,7 @@ complementOnFirstTree(int relax_levels, const scm::math::vec3f& extend_bbx_max,
     for (const auto& col: collision_info) {
         lamure::node_id_type a = col.first;
         bool changed = false;
-        ser_a.read_node_immediate(surfels, a);
+        ser_a.read_node_immediate(surfels, tr_a->get_file_index(a));
 
 /*
 
@@ -302,7 +302,7 @@ complementOnFirstTree(int relax_levels, const scm::math::vec3f& extend_bbx_max,
         }
 
         if (changed)
-            ser_a.write_node_immediate(surfels, a);
+            ser_a.write_node_immediate(surfels, tr_a->get_file_index(a));
 
         if (++pairs % 500 == 0)
             std::cout << "\r" << pairs << " / " << collision_info.size() << " nodes processed; discarded: " << total_discarded << std::flush;
@@ -344,7 +344,7 @@ histogrammatchSecondTree(const scm::math::vec3f& extend_bbx_max, const scm::math
         histogram_matcher::color_array ref_colors;
         pre::surfel_vector surfels;
         for (const auto& col: collision_info) {
-            ser[0]->read_node_immediate(surfels, col);
+            ser[0]->read_node_immediate(surfels, bvhs_[0].first->get_file_index(col));
             for (auto& s: surfels) {
                 if (s != pre::surfel())
                     ref_colors.add_color(s.color());
@@ -367,7 +367,7 @@ histogrammatchSecondTree(const scm::math::vec3f& extend_bbx_max, const scm::math
             colors.clear();
             // get colors
             for (lamure::node_id_type j = 0; j < ranges.second; ++j) {
-                ser[tid]->read_node_immediate(surfels, j + ranges.first);
+                ser[tid]->read_node_immediate(surfels, tr->get_file_index(j + ranges.first));
                 for (auto& s: surfels) {
                     if (s != pre::surfel())
                         colors.add_color(s.color());
@@ -378,7 +378,7 @@ histogrammatchSecondTree(const scm::math::vec3f& extend_bbx_max, const scm::math
             // write colors back
             size_t surfel_ctr = 0;
             for (lamure::node_id_type j = 0; j < ranges.second; ++j) {
-                ser[tid]->read_node_immediate(surfels, j + ranges.first);
+                ser[tid]->read_node_immediate(surfels, tr->get_file_index(j + ranges.first));
                 for (auto& s: surfels) {
                     if (s != pre::surfel()) {
                         vec3b c(colors.r[surfel_ctr], 
@@ -388,7 +388,7 @@ histogrammatchSecondTree(const scm::math::vec3f& extend_bbx_max, const scm::math
                         ++surfel_ctr;
                     }
                 }
-                ser[tid]->write_node_immediate(surfels, j + ranges.first);
+                ser[tid]->write_node_immediate(surfels, tr->get_file_index(j + ranges.first));
             }
             std::cout << "\r" << ctr++ << " / " << tr->depth() << " levels processed" << std::flush;
         }
@@ -409,12 +409,12 @@ MultRadii(lamure::real factor)
         ser.open(add_to_path(tr->base_path(), ".lod").string(), true);
 
         for (lamure::node_id_type i = 0; i < tr->nodes().size(); ++i) {
-            ser.read_node_immediate(surfels, i);
+            ser.read_node_immediate(surfels, tr->get_file_index(i));
             for (auto& s: surfels) {
                 if (s != pre::surfel() && s.radius() != 0.f)
                     s.radius() *= factor;
             }
-            ser.write_node_immediate(surfels, i);
+            ser.write_node_immediate(surfels, tr->get_file_index(i));
             tr->nodes()[i].set_avg_surfel_radius(tr->nodes()[i].avg_surfel_radius() * factor);
             if (++ctr % 500 == 0)
                 std::cout << "\r" << int(float(ctr)/tr->nodes().size()*100) << " % processed" << std::flush;
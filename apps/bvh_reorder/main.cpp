@@ -0,0 +1,208 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <lamure/types.h>
+#include <lamure/ren/bvh.h>
+#include <lamure/ren/lod_stream.h>
+
+// rewrites the .lod (and .prov) file of a bvh so that the nodes of each depth
+// are stored along a morton curve through their centroids. the .bvh receives
+// a node layout segment which maps node ids to their new position in the files.
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+enum layout_t {
+  LAYOUT_MORTON = 0,
+  LAYOUT_BFS = 1
+};
+
+//spreads the lower 10 bits of v so that there are two zero bits between each
+uint32_t expand_bits(uint32_t v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+uint32_t morton_code(const scm::math::vec3f& position, const scm::gl::boxf& domain) {
+    uint32_t code = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = domain.max_vertex()[axis] - domain.min_vertex()[axis];
+        float t = extent > 0.f ? (position[axis] - domain.min_vertex()[axis]) / extent : 0.f;
+        t = std::min(std::max(t, 0.f), 1.f);
+        uint32_t cell = std::min((uint32_t)(t * 1024.f), 1023u);
+        code |= expand_bits(cell) << (2 - axis);
+    }
+    return code;
+}
+
+std::vector<lamure::node_t> compute_layout(const lamure::ren::bvh* bvh, const layout_t layout) {
+    std::vector<lamure::node_t> file_indices(bvh->get_num_nodes());
+
+    const scm::gl::boxf& domain = bvh->get_bounding_box(0);
+
+    for (uint32_t depth = 0; depth <= bvh->get_depth(); ++depth) {
+        lamure::node_t first_node_id = bvh->get_first_node_id_of_depth(depth);
+        uint32_t length = bvh->get_length_of_depth(depth);
+
+        std::vector<std::pair<uint32_t, lamure::node_t>> order;
+        order.reserve(length);
+
+        for (lamure::node_t node_id = first_node_id; node_id < first_node_id + length; ++node_id) {
+            uint32_t key = layout == LAYOUT_MORTON ? morton_code(bvh->get_centroid(node_id), domain) : 0;
+            order.push_back(std::make_pair(key, node_id));
+        }
+
+        //depths stay contiguous, ties keep their bfs order
+        std::sort(order.begin(), order.end());
+
+        for (uint32_t i = 0; i < length; ++i) {
+            file_indices[order[i].second] = first_node_id + i;
+        }
+    }
+
+    return file_indices;
+}
+
+void reorder_file(const std::string& in_filename,
+                  const std::string& out_filename,
+                  const lamure::ren::bvh* bvh,
+                  const std::vector<lamure::node_t>& file_indices,
+                  const size_t size_of_node) {
+
+    lamure::ren::lod_stream in_access;
+    in_access.open(in_filename);
+
+    lamure::ren::lod_stream out_access;
+    out_access.open_for_writing(out_filename);
+
+    std::vector<char> buffer(size_of_node);
+
+    for (lamure::node_t node_id = 0; node_id < bvh->get_num_nodes(); ++node_id) {
+        in_access.read(&buffer[0], (size_t)bvh->get_file_index(node_id) * size_of_node, size_of_node);
+        out_access.write(&buffer[0], (size_t)file_indices[node_id] * size_of_node, size_of_node);
+
+        if (node_id % 10000 == 0) {
+            std::cout << node_id << " / " << bvh->get_num_nodes() << " writing: " << out_filename << "\r";
+            std::cout.flush();
+        }
+    }
+    std::cout << std::endl;
+
+    in_access.close();
+    out_access.close();
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 1 ||
+      cmd_option_exists(argv, argv+argc, "-h") ||
+      !cmd_option_exists(argv, argv+argc, "-f")) {
+
+      std::cout << "Usage: " << argv[0] << " <flags> -f <input_file>" << std::endl <<
+         "INFO: bvh_reorder" << std::endl <<
+         "\t-f: selects .bvh input file" << std::endl <<
+         "\t    (-f flag is required) " << std::endl <<
+         "\t-o: selects .bvh output file" << std::endl <<
+         "\t    (default: <input>_morton.bvh or <input>_bfs.bvh)" << std::endl <<
+         "\t-m: select node layout per depth" << std::endl <<
+         "\t    (options: \"morton\", \"bfs\")" << std::endl <<
+         "\t    (default: \"morton\")" << std::endl <<
+         std::endl;
+      return 0;
+    }
+
+    std::string bvh_filename = std::string(get_cmd_option(argv, argv + argc, "-f"));
+
+    if (bvh_filename.size() < 4 || bvh_filename.substr(bvh_filename.size()-4).compare(".bvh") != 0) {
+        std::cout << "please specify a .bvh file as input" << std::endl;
+        return 0;
+    }
+
+    layout_t layout = LAYOUT_MORTON;
+    if (cmd_option_exists(argv, argv+argc, "-m")) {
+       std::string mode = get_cmd_option(argv, argv+argc, "-m");
+       if (mode.compare("bfs") == 0) {
+          layout = LAYOUT_BFS;
+       }
+       else if (mode.compare("morton") != 0) {
+          std::cout << "unknown node layout " << mode << std::endl;
+          return 0;
+       }
+    }
+
+    std::string base_filename = bvh_filename.substr(0, bvh_filename.size()-4);
+    std::string out_bvh_filename = base_filename + (layout == LAYOUT_MORTON ? "_morton.bvh" : "_bfs.bvh");
+    if (cmd_option_exists(argv, argv+argc, "-o")) {
+       out_bvh_filename = std::string(get_cmd_option(argv, argv + argc, "-o"));
+       if (out_bvh_filename.size() < 4 || out_bvh_filename.substr(out_bvh_filename.size()-4).compare(".bvh") != 0) {
+          std::cout << "please specify a .bvh file as output" << std::endl;
+          return 0;
+       }
+    }
+
+    if (out_bvh_filename == bvh_filename) {
+       std::cout << "input and output must differ" << std::endl;
+       return 0;
+    }
+
+    std::string out_base_filename = out_bvh_filename.substr(0, out_bvh_filename.size()-4);
+
+    std::cout << "input: " << bvh_filename << std::endl;
+    std::cout << "output: " << out_bvh_filename << std::endl;
+
+    lamure::ren::bvh* bvh = new lamure::ren::bvh(bvh_filename);
+
+    std::vector<lamure::node_t> file_indices = compute_layout(bvh, layout);
+
+    size_t size_of_node = (size_t)bvh->get_primitives_per_node() * bvh->get_size_of_primitive();
+    reorder_file(base_filename + ".lod", out_base_filename + ".lod", bvh, file_indices, size_of_node);
+
+    //provenance is stored per node with the same stride in every node
+    std::ifstream prov_file(base_filename + ".prov", std::ios::binary | std::ios::ate);
+    if (prov_file.is_open() && prov_file.tellg() > 0) {
+        size_t size_of_prov_file = (size_t)prov_file.tellg();
+        prov_file.close();
+
+        if (size_of_prov_file % bvh->get_num_nodes() != 0) {
+            std::cout << "provenance file does not match the bvh, skipping" << std::endl;
+        }
+        else {
+            size_t size_of_prov_node = size_of_prov_file / bvh->get_num_nodes();
+            reorder_file(base_filename + ".prov", out_base_filename + ".prov", bvh, file_indices, size_of_prov_node);
+        }
+    }
+
+    if (layout == LAYOUT_BFS) {
+        file_indices.clear();
+    }
+
+    bvh->set_file_indices(file_indices);
+    bvh->write_bvh_file(out_bvh_filename);
+
+    std::cout << "done." << std::endl;
+
+    delete bvh;
+
+    return 0;
+}
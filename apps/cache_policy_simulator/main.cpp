@@ -0,0 +1,253 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <lamure/types.h>
+#include <lamure/ren/cache_index.h>
+#include <lamure/ren/cache_replacement_policy.h>
+
+// replays a cache request trace recorded by cut_update_benchmark --trace
+// against a cache_index per replacement policy and reports how many bytes
+// each policy has to load again after having evicted a node.
+//
+// trace format (text):
+//   slot_size <bytes>
+//   num_models <count>
+//   frame <index>
+//   <view> <model> <node> <screen-space error of the parent> <camera distance>
+//   ...
+
+char* get_cmd_option(char** begin, char** end, const std::string & option) {
+    char** it = std::find(begin, end, option);
+    if (it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char** begin, char** end, const std::string& option) {
+    return std::find(begin, end, option) != end;
+}
+
+struct request_t {
+    lamure::view_t view_id_;
+    lamure::model_t model_id_;
+    lamure::node_t node_id_;
+    float error_;
+    float distance_;
+};
+
+struct trace_t {
+    size_t slot_size_;
+    lamure::model_t num_models_;
+    std::vector<std::vector<request_t>> frames_;
+};
+
+struct result_t {
+    size_t num_loads_;
+    size_t num_reloads_;
+    size_t num_rejected_;
+};
+
+uint64_t node_key(const lamure::view_t view_id, const lamure::model_t model_id, const lamure::node_t node_id) {
+    return (((uint64_t)(view_id & 0xFFFF)) << 48) | (((uint64_t)(model_id & 0xFFFF)) << 32) | (uint64_t)node_id;
+}
+
+trace_t load_trace(const std::string& trace_filename) {
+    std::ifstream trace_file(trace_filename);
+
+    if (!trace_file.is_open()) {
+        throw std::runtime_error("lamure: cache_policy_simulator::Unable to open trace file: " + trace_filename);
+    }
+
+    trace_t trace;
+    trace.slot_size_ = 0;
+    trace.num_models_ = 0;
+
+    std::string line;
+    while (std::getline(trace_file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream line_ss(line);
+
+        if (line.compare(0, 9, "slot_size") == 0) {
+            std::string token;
+            line_ss >> token >> trace.slot_size_;
+        }
+        else if (line.compare(0, 10, "num_models") == 0) {
+            std::string token;
+            line_ss >> token >> trace.num_models_;
+        }
+        else if (line.compare(0, 5, "frame") == 0) {
+            trace.frames_.push_back(std::vector<request_t>());
+        }
+        else if (!trace.frames_.empty()) {
+            request_t request;
+            line_ss >> request.view_id_ >> request.model_id_ >> request.node_id_ >> request.error_ >> request.distance_;
+            if (!line_ss.fail()) {
+                trace.frames_.back().push_back(request);
+            }
+        }
+    }
+
+    if (trace.slot_size_ == 0 || trace.num_models_ == 0) {
+        throw std::runtime_error("lamure: cache_policy_simulator::Trace file lacks slot_size or num_models: " + trace_filename);
+    }
+
+    return trace;
+}
+
+float retention_priority(const lamure::ren::replacement_policy_t policy, const request_t& request) {
+    if (policy == lamure::ren::replacement_policy_t::DISTANCE) {
+        return -request.distance_;
+    }
+    return request.error_;
+}
+
+result_t simulate(const trace_t& trace, const lamure::slot_t num_slots, const lamure::ren::replacement_policy_t policy) {
+    lamure::ren::cache_index index(trace.num_models_, num_slots, policy);
+
+    result_t result;
+    result.num_loads_ = 0;
+    result.num_reloads_ = 0;
+    result.num_rejected_ = 0;
+
+    std::unordered_set<uint64_t> loaded_once;
+    std::unordered_map<uint64_t, request_t> aquired;
+
+    for (const auto& frame : trace.frames_) {
+        std::unordered_map<uint64_t, request_t> requested;
+        for (const auto& request : frame) {
+            requested[node_key(request.view_id_, request.model_id_, request.node_id_)] = request;
+        }
+
+        //release what left the cut first, so its slots can be reused
+        for (auto it = aquired.begin(); it != aquired.end();) {
+            if (requested.find(it->first) == requested.end()) {
+                const request_t& request = it->second;
+                index.set_priority(request.model_id_, request.node_id_, retention_priority(policy, request));
+                index.release_slot(request.view_id_, request.model_id_, request.node_id_);
+                it = aquired.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        for (const auto& entry : requested) {
+            const request_t& request = entry.second;
+
+            if (!index.is_node_indexed(request.model_id_, request.node_id_)) {
+                if (index.num_free_slots() == 0) {
+                    ++result.num_rejected_;
+                    continue;
+                }
+
+                lamure::slot_t slot_id = index.reserve_slot();
+                index.apply_slot(slot_id, request.model_id_, request.node_id_);
+
+                ++result.num_loads_;
+
+                uint64_t model_node_key = node_key(0, request.model_id_, request.node_id_);
+                if (!loaded_once.insert(model_node_key).second) {
+                    ++result.num_reloads_;
+                }
+            }
+
+            index.set_priority(request.model_id_, request.node_id_, retention_priority(policy, request));
+            index.aquire_slot(request.view_id_, request.model_id_, request.node_id_);
+            aquired[entry.first] = request;
+        }
+    }
+
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 1 ||
+      cmd_option_exists(argv, argv+argc, "-h") ||
+      !cmd_option_exists(argv, argv+argc, "-f")) {
+
+      std::cout << "Usage: " << argv[0] << " <flags> -f <trace_file>" << std::endl <<
+         "INFO: cache_policy_simulator" << std::endl <<
+         "\t-f: selects cache request trace (recorded with cut_update_benchmark --trace)" << std::endl <<
+         "\t    (-f flag is required) " << std::endl <<
+         "\t-m: cache budget in MB (default: 1024)" << std::endl <<
+         "\t-s: cache budget in slots, overrides -m" << std::endl <<
+         "\t-p: replacement policy to simulate" << std::endl <<
+         "\t    (options: \"lru\", \"lru_k\", \"error\", \"distance\")" << std::endl <<
+         "\t    (default: all)" << std::endl <<
+         std::endl;
+      return 0;
+    }
+
+    std::string trace_filename = std::string(get_cmd_option(argv, argv + argc, "-f"));
+
+    trace_t trace = load_trace(trace_filename);
+
+    size_t budget_in_mb = 1024;
+    if (cmd_option_exists(argv, argv+argc, "-m")) {
+        budget_in_mb = std::max(atoi(get_cmd_option(argv, argv+argc, "-m")), 1);
+    }
+
+    lamure::slot_t num_slots = (budget_in_mb * 1024 * 1024) / trace.slot_size_;
+    if (cmd_option_exists(argv, argv+argc, "-s")) {
+        num_slots = std::max(atoi(get_cmd_option(argv, argv+argc, "-s")), 1);
+    }
+    num_slots = std::max(num_slots, (lamure::slot_t)1);
+
+    std::vector<lamure::ren::replacement_policy_t> policies = {
+        lamure::ren::replacement_policy_t::LRU,
+        lamure::ren::replacement_policy_t::LRU_K,
+        lamure::ren::replacement_policy_t::SCREEN_SPACE_ERROR,
+        lamure::ren::replacement_policy_t::DISTANCE
+    };
+
+    if (cmd_option_exists(argv, argv+argc, "-p")) {
+        lamure::ren::replacement_policy_t policy;
+        if (!lamure::ren::parse_replacement_policy(get_cmd_option(argv, argv+argc, "-p"), policy)) {
+            std::cout << "unknown replacement policy " << get_cmd_option(argv, argv+argc, "-p") << std::endl;
+            return -1;
+        }
+        policies = {policy};
+    }
+
+    std::cout << "trace: " << trace_filename << std::endl;
+    std::cout << "frames: " << trace.frames_.size() << ", models: " << trace.num_models_ << std::endl;
+    std::cout << "slots: " << num_slots << " x " << trace.slot_size_ << " bytes" << std::endl << std::endl;
+
+    std::cout << std::left << std::setw(12) << "policy"
+              << std::right << std::setw(12) << "loads"
+              << std::setw(12) << "reloads"
+              << std::setw(16) << "reload MB"
+              << std::setw(12) << "rejected" << std::endl;
+
+    for (const auto policy : policies) {
+        result_t result = simulate(trace, num_slots, policy);
+
+        double reload_mb = (double)(result.num_reloads_ * trace.slot_size_) / (1024.0 * 1024.0);
+
+        std::cout << std::left << std::setw(12) << lamure::ren::replacement_policy_name(policy)
+                  << std::right << std::setw(12) << result.num_loads_
+                  << std::setw(12) << result.num_reloads_
+                  << std::setw(16) << std::fixed << std::setprecision(2) << reload_mb
+                  << std::setw(12) << result.num_rejected_ << std::endl;
+    }
+
+    return 0;
+}
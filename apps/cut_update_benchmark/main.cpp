@@ -0,0 +1,504 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lamure/types.h>
+
+#include <lamure/ren/config.h>
+#include <lamure/ren/camera.h>
+#include <lamure/ren/controller.h>
+#include <lamure/ren/cut_database.h>
+#include <lamure/ren/cut_update_pool.h>
+#include <lamure/ren/model_database.h>
+#include <lamure/ren/node_batch.h>
+#include <lamure/ren/ooc_cache.h>
+#include <lamure/ren/policy.h>
+#include <lamure/ren/cache_replacement_policy.h>
+#include <lamure/ren/3rd_party/json.h>
+
+#include <lamure/pvs/pvs_database.h>
+
+#include <scm/core.h>
+#include <scm/core/math.h>
+
+#include <boost/program_options.hpp>
+
+// headless replay of a recorded camera path through the cut update.
+// the gpu cache is driven exactly as in the renderer, but the two
+// temporary upload storages are plain main memory, and the upload
+// is acknowledged immediately instead of being copied to a gpu buffer.
+
+struct frame_record
+{
+    double cut_update_ms_;
+    size_t ooc_bytes_loaded_;
+    lamure::ren::cut_update_pool::statistics statistics_;
+};
+
+std::vector<scm::math::mat4d> const parse_camera_path_file(std::string const &camera_path_file_path)
+{
+    std::ifstream camera_path_file(camera_path_file_path);
+
+    if(!camera_path_file.is_open())
+    {
+        throw std::runtime_error("lamure: cut_update_benchmark::Unable to open camera path file: " + camera_path_file_path);
+    }
+
+    std::string view_matrix_as_string;
+
+    std::vector<scm::math::mat4d> read_view_matrices;
+
+    while(std::getline(camera_path_file, view_matrix_as_string))
+    {
+        if(view_matrix_as_string.empty())
+        {
+            continue;
+        }
+
+        scm::math::mat4d curr_view_matrix;
+        std::istringstream view_matrix_as_strstream(view_matrix_as_string);
+
+        for(int matrix_element_idx = 0; matrix_element_idx < 16; ++matrix_element_idx)
+        {
+            view_matrix_as_strstream >> curr_view_matrix[matrix_element_idx];
+        }
+
+        read_view_matrices.push_back(curr_view_matrix);
+    }
+
+    return read_view_matrices;
+}
+
+std::vector<std::string> const parse_model_list_file(std::string const &model_list_file_path)
+{
+    std::ifstream model_list_file(model_list_file_path);
+
+    if(!model_list_file.is_open())
+    {
+        throw std::runtime_error("lamure: cut_update_benchmark::Unable to open model list file: " + model_list_file_path);
+    }
+
+    std::vector<std::string> model_filenames;
+    std::string one_line;
+
+    while(std::getline(model_list_file, one_line))
+    {
+        std::istringstream model_ss(one_line);
+        std::string model_path;
+        model_ss >> model_path;
+
+        if(model_path.size() < 2 || model_path.substr(0, 2) == "//")
+        {
+            continue;
+        }
+
+        model_filenames.push_back(model_path);
+    }
+
+    return model_filenames;
+}
+
+double const percentile(std::vector<double> const &sorted_values, double const p)
+{
+    if(sorted_values.empty())
+    {
+        return 0.0;
+    }
+
+    size_t rank = (size_t)std::ceil(p * sorted_values.size());
+    rank = std::max(rank, (size_t)1);
+    rank = std::min(rank, sorted_values.size());
+
+    return sorted_values[rank - 1];
+}
+
+// appends the cut rendered in the current frame to a cache request trace,
+// see apps/cache_policy_simulator for the format. The priorities match what
+// cut_update_pool::collapse_node hands to the caches: the error of the
+// collapsed parent and the camera distance of the released node.
+void write_trace_frame(std::ofstream &trace_file, uint32_t const frame, lamure::context_t const context_id, lamure::view_t const view_id,
+                       lamure::ren::camera const &camera, float const height_divided_by_top_minus_bottom)
+{
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+    lamure::ren::cut_database *cuts = lamure::ren::cut_database::get_instance();
+
+    // models are rendered with identity transforms, see main()
+    scm::math::mat4f const model_matrix = scm::math::mat4f::identity();
+    scm::math::mat4f const view_matrix = camera.get_view_matrix();
+    lamure::ren::node_batch batch(model_matrix, view_matrix, camera.get_projection_matrix(), camera.near_plane_value(), height_divided_by_top_minus_bottom);
+
+    trace_file << "frame " << frame << "\n";
+
+    for(lamure::model_t model_id = 0; model_id < database->num_models(); ++model_id)
+    {
+        auto bvh = database->get_model(model_id)->get_bvh();
+        lamure::ren::cut &cut = cuts->get_cut(context_id, view_id, model_id);
+
+        for(const auto &node_slot_aggregate : cut.complete_set())
+        {
+            lamure::node_t node_id = node_slot_aggregate.node_id_;
+            lamure::node_t parent_id = node_id == 0 ? 0 : bvh->get_parent_id(node_id);
+            scm::math::vec3f view_position = view_matrix * model_matrix * bvh->get_centroids()[node_id];
+
+            float error = batch.calculate_error(bvh, parent_id);
+            float distance = scm::math::length(view_position);
+
+            trace_file << view_id << " " << model_id << " " << node_id << " " << error << " " << distance << "\n";
+        }
+    }
+}
+
+double const hit_rate(size_t const hits, size_t const misses)
+{
+    if(hits + misses == 0)
+    {
+        return 1.0;
+    }
+
+    return (double)hits / (double)(hits + misses);
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    const std::string exec_name = (argc > 0) ? std::string(argv[0]) : "";
+    scm::shared_ptr<scm::core> scm_core(new scm::core(1, argv));
+
+    std::string model_list_file_path = "";
+    std::vector<std::string> model_filenames;
+    std::string camera_path_file_path = "";
+    std::string output_file_path = "";
+    std::string pvs_file_path = "";
+    std::string trace_file_path = "";
+    std::string replacement_policy_name = "";
+
+    int window_width;
+    int window_height;
+    unsigned int main_memory_budget;
+    unsigned int video_memory_budget;
+    unsigned int max_upload_budget;
+    unsigned int updates_per_view;
+    unsigned int warmup_updates;
+    float lod_error;
+    float fov;
+    float near_plane;
+    float far_plane;
+
+    po::options_description desc("Usage: " + exec_name + " [OPTION]... -c <camera path> INPUT.bvh...\n\n"
+                                 "Allowed Options");
+    desc.add_options()
+      ("help", "print help message")
+      ("input,i", po::value<std::vector<std::string>>(&model_filenames), "specify .bvh input-file(s)")
+      ("model-list,f", po::value<std::string>(&model_list_file_path), "specify file listing one .bvh input-file per line")
+      ("camera-path,c", po::value<std::string>(&camera_path_file_path), "specify recorded camera path (one view matrix of 16 values per line)")
+      ("output,o", po::value<std::string>(&output_file_path)->default_value("cut_update_benchmark.json"), "specify json report file (default=cut_update_benchmark.json)")
+      ("pvs-file,p", po::value<std::string>(&pvs_file_path), "specify potentially visible set file")
+      ("width,w", po::value<int>(&window_width)->default_value(1920), "specify virtual viewport width (default=1920)")
+      ("height,h", po::value<int>(&window_height)->default_value(1080), "specify virtual viewport height (default=1080)")
+      ("vram,v", po::value<unsigned>(&video_memory_budget)->default_value(2048), "specify emulated graphics memory budget in MB (default=2048)")
+      ("mem,m", po::value<unsigned>(&main_memory_budget)->default_value(4096), "specify main memory budget in MB (default=4096)")
+      ("mmap", "serve out-of-core data from read-only mappings of the .lod/.prov files")
+      ("upload,u", po::value<unsigned>(&max_upload_budget)->default_value(64), "specify maximum upload budget per frame in MB (default=64)")
+      ("error,e", po::value<float>(&lod_error)->default_value(LAMURE_DEFAULT_THRESHOLD), "specify lod error threshold")
+      ("fov", po::value<float>(&fov)->default_value(30.f), "specify vertical opening angle in degrees (default=30)")
+      ("near", po::value<float>(&near_plane)->default_value(0.01f), "specify near plane (default=0.01)")
+      ("far", po::value<float>(&far_plane)->default_value(1000.f), "specify far plane (default=1000)")
+      ("updates-per-view", po::value<unsigned>(&updates_per_view)->default_value(1), "specify number of cut updates per recorded view (default=1)")
+      ("warmup", po::value<unsigned>(&warmup_updates)->default_value(0), "specify number of leading cut updates excluded from the report (default=0)")
+      ("replacement-policy", po::value<std::string>(&replacement_policy_name)->default_value("lru"), "specify cache replacement policy: lru, lru_k, error, distance (default=lru)")
+      ("trace", po::value<std::string>(&trace_file_path), "specify file to record the cache request trace to");
+
+    po::positional_options_description p;
+    p.add("input", -1);
+
+    po::variables_map vm;
+
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+        po::notify(vm);
+    }
+    catch(std::exception &e)
+    {
+        std::cout << e.what() << std::endl << desc;
+        return -1;
+    }
+
+    if(!model_list_file_path.empty())
+    {
+        std::vector<std::string> listed_filenames = parse_model_list_file(model_list_file_path);
+        model_filenames.insert(model_filenames.end(), listed_filenames.begin(), listed_filenames.end());
+    }
+
+    if(vm.count("help") || model_filenames.empty() || camera_path_file_path.empty())
+    {
+        std::cout << desc;
+        return 0;
+    }
+
+    window_width = std::max(window_width, 1);
+    window_height = std::max(window_height, 1);
+    main_memory_budget = std::max(int(main_memory_budget), 1);
+    video_memory_budget = std::max(int(video_memory_budget), 1);
+    max_upload_budget = std::max(int(max_upload_budget), LAMURE_MIN_UPLOAD_BUDGET);
+    updates_per_view = std::max(int(updates_per_view), 1);
+
+    lamure::ren::replacement_policy_t replacement_policy;
+    if(!lamure::ren::parse_replacement_policy(replacement_policy_name, replacement_policy))
+    {
+        std::cout << "unknown replacement policy " << replacement_policy_name << std::endl << desc;
+        return -1;
+    }
+
+    std::vector<scm::math::mat4d> const camera_path = parse_camera_path_file(camera_path_file_path);
+
+    if(camera_path.empty())
+    {
+        std::cout << "camera path " << camera_path_file_path << " contains no views" << std::endl;
+        return -1;
+    }
+
+    lamure::ren::policy *policy = lamure::ren::policy::get_instance();
+    policy->set_max_upload_budget_in_mb(max_upload_budget);
+    policy->set_render_budget_in_mb(video_memory_budget);
+    policy->set_out_of_core_budget_in_mb(main_memory_budget);
+    policy->set_out_of_core_memory_mapped(vm.count("mmap") > 0);
+    policy->set_window_width(window_width);
+    policy->set_window_height(window_height);
+    policy->set_cache_replacement_policy(replacement_policy);
+
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+    lamure::ren::cut_database *cuts = lamure::ren::cut_database::get_instance();
+    lamure::ren::controller *controller = lamure::ren::controller::get_instance();
+
+    std::vector<std::string> model_keys;
+    for(size_t i = 0; i < model_filenames.size(); ++i)
+    {
+        model_keys.push_back(std::to_string(i));
+    }
+    database->add_models(model_filenames, model_keys);
+
+    controller->reset_system();
+
+    if(!pvs_file_path.empty())
+    {
+        std::string pvs_grid_file_path = pvs_file_path;
+        pvs_grid_file_path.resize(pvs_grid_file_path.length() - 3);
+        pvs_grid_file_path = pvs_grid_file_path + "grid";
+
+        lamure::pvs::pvs_database *pvs = lamure::pvs::pvs_database::get_instance();
+        pvs->load_pvs_from_file(pvs_grid_file_path, pvs_file_path, false);
+    }
+
+    lamure::context_t context_id = controller->deduce_context_id(0);
+    lamure::view_t view_id = controller->deduce_view_id(context_id, 0);
+
+    // same budget derivation as gpu_context::test_video_memory
+    size_t slot_size = database->get_slot_size();
+    lamure::node_t render_budget_in_nodes = ((size_t)video_memory_budget * 1024 * 1024) / slot_size;
+    lamure::node_t upload_budget_in_nodes = ((size_t)max_upload_budget * 1024 * 1024) / slot_size;
+
+    std::vector<char> storage_a(upload_budget_in_nodes * slot_size);
+    std::vector<char> storage_b(upload_budget_in_nodes * slot_size);
+
+    lamure::ren::cut_update_pool *pool = new lamure::ren::cut_update_pool(context_id, upload_budget_in_nodes, render_budget_in_nodes);
+
+    lamure::ren::ooc_cache *ooc_cache = lamure::ren::ooc_cache::get_instance();
+    ooc_cache->begin_measure();
+
+    scm::math::mat4f projection_matrix;
+    scm::math::perspective_matrix(projection_matrix, fov, float(window_width) / float(window_height), near_plane, far_plane);
+    lamure::ren::camera camera(view_id, near_plane, scm::math::mat4f::identity(), projection_matrix);
+
+    std::ofstream trace_file;
+    if(!trace_file_path.empty())
+    {
+        trace_file.open(trace_file_path);
+        trace_file << "# lamure cache request trace\n";
+        trace_file << "slot_size " << slot_size << "\n";
+        trace_file << "num_models " << database->num_models() << "\n";
+    }
+
+    std::vector<frame_record> frames;
+    frames.reserve(camera_path.size() * updates_per_view);
+
+    uint32_t num_updates = 0;
+
+    for(const auto &view_matrix : camera_path)
+    {
+        camera.set_view_matrix(view_matrix);
+
+        std::vector<scm::math::vec3d> corner_values = camera.get_frustum_corners();
+        double top_minus_bottom = scm::math::length((corner_values[2]) - (corner_values[0]));
+        float height_divided_by_top_minus_bottom = policy->window_height() / top_minus_bottom;
+
+        for(uint32_t update = 0; update < updates_per_view; ++update)
+        {
+            for(lamure::model_t model_id = 0; model_id < database->num_models(); ++model_id)
+            {
+                cuts->send_transform(context_id, model_id, scm::math::mat4f::identity());
+                cuts->send_threshold(context_id, model_id, lod_error);
+                cuts->send_rendered(context_id, model_id);
+            }
+
+            cuts->send_camera(context_id, view_id, camera);
+            cuts->send_height_divided_by_top_minus_bottom(context_id, view_id, height_divided_by_top_minus_bottom);
+
+            cuts->swap(context_id);
+
+            if(trace_file.is_open())
+            {
+                write_trace_frame(trace_file, num_updates, context_id, view_id, camera, height_divided_by_top_minus_bottom);
+            }
+
+            size_t bytes_loaded_before = ooc_cache->bytes_loaded();
+
+            auto start = std::chrono::high_resolution_clock::now();
+
+            pool->dispatch_cut_update(storage_a.data(), storage_b.data(), nullptr, nullptr);
+
+            while(pool->is_running())
+            {
+                std::this_thread::yield();
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+
+            // stand-in for the gpu upload of the transfer list
+            if(cuts->is_front_modified(context_id))
+            {
+                cuts->signal_upload_complete(context_id);
+            }
+
+            if(num_updates++ < warmup_updates)
+            {
+                continue;
+            }
+
+            frame_record record;
+            record.cut_update_ms_ = std::chrono::duration<double, std::milli>(end - start).count();
+            record.ooc_bytes_loaded_ = ooc_cache->bytes_loaded() - bytes_loaded_before;
+            record.statistics_ = pool->get_statistics();
+            frames.push_back(record);
+        }
+    }
+
+    // report
+    std::vector<double> latencies;
+    size_t total_splits = 0;
+    size_t total_collapses = 0;
+    size_t total_ooc_bytes_loaded = 0;
+    size_t total_ooc_hits = 0;
+    size_t total_ooc_misses = 0;
+    size_t total_gpu_hits = 0;
+    size_t total_gpu_misses = 0;
+
+    picojson::array frames_json;
+
+    for(const auto &record : frames)
+    {
+        latencies.push_back(record.cut_update_ms_);
+
+        total_splits += record.statistics_.num_splits_;
+        total_collapses += record.statistics_.num_collapses_;
+        total_ooc_bytes_loaded += record.ooc_bytes_loaded_;
+        total_ooc_hits += record.statistics_.ooc_cache_hits_;
+        total_ooc_misses += record.statistics_.ooc_cache_misses_;
+        total_gpu_hits += record.statistics_.gpu_cache_hits_;
+        total_gpu_misses += record.statistics_.gpu_cache_misses_;
+
+        picojson::object frame_json;
+        frame_json["cut_update_ms"] = picojson::value(record.cut_update_ms_);
+        frame_json["nodes_split"] = picojson::value((double)record.statistics_.num_splits_);
+        frame_json["nodes_collapsed"] = picojson::value((double)record.statistics_.num_collapses_);
+        frame_json["ooc_bytes_loaded"] = picojson::value((double)record.ooc_bytes_loaded_);
+        frame_json["ooc_cache_hit_rate"] = picojson::value(hit_rate(record.statistics_.ooc_cache_hits_, record.statistics_.ooc_cache_misses_));
+        frame_json["gpu_cache_hit_rate"] = picojson::value(hit_rate(record.statistics_.gpu_cache_hits_, record.statistics_.gpu_cache_misses_));
+        frames_json.push_back(picojson::value(frame_json));
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    double mean_latency = 0.0;
+    for(const auto latency : latencies)
+    {
+        mean_latency += latency;
+    }
+    mean_latency = latencies.empty() ? 0.0 : mean_latency / latencies.size();
+
+    picojson::object latency_json;
+    latency_json["min"] = picojson::value(latencies.empty() ? 0.0 : latencies.front());
+    latency_json["mean"] = picojson::value(mean_latency);
+    latency_json["p50"] = picojson::value(percentile(latencies, 0.5));
+    latency_json["p90"] = picojson::value(percentile(latencies, 0.9));
+    latency_json["p95"] = picojson::value(percentile(latencies, 0.95));
+    latency_json["p99"] = picojson::value(percentile(latencies, 0.99));
+    latency_json["max"] = picojson::value(latencies.empty() ? 0.0 : latencies.back());
+
+    picojson::object summary_json;
+    summary_json["num_frames"] = picojson::value((double)frames.size());
+    summary_json["cut_update_ms"] = picojson::value(latency_json);
+    summary_json["nodes_split"] = picojson::value((double)total_splits);
+    summary_json["nodes_collapsed"] = picojson::value((double)total_collapses);
+    summary_json["ooc_bytes_loaded"] = picojson::value((double)total_ooc_bytes_loaded);
+    summary_json["ooc_cache_hit_rate"] = picojson::value(hit_rate(total_ooc_hits, total_ooc_misses));
+    summary_json["gpu_cache_hit_rate"] = picojson::value(hit_rate(total_gpu_hits, total_gpu_misses));
+
+    picojson::array models_json;
+    for(const auto &model_filename : model_filenames)
+    {
+        models_json.push_back(picojson::value(model_filename));
+    }
+
+    picojson::object config_json;
+    config_json["models"] = picojson::value(models_json);
+    config_json["camera_path"] = picojson::value(camera_path_file_path);
+    config_json["num_views"] = picojson::value((double)camera_path.size());
+    config_json["updates_per_view"] = picojson::value((double)updates_per_view);
+    config_json["warmup_updates"] = picojson::value((double)warmup_updates);
+    config_json["lod_error"] = picojson::value((double)lod_error);
+    config_json["main_memory_budget_mb"] = picojson::value((double)main_memory_budget);
+    config_json["memory_mapped"] = picojson::value(policy->out_of_core_memory_mapped());
+    config_json["video_memory_budget_mb"] = picojson::value((double)video_memory_budget);
+    config_json["upload_budget_mb"] = picojson::value((double)max_upload_budget);
+    config_json["cut_update_threads"] = picojson::value((double)pool->num_threads());
+    config_json["loading_threads"] = picojson::value((double)LAMURE_CUT_UPDATE_NUM_LOADING_THREADS);
+    config_json["replacement_policy"] = picojson::value(lamure::ren::replacement_policy_name(replacement_policy));
+
+    picojson::object report_json;
+    report_json["config"] = picojson::value(config_json);
+    report_json["summary"] = picojson::value(summary_json);
+    report_json["frames"] = picojson::value(frames_json);
+
+    std::ofstream output_file(output_file_path);
+    output_file << picojson::value(report_json).serialize(true);
+    output_file.close();
+
+    std::cout << "cut updates: " << frames.size() << std::endl;
+    std::cout << "cut update latency (ms): p50 " << percentile(latencies, 0.5) << ", p99 " << percentile(latencies, 0.99) << std::endl;
+    std::cout << "report written to " << output_file_path << std::endl;
+
+    delete pool;
+
+    delete lamure::ren::ooc_cache::get_instance();
+    delete lamure::ren::cut_database::get_instance();
+    delete lamure::ren::controller::get_instance();
+    delete lamure::ren::model_database::get_instance();
+    delete lamure::ren::policy::get_instance();
+
+    return 0;
+}
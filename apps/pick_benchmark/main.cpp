@@ -0,0 +1,306 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lamure/types.h>
+
+#include <lamure/ren/bvh.h>
+#include <lamure/ren/controller.h>
+#include <lamure/ren/model_database.h>
+#include <lamure/ren/ooc_cache.h>
+#include <lamure/ren/policy.h>
+#include <lamure/ren/ray.h>
+#include <lamure/ren/ray_pool.h>
+
+#include <scm/core.h>
+#include <scm/core/math.h>
+
+#include <boost/program_options.hpp>
+
+// headless picking benchmark. the upper levels of every model are loaded
+// into the ooc_cache and aquired as a renderer would, then random picks
+// aimed at the models are timed with the bundle pick (ray::intersect)
+// and with the single ray pick (ray::intersect_model).
+
+struct pick_query
+{
+    lamure::model_t model_id_;
+    scm::math::vec3f origin_;
+    scm::math::vec3f direction_;
+    scm::math::vec3f up_;
+    float max_distance_;
+    float bundle_radius_;
+};
+
+std::vector<std::string> const parse_model_list_file(std::string const &model_list_file_path)
+{
+    std::ifstream model_list_file(model_list_file_path);
+
+    if(!model_list_file.is_open())
+    {
+        throw std::runtime_error("lamure: pick_benchmark::Unable to open model list file: " + model_list_file_path);
+    }
+
+    std::vector<std::string> model_filenames;
+    std::string one_line;
+
+    while(std::getline(model_list_file, one_line))
+    {
+        std::istringstream model_ss(one_line);
+        std::string model_path;
+        model_ss >> model_path;
+
+        if(model_path.size() < 2 || model_path.substr(0, 2) == "//")
+        {
+            continue;
+        }
+
+        model_filenames.push_back(model_path);
+    }
+
+    return model_filenames;
+}
+
+double const elapsed_ms(std::chrono::high_resolution_clock::time_point const &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// registers all nodes down to resident_depth with the ooc_cache and
+// aquires them once loaded, returns the number of aquired nodes
+size_t const load_resident_nodes(lamure::context_t const context_id, lamure::view_t const view_id, unsigned int const resident_depth)
+{
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+    lamure::ren::ooc_cache *ooc_cache = lamure::ren::ooc_cache::get_instance();
+
+    std::vector<std::pair<lamure::model_t, lamure::node_t>> pending;
+    for(lamure::model_t model_id = 0; model_id < database->num_models(); ++model_id)
+    {
+        const lamure::ren::bvh *bvh = database->get_model(model_id)->get_bvh();
+        uint32_t depth = std::min((uint32_t)resident_depth, bvh->get_depth());
+        lamure::node_t num_nodes = bvh->get_first_node_id_of_depth(depth) + bvh->get_length_of_depth(depth);
+
+        for(lamure::node_t node_id = 0; node_id < num_nodes; ++node_id)
+        {
+            pending.push_back(std::make_pair(model_id, node_id));
+        }
+    }
+
+    size_t num_aquired = 0;
+
+    while(!pending.empty())
+    {
+        std::vector<std::pair<lamure::model_t, lamure::node_t>> remaining;
+
+        ooc_cache->lock();
+        ooc_cache->refresh();
+
+        for(const auto &node : pending)
+        {
+            if(ooc_cache->is_node_resident(node.first, node.second))
+            {
+                ooc_cache->aquire_node(context_id, view_id, node.first, node.second);
+                ++num_aquired;
+            }
+            else if(ooc_cache->num_free_slots() > 0)
+            {
+                ooc_cache->register_node(node.first, node.second, 0);
+                remaining.push_back(node);
+            }
+        }
+
+        ooc_cache->unlock();
+
+        pending.swap(remaining);
+
+        if(!pending.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    return num_aquired;
+}
+
+std::vector<pick_query> const generate_picks(unsigned int const num_picks, float const bundle_radius_scale)
+{
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+
+    std::mt19937 generator(1337);
+    std::uniform_real_distribution<float> distribution(0.f, 1.f);
+
+    std::vector<pick_query> picks;
+    picks.reserve(num_picks);
+
+    for(unsigned int i = 0; i < num_picks; ++i)
+    {
+        pick_query pick;
+        pick.model_id_ = i % database->num_models();
+
+        const scm::gl::boxf &box = database->get_model(pick.model_id_)->get_bvh()->get_bounding_box(0);
+        const scm::math::mat4f &model_transform = database->get_model(pick.model_id_)->transform();
+
+        scm::math::vec3f extent = box.max_vertex() - box.min_vertex();
+        scm::math::vec3f target =
+            box.min_vertex() + scm::math::vec3f(extent.x * distribution(generator), extent.y * distribution(generator), extent.z * distribution(generator));
+        target = model_transform * target;
+
+        float diagonal = scm::math::length((model_transform * box.max_vertex()) - (model_transform * box.min_vertex()));
+
+        // uniform direction on the sphere
+        float z = 2.f * distribution(generator) - 1.f;
+        float phi = 2.f * 3.1415926535f * distribution(generator);
+        float r = std::sqrt(std::max(0.f, 1.f - z * z));
+        pick.direction_ = scm::math::vec3f(r * std::cos(phi), r * std::sin(phi), z);
+
+        pick.origin_ = target - pick.direction_ * diagonal;
+        pick.max_distance_ = 2.f * diagonal;
+        pick.bundle_radius_ = bundle_radius_scale * diagonal;
+
+        scm::math::vec3f helper = std::abs(pick.direction_.y) < 0.9f ? scm::math::vec3f(0.f, 1.f, 0.f) : scm::math::vec3f(1.f, 0.f, 0.f);
+        pick.up_ = scm::math::normalize(scm::math::cross(pick.direction_, scm::math::cross(helper, pick.direction_)));
+
+        picks.push_back(pick);
+    }
+
+    return picks;
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    const std::string exec_name = (argc > 0) ? std::string(argv[0]) : "";
+    scm::shared_ptr<scm::core> scm_core(new scm::core(1, argv));
+
+    std::string model_list_file_path = "";
+    std::vector<std::string> model_filenames;
+    unsigned int main_memory_budget;
+    unsigned int resident_depth;
+    unsigned int num_picks;
+    unsigned int max_depth;
+    unsigned int surfel_skip;
+    float bundle_radius_scale;
+
+    po::options_description desc("Usage: " + exec_name + " [OPTION]... INPUT.bvh...\n\n"
+                                 "Allowed Options");
+    desc.add_options()
+      ("help", "print help message")
+      ("input,i", po::value<std::vector<std::string>>(&model_filenames), "specify .bvh input-file(s)")
+      ("model-list,f", po::value<std::string>(&model_list_file_path), "specify file listing one .bvh input-file per line")
+      ("mem,m", po::value<unsigned>(&main_memory_budget)->default_value(4096), "specify main memory budget in MB (default=4096)")
+      ("resident-depth,d", po::value<unsigned>(&resident_depth)->default_value(6), "specify depth down to which nodes are loaded (default=6)")
+      ("picks,n", po::value<unsigned>(&num_picks)->default_value(1000), "specify number of picks per mode (default=1000)")
+      ("max-depth", po::value<unsigned>(&max_depth)->default_value(0), "specify maximum traversal depth, 0 for unlimited (default=0)")
+      ("surfel-skip", po::value<unsigned>(&surfel_skip)->default_value(1), "specify surfel stride during intersection (default=1)")
+      ("bundle-radius", po::value<float>(&bundle_radius_scale)->default_value(0.01f), "specify bundle radius relative to the model diagonal (default=0.01)");
+
+    po::positional_options_description p;
+    p.add("input", -1);
+
+    po::variables_map vm;
+
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+        po::notify(vm);
+    }
+    catch(std::exception &e)
+    {
+        std::cout << e.what() << std::endl << desc;
+        return -1;
+    }
+
+    if(!model_list_file_path.empty())
+    {
+        std::vector<std::string> listed_filenames = parse_model_list_file(model_list_file_path);
+        model_filenames.insert(model_filenames.end(), listed_filenames.begin(), listed_filenames.end());
+    }
+
+    if(vm.count("help") || model_filenames.empty() || num_picks == 0)
+    {
+        std::cout << desc;
+        return 0;
+    }
+
+    lamure::ren::policy *policy = lamure::ren::policy::get_instance();
+    policy->set_out_of_core_budget_in_mb(std::max(main_memory_budget, 1u));
+
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+    lamure::ren::controller *controller = lamure::ren::controller::get_instance();
+
+    std::vector<std::string> model_keys;
+    for(size_t i = 0; i < model_filenames.size(); ++i)
+    {
+        model_keys.push_back(std::to_string(i));
+    }
+    database->add_models(model_filenames, model_keys);
+
+    controller->reset_system();
+
+    lamure::context_t context_id = controller->deduce_context_id(0);
+    lamure::view_t view_id = controller->deduce_view_id(context_id, 0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t num_resident = load_resident_nodes(context_id, view_id, resident_depth);
+    double load_ms = elapsed_ms(start);
+
+    std::vector<pick_query> const picks = generate_picks(num_picks, bundle_radius_scale);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "models: " << database->num_models() << std::endl;
+    std::cout << "resident nodes: " << num_resident << " (loaded in " << load_ms << " ms)" << std::endl;
+    std::cout << "ray pool threads: " << lamure::ren::ray_pool::get_instance()->num_threads() << std::endl;
+
+    // bundle picks over all models
+    unsigned int num_bundle_hits = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for(const auto &pick : picks)
+    {
+        lamure::ren::ray ray(pick.origin_, pick.direction_, pick.max_distance_);
+        lamure::ren::ray::intersection intersection;
+        scm::math::vec3f up = pick.up_;
+
+        if(ray.intersect(1.0f, up, pick.bundle_radius_, max_depth, surfel_skip, intersection))
+        {
+            ++num_bundle_hits;
+        }
+    }
+    double bundle_ms = elapsed_ms(start);
+
+    // single ray picks of the targeted model
+    unsigned int num_model_hits = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for(const auto &pick : picks)
+    {
+        lamure::ren::ray ray(pick.origin_, pick.direction_, pick.max_distance_);
+        lamure::ren::ray::intersection intersection;
+        const scm::math::mat4f &model_transform = database->get_model(pick.model_id_)->transform();
+
+        if(ray.intersect_model(pick.model_id_, model_transform, 1.0f, max_depth, surfel_skip, false, intersection))
+        {
+            ++num_model_hits;
+        }
+    }
+    double model_ms = elapsed_ms(start);
+
+    std::cout << "bundle picks: " << num_picks / bundle_ms * 1000.0 << " picks/s (" << bundle_ms / num_picks << " ms/pick, " << num_bundle_hits << " hits)" << std::endl;
+    std::cout << "model picks: " << num_picks / model_ms * 1000.0 << " picks/s (" << model_ms / num_picks << " ms/pick, " << num_model_hits << " hits)" << std::endl;
+
+    return 0;
+}
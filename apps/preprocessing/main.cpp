@@ -119,6 +119,10 @@ int main(int argc, const char *argv[])
          "  .prov for single float value per line\n"
          "  .xyz_prov for xyzrgb +p per line")
 
+        ("prov-join",
+         "ndc_prov only: track surfels during downsweep and upsweep and join the "
+         "provenance attribs onto the LOD after serialization")
+
         ("reduction-algo",
          po::value<std::string>()->default_value("ndc_prov"),
          "Reduction strategy for the LOD construction. Possible values:\n"
@@ -369,6 +373,7 @@ int main(int argc, const char *argv[])
 
         //optional prov file
         desc.prov_file                    = vm["prov-file"].as<std::string>();
+        desc.join_provenance              = vm.count("prov-join");
 
         if (desc.prov_file != "") {
             std::cout << "Provenance data found -> using --reduction-algo ndc_prov" << std::endl;
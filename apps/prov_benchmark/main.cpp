@@ -38,7 +38,7 @@ int main(int argc, char *argv[])
 {
     if(argc == 1 || !cmd_option_exists(argv, argv + argc, "-s") || !cmd_option_exists(argv, argv + argc, "-d"))
     {
-        cout << "Usage: " << argv[0] << " <flags> -s <project>.sparse.prov  -d <project>.dense.prov" << endl << endl;
+        cout << "Usage: " << argv[0] << " <flags> -s <project>.sparse.prov  -d <project>.dense.prov [-c <project>.dense.prov.col]" << endl << endl;
         return -1;
     }
 
@@ -74,6 +74,57 @@ int main(int argc, char *argv[])
         auto end = std::chrono::high_resolution_clock::now();
         printf("Caching dense data took: %f ms\n", std::chrono::duration<double, std::milli>(end - start));
         in_dense.close();
+        in_dense_meta.close();
+    }
+
+    if(!cache_dense.get_points_metadata().empty())
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        cache_dense.intern_image_sets();
+        auto end = std::chrono::high_resolution_clock::now();
+        printf("\nInterning image sets took: %f ms\n", std::chrono::duration<double, std::milli>(end - start).count());
+
+        const lamure::prov::ImageSets &image_sets = cache_dense.get_image_sets();
+        lamure::prov::ImageSets::MemoryReport report = image_sets.get_memory_report();
+        printf("Image lists: %lu points, %lu image ids, %lu distinct sets\n", (unsigned long)report.num_points, (unsigned long)report.num_image_ids,
+               (unsigned long)report.num_distinct_sets);
+        printf("Image list memory: %f MiB as vectors, %f MiB as columns, %f MiB interned\n", report.vector_bytes / 1048576.0, report.columnar_bytes / 1048576.0,
+               report.interned_bytes / 1048576.0);
+
+        std::vector<uint32_t> images;
+        image_sets.get_images_seen(0, images);
+        images.resize(std::min<size_t>(images.size(), 2));
+
+        start = std::chrono::high_resolution_clock::now();
+        std::vector<uint64_t> points = image_sets.points_seen_by(images);
+        end = std::chrono::high_resolution_clock::now();
+        printf("Finding %lu points seen by %lu images took: %f ms\n", (unsigned long)points.size(), (unsigned long)images.size(),
+               std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    in_dense.open(name_file_dense, std::ios::in | std::ios::binary);
+    in_dense_meta.open(name_file_dense + ".meta", std::ios::in | std::ios::binary);
+
+    if(in_dense.is_open())
+    {
+        lamure::prov::DenseCache cache_dense_columns(in_dense, in_dense_meta);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        cache_dense_columns.cache_columns();
+        auto end = std::chrono::high_resolution_clock::now();
+        printf("Caching dense data into columns took: %f ms\n", std::chrono::duration<double, std::milli>(end - start).count());
+        in_dense.close();
+        in_dense_meta.close();
+    }
+
+    if(cmd_option_exists(argv, argv + argc, "-c"))
+    {
+        lamure::prov::DenseCache cache_dense_mapped;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        cache_dense_mapped.map_columns(string(get_cmd_option(argv, argv + argc, "-c")));
+        auto end = std::chrono::high_resolution_clock::now();
+        printf("Mapping columnar dense data took: %f ms\n", std::chrono::duration<double, std::milli>(end - start).count());
     }
 
     in_dense.open(name_file_dense, std::ios::in | std::ios::binary);
@@ -102,6 +153,24 @@ int main(int argc, char *argv[])
 
     in_dense.close();
 
+    const lamure::prov::SparseOctree::Sort sorts[] = {lamure::prov::SparseOctree::STD_SORT, lamure::prov::SparseOctree::BOOST_SPREADSORT, lamure::prov::SparseOctree::PDQ_SORT,
+                                                      lamure::prov::SparseOctree::MORTON_RADIX_SORT};
+    const char *sort_names[] = {"STD_SORT", "BOOST_SPREADSORT", "PDQ_SORT", "MORTON_RADIX_SORT"};
+
+    for(int i = 0; i < 4; i++)
+    {
+        lamure::prov::SparseOctree::Builder sort_builder(cache_dense);
+        sort_builder.with_sort(sorts[i]);
+        sort_builder.with_max_depth(10);
+        sort_builder.with_min_per_node(8);
+        sort_builder.with_cubic_nodes(true);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        lamure::prov::SparseOctree sort_octree = sort_builder.build();
+        auto end = std::chrono::high_resolution_clock::now();
+        printf("\nSparse octree creation with %s took: %f ms\n", sort_names[i], std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
     auto start = std::chrono::high_resolution_clock::now();
     lamure::prov::SparseOctree::Builder builder(cache_dense);
 
@@ -0,0 +1,85 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <chrono>
+#include <lamure/prov/common.h>
+#include <lamure/prov/columnar_store.h>
+#include <lamure/prov/dense_cache.h>
+
+using namespace std;
+
+char *get_cmd_option(char **begin, char **end, const string &option)
+{
+    char **it = find(begin, end, option);
+    if(it != end && ++it != end)
+        return *it;
+    return 0;
+}
+
+bool cmd_option_exists(char **begin, char **end, const string &option) { return find(begin, end, option) != end; }
+bool check_file_extensions(string name_file, const char *pext)
+{
+    string ext(pext);
+    if(name_file.size() < ext.size() || name_file.substr(name_file.size() - ext.size()).compare(ext) != 0)
+    {
+        cout << "Please specify " + ext + " file as input" << endl;
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc == 1 || !cmd_option_exists(argv, argv + argc, "-d"))
+    {
+        cout << "Usage: " << argv[0] << " -d <project>.dense.prov [-o <project>.dense.prov.col] [-c <points per chunk>]" << endl << endl;
+        return -1;
+    }
+
+    string name_file_dense = string(get_cmd_option(argv, argv + argc, "-d"));
+    string name_file_columns = name_file_dense + ".col";
+    if(cmd_option_exists(argv, argv + argc, "-o"))
+    {
+        name_file_columns = string(get_cmd_option(argv, argv + argc, "-o"));
+    }
+    uint64_t points_per_chunk = 1 << 22;
+    if(cmd_option_exists(argv, argv + argc, "-c"))
+    {
+        points_per_chunk = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-c")));
+    }
+
+    if(check_file_extensions(name_file_dense, ".prov"))
+    {
+        throw std::runtime_error("File format is incompatible");
+    }
+
+    std::ifstream in_dense(name_file_dense, std::ios::in | std::ios::binary);
+    std::ifstream in_dense_meta(name_file_dense + ".meta", std::ios::in | std::ios::binary);
+
+    if(!in_dense.is_open() || !in_dense_meta.is_open())
+    {
+        cout << "Unable to open " << name_file_dense << " or its .meta file" << endl;
+        return -1;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    lamure::prov::ColumnarStore::convert(in_dense, in_dense_meta, name_file_columns, points_per_chunk);
+    auto end = std::chrono::high_resolution_clock::now();
+    printf("Conversion to %s took: %f ms\n", name_file_columns.c_str(), std::chrono::duration<double, std::milli>(end - start).count());
+
+    in_dense.close();
+    in_dense_meta.close();
+
+    lamure::prov::DenseCache cache_dense;
+
+    start = std::chrono::high_resolution_clock::now();
+    cache_dense.map_columns(name_file_columns);
+    end = std::chrono::high_resolution_clock::now();
+    printf("Mapping %lu points took: %f ms\n", (unsigned long)cache_dense.get_store().size(), std::chrono::duration<double, std::milli>(end - start).count());
+
+    return 0;
+}
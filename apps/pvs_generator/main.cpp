@@ -15,6 +15,7 @@
 #include <lamure/pvs/visibility_test_id_histogram_renderer.h>
 #include <lamure/pvs/visibility_test_id_histogram_renderer_corners.h>
 #include <lamure/pvs/visibility_test_simple_randomized_id_histogram_renderer.h>
+#include <lamure/pvs/visibility_test_software_rasterizer.h>
 
 #include <lamure/pvs/grid.h>
 #include <lamure/pvs/grid_octree.h>
@@ -55,6 +56,7 @@ int main(int argc, char** argv)
     unsigned int num_steps = 11;
     double oversize_factor = 1.5;
     float optimization_threshold = 1.0f;
+    unsigned int optimization_minhash_size = 0;
 
     namespace po = boost::program_options;
     namespace fs = boost::filesystem;
@@ -70,11 +72,12 @@ int main(int argc, char** argv)
                                "Allowed Options");
     desc.add_options()
       ("pvs-file,p", po::value<std::string>(&pvs_output_file_path), "specify output file of calculated pvs data (.pvs)")
-      ("vistest", po::value<std::string>(&visibility_test_type)->default_value("hrc"), "specify type of visibility test to be used. Default is histogram renderer with corners. (histogram renderer 'hr', histogram renderer with corners 'hrc', simple randomized histogram renderer 'srhr')")
+      ("vistest", po::value<std::string>(&visibility_test_type)->default_value("hrc"), "specify type of visibility test to be used. Default is histogram renderer with corners. (histogram renderer 'hr', histogram renderer with corners 'hrc', simple randomized histogram renderer 'srhr', software rasterizer without OpenGL 'sr')")
       ("gridtype", po::value<std::string>(&grid_type)->default_value("irregular_compressed"), "specify type of grid to store visibility data. Default is irregular compressed grid. ('regular', 'regular_compressed', 'irregular', 'irregular_compressed', octree', 'octree_compressed', octree_hierarchical', 'octree_hierarchical_v2', 'octree_hierarchical_v3')")
       ("gridsize", po::value<unsigned int>(&grid_size)->default_value(1), "specify size/depth of the grid used for the visibility test (depends on chosen grid type)")
       ("oversize", po::value<double>(&oversize_factor)->default_value(1.5), "factor the grid bounds will be scaled by. Default is 1.5 (so grid bounds will exceed scene bounds by factor of 1.5)")
       ("optithresh", po::value<float>(&optimization_threshold)->default_value(-1.0f), "specify the threshold at which common data are converged (percent value between 0 and 1). Negative values will deactivate optimization process. Default value is -1.0, so grid optimization is deactivated.")
+      ("optiminhash", po::value<unsigned int>(&optimization_minhash_size)->default_value(0), "specify the number of MinHash values per view cell used to skip dissimilar cells during optimization of irregular grids. Faster on large grids, but may miss a few joins. Default value is 0, so the pre-filter is deactivated.")
       ("numsteps,n", po::value<unsigned int>(&num_steps)->default_value(11), "specify the number of intervals the occlusion values will be split into (visibility analysis only). Default value is 11.");
       ;
 
@@ -106,6 +109,10 @@ int main(int argc, char** argv)
     {
         vt = new lamure::pvs::visibility_test_simple_randomized_id_histogram_renderer();
     }
+    else if(visibility_test_type == "sr")
+    {
+        vt = new lamure::pvs::visibility_test_software_rasterizer();
+    }
     else
     {
         std::cout << "Invalid visibility test: " << visibility_test_type << ".\n" << desc;
@@ -224,6 +231,7 @@ int main(int argc, char** argv)
             grid_type == lamure::pvs::grid_irregular_compressed::get_grid_identifier())
         {
             lamure::pvs::grid_optimizer_irregular optimizer;
+            optimizer.set_minhash_signature_size(optimization_minhash_size);
             optimizer.optimize_grid(test_grid, optimization_threshold);
         }
 
@@ -38,6 +38,7 @@ int main(int argc, char** argv)
     std::string pvs_output_file_path = "";
     std::string output_grid_type = "";
     float optimization_threshold = 1.0f;
+    unsigned int optimization_minhash_size = 0;
 
     namespace po = boost::program_options;
     namespace fs = boost::filesystem;
@@ -55,7 +56,8 @@ int main(int argc, char** argv)
       ("2nd-pvs-file", po::value<std::string>(&second_pvs_input_file_path), "(optional) specify second input file of calculated pvs data (.pvs) to join visibility with first pvs file")
       ("output-file", po::value<std::string>(&pvs_output_file_path), "specify output file of converted visibility data (.pvs)")
       ("gridtype", po::value<std::string>(&output_grid_type), "specify type of grid to store visibility data. If no grid type is given, the input grid type will be used. ('regular', 'regular_compressed', 'irregular', 'irregular_compressed', octree', 'octree_compressed', octree_hierarchical', 'octree_hierarchical_v2', 'octree_hierarchical_v3')")
-      ("optithresh", po::value<float>(&optimization_threshold)->default_value(-1.0f), "specify the threshold at which common data are converged (percent value between 0 and 1). Negative values will deactivate optimization process. Default value is -1.0, so grid optimization is deactivated.");
+      ("optithresh", po::value<float>(&optimization_threshold)->default_value(-1.0f), "specify the threshold at which common data are converged (percent value between 0 and 1). Negative values will deactivate optimization process. Default value is -1.0, so grid optimization is deactivated.")
+      ("optiminhash", po::value<unsigned int>(&optimization_minhash_size)->default_value(0), "specify the number of MinHash values per view cell used to skip dissimilar cells during optimization of irregular grids. Faster on large grids, but may miss a few joins. Default value is 0, so the pre-filter is deactivated.");
       ;
 
     po::variables_map vm;
@@ -295,6 +297,7 @@ int main(int argc, char** argv)
             output_grid_type == lamure::pvs::grid_irregular_compressed::get_grid_identifier())
         {
             lamure::pvs::grid_optimizer_irregular optimizer;
+            optimizer.set_minhash_signature_size(optimization_minhash_size);
             optimizer.optimize_grid(output_grid, optimization_threshold);
         }
 
@@ -0,0 +1,232 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <lamure/pvs/pvs_database.h>
+#include <lamure/pvs/grid.h>
+#include <lamure/pvs/grid_regular.h>
+#include <lamure/pvs/grid_octree.h>
+#include <lamure/pvs/grid_octree_hierarchical_v3.h>
+#include <lamure/pvs/grid_irregular.h>
+
+#include <boost/program_options.hpp>
+
+// measures the cost of grid::get_cell_at_position, which the pvs_database
+// calls whenever the viewer moves. synthetic grids of the different types
+// are created (or a grid file is loaded) and queried with random positions
+// and with a coherent viewer path.
+
+double const elapsed_ms(std::chrono::high_resolution_clock::time_point const &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+std::vector<scm::math::vec3d> const generate_random_positions(const lamure::pvs::grid *grid, unsigned int const num_positions)
+{
+    std::mt19937 generator(1337);
+    std::uniform_real_distribution<double> distribution(-0.55, 0.55);
+
+    scm::math::vec3d center = grid->get_position_center();
+    scm::math::vec3d size = grid->get_size();
+
+    // roughly 25% of the positions are outside of the grid
+    std::vector<scm::math::vec3d> positions;
+    positions.reserve(num_positions);
+
+    for(unsigned int i = 0; i < num_positions; ++i)
+    {
+        positions.push_back(scm::math::vec3d(center.x + size.x * distribution(generator),
+                                             center.y + size.y * distribution(generator),
+                                             center.z + size.z * distribution(generator)));
+    }
+
+    return positions;
+}
+
+std::vector<scm::math::vec3d> const generate_viewer_path(const lamure::pvs::grid *grid, unsigned int const num_positions)
+{
+    std::mt19937 generator(4711);
+    std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+
+    scm::math::vec3d center = grid->get_position_center();
+    scm::math::vec3d size = grid->get_size();
+    double step = std::min(size.x, std::min(size.y, size.z)) * 0.0005;
+
+    std::vector<scm::math::vec3d> positions;
+    positions.reserve(num_positions);
+
+    scm::math::vec3d position = center;
+    scm::math::vec3d velocity(step, 0.0, 0.0);
+
+    for(unsigned int i = 0; i < num_positions; ++i)
+    {
+        velocity = velocity + scm::math::vec3d(distribution(generator), distribution(generator), distribution(generator)) * (step * 0.1);
+        position = position + velocity;
+
+        // bounce off the grid bounds
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            double half_size = size[axis] * 0.5;
+            if(position[axis] < center[axis] - half_size || position[axis] > center[axis] + half_size)
+            {
+                velocity[axis] = -velocity[axis];
+                position[axis] = std::max(center[axis] - half_size, std::min(center[axis] + half_size, position[axis]));
+            }
+        }
+
+        positions.push_back(position);
+    }
+
+    return positions;
+}
+
+void benchmark_grid(const std::string &name, const lamure::pvs::grid *grid, unsigned int const num_lookups)
+{
+    std::vector<scm::math::vec3d> const random_positions = generate_random_positions(grid, num_lookups);
+    std::vector<scm::math::vec3d> const path_positions = generate_viewer_path(grid, num_lookups);
+
+    const std::vector<scm::math::vec3d> *position_sets[2] = {&random_positions, &path_positions};
+    const char *set_names[2] = {"random", "path"};
+
+    for(size_t set_index = 0; set_index < 2; ++set_index)
+    {
+        size_t num_found = 0;
+        size_t checksum = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for(const auto &position : *position_sets[set_index])
+        {
+            size_t cell_index = 0;
+            if(grid->get_cell_at_position(position, &cell_index) != nullptr)
+            {
+                ++num_found;
+                checksum += cell_index;
+            }
+        }
+        double lookup_ms = elapsed_ms(start);
+
+        std::cout << std::setw(28) << std::left << name << std::setw(8) << set_names[set_index] << std::right
+                  << std::setw(16) << num_lookups / lookup_ms * 1000.0 << " lookups/s  "
+                  << std::setw(10) << lookup_ms * 1000000.0 / num_lookups << " ns/lookup  "
+                  << "(" << grid->get_cell_count() << " cells, " << num_found << " inside, checksum " << checksum << ")" << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    const std::string exec_name = (argc > 0) ? std::string(argv[0]) : "";
+
+    std::string grid_file_path = "";
+    unsigned int num_cells;
+    unsigned int octree_depth;
+    unsigned int num_joins;
+    unsigned int num_lookups;
+
+    po::options_description desc("Usage: " + exec_name + " [OPTION]...\n\n"
+                                 "Allowed Options");
+    desc.add_options()
+      ("help", "print help message")
+      ("grid-file,g", po::value<std::string>(&grid_file_path), "specify a .grid file to benchmark instead of the synthetic grids")
+      ("cells,c", po::value<unsigned>(&num_cells)->default_value(32), "specify number of cells per axis of the regular and irregular grids (default=32)")
+      ("octree-depth,d", po::value<unsigned>(&octree_depth)->default_value(6), "specify depth of the octree grids (default=6)")
+      ("joins,j", po::value<unsigned>(&num_joins)->default_value(1000), "specify number of random cell joins applied to the irregular grid (default=1000)")
+      ("lookups,n", po::value<unsigned>(&num_lookups)->default_value(1000000), "specify number of lookups per grid and position set (default=1000000)");
+
+    po::variables_map vm;
+
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+        po::notify(vm);
+    }
+    catch(std::exception &e)
+    {
+        std::cout << e.what() << std::endl << desc;
+        return -1;
+    }
+
+    if(vm.count("help") || num_lookups == 0 || num_cells == 0 || octree_depth == 0)
+    {
+        std::cout << desc;
+        return 0;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+
+    lamure::pvs::pvs_database *database = lamure::pvs::pvs_database::get_instance();
+
+    if(!grid_file_path.empty())
+    {
+        lamure::pvs::grid *grid = database->load_grid_from_file(grid_file_path);
+
+        if(grid == nullptr)
+        {
+            std::cout << "Error loading grid: " << grid_file_path << std::endl;
+            return -1;
+        }
+
+        benchmark_grid(grid->get_grid_type(), grid, num_lookups);
+        delete grid;
+
+        return 0;
+    }
+
+    // the grids only answer lookups, so a single model without nodes is sufficient
+    std::vector<lamure::node_t> ids(1, 1);
+    const double bounds_size = 100.0;
+    const scm::math::vec3d position_center(0.0, 0.0, 0.0);
+
+    {
+        lamure::pvs::grid *grid = database->create_grid_by_type(lamure::pvs::grid_regular::get_grid_identifier(), num_cells, num_cells, num_cells, bounds_size, position_center, ids);
+        benchmark_grid(grid->get_grid_type(), grid, num_lookups);
+        delete grid;
+    }
+
+    {
+        lamure::pvs::grid_irregular *grid = (lamure::pvs::grid_irregular *)database->create_grid_by_type(
+            lamure::pvs::grid_irregular::get_grid_identifier(), num_cells, num_cells, num_cells, bounds_size, position_center, ids);
+        benchmark_grid(grid->get_grid_type(), grid, num_lookups);
+
+        // join random pairs of cells, lookups then have to be resolved to managing cells
+        std::mt19937 generator(42);
+        for(unsigned int join_index = 0; join_index < num_joins && grid->get_cell_count() > 1; ++join_index)
+        {
+            std::uniform_int_distribution<size_t> distribution(0, grid->get_cell_count() - 1);
+            size_t index_one = distribution(generator);
+            size_t index_two = distribution(generator);
+
+            if(index_one != index_two)
+            {
+                grid->join_cells(index_one, index_two, 0.0f, 0.0f);
+            }
+        }
+
+        benchmark_grid(grid->get_grid_type() + " (joined)", grid, num_lookups);
+        delete grid;
+    }
+
+    const std::string octree_types[2] = {lamure::pvs::grid_octree::get_grid_identifier(), lamure::pvs::grid_octree_hierarchical_v3::get_grid_identifier()};
+
+    for(const auto &grid_type : octree_types)
+    {
+        // octree grids take their depth as the number of cells
+        lamure::pvs::grid *grid = database->create_grid_by_type(grid_type, octree_depth, octree_depth, octree_depth, bounds_size, position_center, ids);
+        benchmark_grid(grid->get_grid_type(), grid, num_lookups);
+        delete grid;
+    }
+
+    return 0;
+}
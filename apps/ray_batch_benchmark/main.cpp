@@ -0,0 +1,367 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lamure/types.h>
+
+#include <lamure/ren/bvh.h>
+#include <lamure/ren/controller.h>
+#include <lamure/ren/model_database.h>
+#include <lamure/ren/ooc_cache.h>
+#include <lamure/ren/policy.h>
+#include <lamure/ren/ray.h>
+#include <lamure/ren/ray_pool.h>
+
+#include <scm/core.h>
+#include <scm/core/math.h>
+
+#include <boost/program_options.hpp>
+
+// headless throughput benchmark for ray::intersect_batch. the upper levels
+// of every model are loaded into the ooc_cache, then a large set of rays is
+// cast either as lidar-like scans from random sensor positions (coherent)
+// or between random points in the scene (incoherent). a subset of the rays
+// is cast one by one with ray::intersect_model as a baseline.
+
+std::vector<std::string> const parse_model_list_file(std::string const &model_list_file_path)
+{
+    std::ifstream model_list_file(model_list_file_path);
+
+    if(!model_list_file.is_open())
+    {
+        throw std::runtime_error("lamure: ray_batch_benchmark::Unable to open model list file: " + model_list_file_path);
+    }
+
+    std::vector<std::string> model_filenames;
+    std::string one_line;
+
+    while(std::getline(model_list_file, one_line))
+    {
+        std::istringstream model_ss(one_line);
+        std::string model_path;
+        model_ss >> model_path;
+
+        if(model_path.size() < 2 || model_path.substr(0, 2) == "//")
+        {
+            continue;
+        }
+
+        model_filenames.push_back(model_path);
+    }
+
+    return model_filenames;
+}
+
+double const elapsed_ms(std::chrono::high_resolution_clock::time_point const &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// registers all nodes down to resident_depth with the ooc_cache and
+// aquires them once loaded, returns the number of aquired nodes
+size_t const load_resident_nodes(lamure::context_t const context_id, lamure::view_t const view_id, unsigned int const resident_depth)
+{
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+    lamure::ren::ooc_cache *ooc_cache = lamure::ren::ooc_cache::get_instance();
+
+    std::vector<std::pair<lamure::model_t, lamure::node_t>> pending;
+    for(lamure::model_t model_id = 0; model_id < database->num_models(); ++model_id)
+    {
+        const lamure::ren::bvh *bvh = database->get_model(model_id)->get_bvh();
+        uint32_t depth = std::min((uint32_t)resident_depth, bvh->get_depth());
+        lamure::node_t num_nodes = bvh->get_first_node_id_of_depth(depth) + bvh->get_length_of_depth(depth);
+
+        for(lamure::node_t node_id = 0; node_id < num_nodes; ++node_id)
+        {
+            pending.push_back(std::make_pair(model_id, node_id));
+        }
+    }
+
+    size_t num_aquired = 0;
+
+    while(!pending.empty())
+    {
+        std::vector<std::pair<lamure::model_t, lamure::node_t>> remaining;
+
+        ooc_cache->lock();
+        ooc_cache->refresh();
+
+        for(const auto &node : pending)
+        {
+            if(ooc_cache->is_node_resident(node.first, node.second))
+            {
+                ooc_cache->aquire_node(context_id, view_id, node.first, node.second);
+                ++num_aquired;
+            }
+            else if(ooc_cache->num_free_slots() > 0)
+            {
+                ooc_cache->register_node(node.first, node.second, 0);
+                remaining.push_back(node);
+            }
+        }
+
+        ooc_cache->unlock();
+
+        pending.swap(remaining);
+
+        if(!pending.empty())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    return num_aquired;
+}
+
+scm::gl::boxf const scene_bounding_box()
+{
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+
+    scm::math::vec3f scene_min(std::numeric_limits<float>::max());
+    scm::math::vec3f scene_max(std::numeric_limits<float>::lowest());
+
+    for(lamure::model_t model_id = 0; model_id < database->num_models(); ++model_id)
+    {
+        const scm::gl::boxf &box = database->get_model(model_id)->get_bvh()->get_bounding_box(0);
+        const scm::math::mat4f &model_transform = database->get_model(model_id)->transform();
+
+        for(int corner = 0; corner < 8; ++corner)
+        {
+            scm::math::vec3f p((corner & 1) ? box.max_vertex().x : box.min_vertex().x,
+                               (corner & 2) ? box.max_vertex().y : box.min_vertex().y,
+                               (corner & 4) ? box.max_vertex().z : box.min_vertex().z);
+            p = model_transform * p;
+
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                scene_min[axis] = std::min(scene_min[axis], p[axis]);
+                scene_max[axis] = std::max(scene_max[axis], p[axis]);
+            }
+        }
+    }
+
+    return scm::gl::boxf(scene_min, scene_max);
+}
+
+// full turn scans of +-30 degrees elevation, rays of one scan line are adjacent
+std::vector<lamure::ren::ray> const generate_sensor_rays(size_t const num_rays, scm::gl::boxf const &scene, float const range)
+{
+    std::mt19937 generator(1337);
+    std::uniform_real_distribution<float> distribution(0.f, 1.f);
+
+    const unsigned int num_columns = 1024;
+    const unsigned int num_lines = 64;
+    const float pi = 3.1415926535f;
+
+    scm::math::vec3f extent = scene.max_vertex() - scene.min_vertex();
+
+    std::vector<lamure::ren::ray> rays;
+    rays.reserve(num_rays);
+
+    while(rays.size() < num_rays)
+    {
+        scm::math::vec3f sensor =
+            scene.min_vertex() + scm::math::vec3f(extent.x * distribution(generator), extent.y * distribution(generator), extent.z * distribution(generator));
+
+        for(unsigned int line = 0; line < num_lines && rays.size() < num_rays; ++line)
+        {
+            float elevation = (-30.f + 60.f * line / (float)(num_lines - 1)) * pi / 180.f;
+
+            for(unsigned int column = 0; column < num_columns && rays.size() < num_rays; ++column)
+            {
+                float azimuth = 2.f * pi * column / (float)num_columns;
+                scm::math::vec3f direction(std::cos(elevation) * std::cos(azimuth), std::sin(elevation), std::cos(elevation) * std::sin(azimuth));
+                rays.push_back(lamure::ren::ray(sensor, direction, range));
+            }
+        }
+    }
+
+    return rays;
+}
+
+std::vector<lamure::ren::ray> const generate_random_rays(size_t const num_rays, scm::gl::boxf const &scene, float const range)
+{
+    std::mt19937 generator(1337);
+    std::uniform_real_distribution<float> distribution(0.f, 1.f);
+
+    scm::math::vec3f extent = scene.max_vertex() - scene.min_vertex();
+
+    std::vector<lamure::ren::ray> rays;
+    rays.reserve(num_rays);
+
+    while(rays.size() < num_rays)
+    {
+        scm::math::vec3f from =
+            scene.min_vertex() + scm::math::vec3f(extent.x * distribution(generator), extent.y * distribution(generator), extent.z * distribution(generator));
+        scm::math::vec3f to =
+            scene.min_vertex() + scm::math::vec3f(extent.x * distribution(generator), extent.y * distribution(generator), extent.z * distribution(generator));
+
+        if(scm::math::length(to - from) <= 0.f)
+        {
+            continue;
+        }
+
+        rays.push_back(lamure::ren::ray(from, scm::math::normalize(to - from), range));
+    }
+
+    return rays;
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    const std::string exec_name = (argc > 0) ? std::string(argv[0]) : "";
+    scm::shared_ptr<scm::core> scm_core(new scm::core(1, argv));
+
+    std::string model_list_file_path = "";
+    std::vector<std::string> model_filenames;
+    std::string mode = "";
+    unsigned int main_memory_budget;
+    unsigned int resident_depth;
+    unsigned int num_rays;
+    unsigned int num_baseline_rays;
+    unsigned int max_depth;
+    unsigned int surfel_skip;
+    float range;
+
+    po::options_description desc("Usage: " + exec_name + " [OPTION]... INPUT.bvh...\n\n"
+                                 "Allowed Options");
+    desc.add_options()
+      ("help", "print help message")
+      ("input,i", po::value<std::vector<std::string>>(&model_filenames), "specify .bvh input-file(s)")
+      ("model-list,f", po::value<std::string>(&model_list_file_path), "specify file listing one .bvh input-file per line")
+      ("mem,m", po::value<unsigned>(&main_memory_budget)->default_value(4096), "specify main memory budget in MB (default=4096)")
+      ("resident-depth,d", po::value<unsigned>(&resident_depth)->default_value(6), "specify depth down to which nodes are loaded (default=6)")
+      ("rays,n", po::value<unsigned>(&num_rays)->default_value(1000000), "specify number of rays (default=1000000)")
+      ("baseline,b", po::value<unsigned>(&num_baseline_rays)->default_value(10000), "specify number of rays cast one by one, 0 to skip (default=10000)")
+      ("mode", po::value<std::string>(&mode)->default_value("sensor"), "specify ray distribution: sensor, random (default=sensor)")
+      ("range,r", po::value<float>(&range)->default_value(0.f), "specify maximum ray distance, 0 for the scene diagonal (default=0)")
+      ("max-depth", po::value<unsigned>(&max_depth)->default_value(0), "specify maximum traversal depth, 0 for unlimited (default=0)")
+      ("surfel-skip", po::value<unsigned>(&surfel_skip)->default_value(1), "specify surfel stride during intersection (default=1)");
+
+    po::positional_options_description p;
+    p.add("input", -1);
+
+    po::variables_map vm;
+
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+        po::notify(vm);
+    }
+    catch(std::exception &e)
+    {
+        std::cout << e.what() << std::endl << desc;
+        return -1;
+    }
+
+    if(!model_list_file_path.empty())
+    {
+        std::vector<std::string> listed_filenames = parse_model_list_file(model_list_file_path);
+        model_filenames.insert(model_filenames.end(), listed_filenames.begin(), listed_filenames.end());
+    }
+
+    if(vm.count("help") || model_filenames.empty() || num_rays == 0)
+    {
+        std::cout << desc;
+        return 0;
+    }
+
+    if(mode != "sensor" && mode != "random")
+    {
+        std::cout << "unknown mode " << mode << std::endl << desc;
+        return -1;
+    }
+
+    lamure::ren::policy *policy = lamure::ren::policy::get_instance();
+    policy->set_out_of_core_budget_in_mb(std::max(main_memory_budget, 1u));
+
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+    lamure::ren::controller *controller = lamure::ren::controller::get_instance();
+
+    std::vector<std::string> model_keys;
+    for(size_t i = 0; i < model_filenames.size(); ++i)
+    {
+        model_keys.push_back(std::to_string(i));
+    }
+    database->add_models(model_filenames, model_keys);
+
+    controller->reset_system();
+
+    lamure::context_t context_id = controller->deduce_context_id(0);
+    lamure::view_t view_id = controller->deduce_view_id(context_id, 0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t num_resident = load_resident_nodes(context_id, view_id, resident_depth);
+    double load_ms = elapsed_ms(start);
+
+    scm::gl::boxf const scene = scene_bounding_box();
+    if(range <= 0.f)
+    {
+        range = scm::math::length(scene.max_vertex() - scene.min_vertex());
+    }
+
+    std::vector<lamure::ren::ray> const rays = mode == "sensor" ? generate_sensor_rays(num_rays, scene, range) : generate_random_rays(num_rays, scene, range);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "models: " << database->num_models() << std::endl;
+    std::cout << "resident nodes: " << num_resident << " (loaded in " << load_ms << " ms)" << std::endl;
+    std::cout << "ray pool threads: " << lamure::ren::ray_pool::get_instance()->num_threads() << std::endl;
+    std::cout << "rays: " << rays.size() << " (" << mode << ", range " << range << ")" << std::endl;
+
+    std::vector<lamure::ren::ray::intersection> intersections;
+    std::vector<uint8_t> hits;
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t num_hits = lamure::ren::ray::intersect_batch(rays, max_depth, surfel_skip, false, intersections, hits);
+    double batch_ms = elapsed_ms(start);
+
+    std::cout << "batch: " << rays.size() / batch_ms * 1000.0 << " rays/s (" << batch_ms << " ms, " << num_hits << " hits)" << std::endl;
+
+    num_baseline_rays = std::min(num_baseline_rays, (unsigned int)rays.size());
+    if(num_baseline_rays > 0)
+    {
+        size_t num_baseline_hits = 0;
+
+        start = std::chrono::high_resolution_clock::now();
+        for(unsigned int i = 0; i < num_baseline_rays; ++i)
+        {
+            lamure::ren::ray ray = rays[i];
+            lamure::ren::ray::intersection intersection;
+            bool hit = false;
+
+            for(lamure::model_t model_id = 0; model_id < database->num_models(); ++model_id)
+            {
+                const scm::math::mat4f &model_transform = database->get_model(model_id)->transform();
+                hit |= ray.intersect_model(model_id, model_transform, 1.0f, max_depth, surfel_skip, false, intersection);
+            }
+
+            if(hit)
+            {
+                ++num_baseline_hits;
+            }
+        }
+        double baseline_ms = elapsed_ms(start);
+
+        std::cout << "one by one: " << num_baseline_rays / baseline_ms * 1000.0 << " rays/s (" << baseline_ms << " ms, " << num_baseline_hits << " hits)" << std::endl;
+    }
+
+    return 0;
+}
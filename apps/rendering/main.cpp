@@ -158,6 +158,7 @@ int main(int argc, char** argv)
       ("resource-file,f", po::value<std::string>(&resource_file_path), "specify resource input-file")
       ("vram,v", po::value<unsigned>(&video_memory_budget)->default_value(2048), "specify graphics memory budget in MB (default=2048)")
       ("mem,m", po::value<unsigned>(&main_memory_budget)->default_value(4096), "specify main memory budget in MB (default=4096)")
+      ("mmap", "serve out-of-core data from read-only mappings of the .lod/.prov files, shared with other render processes")
       ("upload,u", po::value<unsigned>(&max_upload_budget)->default_value(64), "specify maximum video memory upload budget per frame in MB (default=64)")
       ("measurement-file", po::value<std::string>(&measurement_file_path)->default_value(""), "specify camera session for quality measurement_file (default = \"\")")
       ("measurement-interpolate", po::value<bool>(&measurement_file_interpolation)->default_value(false), "allow interpolation between measurement transformations (default=false)")
@@ -257,6 +258,7 @@ int main(int argc, char** argv)
     policy->set_max_upload_budget_in_mb(max_upload_budget); //8
     policy->set_render_budget_in_mb(video_memory_budget); //2048
     policy->set_out_of_core_budget_in_mb(main_memory_budget); //4096, 8192
+    policy->set_out_of_core_memory_mapped(vm.count("mmap") > 0);
     policy->set_window_width(window_width);
     policy->set_window_height(window_height);
 
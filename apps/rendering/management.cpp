@@ -61,11 +61,13 @@ management::management(std::vector<std::string> const &model_filenames, std::vec
     lamure::model_t model_id = database->add_model(model_filenames_[0], std::to_string(num_models_));
     ++num_models_;
 #else
-    for(const auto &filename : model_filenames_)
+    std::vector<std::string> model_keys;
+    for(size_t i = 0; i < model_filenames_.size(); ++i)
     {
-        lamure::model_t model_id = database->add_model(filename, std::to_string(num_models_));
+        model_keys.push_back(std::to_string(num_models_));
         ++num_models_;
     }
+    database->add_models(model_filenames_, model_keys);
 #endif
 
     {
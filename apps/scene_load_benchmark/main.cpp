@@ -0,0 +1,183 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <lamure/types.h>
+
+#include <lamure/ren/bvh.h>
+#include <lamure/ren/controller.h>
+#include <lamure/ren/model_database.h>
+
+#include <scm/core.h>
+
+#include <boost/program_options.hpp>
+
+// measures how long it takes until a scene is registered with the
+// model_database, i.e. the startup cost before the first frame.
+// the .bvh files are first parsed on their own to separate file decoding
+// from registration, then the scene is loaded either model by model
+// or with a single batch call.
+
+std::vector<std::string> const parse_model_list_file(std::string const &model_list_file_path)
+{
+    std::ifstream model_list_file(model_list_file_path);
+
+    if(!model_list_file.is_open())
+    {
+        throw std::runtime_error("lamure: scene_load_benchmark::Unable to open model list file: " + model_list_file_path);
+    }
+
+    std::vector<std::string> model_filenames;
+    std::string one_line;
+
+    while(std::getline(model_list_file, one_line))
+    {
+        std::istringstream model_ss(one_line);
+        std::string model_path;
+        model_ss >> model_path;
+
+        if(model_path.size() < 2 || model_path.substr(0, 2) == "//")
+        {
+            continue;
+        }
+
+        model_filenames.push_back(model_path);
+    }
+
+    return model_filenames;
+}
+
+double const elapsed_ms(std::chrono::high_resolution_clock::time_point const &start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    namespace po = boost::program_options;
+
+    const std::string exec_name = (argc > 0) ? std::string(argv[0]) : "";
+    scm::shared_ptr<scm::core> scm_core(new scm::core(1, argv));
+
+    std::string model_list_file_path = "";
+    std::vector<std::string> model_filenames;
+    std::string mode = "";
+    unsigned int parse_runs;
+
+    po::options_description desc("Usage: " + exec_name + " [OPTION]... INPUT.bvh...\n\n"
+                                 "Allowed Options");
+    desc.add_options()
+      ("help", "print help message")
+      ("input,i", po::value<std::vector<std::string>>(&model_filenames), "specify .bvh input-file(s)")
+      ("model-list,f", po::value<std::string>(&model_list_file_path), "specify file listing one .bvh input-file per line")
+      ("mode,m", po::value<std::string>(&mode)->default_value("batch"), "specify how models are registered: batch, sequential (default=batch)")
+      ("parse-runs,r", po::value<unsigned>(&parse_runs)->default_value(1), "specify number of parse-only passes over all files (default=1)");
+
+    po::positional_options_description p;
+    p.add("input", -1);
+
+    po::variables_map vm;
+
+    try
+    {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+        po::notify(vm);
+    }
+    catch(std::exception &e)
+    {
+        std::cout << e.what() << std::endl << desc;
+        return -1;
+    }
+
+    if(!model_list_file_path.empty())
+    {
+        std::vector<std::string> listed_filenames = parse_model_list_file(model_list_file_path);
+        model_filenames.insert(model_filenames.end(), listed_filenames.begin(), listed_filenames.end());
+    }
+
+    if(vm.count("help") || model_filenames.empty())
+    {
+        std::cout << desc;
+        return 0;
+    }
+
+    if(mode != "batch" && mode != "sequential")
+    {
+        std::cout << "unknown mode " << mode << std::endl << desc;
+        return -1;
+    }
+
+    std::cout << "models: " << model_filenames.size() << std::endl;
+
+    // parse only, nothing is registered
+    size_t num_nodes = 0;
+    double parse_ms = 0.0;
+
+    for(unsigned int run = 0; run < parse_runs; ++run)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        num_nodes = 0;
+
+        for(const auto &model_filename : model_filenames)
+        {
+            lamure::ren::bvh bvh(model_filename);
+            num_nodes += bvh.get_num_nodes();
+        }
+
+        parse_ms += elapsed_ms(start);
+    }
+
+    parse_ms /= std::max(parse_runs, 1u);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "nodes: " << num_nodes << std::endl;
+    std::cout << "parse: " << parse_ms << " ms (" << (parse_ms > 0.0 ? num_nodes / parse_ms * 1000.0 : 0.0) << " nodes/s)" << std::endl;
+
+    // register the scene, as the renderer does at startup
+    lamure::ren::model_database *database = lamure::ren::model_database::get_instance();
+    lamure::ren::controller *controller = lamure::ren::controller::get_instance();
+
+    std::vector<std::string> model_keys;
+    for(size_t i = 0; i < model_filenames.size(); ++i)
+    {
+        model_keys.push_back(std::to_string(i));
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if(mode == "batch")
+    {
+        database->add_models(model_filenames, model_keys);
+    }
+    else
+    {
+        for(size_t i = 0; i < model_filenames.size(); ++i)
+        {
+            database->add_model(model_filenames[i], model_keys[i]);
+        }
+    }
+
+    double register_ms = elapsed_ms(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    controller->reset_system();
+    double reset_ms = elapsed_ms(start);
+
+    std::cout << "scene load (" << mode << "): " << register_ms << " ms" << std::endl;
+    std::cout << "system reset: " << reset_ms << " ms" << std::endl;
+    std::cout << "total: " << register_ms + reset_ms << " ms" << std::endl;
+
+    return 0;
+}
@@ -1297,7 +1297,7 @@ void brush() {
       if (settings_.octrees_[selection_.selected_model_]) {
         uint64_t selected_node_id = settings_.octrees_[selection_.selected_model_]->query(intersection.position_);
         if (selected_node_id > 0) {
-          const std::set<uint32_t>& imgs = settings_.octrees_[selection_.selected_model_]->get_node(selected_node_id).get_fotos();
+          const auto imgs = settings_.octrees_[selection_.selected_model_]->get_fotos(selected_node_id);
           std::cout << "found " << imgs.size() << " of " << provenance_[selection_.selected_model_].num_views_ << " imgs" << std::endl;
           //std::cout << "selected_node_id " << selected_node_id << std::endl;
           selection_.selected_views_.insert(imgs.begin(), imgs.end());
@@ -1575,15 +1575,17 @@ void create_aux_resources() {
         );
       }
 
-      for (uint32_t i = 0; i < aux.get_num_sparse_points(); ++i) {
-        const auto& point = aux.get_sparse_point(i);
-        ready_to_upload.push_back(
-          xyz{point.pos_,
-            point.r_, point.g_, point.b_, point.a_,
-            settings_.aux_point_size_,
-            scm::math::vec3f(1.0, 0.0, 0.0)} //placeholder
-        );
-      }
+      //only positions and colors are needed, the features are not kept resident
+      aux.for_each_sparse_chunk(1 << 16, [&](const lamure::prov::aux::sparse_chunk& chunk) {
+        for (const auto& point : chunk.points_) {
+          ready_to_upload.push_back(
+            xyz{point.pos_,
+              point.r_, point.g_, point.b_, point.a_,
+              settings_.aux_point_size_,
+              scm::math::vec3f(1.0, 0.0, 0.0)} //placeholder
+          );
+        }
+      });
 
       resource point_res;
       point_res.num_primitives_ = ready_to_upload.size();
@@ -7,6 +7,9 @@
 
 #include <iostream>
 #include <sstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #include <lamure/prov/common.h>
 #include <lamure/prov/dense_cache.h>
@@ -15,9 +18,10 @@
 #include <lamure/prov/sparse_octree.h>
 #include <lamure/prov/octree.h>
 
-#include <lamure/prov/3rd_party/exif.h>
+#include <lamure/prov/image_probe.h>
 
 #include <lamure/prov/aux.h>
+#include <lamure/prov/aux_stream.h>
 
 #include <scm/core/math.h>
 #include <scm/gl_core/math.h>
@@ -45,6 +49,53 @@ bool check_file_extensions(string name_file, const char *pext) {
     return false;
 }
 
+typedef std::chrono::high_resolution_clock timer;
+
+double elapsed_ms(const timer::time_point& start) {
+    return std::chrono::duration<double, std::milli>(timer::now() - start).count();
+}
+
+//takes the image dimensions from the jpeg headers, pixels are not read
+bool probe_image(const std::string& filename, lamure::prov::aux::view& v) {
+    lamure::prov::ImageInfo info;
+    if (!lamure::prov::ImageProbe::probe(filename, info)) {
+      return false;
+    }
+
+    v.image_height_ = info.height;
+    v.image_width_ = info.width;
+    //v.focal_length_ = info.focal_length * 0.001;
+    return true;
+}
+
+//parses one point line of the nvm file: x y z r g b n (camera feature x y)*n
+void parse_point(const std::string& line, lamure::prov::aux::flat_sparse_point& p, 
+  std::vector<lamure::prov::aux::feature>& features) {
+    const char* c = line.c_str();
+    char* end = nullptr;
+    p.pos_.x = strtof(c, &end); c = end;
+    p.pos_.y = strtof(c, &end); c = end;
+    p.pos_.z = strtof(c, &end); c = end;
+    p.r_ = (uint8_t)strtoul(c, &end, 10); c = end;
+    p.g_ = (uint8_t)strtoul(c, &end, 10); c = end;
+    p.b_ = (uint8_t)strtoul(c, &end, 10); c = end;
+    p.a_ = (uint8_t)255;
+    uint32_t num_measurements = (uint32_t)strtoul(c, &end, 10); c = end;
+
+    features.clear();
+    for (uint32_t j = 0; j < num_measurements; ++j) {
+      lamure::prov::aux::feature f;
+      f.camera_id_ = (uint32_t)strtoul(c, &end, 10); c = end;
+      strtoul(c, &end, 10); c = end; //feature index, ignored
+      f.coords_.x = strtof(c, &end); c = end;
+      f.coords_.y = strtof(c, &end); c = end;
+      f.using_count_ = 0;
+      f.error_ = scm::math::vec2f(0.f, 0.f);
+      features.push_back(f);
+    }
+    p.num_features_ = num_measurements;
+}
+
 int main(int argc, char *argv[]) {
     if (argc == 1 || 
       cmd_option_exists(argv, argv+argc, "-h") ||
@@ -62,6 +113,8 @@ int main(int argc, char *argv[]) {
          //"\t-patch: .patch input file" << std::endl <<
          //"\t-ply: .ply input file" << std::endl <<
          "\t-aux: .aux output file" << std::endl <<
+         "\t-threads: number of concurrent image reads (default: hardware threads)" << std::endl <<
+         "\t-chunk: number of points parsed at once (default: 65536)" << std::endl <<
          std::endl;
       return 0;
     }
@@ -72,6 +125,15 @@ int main(int argc, char *argv[]) {
     //std::string ply_file = string(get_cmd_option(argv, argv + argc, "-ply"));
     std::string aux_file = string(get_cmd_option(argv, argv + argc, "-aux"));
 
+    uint32_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (cmd_option_exists(argv, argv+argc, "-threads")) {
+      num_threads = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-threads")));
+    }
+    uint32_t chunk_size = 1 << 16;
+    if (cmd_option_exists(argv, argv+argc, "-chunk")) {
+      chunk_size = std::max(1, atoi(get_cmd_option(argv, argv + argc, "-chunk")));
+    }
+
     if (check_file_extensions(nvm_file, ".nvm") && 
         //check_file_extensions(ply_file, ".ply") && 
         //check_file_extensions(patch_file, ".patch") && 
@@ -79,7 +141,8 @@ int main(int argc, char *argv[]) {
         throw std::runtime_error("File format is incompatible");
     }
 
-    lamure::prov::aux aux;
+    auto total_start = timer::now();
+    auto start = timer::now();
 
     //parse nvm file
     std::ifstream nvm(nvm_file.c_str(), std::ios::in);
@@ -105,11 +168,13 @@ int main(int argc, char *argv[]) {
     }
     std::cout << num_views << " views" << std::endl;
 
+    std::vector<lamure::prov::aux::view> views(num_views);
+
     for (uint32_t i = 0; i < num_views; ++i) {
       std::getline(nvm, line);
       std::istringstream line_ss(line);
       
-      lamure::prov::aux::view v;
+      lamure::prov::aux::view& v = views[i];
       v.camera_id_ = i;
       line_ss >> v.image_file_;
       line_ss >> v.focal_length_;
@@ -143,38 +208,36 @@ int main(int argc, char *argv[]) {
 
       v.transform_ = scm::math::make_translation(v.position_) * quat.to_matrix();
       line_ss >> v.distortion_;
-      
-      std::cout << "Reading image " << fotos_directory+v.image_file_ << std::endl;
-
-      FILE *fp = fopen((fotos_directory+v.image_file_).c_str(), "rb");
-      if(!fp) {
-        std::cout << "can't read image" << std::endl;
-        exit(-1);
-      }
-      fseek(fp, 0, SEEK_END);
-      size_t fsize = (size_t)ftell(fp);
-      rewind(fp);
-      unsigned char *buf = new unsigned char[fsize];
-      if (fread(buf, 1, fsize, fp) != fsize) {
-        delete[] buf;
-        std::cout << "can't read image" << std::endl;
-        exit(-1);
-      }
-      fclose(fp);
-
-      easyexif::EXIFInfo result;
-      result.parseFrom(buf, (unsigned int)fsize);
-
-      v.image_height_ = result.ImageHeight;
-      v.image_width_ = result.ImageWidth;
-      //v.focal_length_ = result.FocalLength * 0.001;
- 
       v.atlas_tile_id_ = 0;
+    }
 
-      aux.add_view(v);
-
+    std::cout << "Parsing views took " << elapsed_ms(start) << " ms" << std::endl;
+    start = timer::now();
+
+    //read the image headers, at most num_threads images are read at the same time
+    std::atomic<uint32_t> next_view(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < std::min(num_threads, std::max(num_views, 1u)); ++t) {
+      workers.push_back(std::thread([&]() {
+        for (uint32_t i = next_view++; i < num_views && !failed; i = next_view++) {
+          if (!probe_image(fotos_directory+views[i].image_file_, views[i])) {
+            std::cout << "can't read image " << fotos_directory+views[i].image_file_ << std::endl;
+            failed = true;
+          }
+        }
+      }));
+    }
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    if (failed) {
+      exit(-1);
     }
 
+    std::cout << "Reading " << num_views << " images with " << num_threads << " threads took " << elapsed_ms(start) << " ms" << std::endl;
+    start = timer::now();
+
     std::getline(nvm, line);
     std::getline(nvm, line); //num points
 
@@ -185,82 +248,108 @@ int main(int argc, char *argv[]) {
     }
     std::cout << num_points << " points" << std::endl;
 
-    for (uint32_t i = 0; i < num_points; ++i) {
-      std::getline(nvm, line);
-      std::istringstream line_ss(line);
-    
-      lamure::prov::aux::sparse_point p;
-      line_ss >> p.pos_.x;
-      line_ss >> p.pos_.y;
-      line_ss >> p.pos_.z;
-      uint32_t r, g, b;
-      line_ss >> r;
-      line_ss >> g;
-      line_ss >> b;
-      p.r_ = (uint8_t)r;
-      p.g_ = (uint8_t)g;
-      p.b_ = (uint8_t)b;
-      p.a_ = (uint8_t)255;
-      uint32_t num_measurements = 0;
-      
-      line_ss >> num_measurements;
-      for (uint32_t j = 0; j < num_measurements; ++j) {
-        lamure::prov::aux::feature f;
-        line_ss >> f.camera_id_;
-        uint32_t feature_index; //ignore
-        line_ss >> feature_index;
-        line_ss >> f.coords_.x;
-        line_ss >> f.coords_.y;
-        f.error_ = scm::math::vec2f(0.f, 0.f);
-
-        p.features_.push_back(f);
-      }
-
-      aux.add_sparse_point(p);
-      
+    //checked before anything is written, so no truncated aux file is left behind
+    lamure::prov::octree octree;
+    if (num_points < octree.get_min_num_points()) {
+      std::cout << "Too few points, at least " << octree.get_min_num_points() << " are needed for the octree" << std::endl;
+      exit(-1);
     }
 
-    nvm.close();
-
-
-    std::cout << "create octree " << std::endl;
-
-    //create octree
-    auto octree = std::make_shared<lamure::prov::octree>();
-    octree->create(aux.get_sparse_points());
-    aux.set_octree(octree);
-
-    aux.write_aux_file(aux_file);
-
-    std::cout << "Done" << std::endl;
-
-    return 0;
-}
-
-
-
-
-
+    lamure::prov::aux_stream aux_stream;
+    aux_stream.begin_aux(aux_file);
+    for (const auto& v : views) {
+      aux_stream.write_view(v);
+    }
 
+    //points are parsed in chunks and written right away, only positions
+    //and camera ids are kept for the octree
+    std::vector<scm::math::vec3f> positions;
+    std::vector<uint64_t> camera_offsets(1, 0);
+    std::vector<uint32_t> camera_ids;
+    positions.reserve(num_points);
+    camera_offsets.reserve(num_points+1);
 
+    double parse_ms = 0.0;
+    double write_ms = 0.0;
 
+    std::vector<std::string> lines;
+    std::vector<std::vector<lamure::prov::aux::feature>> line_features;
+    lamure::prov::aux::sparse_chunk chunk;
 
+    aux_stream.begin_sparse_points();
 
+    for (uint32_t first = 0; first < num_points; first += chunk_size) {
+      auto chunk_start = timer::now();
 
+      uint32_t num_lines = std::min(chunk_size, num_points - first);
+      lines.resize(num_lines);
+      for (uint32_t i = 0; i < num_lines; ++i) {
+        std::getline(nvm, lines[i]);
+      }
 
+      chunk.first_point_id_ = first;
+      chunk.points_.resize(num_lines);
+      line_features.resize(num_lines);
 
+      #pragma omp parallel for schedule(dynamic, 256)
+      for (int64_t i = 0; i < (int64_t)num_lines; ++i) {
+        parse_point(lines[i], chunk.points_[i], line_features[i]);
+      }
 
+      uint64_t num_features = 0;
+      for (uint32_t i = 0; i < num_lines; ++i) {
+        chunk.points_[i].features_offset_ = num_features;
+        num_features += chunk.points_[i].num_features_;
+      }
+      chunk.features_.resize(num_features);
+
+      uint64_t first_camera = camera_ids.size();
+      camera_ids.resize(first_camera + num_features);
+
+      #pragma omp parallel for
+      for (int64_t i = 0; i < (int64_t)num_lines; ++i) {
+        const auto& p = chunk.points_[i];
+        for (uint32_t j = 0; j < p.num_features_; ++j) {
+          chunk.features_[p.features_offset_ + j] = line_features[i][j];
+          camera_ids[first_camera + p.features_offset_ + j] = line_features[i][j].camera_id_;
+        }
+      }
 
+      for (const auto& p : chunk.points_) {
+        positions.push_back(p.pos_);
+        camera_offsets.push_back(camera_offsets.back() + p.num_features_);
+      }
 
+      parse_ms += elapsed_ms(chunk_start);
+      chunk_start = timer::now();
 
+      aux_stream.write_sparse_points(chunk);
 
+      write_ms += elapsed_ms(chunk_start);
+    }
 
+    aux_stream.end_sparse_points();
 
+    nvm.close();
 
+    std::cout << "Parsing points took " << parse_ms << " ms, writing them took " << write_ms << " ms" << std::endl;
+    start = timer::now();
 
+    std::cout << "create octree " << std::endl;
 
+    //create octree
+    octree.create(positions, camera_offsets, camera_ids);
 
+    std::cout << "Creating octree took " << elapsed_ms(start) << " ms" << std::endl;
+    start = timer::now();
 
+    aux_stream.write_octree(octree);
+    aux_stream.end_aux();
 
+    std::cout << "Writing octree took " << elapsed_ms(start) << " ms" << std::endl;
+    std::cout << "Import took " << elapsed_ms(total_start) << " ms" << std::endl;
 
+    std::cout << "Done" << std::endl;
 
+    return 0;
+}
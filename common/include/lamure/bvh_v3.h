@@ -0,0 +1,144 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef COMMON_BVH_V3_H_
+#define COMMON_BVH_V3_H_
+
+#include <lamure/platform.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lamure {
+
+// Version 3 of the .bvh format. The file starts with a fixed header and a
+// section table, followed by one contiguous array per node attribute.
+// Sections start at 64-byte boundaries, so uncompressed sections can be
+// used in place from a read-only mapping of the file.
+//
+//   header          64 bytes
+//   section table   num_sections_ * 48 bytes
+//   sections        raw or block compressed node attributes
+//
+// Intermediate trees (after downsweep/upsweep) keep using the segment
+// based format, version 3 only holds serialized trees.
+
+namespace bvh_v3 {
+
+enum section_type : uint32_t {
+    SECTION_BOUNDING_BOXES = 0,      // float[6] per node, min xyz, max xyz
+    SECTION_CENTROIDS = 1,           // float[3] per node
+    SECTION_AVG_PRIMITIVE_EXTENTS = 2, // float per node
+    SECTION_MAX_EXTENT_DEVIATIONS = 3, // float per node
+    SECTION_VISIBILITY = 4,          // one bit per node, set if invisible
+    SECTION_REDUCTION_ERRORS = 5,    // float per node
+    SECTION_NODE_LAYOUT = 6          // uint32 per node, index in .lod/.prov
+};
+
+enum codec_type : uint32_t {
+    CODEC_NONE = 0,
+    CODEC_LZ4 = 1                    // byte shuffle by element size, then lz4 block
+};
+
+struct header {
+    char     magic_[8];
+    uint32_t major_version_;
+    uint32_t minor_version_;
+    uint32_t num_nodes_;
+    uint32_t depth_;
+    uint32_t fan_factor_;
+    uint32_t primitives_per_node_;
+    uint32_t size_of_primitive_;
+    uint32_t primitive_;
+    uint32_t state_;
+    uint32_t num_sections_;
+    float    translation_[3];
+    uint32_t reserved_;
+};
+
+struct section {
+    uint32_t type_;
+    uint32_t codec_;
+    uint32_t element_size_;
+    uint32_t reserved_0_;
+    uint64_t offset_;
+    uint64_t stored_size_;
+    uint64_t raw_size_;
+    uint64_t reserved_1_;
+};
+
+static_assert(sizeof(header) == 64, "bvh_v3::header must be 64 bytes");
+static_assert(sizeof(section) == 48, "bvh_v3::section must be 48 bytes");
+
+const static uint32_t alignment = 64;
+
+COMMON_DLL void        init_header(header& h);
+COMMON_DLL const bool  is_bvh_v3(const std::string& filename);
+
+// lz4 block format, compatible with LZ4_compress_default/LZ4_decompress_safe
+COMMON_DLL void        lz4_compress(const char* src, const size_t size, std::vector<char>& dst);
+COMMON_DLL const bool  lz4_decompress(const char* src, const size_t size, char* dst, const size_t raw_size);
+
+class COMMON_DLL writer
+{
+public:
+                        writer(const header& h);
+
+    void                add_section(const section_type type,
+                                    const uint32_t element_size,
+                                    const void* data,
+                                    const size_t raw_size,
+                                    const codec_type codec);
+
+    void                write(const std::string& filename);
+
+private:
+    header              header_;
+    std::vector<section> sections_;
+    std::vector<std::vector<char>> payloads_;
+};
+
+class COMMON_DLL reader
+{
+public:
+                        reader();
+                        reader(const reader&) = delete;
+                        reader& operator=(const reader&) = delete;
+                        ~reader();
+
+    void                open(const std::string& filename);
+    void                close();
+
+    const header&       get_header() const { return header_; }
+    const bool          has_section(const section_type type) const;
+
+    // returns the raw section, which points into the mapped file for
+    // uncompressed sections and into a decoded copy otherwise
+    const char*         section_data(const section_type type);
+    const size_t        section_size(const section_type type) const;
+
+private:
+    const section*      find_section(const section_type type) const;
+
+    std::string         filename_;
+    const char*         data_;
+    size_t              size_;
+    bool                mapped_;
+    std::vector<char>   buffer_;
+
+    header              header_;
+    std::vector<section> sections_;
+    std::vector<std::vector<char>> decoded_;
+};
+
+} // namespace bvh_v3
+
+} // namespace lamure
+
+#endif // COMMON_BVH_V3_H_
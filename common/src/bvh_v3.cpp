@@ -0,0 +1,476 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/bvh_v3.h>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lamure {
+
+namespace bvh_v3 {
+
+namespace {
+
+const char magic[8] = {'B', 'V', 'H', '3', 'L', 'A', 'M', 'U'};
+
+//lz4 block format constants
+const size_t min_match = 4;
+const size_t last_literals = 5;
+const size_t match_search_limit = 12;
+const size_t max_offset = 65535;
+const uint32_t hash_log = 12;
+
+inline uint32_t read_32(const char* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t hash_32(const uint32_t v) {
+    return (v * 2654435761u) >> (32 - hash_log);
+}
+
+void write_length(std::vector<char>& dst, size_t length) {
+    while (length >= 255) {
+        dst.push_back((char)255);
+        length -= 255;
+    }
+    dst.push_back((char)length);
+}
+
+void write_sequence(std::vector<char>& dst, const char* literals, const size_t num_literals,
+                    const size_t offset, const size_t match_length) {
+    size_t token_position = dst.size();
+    dst.push_back(0);
+
+    uint8_t token = 0;
+    if (num_literals >= 15) {
+        token = 15 << 4;
+        write_length(dst, num_literals - 15);
+    }
+    else {
+        token = (uint8_t)(num_literals << 4);
+    }
+
+    dst.insert(dst.end(), literals, literals + num_literals);
+
+    if (match_length > 0) {
+        dst.push_back((char)(offset & 0xFF));
+        dst.push_back((char)((offset >> 8) & 0xFF));
+
+        size_t length = match_length - min_match;
+        if (length >= 15) {
+            token |= 15;
+            write_length(dst, length - 15);
+        }
+        else {
+            token |= (uint8_t)length;
+        }
+    }
+
+    dst[token_position] = (char)token;
+}
+
+//groups byte k of every element, float arrays compress much better this way
+void shuffle(const char* src, const size_t size, const uint32_t element_size, char* dst) {
+    const size_t num_elements = size / element_size;
+    for (size_t i = 0; i < num_elements; ++i) {
+        for (uint32_t b = 0; b < element_size; ++b) {
+            dst[b * num_elements + i] = src[i * element_size + b];
+        }
+    }
+    size_t tail = num_elements * element_size;
+    memcpy(dst + tail, src + tail, size - tail);
+}
+
+void unshuffle(const char* src, const size_t size, const uint32_t element_size, char* dst) {
+    const size_t num_elements = size / element_size;
+    for (size_t i = 0; i < num_elements; ++i) {
+        for (uint32_t b = 0; b < element_size; ++b) {
+            dst[i * element_size + b] = src[b * num_elements + i];
+        }
+    }
+    size_t tail = num_elements * element_size;
+    memcpy(dst + tail, src + tail, size - tail);
+}
+
+inline size_t align(const size_t offset) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+void
+init_header(header& h) {
+    memset(&h, 0, sizeof(header));
+    memcpy(h.magic_, magic, 8);
+    h.major_version_ = 3;
+    h.minor_version_ = 0;
+}
+
+const bool
+is_bvh_v3(const std::string& filename) {
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    char file_magic[8];
+    if (!file.read(file_magic, 8)) {
+        return false;
+    }
+    return memcmp(file_magic, magic, 8) == 0;
+}
+
+void
+lz4_compress(const char* src, const size_t size, std::vector<char>& dst) {
+    dst.clear();
+    dst.reserve(size + size / 255 + 16);
+
+    size_t anchor = 0;
+
+    if (size >= match_search_limit + 1) {
+        std::vector<uint32_t> table(1 << hash_log, 0);
+
+        const size_t match_start_limit = size - match_search_limit;
+        const size_t match_end_limit = size - last_literals;
+
+        size_t ip = 0;
+        while (ip < match_start_limit) {
+            uint32_t sequence = read_32(src + ip);
+            uint32_t h = hash_32(sequence);
+            size_t candidate = table[h];
+            table[h] = (uint32_t)(ip + 1);
+
+            //table stores positions + 1, zero marks an empty entry
+            if (candidate == 0 || ip - (candidate - 1) > max_offset
+                || read_32(src + candidate - 1) != sequence) {
+                ++ip;
+                continue;
+            }
+            size_t match = candidate - 1;
+
+            size_t length = min_match;
+            while (ip + length < match_end_limit && src[match + length] == src[ip + length]) {
+                ++length;
+            }
+
+            write_sequence(dst, src + anchor, ip - anchor, ip - match, length);
+
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    write_sequence(dst, src + anchor, size - anchor, 0, 0);
+}
+
+const bool
+lz4_decompress(const char* src, const size_t size, char* dst, const size_t raw_size) {
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < size) {
+        uint8_t token = (uint8_t)src[ip++];
+
+        size_t num_literals = token >> 4;
+        if (num_literals == 15) {
+            uint8_t s = 255;
+            while (s == 255) {
+                if (ip >= size) return false;
+                s = (uint8_t)src[ip++];
+                num_literals += s;
+            }
+        }
+
+        if (ip + num_literals > size || op + num_literals > raw_size) {
+            return false;
+        }
+        memcpy(dst + op, src + ip, num_literals);
+        ip += num_literals;
+        op += num_literals;
+
+        //the last sequence has no match
+        if (ip == size) {
+            break;
+        }
+
+        if (ip + 2 > size) return false;
+        size_t offset = (uint8_t)src[ip] | ((size_t)(uint8_t)src[ip + 1] << 8);
+        ip += 2;
+
+        size_t length = token & 15;
+        if (length == 15) {
+            uint8_t s = 255;
+            while (s == 255) {
+                if (ip >= size) return false;
+                s = (uint8_t)src[ip++];
+                length += s;
+            }
+        }
+        length += min_match;
+
+        if (offset == 0 || offset > op || op + length > raw_size) {
+            return false;
+        }
+
+        //matches may overlap the bytes they produce
+        size_t match = op - offset;
+        for (size_t i = 0; i < length; ++i) {
+            dst[op + i] = dst[match + i];
+        }
+        op += length;
+    }
+
+    return op == raw_size;
+}
+
+writer::
+writer(const header& h)
+: header_(h) {
+
+}
+
+void writer::
+add_section(const section_type type,
+            const uint32_t element_size,
+            const void* data,
+            const size_t raw_size,
+            const codec_type codec) {
+
+    section s;
+    memset(&s, 0, sizeof(section));
+    s.type_ = type;
+    s.codec_ = CODEC_NONE;
+    s.element_size_ = element_size > 0 ? element_size : 1;
+    s.raw_size_ = raw_size;
+
+    const char* raw = (const char*)data;
+    std::vector<char> payload(raw, raw + raw_size);
+
+    if (codec == CODEC_LZ4 && raw_size > 0) {
+        std::vector<char> shuffled(raw_size);
+        shuffle(raw, raw_size, s.element_size_, &shuffled[0]);
+
+        std::vector<char> compressed;
+        lz4_compress(&shuffled[0], raw_size, compressed);
+
+        //incompressible sections are stored raw
+        if (compressed.size() < raw_size) {
+            s.codec_ = CODEC_LZ4;
+            payload.swap(compressed);
+        }
+    }
+
+    s.stored_size_ = payload.size();
+
+    sections_.push_back(s);
+    payloads_.push_back(std::move(payload));
+}
+
+void writer::
+write(const std::string& filename) {
+    std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error(
+            "lamure: bvh_v3::writer::Unable to open file: " + filename);
+    }
+
+    header_.num_sections_ = (uint32_t)sections_.size();
+
+    size_t offset = align(sizeof(header) + sections_.size() * sizeof(section));
+    for (auto& s : sections_) {
+        s.offset_ = offset;
+        offset = align(offset + s.stored_size_);
+    }
+
+    file.write((const char*)&header_, sizeof(header));
+    for (const auto& s : sections_) {
+        file.write((const char*)&s, sizeof(section));
+    }
+
+    size_t position = sizeof(header) + sections_.size() * sizeof(section);
+    const char padding[alignment] = {0};
+
+    for (size_t i = 0; i < sections_.size(); ++i) {
+        file.write(padding, sections_[i].offset_ - position);
+        if (sections_[i].stored_size_ > 0) {
+            file.write(&payloads_[i][0], sections_[i].stored_size_);
+        }
+        position = sections_[i].offset_ + sections_[i].stored_size_;
+    }
+    file.write(padding, align(position) - position);
+
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error(
+            "lamure: bvh_v3::writer::Unable to write file: " + filename);
+    }
+}
+
+reader::
+reader()
+: data_(nullptr),
+  size_(0),
+  mapped_(false) {
+
+}
+
+reader::
+~reader() {
+    close();
+}
+
+void reader::
+open(const std::string& filename) {
+    close();
+
+    filename_ = filename;
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (address != MAP_FAILED) {
+                data_ = (const char*)address;
+                size_ = (size_t)info.st_size;
+                mapped_ = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    if (!mapped_) {
+        std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            throw std::runtime_error(
+                "lamure: bvh_v3::reader::Unable to open file: " + filename);
+        }
+        size_ = (size_t)file.tellg();
+        file.seekg(0, std::ios::beg);
+        buffer_.resize(size_);
+        if (size_ > 0 && !file.read(&buffer_[0], size_)) {
+            throw std::runtime_error(
+                "lamure: bvh_v3::reader::Unable to read file: " + filename);
+        }
+        data_ = buffer_.empty() ? nullptr : &buffer_[0];
+    }
+
+    if (size_ < sizeof(header) || memcmp(data_, magic, 8) != 0) {
+        close();
+        throw std::runtime_error(
+            "lamure: bvh_v3::reader::Invalid magic encountered: " + filename);
+    }
+
+    memcpy(&header_, data_, sizeof(header));
+
+    if (header_.major_version_ != 3
+        || sizeof(header) + (size_t)header_.num_sections_ * sizeof(section) > size_) {
+        close();
+        throw std::runtime_error(
+            "lamure: bvh_v3::reader::File corrupt -- Invalid header: " + filename);
+    }
+
+    sections_.resize(header_.num_sections_);
+    for (uint32_t i = 0; i < header_.num_sections_; ++i) {
+        memcpy(&sections_[i], data_ + sizeof(header) + i * sizeof(section), sizeof(section));
+        if (sections_[i].offset_ > size_ || sections_[i].stored_size_ > size_ - sections_[i].offset_) {
+            close();
+            throw std::runtime_error(
+                "lamure: bvh_v3::reader::File corrupt -- Truncated section: " + filename);
+        }
+        //the writer never stores an element size of 0, unshuffle divides by it
+        if (sections_[i].element_size_ == 0) {
+            close();
+            throw std::runtime_error(
+                "lamure: bvh_v3::reader::File corrupt -- Invalid element size: " + filename);
+        }
+    }
+    decoded_.resize(header_.num_sections_);
+}
+
+void reader::
+close() {
+#ifndef _WIN32
+    if (mapped_) {
+        munmap((void*)data_, size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    buffer_.clear();
+    sections_.clear();
+    decoded_.clear();
+}
+
+const section* reader::
+find_section(const section_type type) const {
+    for (const auto& s : sections_) {
+        if (s.type_ == type) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+const bool reader::
+has_section(const section_type type) const {
+    return find_section(type) != nullptr;
+}
+
+const size_t reader::
+section_size(const section_type type) const {
+    const section* s = find_section(type);
+    return s != nullptr ? s->raw_size_ : 0;
+}
+
+const char* reader::
+section_data(const section_type type) {
+    const section* s = find_section(type);
+    if (s == nullptr) {
+        return nullptr;
+    }
+
+    if (s->codec_ == CODEC_NONE) {
+        if (s->stored_size_ != s->raw_size_) {
+            throw std::runtime_error(
+                "lamure: bvh_v3::reader::File corrupt -- Invalid section size: " + filename_);
+        }
+        return data_ + s->offset_;
+    }
+
+    if (s->codec_ != CODEC_LZ4) {
+        throw std::runtime_error(
+            "lamure: bvh_v3::reader::Unknown section codec: " + filename_);
+    }
+
+    std::vector<char>& decoded = decoded_[s - &sections_[0]];
+    if (decoded.size() != s->raw_size_) {
+        std::vector<char> shuffled(s->raw_size_);
+        if (!lz4_decompress(data_ + s->offset_, s->stored_size_, shuffled.empty() ? nullptr : &shuffled[0], s->raw_size_)) {
+            throw std::runtime_error(
+                "lamure: bvh_v3::reader::File corrupt -- Unable to decompress section: " + filename_);
+        }
+        decoded.resize(s->raw_size_);
+        unshuffle(shuffled.empty() ? nullptr : &shuffled[0], s->raw_size_, s->element_size_, decoded.empty() ? nullptr : &decoded[0]);
+    }
+
+    return decoded.empty() ? nullptr : &decoded[0];
+}
+
+} // namespace bvh_v3
+
+} // namespace lamure
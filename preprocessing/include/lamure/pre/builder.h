@@ -48,6 +48,8 @@ public:
         bool translate_to_origin;
         uint16_t number_of_outlier_neighbours;
         float outlier_ratio;
+        // ndc_prov only: keep provenance out of downsweep and upsweep and join it after serialization
+        bool join_provenance = false;
 
         rep_radius_algorithm rep_radius_algo;
         reduction_algorithm reduction_algo;
@@ -79,10 +81,12 @@ private:
     bool reserialize(boost::filesystem::path const &input_file, uint16_t start_stage) const;
 
     size_t calculate_memory_limit() const;
+    bool joins_provenance() const;
 
     descriptor desc_;
     size_t memory_limit_;
     boost::filesystem::path base_path_;
+    boost::filesystem::path prov_join_surfel_file_;
 };
 
 } // namespace pre
@@ -16,6 +16,7 @@
 #include <lamure/pre/node_serializer.h>
 #include <lamure/pre/normal_computation_strategy.h>
 #include <lamure/pre/platform.h>
+#include <lamure/pre/prov_join.h>
 #include <lamure/pre/radius_computation_strategy.h>
 #include <lamure/pre/reduction_strategy.h>
 
@@ -106,6 +107,12 @@ class PREPROCESSING_DLL bvh
     void print_tree_properties() const;
     const node_id_type first_leaf() const { return first_leaf_; }
 
+    // index of a node in the .lod and .prov files, differs from the node id
+    // only for trees whose files were reordered
+    node_id_type get_file_index(const node_id_type node_id) const { return file_indices_.empty() ? node_id : file_indices_[node_id]; }
+    bool has_node_layout() const { return !file_indices_.empty(); }
+    const std::vector<node_id_type> &file_indices() const { return file_indices_; }
+
     // processing functions
     void downsweep(bool adjust_translation, const std::string &surfels_input_file, const std::string &prov_input_file);
 
@@ -142,6 +149,7 @@ class PREPROCESSING_DLL bvh
     void set_base_path(const boost::filesystem::path &base_path) { base_path_ = base_path; };
     void set_nodes(const std::vector<bvh_node> &nodes) { nodes_ = nodes; };
     void set_first_leaf(const node_id_type first_leaf) { first_leaf_ = first_leaf; };
+    void set_file_indices(const std::vector<node_id_type> &file_indices) { file_indices_ = file_indices; };
     void set_state(const state_type state) { state_ = state; };
 
     void spawn_create_lod_jobs(const uint32_t first_node_of_level, const uint32_t last_node_of_level, const reduction_strategy &reduction_strgy, const bool resample);
@@ -179,6 +187,8 @@ class PREPROCESSING_DLL bvh
 
     node_id_type first_leaf_;
 
+    std::vector<node_id_type> file_indices_; ///< empty for bfs layout
+
     // std::string         working_directory_;
     // std::string         basename_;
     boost::filesystem::path base_path_;
@@ -189,6 +199,8 @@ class PREPROCESSING_DLL bvh
 
     vec3r translation_ = vec3r(0.0); ///< translation of surfels
 
+    std::vector<prov_join::merge_map> merge_maps_; ///< merge maps of the level being reduced, empty unless provenance is joined
+
     void downsweep_subtree_in_core(const bvh_node &node, size_t &disk_leaf_destination, uint32_t &processed_nodes, uint8_t &percent_processed, 
         shared_surfel_file leaf_level_access, shared_prov_file prov_leaf_level_access);
 
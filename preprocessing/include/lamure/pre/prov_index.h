@@ -0,0 +1,62 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_PROV_INDEX_H_
+#define PRE_PROV_INDEX_H_
+
+#include <lamure/pre/platform.h>
+#include <lamure/types.h>
+
+#include <string>
+
+namespace lamure
+{
+namespace pre
+{
+
+class bvh;
+
+/**
+* writes per-node summaries of the provenance attributes to a sidecar index.
+*
+* For every node and float attribute of the .prov records the index stores
+* min, max, the number of surfels and a histogram over the global range of
+* the attribute, so renderers can tell which nodes can't satisfy an
+* attribute filter without loading them.
+*
+* File layout (.pidx): magic, version, num_nodes, fan_factor,
+* num_attributes, num_bins (uint32 each), the global min and max per
+* attribute, then per node and attribute min, max (float), count and
+* num_bins histogram counts (uint32).
+*/
+class PREPROCESSING_DLL prov_index
+{
+public:
+    static const uint32_t magic = 0x58444950u; // "PIDX"
+    static const uint32_t version = 1;
+    static const uint32_t default_num_bins = 16;
+
+    /**
+    * reads prov_file, which holds surfels_per_node records per node, twice:
+    * once for the global ranges, once for the node summaries.
+    */
+    static void build(const bvh &tree,
+                      const std::string &prov_file,
+                      const std::string &index_file,
+                      const size_t buffer_size,
+                      const uint32_t num_bins = default_num_bins);
+
+    static uint32_t bin_index(const float value,
+                              const float range_min,
+                              const float range_max,
+                              const uint32_t num_bins);
+};
+
+}
+} // namespace lamure
+
+#endif // PRE_PROV_INDEX_H_
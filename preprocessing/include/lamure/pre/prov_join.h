@@ -0,0 +1,87 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef PRE_PROV_JOIN_H_
+#define PRE_PROV_JOIN_H_
+
+#include <lamure/pre/platform.h>
+#include <lamure/pre/prov.h>
+#include <lamure/types.h>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace lamure
+{
+namespace pre
+{
+
+class bvh;
+
+/**
+* joins provenance data onto the serialized LOD.
+*
+* In this mode downsweep and upsweep only move surfels. The reduction
+* records a merge map per inner node instead, which names the child surfels
+* every output surfel was built from. After serialization, leaf surfels are
+* matched to the input surfels by position and color, and the merge maps are
+* replayed level by level to aggregate the provenance values.
+*/
+class PREPROCESSING_DLL prov_join
+{
+public:
+    // references with this bit set address a group of the same merge map,
+    // all others a child surfel as child_index * surfels_per_node + surfel_index
+    static const uint32_t group_flag = 0x80000000u;
+
+    struct merge_map
+    {
+        uint32_t node_id_ = 0;
+        std::vector<uint32_t> group_offsets_ = std::vector<uint32_t>(1, 0);
+        std::vector<uint32_t> group_members_;
+        // mean absolute deviation, standard deviation and coefficient of variation per group
+        std::vector<float> group_deviations_;
+        std::vector<uint32_t> outputs_;
+
+        uint32_t add_group(const std::vector<uint32_t> &members,
+                           const float mean_absolute_deviation,
+                           const float standard_deviation,
+                           const float coefficient_of_variation);
+    };
+
+    struct statistics
+    {
+        uint64_t bytes_read_ = 0;
+        uint64_t bytes_written_ = 0;
+        uint64_t num_unmatched_ = 0;
+        uint32_t num_leaf_passes_ = 0;
+    };
+
+    static void write_map(std::ostream &os, const merge_map &map);
+    static void read_map(std::istream &is, merge_map &map);
+
+    /**
+    * writes one prov record per LOD surfel to prov_output_file, laid out like
+    * lod_file. prov_input_file may be empty, input values are zero then.
+    * Leaves are matched in as many passes over the input as needed to keep
+    * the working set within memory_budget (in bytes).
+    */
+    static statistics join(const bvh &tree,
+                           const std::string &lod_file,
+                           const std::string &map_file,
+                           const std::string &surfel_input_file,
+                           const std::string &prov_input_file,
+                           const std::string &prov_output_file,
+                           const size_t buffer_size,
+                           const size_t memory_budget);
+};
+
+}
+} // namespace lamure
+
+#endif // PRE_PROV_JOIN_H_
@@ -28,6 +28,9 @@ class PREPROCESSING_DLL reduction_normal_deviation_clustering_provenance : publi
     surfel_mem_array create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, std::vector<LoDMetaData> &deviations, const uint32_t surfels_per_node,
                                 const bvh &tree, const size_t start_node_id) const override;
 
+    surfel_mem_array create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, prov_join::merge_map &merge_map, const uint32_t surfels_per_node,
+                                const bvh &tree, const size_t start_node_id) const override;
+
   private:
     using value_index_pair = std::pair<real, uint16_t>;
 
@@ -52,6 +55,9 @@ class PREPROCESSING_DLL reduction_normal_deviation_clustering_provenance : publi
         bool operator()(const provenance_cluster &left, const provenance_cluster &right) { return left.cluster.size() < right.cluster.size(); }
     };
 
+    surfel_mem_array create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, std::vector<LoDMetaData> &deviations, prov_join::merge_map *merge_map,
+                                const uint32_t surfels_per_node, const bvh &tree, const size_t start_node_id) const;
+
     static surfel_ext create_representative(const std::vector<surfel_ext> &input);
 
     std::pair<vec3ui, vec3b> compute_grid_dimensions(const std::vector<surfel_mem_array *> &input, const bounding_box &bounding_box, const uint32_t surfels_per_node) const;
@@ -2,6 +2,7 @@
 #define LAMURE_PROVENANCE_REDUCTION_STRATEGY_H
 
 #include <lamure/pre/bvh_node.h>
+#include <lamure/pre/prov_join.h>
 #include <lamure/pre/surfel_mem_array.h>
 #include <sys/stat.h>
 
@@ -35,6 +36,10 @@ class reduction_strategy_provenance : public reduction_strategy
     virtual surfel_mem_array create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, std::vector<LoDMetaData> &deviations, const uint32_t surfels_per_node, const bvh &tree,
                                         const size_t start_node_id) const = 0;
 
+    // Reduces surfels without provenance and records which input surfels each output surfel was merged from.
+    virtual surfel_mem_array create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, prov_join::merge_map &merge_map, const uint32_t surfels_per_node, const bvh &tree,
+                                        const size_t start_node_id) const = 0;
+
     template <typename T>
     T swap(const T &arg, bool big_in_mem)
     {
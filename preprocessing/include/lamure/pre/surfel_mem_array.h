@@ -23,6 +23,8 @@ public:
 
   surfel surfel_;
   prov prov_;
+  // surfel or merge group reference while provenance is joined after serialization
+  uint32_t prov_ref_ = 0;
 
 
   static bool compare_x(const surfel_ext &left_surfel, const surfel_ext &right_surfel) {
@@ -36,9 +36,15 @@
 #include <lamure/pre/reduction_pair_contraction.h>
 #include <lamure/pre/reduction_hierarchical_clustering_mk5.h>
 #endif
+#include <lamure/pre/prov_index.h>
+#include <lamure/pre/prov_join.h>
 #include <cstdio>
 #include <fstream>
 
+#if !WIN32
+#include <sys/resource.h>
+#endif
+
 
 #define CPU_TIMER auto_timer timer("CPU time: %ws wall, usr+sys = %ts CPU (%p%)\n")
 
@@ -49,6 +55,32 @@ namespace lamure
 namespace pre
 {
 
+namespace
+{
+
+// prints peak resident memory and the bytes read and written by the process so far
+void print_resource_usage(const std::string &stage)
+{
+#if !WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    size_t read_bytes = 0, written_bytes = 0;
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    size_t value;
+    while (io >> key >> value) {
+        if (key == "rchar:") read_bytes = value;
+        else if (key == "wchar:") written_bytes = value;
+    }
+
+    std::cout << "resources after " << stage << ": peak memory " << usage.ru_maxrss / 1024 << " MiB, "
+              << "read " << read_bytes / 1024 / 1024 << " MiB, written " << written_bytes / 1024 / 1024 << " MiB" << std::endl;
+#endif
+}
+
+}
+
 builder::
 builder(const descriptor &desc)
     : desc_(desc),
@@ -201,13 +233,13 @@ boost::filesystem::path builder::downsweep(boost::filesystem::path input_file, u
         LOGGER_TRACE("downsweep stage");
 
         CPU_TIMER;
-        bvh.downsweep(desc_.translate_to_origin, input_file.string(), desc_.prov_file);
+        bvh.downsweep(desc_.translate_to_origin, input_file.string(), joins_provenance() ? "" : desc_.prov_file);
 
         auto bvhd_file = add_to_path(base_path_, ".bvhd");
 
         bvh.serialize_tree_to_file(bvhd_file.string(), true);
 
-        if ((!desc_.keep_intermediate_files) && (start_stage < 1)) {
+        if ((!desc_.keep_intermediate_files) && (start_stage < 1) && (input_file != prov_join_surfel_file_)) {
             // do not remove input file
             std::remove(input_file.string().c_str());
         }
@@ -382,6 +414,33 @@ bool builder::reserialize(boost::filesystem::path const &input_file, uint16_t st
     std::cout << "serialize surfels to file" << std::endl;
     bvh.serialize_surfels_to_file(lod_file.string(), prov_file.string(), desc_.buffer_size);
 
+    if (joins_provenance()) {
+        std::cout << "write paradata json description: " << json_file << std::endl;
+        prov::write_json(json_file.string());
+
+        std::cout << "join provenance to surfels" << std::endl;
+        auto map_file = add_to_path(base_path_, ".pjm");
+        const size_t memory_budget = size_t(desc_.memory_budget * 1024.f * 1024.f * 1024.f);
+        prov_join::statistics stats = prov_join::join(bvh, lod_file.string(), map_file.string(), prov_join_surfel_file_.string(),
+                                                      desc_.prov_file, prov_file.string(), desc_.buffer_size, memory_budget);
+        std::cout << "provenance join: read " << stats.bytes_read_ / 1024 / 1024 << " MiB, written " << stats.bytes_written_ / 1024 / 1024
+                  << " MiB in " << stats.num_leaf_passes_ << " leaf passes" << std::endl;
+        print_resource_usage("provenance join");
+
+        if (!desc_.keep_intermediate_files) {
+            std::remove(map_file.string().c_str());
+            if (start_stage < 1) {
+                std::remove(prov_join_surfel_file_.string().c_str());
+            }
+        }
+    }
+
+    if (bvh.nodes()[0].has_provenance() || joins_provenance()) {
+        auto index_file = add_to_path(base_path_, ".pidx");
+        std::cout << "write provenance index: " << index_file << std::endl;
+        prov_index::build(bvh, prov_file.string(), index_file.string(), desc_.buffer_size);
+    }
+
     std::cout << "serialize bvh to file" << std::endl << std::endl;
     bvh.serialize_tree_to_file(kdn_file.string(), false);
 
@@ -394,6 +453,11 @@ bool builder::reserialize(boost::filesystem::path const &input_file, uint16_t st
     return true;
 }
 
+bool builder::joins_provenance() const
+{
+    return desc_.join_provenance && desc_.reduction_algo == reduction_algorithm::ndc_prov;
+}
+
 size_t builder::calculate_memory_limit() const
 {
 
@@ -501,7 +565,7 @@ construct()
         if (prov_file.empty()) return false;
     }
     else {
-        if (desc_.reduction_algo == lamure::pre::reduction_algorithm::ndc_prov) {
+        if (desc_.reduction_algo == lamure::pre::reduction_algorithm::ndc_prov && !joins_provenance()) {
             //create a dummy prov_file
             std::ifstream surfel_bin_file(input_file.string().c_str(), std::ios::binary | std::ios::ate);
             uint64_t num_surfels = surfel_bin_file.tellg() / sizeof(surfel);
@@ -516,22 +580,30 @@ construct()
         }
     }
 
+    // the provenance join matches leaf surfels against the input surfels, keep them
+    if (joins_provenance()) {
+        prov_join_surfel_file_ = (start_stage <= 1) ? input_file : add_to_path(base_path_, ".bin");
+    }
+
     // downsweep (create bvh)
     if ((3 >= start_stage) && (3 <= final_stage)) {
         input_file = downsweep(input_file, start_stage);
         if (input_file.empty()) return false;
+        print_resource_usage("downsweep");
     }
 
     // upsweep (create LOD)
     if ((4 >= start_stage) && (4 <= final_stage)) {
         input_file = upsweep(input_file, start_stage, reduction_strategy.get(), normal_comp_strategy.get(), radius_comp_strategy.get());
         if (input_file.empty()) return false;
+        print_resource_usage("upsweep");
     }
 
     // serialize to file
     if ((5 >= start_stage) && (5 <= final_stage)) {
         bool reserialize_success = reserialize(input_file, start_stage);
         if (!reserialize_success) return false;
+        print_resource_usage("serialization");
     }
     return true;
 }
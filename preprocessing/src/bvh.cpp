@@ -1070,7 +1070,7 @@ void bvh::thread_create_lod(const uint32_t start_marker, const uint32_t end_mark
 
             if(do_resample)
             {
-                if (current_node->has_provenance()) {
+                if (current_node->has_provenance() || !merge_maps_.empty()) {
                     throw std::runtime_error("resampling not supported for PROVENANCE");
                 }
                 for(uint8_t child_index = 0; child_index < fan_factor_; ++child_index)
@@ -1106,9 +1106,17 @@ void bvh::thread_create_lod(const uint32_t start_marker, const uint32_t end_mark
             reduction_strategy *p_reduction_strgy = (reduction_strategy *)&reduction_strgy;
             if(reduction_strategy_provenance *cast = dynamic_cast<reduction_strategy_provenance *>(p_reduction_strgy))
             {
-                std::vector<reduction_strategy_provenance::LoDMetaData> deviations;
-                reduction_result = cast->create_lod(reduction_error, input_mem_arrays, deviations, max_surfels_per_node_, (*this), get_child_id(current_node->node_id(), 0));
-                //cast->output_lod(deviations, node_index);
+                if(!merge_maps_.empty())
+                {
+                    prov_join::merge_map &merge_map = merge_maps_[node_index - start_marker];
+                    reduction_result = cast->create_lod(reduction_error, input_mem_arrays, merge_map, max_surfels_per_node_, (*this), get_child_id(current_node->node_id(), 0));
+                }
+                else
+                {
+                    std::vector<reduction_strategy_provenance::LoDMetaData> deviations;
+                    reduction_result = cast->create_lod(reduction_error, input_mem_arrays, deviations, max_surfels_per_node_, (*this), get_child_id(current_node->node_id(), 0));
+                    //cast->output_lod(deviations, node_index);
+                }
             }
             else
             {
@@ -1421,6 +1429,14 @@ void bvh::upsweep(const reduction_strategy &reduction_strgy, const normal_comput
     std::cout << "num_nodes: " << nodes_.size() << std::endl;
     std::cout << "num_nodes_with_provenance: " << num_nodes_with_provenance << std::endl;
 
+    // ndc_prov on surfels without provenance: only record which surfels were merged,
+    // the provenance values are joined after serialization
+    std::ofstream merge_map_stream;
+    if (num_nodes_with_provenance == 0 && dynamic_cast<const reduction_strategy_provenance *>(&reduction_strgy) != nullptr) {
+        merge_map_stream.open(add_to_path(base_path_, ".pjm").string(), std::ios::out | std::ios::binary | std::ios::trunc);
+        LOGGER_INFO("Output provenance merge maps: " << add_to_path(base_path_, ".pjm").string());
+    }
+
     // Create level temp files
     std::vector<shared_surfel_file> level_temp_files;
     std::vector<shared_prov_file> prov_temp_files;
@@ -1463,7 +1479,19 @@ void bvh::upsweep(const reduction_strategy &reduction_strgy, const normal_comput
         // First apply reduction strategy, since calculation of attributes might depend on surfel data of nodes in same level.
         if(level != int32_t(depth_))
         {
+            if (merge_map_stream.is_open()) {
+                merge_maps_.assign(last_node_of_level - first_node_of_level, prov_join::merge_map());
+                for (uint32_t node_index = first_node_of_level; node_index < last_node_of_level; ++node_index) {
+                    merge_maps_[node_index - first_node_of_level].node_id_ = node_index;
+                }
+            }
+
             spawn_create_lod_jobs(first_node_of_level, last_node_of_level, reduction_strgy, resample);
+
+            for (const auto &merge_map : merge_maps_) {
+                prov_join::write_map(merge_map_stream, merge_map);
+            }
+            merge_maps_.clear();
         }
 
         // skip the leaf level attribute computation if it was not requested or necessary
@@ -14,6 +14,27 @@ namespace lamure
 namespace pre
 {
 
+namespace
+{
+
+//a node layout has to map every node to its own slot of the .lod file
+bool is_valid_node_layout(const std::vector<node_id_type> &file_indices, const size_t num_nodes)
+{
+    if (file_indices.size() != num_nodes) {
+        return false;
+    }
+    std::vector<bool> used(num_nodes, false);
+    for (const node_id_type file_index : file_indices) {
+        if (file_index >= num_nodes || used[file_index]) {
+            return false;
+        }
+        used[file_index] = true;
+    }
+    return true;
+}
+
+}
+
 bvh_stream::
 bvh_stream()
     : filename_(""),
@@ -125,6 +146,11 @@ void bvh_stream::
 read_bvh(const std::string &filename, bvh &bvh)
 {
 
+    if (bvh_v3::is_bvh_v3(filename)) {
+        read_bvh_v3(filename, bvh);
+        return;
+    }
+
     open_stream(filename, bvh_stream_type::BVH_STREAM_IN);
 
     if (type_ != BVH_STREAM_IN) {
@@ -147,10 +173,12 @@ read_bvh(const std::string &filename, bvh &bvh)
     bvh_tree_extension_seg tree_ext;
     std::vector<bvh_node_seg> nodes;
     std::vector<bvh_node_extension_seg> nodes_ext;
+    bvh_node_layout_seg layout;
     uint32_t tree_id = 0;
     uint32_t tree_ext_id = 0;
     uint32_t node_id = 0;
     uint32_t node_ext_id = 0;
+    uint32_t layout_id = 0;
 
 
     //go through entire stream and fetch the segments
@@ -226,6 +254,11 @@ read_bvh(const std::string &filename, bvh &bvh)
                 }
                 break;
             }
+            case 'L': { //"BVHXLAYT"
+                layout.deserialize(file_);
+                ++layout_id;
+                break;
+            }
             default: {
                 throw std::runtime_error(
                     "PLOD: bvh_stream::file corrupt -- Invalid segment encountered");
@@ -254,6 +287,11 @@ read_bvh(const std::string &filename, bvh &bvh)
             "PLOD: bvh_stream::Stream corrupt -- Invalid number of bvh extensions");
     }
 
+    if (layout_id > 1) {
+        throw std::runtime_error(
+            "PLOD: bvh_stream::Stream corrupt -- Invalid number of node layouts");
+    }
+
     //Note: This is the preprocessing library version of the file reader!
 
     //setup bvh
@@ -374,6 +412,15 @@ read_bvh(const std::string &filename, bvh &bvh)
     bvh.set_state(current_state);
     bvh.set_nodes(bvh_nodes);
 
+    if (layout_id == 1) {
+        std::vector<node_id_type> file_indices(layout.file_indices_.begin(), layout.file_indices_.end());
+        if (layout.num_nodes_ != tree.num_nodes_ || !is_valid_node_layout(file_indices, tree.num_nodes_)) {
+            throw std::runtime_error(
+                "PLOD: bvh_stream::Stream corrupt -- Invalid node layout");
+        }
+        bvh.set_file_indices(file_indices);
+    }
+
 }
 
 void bvh_stream::
@@ -443,6 +490,16 @@ write_bvh(const std::string& filename, bvh& bvh, const bool intermediate) {
        write(node);
    }
 
+   if (bvh.has_node_layout()) {
+       bvh_node_layout_seg layout;
+       layout.segment_id_ = num_segments_++;
+       layout.num_nodes_ = bvh_nodes.size();
+       layout.reserved_ = 0;
+       layout.file_indices_.assign(bvh.file_indices().begin(), bvh.file_indices().end());
+
+       write(layout);
+   }
+
    if (intermediate) {
        bvh_tree_extension_seg tree_ext;
        tree_ext.segment_id_ = num_segments_++;
@@ -544,5 +601,161 @@ write_bvh(const std::string& filename, bvh& bvh, const bool intermediate) {
 
 }
 
+
+void bvh_stream::
+read_bvh_v3(const std::string &filename, bvh &bvh)
+{
+    bvh_v3::reader reader;
+    reader.open(filename);
+
+    const bvh_v3::header &header = reader.get_header();
+
+    if (header.state_ != BVH_STATE_SERIALIZED) {
+        throw std::runtime_error(
+            "PLOD: bvh_stream::Stream corrupt -- Version 3 holds serialized trees only");
+    }
+
+    //Note: This is the preprocessing library version of the file reader!
+
+    bvh.set_depth(header.depth_);
+    bvh.set_fan_factor(header.fan_factor_);
+    bvh.set_max_surfels_per_node(header.primitives_per_node_);
+    bvh.set_translation(vec3r(header.translation_[0],
+                              header.translation_[1],
+                              header.translation_[2]));
+
+    boost::filesystem::path base_path = boost::filesystem::canonical(boost::filesystem::path(filename));
+    base_path.replace_extension("");
+    bvh.set_base_path(base_path);
+
+    const size_t num_nodes = header.num_nodes_;
+
+    auto fetch = [&](const bvh_v3::section_type type, const size_t size) -> const char* {
+        const char* data = reader.section_data(type);
+        if (data == nullptr || reader.section_size(type) != size) {
+            throw std::runtime_error(
+                "PLOD: bvh_stream::Stream corrupt -- Missing or invalid section");
+        }
+        return data;
+    };
+
+    const float *boxes = (const float *) fetch(bvh_v3::SECTION_BOUNDING_BOXES, num_nodes * 6 * sizeof(float));
+    const float *centroids = (const float *) fetch(bvh_v3::SECTION_CENTROIDS, num_nodes * 3 * sizeof(float));
+    const float *extents = (const float *) fetch(bvh_v3::SECTION_AVG_PRIMITIVE_EXTENTS, num_nodes * sizeof(float));
+    const float *deviations = (const float *) fetch(bvh_v3::SECTION_MAX_EXTENT_DEVIATIONS, num_nodes * sizeof(float));
+    const char *visibility = fetch(bvh_v3::SECTION_VISIBILITY, (num_nodes + 7) / 8);
+
+    const float *errors = nullptr;
+    if (reader.has_section(bvh_v3::SECTION_REDUCTION_ERRORS)) {
+        errors = (const float *) fetch(bvh_v3::SECTION_REDUCTION_ERRORS, num_nodes * sizeof(float));
+    }
+
+    std::vector<bvh_node> bvh_nodes(num_nodes);
+
+    uint32_t depth = 0;
+    size_t end_of_depth = 1;
+
+    for (uint32_t i = 0; i < num_nodes; ++i) {
+        while (i >= end_of_depth) {
+            ++depth;
+            end_of_depth += (size_t) std::pow((double) header.fan_factor_, (double) depth);
+        }
+
+        const float *box = boxes + 6 * i;
+        const float *centroid = centroids + 3 * i;
+
+        bvh_nodes[i] = bvh_node(i, depth, bounding_box(vec3r(box[0], box[1], box[2]), vec3r(box[3], box[4], box[5])));
+
+        bvh_nodes[i].set_reduction_error(errors != nullptr ? errors[i] : 0.f);
+        bvh_nodes[i].set_centroid(vec3r(centroid[0], centroid[1], centroid[2]));
+        bvh_nodes[i].set_avg_surfel_radius(extents[i]);
+        bvh_nodes[i].set_visibility(((visibility[i / 8] >> (i % 8)) & 1) ? bvh_node::node_invisible : bvh_node::node_visible);
+        bvh_nodes[i].set_max_surfel_radius_deviation(deviations[i]);
+    }
+
+    bvh.set_first_leaf(num_nodes - std::pow(header.fan_factor_, header.depth_));
+    bvh.set_state(bvh::state_type::serialized);
+    bvh.set_nodes(bvh_nodes);
+
+    if (reader.has_section(bvh_v3::SECTION_NODE_LAYOUT)) {
+        const uint32_t *layout = (const uint32_t *) fetch(bvh_v3::SECTION_NODE_LAYOUT, num_nodes * sizeof(uint32_t));
+        std::vector<node_id_type> file_indices(layout, layout + num_nodes);
+        if (!is_valid_node_layout(file_indices, num_nodes)) {
+            throw std::runtime_error(
+                "PLOD: bvh_stream::Stream corrupt -- Invalid node layout");
+        }
+        bvh.set_file_indices(file_indices);
+    }
+
+}
+
+void bvh_stream::
+write_bvh_v3(const std::string &filename, bvh &bvh, const bool compress)
+{
+    if (bvh.state() != bvh::state_type::serialized) {
+        throw std::runtime_error(
+            "PLOD: bvh_stream::Version 3 holds serialized trees only: " + filename);
+    }
+
+    //Note: This is the preprocessing library version of the file writer!
+
+    const auto &bvh_nodes = bvh.nodes();
+    const size_t num_nodes = bvh_nodes.size();
+
+    bvh_v3::header header;
+    bvh_v3::init_header(header);
+    header.num_nodes_ = num_nodes;
+    header.depth_ = bvh.depth();
+    header.fan_factor_ = bvh.fan_factor();
+    header.primitives_per_node_ = bvh.max_surfels_per_node();
+    header.size_of_primitive_ = serialized_surfel::get_size();
+    header.primitive_ = (uint32_t)BVH_POINTCLOUD;
+    header.state_ = BVH_STATE_SERIALIZED;
+    header.translation_[0] = bvh.translation().x;
+    header.translation_[1] = bvh.translation().y;
+    header.translation_[2] = bvh.translation().z;
+
+    std::vector<float> boxes(6 * num_nodes);
+    std::vector<float> centroids(3 * num_nodes);
+    std::vector<float> extents(num_nodes);
+    std::vector<float> deviations(num_nodes);
+    std::vector<float> errors(num_nodes);
+    std::vector<uint8_t> visibility((num_nodes + 7) / 8, 0);
+
+    for (uint32_t i = 0; i < num_nodes; ++i) {
+        const auto &node = bvh_nodes[i];
+        for (int axis = 0; axis < 3; ++axis) {
+            boxes[6 * i + axis] = node.get_bounding_box().min()[axis];
+            boxes[6 * i + 3 + axis] = node.get_bounding_box().max()[axis];
+            centroids[3 * i + axis] = node.centroid()[axis];
+        }
+        extents[i] = node.avg_surfel_radius();
+        deviations[i] = node.max_surfel_radius_deviation();
+        errors[i] = node.reduction_error();
+        if (node.visibility() == bvh_node::node_invisible) {
+            visibility[i / 8] |= (uint8_t)(1 << (i % 8));
+        }
+    }
+
+    bvh_v3::codec_type codec = compress ? bvh_v3::CODEC_LZ4 : bvh_v3::CODEC_NONE;
+
+    bvh_v3::writer writer(header);
+    writer.add_section(bvh_v3::SECTION_BOUNDING_BOXES, sizeof(float), boxes.data(), boxes.size() * sizeof(float), codec);
+    writer.add_section(bvh_v3::SECTION_CENTROIDS, sizeof(float), centroids.data(), centroids.size() * sizeof(float), codec);
+    writer.add_section(bvh_v3::SECTION_AVG_PRIMITIVE_EXTENTS, sizeof(float), extents.data(), extents.size() * sizeof(float), codec);
+    writer.add_section(bvh_v3::SECTION_MAX_EXTENT_DEVIATIONS, sizeof(float), deviations.data(), deviations.size() * sizeof(float), codec);
+    writer.add_section(bvh_v3::SECTION_VISIBILITY, 1, visibility.data(), visibility.size(), codec);
+    writer.add_section(bvh_v3::SECTION_REDUCTION_ERRORS, sizeof(float), errors.data(), errors.size() * sizeof(float), codec);
+
+    if (bvh.has_node_layout()) {
+        const auto &file_indices = bvh.file_indices();
+        writer.add_section(bvh_v3::SECTION_NODE_LAYOUT, sizeof(uint32_t), file_indices.data(), file_indices.size() * sizeof(uint32_t), codec);
+    }
+
+    writer.write(filename);
+
+    std::cout << "BVH serialization successful" << std::endl;
+}
+
 }
 } // namespace lamure
@@ -138,7 +138,8 @@ serialize_prov(const std::vector<bvh_node> &nodes) {
                                    surfels_per_node_ :
                                    node.disk_array().length();
 
-        prov_vector prov_buffer(read_length);
+        // padded like the surfels, renderers address nodes by id * surfels_per_node
+        prov_vector prov_buffer(surfels_per_node_);
         node.disk_array().get_prov_file()->read(&prov_buffer, 0,
                                        node.disk_array().offset(),
                                        read_length);
@@ -0,0 +1,187 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/pre/prov_index.h>
+
+#include <lamure/pre/bvh.h>
+#include <lamure/pre/logger.h>
+#include <lamure/pre/prov.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace lamure {
+namespace pre {
+
+namespace {
+
+struct attribute_range
+{
+    float min_ = 0.f;
+    float max_ = 0.f;
+    uint32_t count_ = 0;
+};
+
+}
+
+uint32_t prov_index::
+bin_index(const float value,
+          const float range_min,
+          const float range_max,
+          const uint32_t num_bins)
+{
+    if (!(range_max > range_min))
+        return 0;
+
+    const float bin = (value - range_min) / (range_max - range_min) * float(num_bins);
+    if (!(bin > 0.f))
+        return 0;
+    if (bin >= float(num_bins))
+        return num_bins - 1;
+    return uint32_t(bin);
+}
+
+void prov_index::
+build(const bvh &tree,
+      const std::string &prov_file,
+      const std::string &index_file,
+      const size_t buffer_size,
+      const uint32_t num_bins)
+{
+    const uint32_t num_nodes = uint32_t(tree.nodes().size());
+    const size_t surfels_per_node = tree.max_surfels_per_node();
+    const uint32_t num_attributes = sizeof(prov) / sizeof(float);
+    const size_t node_bytes = surfels_per_node * sizeof(prov);
+    const size_t nodes_per_chunk = std::max<size_t>(1, buffer_size / node_bytes);
+
+    // the index is addressed by node id, the .prov file by file index
+    if (tree.has_node_layout()) {
+        LOGGER_WARN("Provenance file was reordered, no index written: " << prov_file);
+        return;
+    }
+
+    std::ifstream is(prov_file, std::ios::in | std::ios::binary);
+    if (!is.is_open())
+        throw std::runtime_error("Failed to open file: " + prov_file);
+
+    is.seekg(0, std::ios::end);
+    if (size_t(is.tellg()) != num_nodes * node_bytes) {
+        LOGGER_WARN("Provenance file is not laid out per node, no index written: " << prov_file);
+        return;
+    }
+
+    std::vector<float> values;
+    auto read_chunk = [&](const uint32_t first_node, const uint32_t num_chunk_nodes) {
+        values.resize(num_chunk_nodes * surfels_per_node * num_attributes);
+        is.seekg(first_node * node_bytes);
+        is.read(reinterpret_cast<char *>(values.data()), num_chunk_nodes * node_bytes);
+        if (!is)
+            throw std::runtime_error("Failed to read file: " + prov_file);
+    };
+    auto num_surfels = [&](const uint32_t node_id) {
+        return std::min<size_t>(tree.nodes()[node_id].disk_array().length(), surfels_per_node);
+    };
+
+    // first pass: per node and global ranges
+    std::vector<attribute_range> node_ranges(size_t(num_nodes) * num_attributes);
+    std::vector<attribute_range> global_ranges(num_attributes);
+
+    for (uint32_t first_node = 0; first_node < num_nodes; first_node += nodes_per_chunk) {
+        const uint32_t num_chunk_nodes = std::min<uint32_t>(nodes_per_chunk, num_nodes - first_node);
+        read_chunk(first_node, num_chunk_nodes);
+
+#pragma omp parallel for
+        for (uint32_t k = 0; k < num_chunk_nodes; ++k) {
+            const float *node_values = values.data() + k * surfels_per_node * num_attributes;
+            attribute_range *ranges = node_ranges.data() + size_t(first_node + k) * num_attributes;
+
+            for (size_t i = 0; i < num_surfels(first_node + k); ++i) {
+                for (uint32_t a = 0; a < num_attributes; ++a) {
+                    const float value = node_values[i * num_attributes + a];
+                    if (std::isnan(value))
+                        continue;
+                    attribute_range &range = ranges[a];
+                    range.min_ = range.count_ == 0 ? value : std::min(range.min_, value);
+                    range.max_ = range.count_ == 0 ? value : std::max(range.max_, value);
+                    ++range.count_;
+                }
+            }
+        }
+
+        for (uint32_t k = 0; k < num_chunk_nodes; ++k) {
+            for (uint32_t a = 0; a < num_attributes; ++a) {
+                const attribute_range &range = node_ranges[size_t(first_node + k) * num_attributes + a];
+                attribute_range &global = global_ranges[a];
+                if (range.count_ == 0)
+                    continue;
+                global.min_ = global.count_ == 0 ? range.min_ : std::min(global.min_, range.min_);
+                global.max_ = global.count_ == 0 ? range.max_ : std::max(global.max_, range.max_);
+                global.count_ += range.count_;
+            }
+        }
+    }
+
+    std::ofstream os(index_file, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os.is_open())
+        throw std::runtime_error("Failed to create file: " + index_file);
+
+    const uint32_t header[6] = {magic, version, num_nodes, tree.fan_factor(), num_attributes, num_bins};
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (const attribute_range &global : global_ranges) {
+        os.write(reinterpret_cast<const char *>(&global.min_), sizeof(float));
+        os.write(reinterpret_cast<const char *>(&global.max_), sizeof(float));
+    }
+
+    // second pass: histograms over the global ranges
+    const size_t record_size = 3 + num_bins;
+    std::vector<uint32_t> records;
+
+    for (uint32_t first_node = 0; first_node < num_nodes; first_node += nodes_per_chunk) {
+        const uint32_t num_chunk_nodes = std::min<uint32_t>(nodes_per_chunk, num_nodes - first_node);
+        read_chunk(first_node, num_chunk_nodes);
+        records.assign(num_chunk_nodes * num_attributes * record_size, 0);
+
+#pragma omp parallel for
+        for (uint32_t k = 0; k < num_chunk_nodes; ++k) {
+            const float *node_values = values.data() + k * surfels_per_node * num_attributes;
+            uint32_t *node_records = records.data() + k * num_attributes * record_size;
+
+            for (uint32_t a = 0; a < num_attributes; ++a) {
+                const attribute_range &range = node_ranges[size_t(first_node + k) * num_attributes + a];
+                uint32_t *record = node_records + a * record_size;
+                std::memcpy(&record[0], &range.min_, sizeof(float));
+                std::memcpy(&record[1], &range.max_, sizeof(float));
+                record[2] = range.count_;
+            }
+
+            for (size_t i = 0; i < num_surfels(first_node + k); ++i) {
+                for (uint32_t a = 0; a < num_attributes; ++a) {
+                    const float value = node_values[i * num_attributes + a];
+                    if (std::isnan(value))
+                        continue;
+                    const attribute_range &global = global_ranges[a];
+                    ++node_records[a * record_size + 3 + bin_index(value, global.min_, global.max_, num_bins)];
+                }
+            }
+        }
+
+        os.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(uint32_t));
+    }
+
+    os.close();
+    if (os.fail())
+        throw std::runtime_error("Failed to write file: " + index_file);
+
+    LOGGER_INFO("Provenance index: " << num_nodes << " nodes, " << num_attributes << " attributes, " << num_bins << " bins");
+}
+
+}
+} // namespace lamure
@@ -0,0 +1,376 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/pre/prov_join.h>
+
+#include <lamure/pre/bvh.h>
+#include <lamure/pre/io/file.h>
+#include <lamure/pre/logger.h>
+#include <lamure/pre/serialized_surfel.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#if WIN32
+  #include <ppl.h>
+#else
+  #include <parallel/algorithm>
+#endif
+
+namespace lamure {
+namespace pre {
+
+namespace {
+
+// a surfel as it ends up in the LOD file: float position and color. Leaf
+// surfels are copies of input surfels, so the key identifies them exactly.
+struct surfel_key
+{
+    uint64_t xy_;
+    uint64_t z_color_;
+    uint64_t slot_;
+
+    bool same_surfel(const surfel_key &other) const
+    { return xy_ == other.xy_ && z_color_ == other.z_color_; }
+
+    bool operator<(const surfel_key &other) const
+    {
+        if (xy_ != other.xy_) return xy_ < other.xy_;
+        if (z_color_ != other.z_color_) return z_color_ < other.z_color_;
+        return slot_ < other.slot_;
+    }
+};
+
+surfel_key
+make_key(const float x, const float y, const float z, const vec3b &color, const uint64_t slot)
+{
+    uint32_t bits[3];
+    std::memcpy(&bits[0], &x, 4);
+    std::memcpy(&bits[1], &y, 4);
+    std::memcpy(&bits[2], &z, 4);
+
+    return surfel_key{uint64_t(bits[0]) << 32 | bits[1],
+                      uint64_t(bits[2]) << 32 | uint64_t(color.x) << 16 | uint64_t(color.y) << 8 | color.z,
+                      slot};
+}
+
+template<typename T>
+void write_values(std::ostream &os, const std::vector<T> &values)
+{
+    if (!values.empty())
+        os.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+}
+
+template<typename T>
+void read_values(std::istream &is, std::vector<T> &values, const uint32_t count)
+{
+    values.resize(count);
+    if (count != 0)
+        is.read(reinterpret_cast<char *>(values.data()), count * sizeof(T));
+}
+
+}
+
+uint32_t prov_join::merge_map::
+add_group(const std::vector<uint32_t> &members,
+          const float mean_absolute_deviation,
+          const float standard_deviation,
+          const float coefficient_of_variation)
+{
+    const uint32_t group = uint32_t(group_offsets_.size() - 1);
+
+    group_members_.insert(group_members_.end(), members.begin(), members.end());
+    group_offsets_.push_back(uint32_t(group_members_.size()));
+    group_deviations_.push_back(mean_absolute_deviation);
+    group_deviations_.push_back(standard_deviation);
+    group_deviations_.push_back(coefficient_of_variation);
+
+    return group | group_flag;
+}
+
+void prov_join::
+write_map(std::ostream &os, const merge_map &map)
+{
+    const uint32_t header[4] = {map.node_id_,
+                                uint32_t(map.group_offsets_.size() - 1),
+                                uint32_t(map.group_members_.size()),
+                                uint32_t(map.outputs_.size())};
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+    write_values(os, map.group_offsets_);
+    write_values(os, map.group_members_);
+    write_values(os, map.group_deviations_);
+    write_values(os, map.outputs_);
+}
+
+void prov_join::
+read_map(std::istream &is, merge_map &map)
+{
+    uint32_t header[4];
+    is.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!is) {
+        throw std::runtime_error("unexpected end of provenance merge maps");
+    }
+    map.node_id_ = header[0];
+    read_values(is, map.group_offsets_, header[1] + 1);
+    read_values(is, map.group_members_, header[2]);
+    read_values(is, map.group_deviations_, header[1] * 3);
+    read_values(is, map.outputs_, header[3]);
+    if (!is) {
+        throw std::runtime_error("unexpected end of provenance merge maps");
+    }
+}
+
+prov_join::statistics prov_join::
+join(const bvh &tree,
+     const std::string &lod_file,
+     const std::string &map_file,
+     const std::string &surfel_input_file,
+     const std::string &prov_input_file,
+     const std::string &prov_output_file,
+     const size_t buffer_size,
+     const size_t memory_budget)
+{
+    // nodes are addressed at node_id * stride in the .lod and .prov files
+    if (tree.has_node_layout())
+        throw std::runtime_error("unable to join provenance, the .lod of this tree was reordered: " + lod_file);
+
+    statistics stats;
+
+    const size_t surfels_per_node = tree.max_surfels_per_node();
+    const uint32_t depth = tree.depth();
+    const node_id_type first_leaf = tree.get_first_node_id_of_depth(depth);
+    const size_t num_leaves = tree.get_length_of_depth(depth);
+    const vec3r translation = tree.translation();
+
+    const size_t node_size = serialized_surfel::get_size() * surfels_per_node;
+    const size_t node_bytes = surfels_per_node * sizeof(prov);
+
+    std::fstream output(prov_output_file, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        throw std::runtime_error("unable to open file " + prov_output_file);
+    }
+
+    surfel_file surfels;
+    surfels.open(surfel_input_file);
+    prov_file provs;
+    if (prov_input_file != "") {
+        provs.open(prov_input_file);
+        if (provs.get_size() != surfels.get_size()) {
+            LOGGER_ERROR("Num provenance data and num surfels must match!");
+        }
+    }
+
+    const size_t num_input = surfels.get_size();
+    const size_t surfels_in_buffer = std::max(buffer_size / (sizeof(surfel) + sizeof(prov)), size_t(1));
+    const size_t nodes_in_buffer = std::max(buffer_size / node_size, size_t(1));
+
+    // the leaves are matched in passes over contiguous node ranges, so that
+    // keys, counters and provenance of one pass fit into the memory budget
+    // next to the read buffers and one bit per input surfel
+    const size_t fixed_bytes = surfels_in_buffer * (sizeof(surfel) + sizeof(prov) + sizeof(size_t)) +
+                               nodes_in_buffer * node_size + num_input / 8;
+    const size_t leaf_bytes = surfels_per_node * (sizeof(surfel_key) + sizeof(uint32_t) + sizeof(prov));
+    const size_t leaves_per_pass = std::min(std::max((memory_budget > fixed_bytes ? memory_budget - fixed_bytes : 0) / leaf_bytes, size_t(1)), num_leaves);
+
+    std::ifstream lod(lod_file, std::ios::in | std::ios::binary);
+    if (!lod.is_open()) {
+        throw std::runtime_error("unable to open file " + lod_file);
+    }
+
+    // Input surfels are handed out in input order to the matching leaf surfels
+    // in slot order. Passes run in slot order and skip inputs taken by earlier
+    // passes, which gives the same assignment as a single pass over all leaves.
+    std::vector<bool> consumed(num_input, false);
+    std::vector<char> lod_buffer(node_size * nodes_in_buffer);
+    surfel_vector surfel_buffer;
+    prov_vector prov_buffer;
+    std::vector<size_t> candidates;
+    size_t matched = 0;
+    size_t num_leaf_surfels = 0;
+
+    for (size_t pass_first = 0; pass_first < num_leaves; pass_first += leaves_per_pass) {
+        const size_t pass_leaves = std::min(leaves_per_pass, num_leaves - pass_first);
+        ++stats.num_leaf_passes_;
+
+        // collect keys of the leaf surfels of this pass from the LOD file
+        std::vector<surfel_key> leaf_keys;
+        lod.seekg((first_leaf + pass_first) * node_size);
+        for (size_t first = 0; first < pass_leaves; first += nodes_in_buffer) {
+            const size_t count = std::min(nodes_in_buffer, pass_leaves - first);
+            lod.read(lod_buffer.data(), count * node_size);
+            stats.bytes_read_ += count * node_size;
+
+            for (size_t k = 0; k < count; ++k) {
+                const bvh_node &node = tree.nodes()[first_leaf + pass_first + first + k];
+                const size_t length = std::min(node.disk_array().length(), surfels_per_node);
+                for (size_t i = 0; i < length; ++i) {
+                    const surfel s = serialized_surfel().Deserialize(lod_buffer.data() + k * node_size + i * serialized_surfel::get_size()).get_surfel();
+                    leaf_keys.push_back(make_key(float(s.pos().x), float(s.pos().y), float(s.pos().z), s.color(), (first + k) * surfels_per_node + i));
+                }
+            }
+        }
+        num_leaf_surfels += leaf_keys.size();
+
+#if WIN32
+        Concurrency::parallel_sort(leaf_keys.begin(), leaf_keys.end());
+#else
+        __gnu_parallel::sort(leaf_keys.begin(), leaf_keys.end());
+#endif
+
+        // stream the input surfels and hand their provenance to matching leaf surfels.
+        // The first unused leaf surfel of a key is tracked at the first position of its range.
+        prov_vector child_provs(pass_leaves * surfels_per_node);
+        std::vector<uint32_t> num_used(leaf_keys.size(), 0);
+
+        for (size_t first = 0; first < num_input; first += surfels_in_buffer) {
+            const size_t count = std::min(surfels_in_buffer, num_input - first);
+            surfel_buffer.resize(count);
+            surfels.read(&surfel_buffer, 0, first, count);
+            stats.bytes_read_ += count * sizeof(surfel);
+            if (provs.is_open()) {
+                prov_buffer.resize(count);
+                provs.read(&prov_buffer, 0, first, count);
+                stats.bytes_read_ += count * sizeof(prov);
+            }
+
+            candidates.resize(count);
+#pragma omp parallel for
+            for (int64_t i = 0; i < int64_t(count); ++i) {
+                vec3r pos = surfel_buffer[i].pos();
+                pos += -translation;
+                const surfel_key key = make_key(float(pos.x), float(pos.y), float(pos.z), surfel_buffer[i].color(), 0);
+                const auto range = std::lower_bound(leaf_keys.begin(), leaf_keys.end(), key);
+                candidates[i] = (range != leaf_keys.end() && range->same_surfel(key)) ? size_t(range - leaf_keys.begin()) : leaf_keys.size();
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                const size_t range = candidates[i];
+                if (range == leaf_keys.size() || consumed[first + i]) {
+                    continue;
+                }
+                const size_t candidate = range + num_used[range];
+                if (candidate < leaf_keys.size() && leaf_keys[candidate].same_surfel(leaf_keys[range])) {
+                    ++num_used[range];
+                    consumed[first + i] = true;
+                    child_provs[leaf_keys[candidate].slot_] = provs.is_open() ? prov_buffer[i] : prov();
+                    ++matched;
+                }
+            }
+        }
+
+        output.seekp((first_leaf + pass_first) * node_bytes);
+        output.write(reinterpret_cast<const char *>(child_provs.data()), child_provs.size() * sizeof(prov));
+        stats.bytes_written_ += child_provs.size() * sizeof(prov);
+    }
+
+    lod.close();
+    surfels.close();
+    if (provs.is_open()) {
+        provs.close();
+    }
+    consumed = std::vector<bool>();
+    stats.num_unmatched_ = num_leaf_surfels - matched;
+
+    // replay the merge maps, written bottom up by the upsweep. Nodes of a level
+    // are processed in chunks, the children of a chunk are a contiguous range
+    // of the level below and are read back from the output file.
+    std::ifstream maps(map_file, std::ios::in | std::ios::binary);
+    if (!maps.is_open()) {
+        throw std::runtime_error("unable to open file " + map_file);
+    }
+
+    const size_t fan_factor = tree.fan_factor();
+    // provenance of a node and its children, plus an upper bound for its merge map
+    const size_t inner_bytes = (1 + fan_factor) * node_bytes + fan_factor * surfels_per_node * 5 * sizeof(uint32_t) + surfels_per_node * sizeof(uint32_t);
+    const size_t nodes_per_chunk = std::max(memory_budget / inner_bytes, size_t(1));
+
+    for (int32_t level = int32_t(depth) - 1; level >= 0; --level) {
+        const node_id_type first_node = tree.get_first_node_id_of_depth(level);
+        const size_t num_nodes = tree.get_length_of_depth(level);
+
+        for (size_t chunk_first = 0; chunk_first < num_nodes; chunk_first += nodes_per_chunk) {
+            const size_t chunk_nodes = std::min(nodes_per_chunk, num_nodes - chunk_first);
+            const node_id_type chunk_first_node = node_id_type(first_node + chunk_first);
+            const node_id_type first_child = tree.get_child_id(chunk_first_node, 0);
+
+            std::vector<merge_map> chunk_maps(chunk_nodes);
+            uint64_t map_bytes = 0;
+            for (size_t k = 0; k < chunk_nodes; ++k) {
+                merge_map &map = chunk_maps[k];
+                read_map(maps, map);
+                if (map.node_id_ != chunk_first_node + k) {
+                    throw std::runtime_error("provenance merge maps do not match the tree");
+                }
+                map_bytes += (4 + map.group_offsets_.size() + map.group_members_.size() + map.group_deviations_.size() + map.outputs_.size()) * 4;
+            }
+            stats.bytes_read_ += map_bytes;
+
+            prov_vector child_provs(chunk_nodes * fan_factor * surfels_per_node);
+            output.seekg(first_child * node_bytes);
+            output.read(reinterpret_cast<char *>(child_provs.data()), child_provs.size() * sizeof(prov));
+            if (!output) {
+                throw std::runtime_error("unable to read file " + prov_output_file);
+            }
+            stats.bytes_read_ += child_provs.size() * sizeof(prov);
+
+            prov_vector node_provs(chunk_nodes * surfels_per_node);
+
+#pragma omp parallel for schedule(dynamic, 16)
+            for (int64_t k = 0; k < int64_t(chunk_nodes); ++k) {
+                const merge_map &map = chunk_maps[k];
+                const size_t child_offset = (tree.get_child_id(uint32_t(chunk_first_node + k), 0) - first_child) * surfels_per_node;
+                const size_t num_groups = map.group_offsets_.size() - 1;
+                prov_vector groups(num_groups);
+
+                auto resolve = [&](const uint32_t ref) -> const prov & {
+                    return (ref & group_flag) ? groups[ref & ~group_flag] : child_provs[child_offset + ref];
+                };
+
+                // same aggregation as reduction_normal_deviation_clustering_provenance
+                for (size_t g = 0; g < num_groups; ++g) {
+                    prov &group = groups[g];
+                    const uint32_t begin = map.group_offsets_[g];
+                    const uint32_t end = map.group_offsets_[g + 1];
+                    for (uint32_t m = begin; m < end; ++m) {
+                        const prov &member = resolve(map.group_members_[m]);
+                        group.value_3_ += member.value_3_;
+                        group.value_4_ += member.value_4_;
+                        group.value_5_ += member.value_5_;
+                        group.value_6_ += member.value_6_;
+                    }
+                    group.value_3_ /= float(end - begin);
+                    group.value_4_ /= float(end - begin);
+                    group.value_5_ /= float(end - begin);
+                    group.value_6_ /= float(end - begin);
+                    group.mean_absolute_deviation_ = map.group_deviations_[g * 3];
+                    group.standard_deviation_ = map.group_deviations_[g * 3 + 1];
+                    group.coefficient_of_variation_ = map.group_deviations_[g * 3 + 2];
+                }
+
+                const size_t num_outputs = std::min(map.outputs_.size(), surfels_per_node);
+                for (size_t i = 0; i < num_outputs; ++i) {
+                    node_provs[k * surfels_per_node + i] = resolve(map.outputs_[i]);
+                }
+            }
+
+            output.seekp(chunk_first_node * node_bytes);
+            output.write(reinterpret_cast<const char *>(node_provs.data()), node_provs.size() * sizeof(prov));
+            stats.bytes_written_ += node_provs.size() * sizeof(prov);
+        }
+    }
+
+    output.close();
+
+    LOGGER_INFO("Provenance join: " << stats.num_unmatched_ << " leaf surfels without input match, " << stats.num_leaf_passes_ << " leaf passes");
+
+    return stats;
+}
+
+}
+} // namespace lamure
@@ -305,6 +305,19 @@ std::pair<vec3ui, vec3b> reduction_normal_deviation_clustering_provenance::compu
 
 surfel_mem_array reduction_normal_deviation_clustering_provenance::create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, std::vector<LoDMetaData> &deviations,
                                                                    const uint32_t surfels_per_node, const bvh &tree, const size_t start_node_id) const
+{
+    return create_lod(reduction_error, input, deviations, nullptr, surfels_per_node, tree, start_node_id);
+}
+
+surfel_mem_array reduction_normal_deviation_clustering_provenance::create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, prov_join::merge_map &merge_map,
+                                                                   const uint32_t surfels_per_node, const bvh &tree, const size_t start_node_id) const
+{
+    std::vector<LoDMetaData> deviations;
+    return create_lod(reduction_error, input, deviations, &merge_map, surfels_per_node, tree, start_node_id);
+}
+
+surfel_mem_array reduction_normal_deviation_clustering_provenance::create_lod(real &reduction_error, const std::vector<surfel_mem_array *> &input, std::vector<LoDMetaData> &deviations,
+                                                                   prov_join::merge_map *merge_map, const uint32_t surfels_per_node, const bvh &tree, const size_t start_node_id) const
 {
     bool provenance = input[0]->has_provenance();
 
@@ -392,7 +405,14 @@ surfel_mem_array reduction_normal_deviation_clustering_provenance::create_lod(re
             if((index[2] != 0) && (index[2] == grid_dimensions[2]))
                 index[2] = grid_dimensions[2] - 1;
 
-            grid[index[0]][index[1]][index[2]]->push_back(input[i]->read_surfel_ext(j));
+            if(merge_map != nullptr)
+            {
+                grid[index[0]][index[1]][index[2]]->push_back(surfel_ext{input[i]->read_surfel_ref(j), prov(), uint32_t(i * surfels_per_node + j)});
+            }
+            else
+            {
+                grid[index[0]][index[1]][index[2]]->push_back(input[i]->read_surfel_ext(j));
+            }
         }
     }
 
@@ -544,6 +564,16 @@ surfel_mem_array reduction_normal_deviation_clustering_provenance::create_lod(re
 
             LoDMetaData data = calculate_deviations(repr, surfels_to_merge);
 
+            if(merge_map != nullptr && surfels_to_merge.size() > 1)
+            {
+                std::vector<uint32_t> members;
+                for(const auto &member : surfels_to_merge)
+                {
+                    members.push_back(member.prov_ref_);
+                }
+                repr.prov_ref_ = merge_map->add_group(members, data._mean_absolute_deviation, data._standard_deviation, data._coefficient_of_variation);
+            }
+
             output_cluster->push_back(repr);
 
             provenance_cluster.push_back(data);
@@ -597,8 +627,8 @@ surfel_mem_array reduction_normal_deviation_clustering_provenance::create_lod(re
         prov_pq.push({provenance_cluster});
     }
 
-    surfel_mem_array mem_array(std::make_shared<surfel_vector>(surfel_vector()),
-                               std::make_shared<prov_vector>(prov_vector()), 0, 0);
+    surfel_mem_array mem_array = merge_map != nullptr ? surfel_mem_array(std::make_shared<surfel_vector>(surfel_vector()), 0, 0)
+                                                      : surfel_mem_array(std::make_shared<surfel_vector>(surfel_vector()), std::make_shared<prov_vector>(prov_vector()), 0, 0);
 
     while(!cell_pq.empty())
     {
@@ -613,7 +643,15 @@ surfel_mem_array reduction_normal_deviation_clustering_provenance::create_lod(re
 
         for(; surfel != cluster->end() && meta_data != prov_cluster.end(); ++surfel, ++meta_data)
         {
-            mem_array.write_surfel_ext(*surfel);
+            if(merge_map != nullptr)
+            {
+                mem_array.surfel_mem_data()->push_back(surfel->surfel_);
+                merge_map->outputs_.push_back(surfel->prov_ref_);
+            }
+            else
+            {
+                mem_array.write_surfel_ext(*surfel);
+            }
             deviations.push_back(*meta_data);
         }
 
@@ -16,11 +16,13 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <functional>
 
 namespace lamure {
 namespace prov {
 
 class octree;
+class aux_stream;
 
 class aux {
 public:
@@ -41,6 +43,23 @@ public:
       std::vector<feature> features_;
     };
 
+    //sparse point whose features are a range of the flat feature array of its chunk
+    struct flat_sparse_point {
+      scm::math::vec3f pos_;
+      uint8_t r_;
+      uint8_t g_;
+      uint8_t b_;
+      uint8_t a_;
+      uint64_t features_offset_;
+      uint32_t num_features_;
+    };
+
+    struct sparse_chunk {
+      uint64_t first_point_id_;
+      std::vector<flat_sparse_point> points_;
+      std::vector<feature> features_;
+    };
+
     struct view {
       uint32_t camera_id_;
       scm::math::vec3f position_;
@@ -60,13 +79,14 @@ public:
     };
 
                         aux();
+                        //segments of the file are loaded on first access
                         aux(const std::string& filename);
     virtual             ~aux() {}
 
     const std::string   get_filename() const { return filename_; }
-    const uint32_t      get_num_views() const { return views_.size(); }
-    const uint64_t      get_num_sparse_points() const { return sparse_points_.size(); }
-    const uint32_t      get_num_atlas_tiles() const { return atlas_tiles_.size(); }
+    const uint32_t      get_num_views() const;
+    const uint64_t      get_num_sparse_points() const;
+    const uint32_t      get_num_atlas_tiles() const;
 
     const view&         get_view(uint32_t id) const;
     const sparse_point& get_sparse_point(uint64_t id) const;
@@ -81,20 +101,37 @@ public:
 
     void                write_aux_file(const std::string& filename);
 
-    std::vector<sparse_point>& get_sparse_points() { return sparse_points_; };
+    std::vector<sparse_point>& get_sparse_points();
+
+    //visits the sparse points in chunks of at most max_points, points that
+    //are not resident yet are streamed from the file instead of being loaded
+    void                for_each_sparse_chunk(uint64_t max_points,
+                          const std::function<void(const sparse_chunk&)>& visit) const;
 
 protected:
 
     void                load_aux_file(const std::string& filename);
 
+    void                load_views() const;
+    void                load_sparse_points() const;
+    void                load_atlas_tiles() const;
+    void                load_octree() const;
+
 private:
 
-    std::vector<view> views_;
-    std::vector<sparse_point> sparse_points_;
-    std::vector<atlas_tile> atlas_tiles_;
-    std::shared_ptr<octree> octree_;
+    mutable std::vector<view> views_;
+    mutable std::vector<sparse_point> sparse_points_;
+    mutable std::vector<atlas_tile> atlas_tiles_;
+    mutable std::shared_ptr<octree> octree_;
     std::string filename_;
 
+    //indexed file the remaining segments are loaded from
+    std::shared_ptr<aux_stream> stream_;
+    mutable bool views_loaded_;
+    mutable bool sparse_points_loaded_;
+    mutable bool atlas_tiles_loaded_;
+    mutable bool octree_loaded_;
+
 };
 
 
@@ -21,10 +21,13 @@
 #include <vector>
 #include <cstring>
 #include <set>
+#include <memory>
 
 namespace lamure {
 namespace prov {
 
+class octree;
+
 class aux_stream
 {
 
@@ -44,6 +47,39 @@ public:
     void read_aux(const std::string& filename, aux& aux);
     void write_aux(const std::string& filename, aux& aux);
 
+    struct aux_segment {
+      char signature_[8];
+      size_t offset_; //first byte after the segment signature
+      size_t allocated_size_;
+      size_t used_size_;
+    };
+
+    //scans the signatures of all segments and keeps the stream open,
+    //so that the segments can be read on demand afterwards
+    void index_aux(const std::string& filename);
+    const std::vector<aux_segment>& segments() const { return segments_; };
+
+    void read_views(std::vector<aux::view>& views);
+    void read_atlas_tiles(std::vector<aux::atlas_tile>& tiles);
+    void read_sparse_points(std::vector<aux::sparse_point>& points);
+    std::shared_ptr<octree> read_octree();
+
+    const uint64_t get_num_sparse_points() const { return num_sparse_points_; };
+    void seek_sparse_points();
+    //reads the next points into a flat chunk, returns the number of points read
+    uint64_t read_sparse_chunk(uint64_t max_points, aux::sparse_chunk& chunk);
+
+    //incremental writing, segments are appended in the order of the calls and
+    //sparse points are written chunk by chunk between begin/end_sparse_points
+    void begin_aux(const std::string& filename);
+    void write_view(const aux::view& view);
+    void write_atlas_tile(const aux::atlas_tile& tile);
+    void begin_sparse_points();
+    void write_sparse_points(const aux::sparse_chunk& chunk);
+    void end_sparse_points();
+    void write_octree(const octree& tree);
+    void end_aux();
+
 
 protected:
 
@@ -132,7 +168,7 @@ protected:
             char* buffer = new char[text.length_];
             memset(buffer, 0, text.length_);
             file.read(buffer, text.length_);
-            text.string_ = std::string(buffer);
+            text.string_ = std::string(buffer, text.length_);
             delete[] buffer;
             
             size_t allocated_size = 8 + text.length_;
@@ -667,12 +703,21 @@ protected:
  
     void write(aux_serializable& serializable);
 
+    const aux_segment* find_segment(const char* signature) const;
+    std::vector<const aux_segment*> find_segments(const char* signature) const;
+
 
 private:
     aux_stream_type type_;    
     std::string filename_;
     std::fstream file_;
     uint32_t num_segments_;
+
+    std::vector<aux_segment> segments_;
+    uint64_t num_sparse_points_;
+    uint64_t next_sparse_point_;
+    size_t next_sparse_offset_;
+    size_t sparse_segment_offset_;
     
 
 };
@@ -0,0 +1,239 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_BULK_DECODER_H
+#define LAMURE_BULK_DECODER_H
+
+#include <lamure/prov/readable.h>
+#include <lamure/prov/common.h>
+#include <lamure/prov/dense_point.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace lamure {
+namespace prov
+{
+// Dense provenance decoded into one array per attribute. Image lists of all points share one id array each,
+// the ids of point i are found at [offsets[i], offsets[i + 1]).
+struct DenseColumns
+{
+    vec<float> positions;
+    vec<float> colors;
+    vec<float> normals;
+    vec<float> photometric_consistencies;
+
+    vec<uint64_t> images_seen_offsets;
+    vec<uint32_t> images_seen;
+    vec<uint64_t> images_not_seen_offsets;
+    vec<uint32_t> images_not_seen;
+
+    uint64_t size() const { return photometric_consistencies.size(); }
+    vec3f get_position(uint64_t index) const { return vec3f(positions[3 * index], positions[3 * index + 1], positions[3 * index + 2]); }
+    vec3f get_color(uint64_t index) const { return vec3f(colors[3 * index], colors[3 * index + 1], colors[3 * index + 2]); }
+    vec3f get_normal(uint64_t index) const { return vec3f(normals[3 * index], normals[3 * index + 1], normals[3 * index + 2]); }
+    uint64_t get_num_images_seen(uint64_t index) const { return images_seen_offsets[index + 1] - images_seen_offsets[index]; }
+    const uint32_t *get_images_seen(uint64_t index) const { return images_seen.data() + images_seen_offsets[index]; }
+    uint64_t get_num_images_not_seen(uint64_t index) const { return images_not_seen_offsets[index + 1] - images_not_seen_offsets[index]; }
+    const uint32_t *get_images_not_seen(uint64_t index) const { return images_not_seen.data() + images_not_seen_offsets[index]; }
+};
+
+// Reads provenance files in large blocks instead of one field per stream read and decodes them in parallel.
+class BulkDecoder : public Readable
+{
+  public:
+    // Reverses the byte order of consecutive 32-bit words in place if the host is little endian.
+    static void swap_words(char *data, uint64_t num_words)
+    {
+        if(BYTE_ORDER == BIG_ENDIAN)
+        {
+            return;
+        }
+
+        uint64_t i = 0;
+
+#if defined(__SSSE3__)
+        const __m128i shuffle = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+        for(; i + 4 <= num_words; i += 4)
+        {
+            __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 4 * i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(data + 4 * i), _mm_shuffle_epi8(words, shuffle));
+        }
+#elif defined(__SSE2__)
+        for(; i + 4 <= num_words; i += 4)
+        {
+            __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 4 * i));
+            // swap the 16-bit halves of each word, then the bytes of each half
+            words = _mm_shufflehi_epi16(_mm_shufflelo_epi16(words, 0xB1), 0xB1);
+            words = _mm_or_si128(_mm_slli_epi16(words, 8), _mm_srli_epi16(words, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(data + 4 * i), words);
+        }
+#endif
+
+        for(; i < num_words; i++)
+        {
+            uint32_t word = read_swapped<uint32_t>(data + 4 * i, true);
+            memcpy(data + 4 * i, &word, 4);
+        }
+    }
+
+    // Reads num_bytes from the current position of the stream.
+    static vec<char> read_block(ifstream &is, uint64_t num_bytes)
+    {
+        vec<char> block(num_bytes);
+        if(num_bytes > 0)
+        {
+            is.read(block.data(), num_bytes);
+            if((uint64_t)is.gcount() != num_bytes)
+            {
+                throw std::out_of_range("Unexpected end of provenance file");
+            }
+        }
+
+        return block;
+    }
+
+    // Reads everything from the current position up to the end of the stream.
+    static vec<char> read_remaining_block(ifstream &is)
+    {
+        std::streampos start = is.tellg();
+        is.seekg(0, std::ios::end);
+        uint64_t num_bytes = (uint64_t)(is.tellg() - start);
+        is.seekg(start);
+
+        return read_block(is, num_bytes);
+    }
+
+    // Decodes a dense .prov file and its .meta file into columns. Both streams are expected at the beginning of the file.
+    static void decode_dense(ifstream &is_prov, ifstream &is_meta, DenseColumns &columns)
+    {
+        read_header(is_prov);
+        read_header(is_meta);
+
+        uint32_t points_length = read_swapped<uint32_t>(read_block(is_prov, 4).data(), true);
+        uint32_t meta_data_length = read_swapped<uint32_t>(read_block(is_prov, 4).data(), true);
+
+        vec<char> point_block = read_block(is_prov, (uint64_t)points_length * DensePoint::RECORD_LENGTH);
+        vec<char> meta_block = read_block(is_meta, (uint64_t)points_length * meta_data_length);
+
+        decode_dense_points(point_block, points_length, columns);
+        decode_dense_metadata(meta_block, points_length, meta_data_length, columns);
+    }
+
+    static void decode_dense_points(vec<char> &point_block, uint32_t points_length, DenseColumns &columns)
+    {
+        const uint32_t words_per_record = DensePoint::RECORD_LENGTH / 4;
+
+        columns.positions.resize(3 * (uint64_t)points_length);
+        columns.colors.resize(3 * (uint64_t)points_length);
+        columns.normals.resize(3 * (uint64_t)points_length);
+
+        // All fields of a dense point are 32 bit, so the whole block is swapped as one array of words.
+        const int64_t chunk_length = 1 << 14;
+        const int64_t num_chunks = (points_length + chunk_length - 1) / chunk_length;
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for(int64_t chunk = 0; chunk < num_chunks; chunk++)
+        {
+            uint64_t first = chunk * chunk_length;
+            uint64_t last = std::min<uint64_t>(first + chunk_length, points_length);
+            char *data = point_block.data() + first * DensePoint::RECORD_LENGTH;
+
+            swap_words(data, (last - first) * words_per_record);
+
+            for(uint64_t i = first; i < last; i++, data += DensePoint::RECORD_LENGTH)
+            {
+                memcpy(&columns.positions[3 * i], data, 12);
+                memcpy(&columns.colors[3 * i], data + 12, 12);
+                memcpy(&columns.normals[3 * i], data + 24, 12);
+            }
+        }
+    }
+
+    static void decode_dense_metadata(vec<char> &meta_block, uint32_t points_length, uint32_t meta_data_length, DenseColumns &columns)
+    {
+        columns.photometric_consistencies.resize(points_length);
+        columns.images_seen_offsets.assign((uint64_t)points_length + 1, 0);
+        columns.images_not_seen_offsets.assign((uint64_t)points_length + 1, 0);
+
+        if(meta_data_length < 12)
+        {
+            if(points_length > 0)
+                throw std::out_of_range("Dense meta data record is too short");
+            return;
+        }
+
+        bool malformed = false;
+
+        // First pass counts the image ids of each point, so that both id arrays are allocated once at their final size.
+#pragma omp parallel for reduction(|| : malformed)
+        for(int64_t i = 0; i < (int64_t)points_length; i++)
+        {
+            const char *data = meta_block.data() + i * (uint64_t)meta_data_length;
+
+            uint32_t num_seen = read_swapped<uint32_t>(data + 4, true);
+            uint32_t num_not_seen = 0;
+            if(8 + 4 * (uint64_t)num_seen + 4 > meta_data_length)
+            {
+                malformed = true;
+                num_seen = 0;
+            }
+            else
+            {
+                num_not_seen = read_swapped<uint32_t>(data + 8 + 4 * num_seen, true);
+                if(8 + 4 * ((uint64_t)num_seen + num_not_seen) + 4 > meta_data_length)
+                {
+                    malformed = true;
+                    num_seen = 0;
+                    num_not_seen = 0;
+                }
+            }
+
+            columns.photometric_consistencies[i] = read_swapped<float>(data, true);
+            columns.images_seen_offsets[i + 1] = num_seen;
+            columns.images_not_seen_offsets[i + 1] = num_not_seen;
+        }
+
+        if(malformed)
+        {
+            throw std::out_of_range("Dense meta data record exceeds the declared meta data length");
+        }
+
+        for(uint64_t i = 0; i < points_length; i++)
+        {
+            columns.images_seen_offsets[i + 1] += columns.images_seen_offsets[i];
+            columns.images_not_seen_offsets[i + 1] += columns.images_not_seen_offsets[i];
+        }
+
+        columns.images_seen.resize(columns.images_seen_offsets[points_length]);
+        columns.images_not_seen.resize(columns.images_not_seen_offsets[points_length]);
+
+#pragma omp parallel for schedule(dynamic, 1024)
+        for(int64_t i = 0; i < (int64_t)points_length; i++)
+        {
+            const char *data = meta_block.data() + i * (uint64_t)meta_data_length;
+
+            uint64_t num_seen = columns.get_num_images_seen(i);
+            uint64_t num_not_seen = columns.get_num_images_not_seen(i);
+
+            char *seen = reinterpret_cast<char *>(columns.images_seen.data() + columns.images_seen_offsets[i]);
+            memcpy(seen, data + 8, 4 * num_seen);
+            swap_words(seen, num_seen);
+
+            char *not_seen = reinterpret_cast<char *>(columns.images_not_seen.data() + columns.images_not_seen_offsets[i]);
+            memcpy(not_seen, data + 12 + 4 * num_seen, 4 * num_not_seen);
+            swap_words(not_seen, num_not_seen);
+        }
+    }
+};
+}
+}
+
+#endif // LAMURE_BULK_DECODER_H
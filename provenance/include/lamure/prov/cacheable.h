@@ -11,7 +11,7 @@
 #include <lamure/prov/readable.h>
 #include <lamure/prov/common.h>
 #include <lamure/prov/point.h>
-#include <lamure/prov/cacheable.h>
+#include <lamure/prov/bulk_decoder.h>
 
 namespace lamure {
 namespace prov
@@ -47,16 +47,44 @@ class Cacheable : public Readable
         // if(DEBUG)
         //             printf("\nPoints meta data length: %i ", meta_data_length);
 
+        // Points and meta data are read in one block each and decoded in parallel into preallocated vectors,
+        // instead of issuing a stream read per field.
+        std::streampos points_start = (*is_prov).tellg();
+        vec<char> point_block = BulkDecoder::read_remaining_block(*is_prov);
+        vec<char> meta_block = BulkDecoder::read_block(*is_meta, (uint64_t)points_length * meta_data_length);
+
+        // Records may differ in length, so their offsets are found in a sequential scan first.
+        vec<uint64_t> record_offsets(points_length + 1, 0);
         for(uint32_t i = 0; i < points_length; i++)
         {
-            TPoint point = TPoint();
-            (*is_prov) >> point;
-            _points.push_back(point);
+            uint64_t offset = record_offsets[i];
+            if(offset + TPoint::MIN_RECORD_LENGTH > point_block.size() || offset + TPoint::record_length(&point_block[offset]) > point_block.size())
+            {
+                throw std::out_of_range("Unexpected end of provenance file");
+            }
+            record_offsets[i + 1] = offset + TPoint::record_length(&point_block[offset]);
+        }
+
+        _points.resize(points_length);
+        _points_metadata.resize(points_length);
+
+        bool malformed = false;
+
+#pragma omp parallel for schedule(dynamic, 1024) reduction(|| : malformed)
+        for(int64_t i = 0; i < (int64_t)points_length; i++)
+        {
+            _points[i].read_record(&point_block[record_offsets[i]]);
+            malformed = !_points_metadata[i].read_metadata(meta_block.data() + i * (uint64_t)meta_data_length, meta_data_length) || malformed;
+        }
 
-            TMetaData meta_container = TMetaData();
-            meta_container.read_metadata((*is_meta), meta_data_length);
-            _points_metadata.push_back(meta_container);
+        if(malformed)
+        {
+            throw std::out_of_range("Meta data record exceeds the declared meta data length");
         }
+
+        // Leave the stream behind the points, further sections follow in sparse files.
+        (*is_prov).clear();
+        (*is_prov).seekg(points_start + (std::streamoff)record_offsets[points_length]);
     }
 
     const vec<TPoint> &get_points() const { return _points; }
@@ -70,6 +98,8 @@ class Cacheable : public Readable
     }
 
   protected:
+    Cacheable() : is_prov(nullptr), is_meta(nullptr) {}
+
     ifstream *is_prov, *is_meta;
     vec<TPoint> _points;
     vec<TMetaData> _points_metadata;
@@ -10,6 +10,7 @@
 
 #include <lamure/prov/meta_data.h>
 #include <lamure/prov/common.h>
+#include <lamure/prov/image_probe.h>
 
 #include <memory>
 
@@ -44,6 +45,31 @@ class Camera
         }
     }
 
+    // Applies image metadata probed ahead of time, e.g. in parallel for all cameras of a cache.
+    void prepare(const ImageInfo &info)
+    {
+        _im_height = info.height;
+        _im_width = info.width;
+        _focal_length = info.focal_length * 0.001;
+        _fp_resolution_x = info.fp_resolution_unit == 2 ? info.fp_resolution_x / 0.0254 : info.fp_resolution_x / 0.01;
+        _fp_resolution_y = info.fp_resolution_unit == 2 ? info.fp_resolution_y / 0.0254 : info.fp_resolution_y / 0.01;
+
+        // std::cout << info.focal_length << std::endl;
+        // std::cout << info.fp_resolution_x << std::endl;
+        if(_fp_resolution_x == 0 && _fp_resolution_y == 0)
+        {
+            // _fp_resolution_x = 5715.545755 / 0.0254;
+            // _fp_resolution_x = (2976 / 0.384615385) / 0.0254;
+            // _fp_resolution_y = (2976 / 0.384615385) / 0.0254;
+            // how many pixels are inside 1m = 1m / (1.12nm / 1'000'000)
+            _fp_resolution_x = 1.0f / (1.12 / 1000000);
+            _fp_resolution_y = 1.0f / (1.12 / 1000000);
+        }
+
+        // if(DEBUG)
+        // printf("Focal length: %f, FP Resolution X: %f, Y: %f\n", _focal_length, _fp_resolution_x, _fp_resolution_y);
+    }
+
     int get_index() { return _index; }
     quatf &get_orientation() { return _orientation; }
     string &get_file_name() { return _im_file_name; }
@@ -135,49 +161,15 @@ class Camera
     {
         std::cout << "Reading image " << fotos_directory+_im_file_name << std::endl;
 
-        FILE *fp = fopen((fotos_directory+_im_file_name).c_str(), "rb");
-        if(!fp)
+        ImageInfo info;
+        if(!ImageProbe::probe(fotos_directory + _im_file_name, info))
         {
-            std::stringstream sstr;
-            sstr << "Can't open file: \'" << _im_file_name << '\'';
-            throw std::runtime_error(sstr.str());
-        }
-        fseek(fp, 0, SEEK_END);
-        size_t fsize = (size_t)ftell(fp);
-        rewind(fp);
-        unsigned char *buf = new unsigned char[fsize];
-        if(fread(buf, 1, fsize, fp) != fsize)
-        {
-            delete[] buf;
             std::stringstream sstr;
             sstr << "Can't read file: \'" << _im_file_name << '\'';
             throw std::runtime_error(sstr.str());
         }
-        fclose(fp);
-
-        easyexif::EXIFInfo result;
-        result.parseFrom(buf, (unsigned int)fsize);
-
-        _im_height = result.ImageHeight;
-        _im_width = result.ImageWidth;
-        _focal_length = result.FocalLength * 0.001;
-        _fp_resolution_x = result.LensInfo.FocalPlaneResolutionUnit == 2 ? result.LensInfo.FocalPlaneXResolution / 0.0254 : result.LensInfo.FocalPlaneXResolution / 0.01;
-        _fp_resolution_y = result.LensInfo.FocalPlaneResolutionUnit == 2 ? result.LensInfo.FocalPlaneYResolution / 0.0254 : result.LensInfo.FocalPlaneYResolution / 0.01;
-
-        // std::cout << result.FocalLength << std::endl;
-        // std::cout << result.LensInfo.FocalPlaneXResolution << std::endl;
-        if(_fp_resolution_x == 0 && _fp_resolution_y == 0)
-        {
-            // _fp_resolution_x = 5715.545755 / 0.0254;
-            // _fp_resolution_x = (2976 / 0.384615385) / 0.0254;
-            // _fp_resolution_y = (2976 / 0.384615385) / 0.0254;
-            // how many pixels are inside 1m = 1m / (1.12nm / 1'000'000)
-            _fp_resolution_x = 1.0f / (1.12 / 1000000);
-            _fp_resolution_y = 1.0f / (1.12 / 1000000);
-        }
 
-        // if(DEBUG)
-        // printf("Focal length: %f, FP Resolution X: %f, Y: %f\n", _focal_length, _fp_resolution_x, _fp_resolution_y);
+        prepare(info);
     }
 
   protected:
@@ -0,0 +1,95 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_COLUMNAR_STORE_H
+#define LAMURE_COLUMNAR_STORE_H
+
+#include <lamure/prov/common.h>
+#include <lamure/prov/bulk_decoder.h>
+
+namespace lamure {
+namespace prov
+{
+// Native little endian file holding dense provenance as one section per attribute, so that it can be memory mapped
+// and used in place. Image lists are stored in CSR form: the ids of point i are found at [offsets[i], offsets[i + 1]).
+//
+// Layout: header, followed by the sections in the order of the Section enum, each aligned to SECTION_ALIGNMENT bytes.
+class ColumnarStore
+{
+  public:
+    enum Section
+    {
+        POSITIONS = 0,
+        COLORS,
+        NORMALS,
+        PHOTOMETRIC_CONSISTENCIES,
+        IMAGES_SEEN_OFFSETS,
+        IMAGES_NOT_SEEN_OFFSETS,
+        IMAGES_SEEN,
+        IMAGES_NOT_SEEN,
+        NUM_SECTIONS
+    };
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t num_sections;
+        uint64_t num_points;
+        uint64_t section_offsets[NUM_SECTIONS];
+        uint64_t section_lengths[NUM_SECTIONS];
+    };
+
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+    static const uint64_t SECTION_ALIGNMENT = 64;
+
+    ColumnarStore();
+    ~ColumnarStore();
+
+    void open(const string &file_name);
+    void close();
+    bool is_open() const { return _data != nullptr; }
+
+    uint64_t size() const { return _header.num_points; }
+
+    span<vec3f> get_positions() const { return get_section<vec3f>(POSITIONS); }
+    span<vec3f> get_colors() const { return get_section<vec3f>(COLORS); }
+    span<vec3f> get_normals() const { return get_section<vec3f>(NORMALS); }
+    span<float> get_photometric_consistencies() const { return get_section<float>(PHOTOMETRIC_CONSISTENCIES); }
+    span<uint64_t> get_images_seen_offsets() const { return get_section<uint64_t>(IMAGES_SEEN_OFFSETS); }
+    span<uint64_t> get_images_not_seen_offsets() const { return get_section<uint64_t>(IMAGES_NOT_SEEN_OFFSETS); }
+
+    span<uint32_t> get_images_seen(uint64_t index) const;
+    span<uint32_t> get_images_not_seen(uint64_t index) const;
+
+    // Writes columns decoded in memory.
+    static void write(const string &file_name, const DenseColumns &columns);
+
+    // Converts a dense .prov file and its .meta file, both expected at the beginning of the file. Points are decoded
+    // in chunks of points_per_chunk, so the whole data set never has to fit into memory.
+    static void convert(ifstream &is_prov, ifstream &is_meta, const string &file_name, uint64_t points_per_chunk = 1 << 22);
+
+  private:
+    template <typename T>
+    span<T> get_section(Section section) const
+    {
+        return span<T>(reinterpret_cast<const T *>(_data + _header.section_offsets[section]), _header.section_lengths[section] / sizeof(T));
+    }
+
+    static Header create_header(uint64_t num_points, uint64_t num_images_seen, uint64_t num_images_not_seen);
+
+    const char *_data;
+    uint64_t _size;
+    bool _mapped;
+    vec<char> _buffer;
+    Header _header;
+};
+}
+}
+
+#endif // LAMURE_COLUMNAR_STORE_H
@@ -23,12 +23,15 @@
 #include <fstream>
 #include <memory>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <vector>
 
 #include <scm/core.h>
 #include <scm/core/math.h>
 
+#include <lamure/prov/span.h>
+
 namespace lamure {
 namespace prov
 {
@@ -84,6 +87,14 @@ T swap(const T &arg, bool big_in_mem)
     }
 }
 
+template <typename T>
+T read_swapped(const char *data, bool big_in_mem)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return swap(value, big_in_mem);
+}
+
 static inline std::string &ltrim(std::string &s)
 {
     s.erase(s.begin(), std::find_if(s.begin(), s.end(), std::not1(std::ptr_fun<int, int>(std::isspace))));
@@ -11,7 +11,10 @@
 #include <lamure/prov/common.h>
 #include <lamure/prov/dense_point.h>
 #include <lamure/prov/dense_meta_data.h>
+#include <lamure/prov/bulk_decoder.h>
 #include <lamure/prov/cacheable.h>
+#include <lamure/prov/columnar_store.h>
+#include <lamure/prov/image_sets.h>
 #include <lamure/prov/streamable.h>
 
 namespace lamure {
@@ -21,7 +24,52 @@ class DenseCache : public Cacheable<DensePoint, DenseMetaData>
 {
   public:
     DenseCache(ifstream &is_prov, ifstream &is_meta) : Cacheable(is_prov, is_meta){};
+    // Cache that is only used with map_columns().
+    DenseCache() : Cacheable(){};
     ~DenseCache(){};
+
+    // Alternative to cache(), decodes the files into one array per attribute instead of one object per point.
+    void cache_columns() { BulkDecoder::decode_dense((*is_prov), (*is_meta), _columns); }
+    const DenseColumns &get_columns() const { return _columns; }
+
+    // Maps a file written by ColumnarStore, its attributes are used in place without decoding anything.
+    void map_columns(const string &file_name) { _store.open(file_name); }
+    const ColumnarStore &get_store() const { return _store; }
+
+    // Interns the image lists of whichever representation was loaded. With release_point_lists the lists of cached
+    // points are freed afterwards, leaving get_image_sets() as the only copy.
+    void intern_image_sets(bool release_point_lists = false)
+    {
+        _image_sets = ImageSets();
+        if(!_points_metadata.empty())
+        {
+            _image_sets.add_points(_points_metadata.size(), [&](uint64_t i) { return span<uint32_t>(_points_metadata[i].get_images_seen()); },
+                                   [&](uint64_t i) { return span<uint32_t>(_points_metadata[i].get_images_not_seen()); });
+            if(release_point_lists)
+            {
+                for(DenseMetaData &metadata : _points_metadata)
+                {
+                    metadata.set_images_seen(vec<uint32_t>());
+                    metadata.set_images_not_seen(vec<uint32_t>());
+                }
+            }
+        }
+        else if(_columns.size() > 0)
+        {
+            _image_sets.add_points(_columns.size(), [&](uint64_t i) { return span<uint32_t>(_columns.get_images_seen(i), _columns.get_num_images_seen(i)); },
+                                   [&](uint64_t i) { return span<uint32_t>(_columns.get_images_not_seen(i), _columns.get_num_images_not_seen(i)); });
+        }
+        else if(_store.is_open())
+        {
+            _image_sets.add_points(_store.size(), [&](uint64_t i) { return _store.get_images_seen(i); }, [&](uint64_t i) { return _store.get_images_not_seen(i); });
+        }
+    }
+    const ImageSets &get_image_sets() const { return _image_sets; }
+
+  protected:
+    DenseColumns _columns;
+    ColumnarStore _store;
+    ImageSets _image_sets;
 };
 }
 }
@@ -76,12 +76,52 @@ class DenseMetaData : public MetaData
         }
     }
 
+    // Decodes the record without keeping a copy of the raw bytes, image lists are allocated once at their final size.
+    virtual bool read_metadata(const char *data, uint32_t meta_data_length) override
+    {
+        if(meta_data_length < 12)
+        {
+            return false;
+        }
+
+        _photometric_consistency = read_swapped<float>(data, true);
+
+        uint32_t num_seen = read_swapped<uint32_t>(data + 4, true);
+        if(8 + 4 * (uint64_t)num_seen + 4 > meta_data_length)
+        {
+            return false;
+        }
+
+        const char *seen_data = data + 8;
+        uint32_t num_not_seen = read_swapped<uint32_t>(seen_data + 4 * num_seen, true);
+        if(8 + 4 * ((uint64_t)num_seen + num_not_seen) + 4 > meta_data_length)
+        {
+            return false;
+        }
+
+        const char *not_seen_data = seen_data + 4 * num_seen + 4;
+
+        _images_seen.resize(num_seen);
+        for(uint32_t i = 0; i < num_seen; i++)
+        {
+            _images_seen[i] = read_swapped<uint32_t>(seen_data + 4 * i, true);
+        }
+
+        _images_not_seen.resize(num_not_seen);
+        for(uint32_t i = 0; i < num_not_seen; i++)
+        {
+            _images_not_seen[i] = read_swapped<uint32_t>(not_seen_data + 4 * i, true);
+        }
+
+        return true;
+    }
+
     float get_photometric_consistency() const { return _photometric_consistency; }
-    vec<uint32_t> get_images_seen() const { return _images_seen; }
-    vec<uint32_t> get_images_not_seen() const { return _images_not_seen; }
+    const vec<uint32_t> &get_images_seen() const { return _images_seen; }
+    const vec<uint32_t> &get_images_not_seen() const { return _images_not_seen; }
     void set_photometric_consistency(float _photometric_consistency) { this->_photometric_consistency = _photometric_consistency; }
-    void set_images_seen(vec<uint32_t> _images_seen) { this->_images_seen = _images_seen; }
-    void set_images_not_seen(vec<uint32_t> _images_not_seen) { this->_images_not_seen = _images_not_seen; }
+    void set_images_seen(vec<uint32_t> _images_seen) { this->_images_seen = std::move(_images_seen); }
+    void set_images_not_seen(vec<uint32_t> _images_not_seen) { this->_images_not_seen = std::move(_images_not_seen); }
 
     friend class boost::serialization::access;
     template <class Archive>
@@ -37,7 +37,17 @@ class DensePoint : public Point
 
         return is;
     }
+    void read_record(const char *data)
+    {
+        data = read_essentials(data);
+
+        for(int i = 0; i < 3; i++)
+            _normal[i] = read_swapped<float>(data + 4 * i, true);
+    }
+    static uint32_t record_length(const char *data) { return RECORD_LENGTH; }
     static const uint32_t ENTITY_LENGTH = 72;
+    static const uint32_t RECORD_LENGTH = 36;
+    static const uint32_t MIN_RECORD_LENGTH = RECORD_LENGTH;
 
   protected:
     vec3f _normal;
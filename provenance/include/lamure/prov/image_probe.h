@@ -0,0 +1,229 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_IMAGE_PROBE_H
+#define LAMURE_IMAGE_PROBE_H
+
+#include <lamure/prov/common.h>
+
+#include <map>
+#include <sys/stat.h>
+
+namespace lamure {
+namespace prov
+{
+// Image metadata needed by cameras, taken from the JPEG headers only.
+struct ImageInfo
+{
+    ImageInfo() : width(0), height(0), focal_length(0.), fp_resolution_unit(0), fp_resolution_x(0.), fp_resolution_y(0.) {}
+
+    uint32_t width;
+    uint32_t height;
+    // EXIF focal length in millimeters and focal plane resolution
+    double focal_length;
+    uint16_t fp_resolution_unit;
+    double fp_resolution_x;
+    double fp_resolution_y;
+};
+
+class ImageProbe
+{
+  public:
+    // Walks the JPEG markers up to the start of scan. Dimensions are taken from the EXIF segment, or from the frame
+    // header if EXIF does not provide them. Pixel data is never read. Returns false only if the file can't be opened,
+    // files that are no JPEG leave info zeroed.
+    static bool probe(const string &file_name, ImageInfo &info)
+    {
+        FILE *fp = fopen(file_name.c_str(), "rb");
+        if(!fp)
+        {
+            return false;
+        }
+
+        info = ImageInfo();
+        uint32_t frame_width = 0;
+        uint32_t frame_height = 0;
+        bool is_jpeg = fgetc(fp) == 0xFF && fgetc(fp) == 0xD8;
+
+        while(is_jpeg)
+        {
+            int byte = fgetc(fp);
+            if(byte != 0xFF)
+            {
+                break;
+            }
+            int marker = fgetc(fp);
+            while(marker == 0xFF)
+            {
+                marker = fgetc(fp);
+            }
+            if(marker == EOF || marker == 0xD9 || marker == 0xDA)
+            {
+                break;
+            }
+            if(marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+            {
+                continue;
+            }
+
+            int length_high = fgetc(fp);
+            int length_low = fgetc(fp);
+            if(length_low == EOF)
+            {
+                break;
+            }
+            long length = (length_high << 8 | length_low) - 2;
+            if(length < 0)
+            {
+                break;
+            }
+
+            bool is_frame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if(is_frame && length >= 5)
+            {
+                unsigned char frame[5];
+                if(fread(frame, 1, 5, fp) != 5)
+                {
+                    break;
+                }
+                frame_height = frame[1] << 8 | frame[2];
+                frame_width = frame[3] << 8 | frame[4];
+                length -= 5;
+            }
+            else if(marker == 0xE1 && length >= 6)
+            {
+                vec<unsigned char> segment(length);
+                if(fread(segment.data(), 1, length, fp) != (size_t)length)
+                {
+                    break;
+                }
+                length = 0;
+
+                easyexif::EXIFInfo exif;
+                if(exif.parseFromEXIFSegment(segment.data(), (unsigned)segment.size()) == PARSE_EXIF_SUCCESS)
+                {
+                    info.width = exif.ImageWidth;
+                    info.height = exif.ImageHeight;
+                    info.focal_length = exif.FocalLength;
+                    info.fp_resolution_unit = exif.LensInfo.FocalPlaneResolutionUnit;
+                    info.fp_resolution_x = exif.LensInfo.FocalPlaneXResolution;
+                    info.fp_resolution_y = exif.LensInfo.FocalPlaneYResolution;
+                }
+            }
+
+            if(fseek(fp, length, SEEK_CUR) != 0)
+            {
+                break;
+            }
+        }
+
+        fclose(fp);
+
+        if(info.width == 0 || info.height == 0)
+        {
+            info.width = frame_width;
+            info.height = frame_height;
+        }
+
+        return true;
+    }
+};
+
+// Sidecar file of probed image metadata. Entries are keyed by file path and only used while modification time and size
+// of the image are unchanged.
+class ImageInfoCache
+{
+  public:
+    ImageInfoCache(const string &file_name) : _file_name(file_name), _modified(false)
+    {
+        ifstream is(_file_name);
+        string line;
+        while(std::getline(is, line))
+        {
+            std::istringstream line_ss(line);
+            Entry entry;
+            line_ss >> entry.mtime >> entry.size >> entry.info.width >> entry.info.height >> entry.info.focal_length >> entry.info.fp_resolution_unit >>
+                entry.info.fp_resolution_x >> entry.info.fp_resolution_y;
+            string path;
+            std::getline(line_ss, path);
+            if(!line_ss.fail() && path.size() > 1)
+            {
+                _entries[path.substr(1)] = entry;
+            }
+        }
+    }
+
+    bool lookup(const string &path, ImageInfo &info) const
+    {
+        auto it = _entries.find(path);
+        uint64_t mtime, size;
+        if(it == _entries.end() || !stamp(path, mtime, size) || it->second.mtime != mtime || it->second.size != size)
+        {
+            return false;
+        }
+        info = it->second.info;
+        return true;
+    }
+
+    void insert(const string &path, const ImageInfo &info)
+    {
+        Entry entry;
+        entry.info = info;
+        if(stamp(path, entry.mtime, entry.size))
+        {
+            _entries[path] = entry;
+            _modified = true;
+        }
+    }
+
+    // Failing to write the sidecar only costs probing again, so errors are ignored.
+    void save()
+    {
+        if(!_modified)
+        {
+            return;
+        }
+
+        ofstream os(_file_name);
+        os.precision(17);
+        for(const auto &it : _entries)
+        {
+            const Entry &entry = it.second;
+            os << entry.mtime << " " << entry.size << " " << entry.info.width << " " << entry.info.height << " " << entry.info.focal_length << " "
+               << entry.info.fp_resolution_unit << " " << entry.info.fp_resolution_x << " " << entry.info.fp_resolution_y << " " << it.first << "\n";
+        }
+        _modified = false;
+    }
+
+  private:
+    struct Entry
+    {
+        uint64_t mtime;
+        uint64_t size;
+        ImageInfo info;
+    };
+
+    static bool stamp(const string &path, uint64_t &mtime, uint64_t &size)
+    {
+        struct stat status;
+        if(stat(path.c_str(), &status) != 0)
+        {
+            return false;
+        }
+        mtime = (uint64_t)status.st_mtime;
+        size = (uint64_t)status.st_size;
+        return true;
+    }
+
+    string _file_name;
+    bool _modified;
+    std::map<string, Entry> _entries;
+};
+}
+}
+
+#endif // LAMURE_IMAGE_PROBE_H
@@ -0,0 +1,371 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_IMAGE_SETS_H
+#define LAMURE_IMAGE_SETS_H
+
+#include <lamure/prov/common.h>
+
+#include <unordered_map>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace lamure {
+namespace prov
+{
+// Distinct image id sets, each stored once. Sets are encoded roaring style: ids are split by their high 16 bits into
+// containers, which hold the low 16 bits either as a sorted array or, where that is smaller, as a bitmap over the words
+// between the lowest and the highest id. Set 0 is the empty set.
+class ImageSetDictionary
+{
+  public:
+    ImageSetDictionary() : _container_offsets(2, 0) {}
+
+    // Returns the id of the set holding [begin, end), which has to be sorted and free of duplicates.
+    uint32_t intern(const uint32_t *begin, const uint32_t *end) { return intern(begin, end, hash_ids(begin, end)); }
+    uint32_t intern(const uint32_t *begin, const uint32_t *end, uint64_t hash)
+    {
+        if(begin == end)
+        {
+            return 0;
+        }
+
+        auto range = _lookup.equal_range(hash);
+        for(auto it = range.first; it != range.second; ++it)
+        {
+            if(equals(it->second, begin, end))
+            {
+                return it->second;
+            }
+        }
+
+        uint32_t set = size();
+        encode(begin, end);
+        _lookup.emplace(hash, set);
+        return set;
+    }
+
+    uint32_t size() const { return (uint32_t)_container_offsets.size() - 1; }
+
+    uint32_t cardinality(uint32_t set) const
+    {
+        uint32_t cardinality = 0;
+        for(uint32_t c = _container_offsets[set]; c < _container_offsets[set + 1]; c++)
+        {
+            cardinality += _containers[c].cardinality;
+        }
+        return cardinality;
+    }
+
+    bool contains(uint32_t set, uint32_t image) const
+    {
+        for(uint32_t c = _container_offsets[set]; c < _container_offsets[set + 1]; c++)
+        {
+            const Container &container = _containers[c];
+            if(container.key == image >> 16)
+            {
+                uint16_t low = image & 0xFFFF;
+                if(container.is_bitmap)
+                {
+                    uint32_t word = low >> 6;
+                    return word >= container.first_word && word < (uint32_t)container.first_word + container.length &&
+                           (_bitmaps[container.offset + word - container.first_word] >> (low & 63) & 1) != 0;
+                }
+                const uint16_t *array = _arrays.data() + container.offset;
+                return std::binary_search(array, array + container.length, low);
+            }
+        }
+        return false;
+    }
+
+    // True if the set holds every id of images.
+    bool contains_all(uint32_t set, const vec<uint32_t> &images) const
+    {
+        for(uint32_t image : images)
+        {
+            if(!contains(set, image))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Calls f with every id of the set in ascending order.
+    template <typename F>
+    void for_each(uint32_t set, F f) const
+    {
+        for(uint32_t c = _container_offsets[set]; c < _container_offsets[set + 1]; c++)
+        {
+            const Container &container = _containers[c];
+            uint32_t high = (uint32_t)container.key << 16;
+            if(container.is_bitmap)
+            {
+                for(uint32_t w = 0; w < container.length; w++)
+                {
+                    uint64_t word = _bitmaps[container.offset + w];
+                    while(word != 0)
+                    {
+                        uint32_t bit = count_trailing_zeros(word);
+                        f(high | ((container.first_word + w) << 6 | bit));
+                        word &= word - 1;
+                    }
+                }
+            }
+            else
+            {
+                for(uint32_t i = 0; i < container.length; i++)
+                {
+                    f(high | _arrays[container.offset + i]);
+                }
+            }
+        }
+    }
+
+    void decode(uint32_t set, vec<uint32_t> &images) const
+    {
+        images.clear();
+        images.reserve(cardinality(set));
+        for_each(set, [&](uint32_t image) { images.push_back(image); });
+    }
+
+    vec<uint32_t> intersect(uint32_t set_a, uint32_t set_b) const
+    {
+        vec<uint32_t> result;
+        for_each(set_a, [&](uint32_t image) {
+            if(contains(set_b, image))
+            {
+                result.push_back(image);
+            }
+        });
+        return result;
+    }
+
+    // Approximate bytes held, including the lookup table used for interning.
+    uint64_t memory_usage() const
+    {
+        return _container_offsets.capacity() * sizeof(uint32_t) + _containers.capacity() * sizeof(Container) + _arrays.capacity() * sizeof(uint16_t) +
+               _bitmaps.capacity() * sizeof(uint64_t) + _lookup.size() * (sizeof(pair<const uint64_t, uint32_t>) + sizeof(void *)) +
+               _lookup.bucket_count() * sizeof(void *);
+    }
+
+    static uint64_t hash_ids(const uint32_t *begin, const uint32_t *end)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for(const uint32_t *it = begin; it != end; ++it)
+        {
+            hash = (hash ^ *it) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+  private:
+    static uint32_t count_trailing_zeros(uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long bit;
+        _BitScanForward64(&bit, word);
+        return (uint32_t)bit;
+#else
+        return (uint32_t)__builtin_ctzll(word);
+#endif
+    }
+
+    struct Container
+    {
+        uint16_t key;
+        uint16_t first_word;
+        uint16_t is_bitmap;
+        // array entries or bitmap words
+        uint16_t length;
+        uint32_t cardinality;
+        uint32_t offset;
+    };
+
+    void encode(const uint32_t *begin, const uint32_t *end)
+    {
+        for(const uint32_t *first = begin; first != end;)
+        {
+            uint32_t key = *first >> 16;
+            const uint32_t *last = first;
+            while(last != end && *last >> 16 == key)
+            {
+                ++last;
+            }
+
+            uint32_t cardinality = (uint32_t)(last - first);
+            uint32_t first_word = (*first & 0xFFFF) >> 6;
+            uint32_t num_words = (*(last - 1) & 0xFFFF) / 64 - first_word + 1;
+
+            Container container;
+            container.key = (uint16_t)key;
+            container.first_word = (uint16_t)first_word;
+            container.cardinality = cardinality;
+
+            if(num_words * sizeof(uint64_t) < cardinality * sizeof(uint16_t))
+            {
+                container.is_bitmap = 1;
+                container.length = (uint16_t)num_words;
+                container.offset = (uint32_t)_bitmaps.size();
+                _bitmaps.resize(_bitmaps.size() + num_words, 0);
+                for(const uint32_t *it = first; it != last; ++it)
+                {
+                    uint32_t low = *it & 0xFFFF;
+                    _bitmaps[container.offset + (low >> 6) - first_word] |= 1ull << (low & 63);
+                }
+            }
+            else
+            {
+                container.is_bitmap = 0;
+                container.length = (uint16_t)cardinality;
+                container.offset = (uint32_t)_arrays.size();
+                for(const uint32_t *it = first; it != last; ++it)
+                {
+                    _arrays.push_back((uint16_t)(*it & 0xFFFF));
+                }
+            }
+
+            _containers.push_back(container);
+            first = last;
+        }
+        _container_offsets.push_back((uint32_t)_containers.size());
+    }
+
+    bool equals(uint32_t set, const uint32_t *begin, const uint32_t *end) const
+    {
+        if(cardinality(set) != (uint64_t)(end - begin))
+        {
+            return false;
+        }
+        bool equal = true;
+        const uint32_t *it = begin;
+        for_each(set, [&](uint32_t image) { equal = equal && image == *it++; });
+        return equal;
+    }
+
+    vec<uint32_t> _container_offsets;
+    vec<Container> _containers;
+    vec<uint16_t> _arrays;
+    vec<uint64_t> _bitmaps;
+    std::unordered_multimap<uint64_t, uint32_t> _lookup;
+};
+
+// Image lists of dense points, interned: every point references its seen and not seen set by 32 bit id.
+class ImageSets
+{
+  public:
+    struct MemoryReport
+    {
+        uint64_t num_points;
+        uint64_t num_image_ids;
+        uint64_t num_distinct_sets;
+        // two vectors per point, as held by DenseMetaData
+        uint64_t vector_bytes;
+        // offsets and ids, as held by DenseColumns
+        uint64_t columnar_bytes;
+        // set ids per point and the dictionary
+        uint64_t interned_bytes;
+    };
+
+    ImageSets() : _num_image_ids(0) {}
+
+    // Adds num_points points, seen(i) and not_seen(i) return the image lists of point i as span<uint32_t>. Lists don't
+    // have to be sorted. They are sorted and hashed in parallel, interning itself is sequential.
+    template <typename Seen, typename NotSeen>
+    void add_points(uint64_t num_points, Seen seen, NotSeen not_seen)
+    {
+        const uint64_t chunk_size = 1 << 16;
+        vec<vec<uint32_t>> lists(2 * std::min(chunk_size, num_points));
+        vec<uint64_t> hashes(lists.size());
+
+        _seen.reserve(_seen.size() + num_points);
+        _not_seen.reserve(_not_seen.size() + num_points);
+
+        for(uint64_t first = 0; first < num_points; first += chunk_size)
+        {
+            uint64_t count = std::min(chunk_size, num_points - first);
+
+#pragma omp parallel for schedule(dynamic, 256)
+            for(int64_t i = 0; i < (int64_t)count; i++)
+            {
+                canonicalize(seen(first + i), lists[2 * i], hashes[2 * i]);
+                canonicalize(not_seen(first + i), lists[2 * i + 1], hashes[2 * i + 1]);
+            }
+
+            for(uint64_t i = 0; i < count; i++)
+            {
+                _seen.push_back(_dictionary.intern(lists[2 * i].data(), lists[2 * i].data() + lists[2 * i].size(), hashes[2 * i]));
+                _not_seen.push_back(_dictionary.intern(lists[2 * i + 1].data(), lists[2 * i + 1].data() + lists[2 * i + 1].size(), hashes[2 * i + 1]));
+                _num_image_ids += lists[2 * i].size() + lists[2 * i + 1].size();
+            }
+        }
+    }
+
+    uint64_t size() const { return _seen.size(); }
+    const ImageSetDictionary &get_dictionary() const { return _dictionary; }
+    uint32_t get_images_seen_set(uint64_t index) const { return _seen[index]; }
+    uint32_t get_images_not_seen_set(uint64_t index) const { return _not_seen[index]; }
+    void get_images_seen(uint64_t index, vec<uint32_t> &images) const { _dictionary.decode(_seen[index], images); }
+    void get_images_not_seen(uint64_t index, vec<uint32_t> &images) const { _dictionary.decode(_not_seen[index], images); }
+
+    // Indices of the points seen by all of the given images. Each distinct set is tested once, points are only
+    // compared by set id.
+    vec<uint64_t> points_seen_by(vec<uint32_t> images) const
+    {
+        std::sort(images.begin(), images.end());
+        images.erase(std::unique(images.begin(), images.end()), images.end());
+
+        vec<char> matches(_dictionary.size());
+#pragma omp parallel for schedule(dynamic, 1024)
+        for(int64_t set = 0; set < (int64_t)matches.size(); set++)
+        {
+            matches[set] = _dictionary.contains_all((uint32_t)set, images);
+        }
+
+        vec<uint64_t> points;
+        for(uint64_t i = 0; i < _seen.size(); i++)
+        {
+            if(matches[_seen[i]])
+            {
+                points.push_back(i);
+            }
+        }
+        return points;
+    }
+
+    MemoryReport get_memory_report() const
+    {
+        MemoryReport report;
+        report.num_points = size();
+        report.num_image_ids = _num_image_ids;
+        report.num_distinct_sets = _dictionary.size();
+        report.vector_bytes = report.num_points * 2 * sizeof(vec<uint32_t>) + _num_image_ids * sizeof(uint32_t);
+        report.columnar_bytes = (report.num_points + 1) * 2 * sizeof(uint64_t) + _num_image_ids * sizeof(uint32_t);
+        report.interned_bytes = (_seen.capacity() + _not_seen.capacity()) * sizeof(uint32_t) + _dictionary.memory_usage();
+        return report;
+    }
+
+  private:
+    static void canonicalize(const span<uint32_t> &images, vec<uint32_t> &list, uint64_t &hash)
+    {
+        list.assign(images.begin(), images.end());
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        hash = ImageSetDictionary::hash_ids(list.data(), list.data() + list.size());
+    }
+
+    ImageSetDictionary _dictionary;
+    vec<uint32_t> _seen;
+    vec<uint32_t> _not_seen;
+    uint64_t _num_image_ids;
+};
+}
+}
+
+#endif // LAMURE_IMAGE_SETS_H
@@ -24,6 +24,13 @@ class MetaData
         _metadata = vec<char>(meta_data_length, 0);
         is.read(&_metadata[0], meta_data_length);
     }
+    // Same as above, copying from a block of the file that was read into memory at once.
+    // Returns false if the record is malformed.
+    virtual bool read_metadata(const char *data, uint32_t meta_data_length)
+    {
+        _metadata = vec<char>(data, data + meta_data_length);
+        return true;
+    }
 
   protected:
     vec<char> _metadata;
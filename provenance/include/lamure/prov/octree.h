@@ -10,6 +10,7 @@
 
 #include <lamure/types.h>
 #include <lamure/prov/aux.h>
+#include <lamure/prov/span.h>
 
 #include <scm/core/math.h>
 
@@ -29,10 +30,12 @@ namespace prov {
 class octree_node {
 public:
   octree_node()
-    : idx_(0), child_mask_(0), child_idx_(0), min_(std::numeric_limits<float>::max()), max_(std::numeric_limits<float>::lowest()) {};
+    : idx_(0), child_mask_(0), child_idx_(0), min_(std::numeric_limits<float>::max()), max_(std::numeric_limits<float>::lowest()),
+      fotos_offset_(0), num_fotos_(0) {};
   octree_node(uint64_t _idx, uint32_t _child_mask, uint32_t _child_idx,
-    const scm::math::vec3f& _min, const scm::math::vec3f& _max, const std::set<uint32_t>& _fotos)
-    : idx_(_idx), child_mask_(_child_mask), child_idx_(_child_idx), min_(_min), max_(_max), fotos_(_fotos) {};
+    const scm::math::vec3f& _min, const scm::math::vec3f& _max)
+    : idx_(_idx), child_mask_(_child_mask), child_idx_(_child_idx), min_(_min), max_(_max),
+      fotos_offset_(0), num_fotos_(0) {};
   ~octree_node() {};
 
   void set_idx(uint64_t _idx) { idx_ = _idx; };
@@ -47,8 +50,11 @@ public:
   void set_max(const scm::math::vec3f& _max) { max_ = _max; };
   const scm::math::vec3f& get_max() const { return max_; };
 
-  void set_fotos(const std::set<uint32_t>& _fotos) { fotos_ = _fotos; };
-  const std::set<uint32_t>& get_fotos() const { return fotos_; };
+  //range of the sorted foto ids of this node in the foto array of its octree
+  void set_fotos_offset(uint64_t _fotos_offset) { fotos_offset_ = _fotos_offset; };
+  uint64_t get_fotos_offset() const { return fotos_offset_; };
+  void set_num_fotos(uint32_t _num_fotos) { num_fotos_ = _num_fotos; };
+  uint32_t get_num_fotos() const { return num_fotos_; };
 
 
 protected:
@@ -57,7 +63,8 @@ protected:
   uint32_t child_idx_; //idx of first child
   scm::math::vec3f min_;
   scm::math::vec3f max_;
-  std::set<uint32_t> fotos_;
+  uint64_t fotos_offset_;
+  uint32_t num_fotos_;
 };
 
 class octree {
@@ -65,22 +72,36 @@ public:
                       octree();
   virtual             ~octree();
 
+  //linear octree, nodes are stored breadth first and siblings are consecutive
   void                create(std::vector<aux::sparse_point>& _points);
-  uint64_t            query(const scm::math::vec3f& _pos);
+  //the cameras of point i are _camera_ids[_camera_offsets[i], _camera_offsets[i+1])
+  void                create(const std::vector<scm::math::vec3f>& _positions,
+                        const std::vector<uint64_t>& _camera_offsets, const std::vector<uint32_t>& _camera_ids);
+  uint64_t            query(const scm::math::vec3f& _pos) const;
+  std::vector<uint64_t> query(const span<scm::math::vec3f>& _positions) const;
 
-  uint64_t            get_child_id(uint64_t node_id, uint32_t child_index);
+  uint64_t            get_child_id(uint64_t node_id, uint32_t child_index) const;
   uint64_t            get_parent_id(uint64_t node_id);
   uint64_t            get_num_nodes() const;
-  const octree_node&  get_node(uint64_t _node_id);
-  void                add_node(const octree_node& _node);
+  const octree_node&  get_node(uint64_t _node_id) const;
+  void                add_node(const octree_node& _node, const std::set<uint32_t>& _fotos);
+
+  span<uint32_t>      get_fotos(uint64_t _node_id) const;
+  uint64_t            get_num_fotos() const;
+  //create needs at least this many points
+  uint64_t            get_min_num_points() const;
   
   uint32_t            get_depth() const;
   void                set_depth(uint32_t _depth);
 
 protected:
 
+  //cell coordinates of a position inside [_min, _max) subdivided _depth times
+  static void         quantize(const scm::math::vec3f& _pos, const scm::math::vec3f& _min, const scm::math::vec3f& _max,
+                        uint32_t _depth, uint32_t* _coords);
 
   std::vector<octree_node> nodes_;
+  std::vector<uint32_t> fotos_;
   uint64_t min_num_points_per_node_;
   uint32_t depth_;
 
@@ -22,8 +22,12 @@ namespace prov
 {
 typedef pair<DensePoint, DenseMetaData> dense_pair;
 
+class SparseOctree;
+
 class OctreeNode : public Partition<dense_pair, DenseMetaData>, public Partitionable<OctreeNode>
 {
+    friend class SparseOctree;
+
   public:
     OctreeNode() : Partition<dense_pair, DenseMetaData>(), Partitionable<OctreeNode>()
     {
@@ -22,7 +22,9 @@ class Partitionable
     {
         STD_SORT = 0,
         BOOST_SPREADSORT = 1,
-        PDQ_SORT = 2
+        PDQ_SORT = 2,
+        // Not a comparison sort: Morton codes are radix sorted once and the tree is derived from their prefixes.
+        MORTON_RADIX_SORT = 3
     };
 
     Partitionable()
@@ -50,6 +50,17 @@ class Point
 
         return is;
     }
+    // Same as above, decoding from a block of the file that was read into memory at once.
+    const char *read_essentials(const char *data)
+    {
+        for(int i = 0; i < 3; i++)
+            _position[i] = read_swapped<float>(data + 4 * i, true);
+        for(int i = 0; i < 3; i++)
+            _color[i] = read_swapped<float>(data + 12 + 4 * i, true);
+
+        return data + ESSENTIALS_LENGTH;
+    }
+    static const uint32_t ESSENTIALS_LENGTH = 24;
 
   protected:
     vec3f _position;
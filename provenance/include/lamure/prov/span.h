@@ -0,0 +1,40 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_PROV_SPAN_H
+#define LAMURE_PROV_SPAN_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace lamure {
+namespace prov
+{
+// Read-only view of contiguous elements owned elsewhere, e.g. a section of a memory mapped file.
+template <typename T>
+class span
+{
+  public:
+    span() : _data(nullptr), _size(0) {}
+    span(const T *data, uint64_t size) : _data(data), _size(size) {}
+    span(const std::vector<T> &elements) : _data(elements.data()), _size(elements.size()) {}
+
+    const T *data() const { return _data; }
+    uint64_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    const T *begin() const { return _data; }
+    const T *end() const { return _data + _size; }
+    const T &operator[](uint64_t index) const { return _data[index]; }
+
+  private:
+    const T *_data;
+    uint64_t _size;
+};
+}
+}
+
+#endif // LAMURE_PROV_SPAN_H
@@ -67,15 +67,57 @@ class SparseCache : public Cacheable<SparsePoint, MetaData>
             Camera camera = Camera();
             camera.MAX_LENGTH_FILE_PATH = max_len_fpath;
             (*is_prov) >> camera;
-            if (load_images) {
-              camera.prepare(fotos_directory);
-            }
             _cameras.push_back(camera);
 
             MetaData meta_container;
             meta_container.read_metadata((*is_meta), meta_data_length);
             _cameras_metadata.push_back(meta_container);
         }
+
+        if(load_images)
+        {
+            prepare_cameras(fotos_directory);
+        }
+    }
+
+    // Only the JPEG headers of the images are probed, in parallel across cameras. Results are kept in a sidecar file
+    // next to the images, so unchanged images are not opened again when the cache is rebuilt.
+    void prepare_cameras(const std::string &fotos_directory)
+    {
+        ImageInfoCache info_cache(fotos_directory + ".prov_image_info");
+
+        vec<ImageInfo> infos(_cameras.size());
+        vec<uint8_t> cached(_cameras.size(), 0);
+        vec<uint8_t> readable(_cameras.size(), 1);
+        for(size_t i = 0; i < _cameras.size(); i++)
+        {
+            cached[i] = info_cache.lookup(fotos_directory + _cameras[i].get_image_file(), infos[i]);
+        }
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for(int64_t i = 0; i < (int64_t)_cameras.size(); i++)
+        {
+            if(!cached[i])
+            {
+                readable[i] = ImageProbe::probe(fotos_directory + _cameras[i].get_image_file(), infos[i]);
+            }
+        }
+
+        for(size_t i = 0; i < _cameras.size(); i++)
+        {
+            if(!readable[i])
+            {
+                printf("\nFailed to read image: Can't open file: '%s'", _cameras[i].get_image_file().c_str());
+                continue;
+            }
+            if(!cached[i])
+            {
+                info_cache.insert(fotos_directory + _cameras[i].get_image_file(), infos[i]);
+            }
+            _cameras[i].prepare(infos[i]);
+        }
+
+        info_cache.save();
     }
 
     vec<Camera> _cameras;
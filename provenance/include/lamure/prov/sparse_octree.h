@@ -12,6 +12,14 @@
 #include <lamure/prov/octree_node.h>
 #include <lamure/prov/partitionable.h>
 
+#include <boost/serialization/version.hpp>
+
+#include <bitset>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace lamure {
 namespace prov
 {
@@ -47,13 +55,22 @@ class SparseOctree : public OctreeNode
         {
             SparseOctree octree(0, _sort, _max_depth, _min_per_node, _cubic_nodes);
 
-            if(_dense_cache != nullptr)
+            if(_dense_cache != nullptr && _sort == MORTON_RADIX_SORT)
+            {
+                octree.partition_morton(*_dense_cache);
+            }
+            else if(_dense_cache != nullptr)
             {
                 _glue_pairs();
-                octree._pair_ptrs.reserve(_unsorted_pairs.size());
-                for(size_t i = 0; i < _unsorted_pairs.size(); i++)
+
+                // Pairs are owned by one shared vector, the pointers only alias its elements.
+                s_ptr<vec<dense_pair>> pairs = std::make_shared<vec<dense_pair>>(std::move(_unsorted_pairs));
+                _unsorted_pairs = vec<dense_pair>();
+
+                octree._pair_ptrs.reserve(pairs->size());
+                for(size_t i = 0; i < pairs->size(); i++)
                 {
-                    octree._pair_ptrs.push_back(s_ptr<dense_pair>(&_unsorted_pairs.at(i)));
+                    octree._pair_ptrs.push_back(s_ptr<dense_pair>(pairs, &pairs->at(i)));
                 }
                 octree.partition();
             }
@@ -124,6 +141,11 @@ class SparseOctree : public OctreeNode
             return this;
         }
 
+        if(!this->_nodes.empty())
+        {
+            return lookup_flat_node_at_position(position);
+        }
+
         if(this->_partitions.empty())
         {
             //            printf("\nMaximum depth reached at this position\n");
@@ -160,6 +182,23 @@ class SparseOctree : public OctreeNode
         }
     }
 
+    // Number of nodes of a tree built with MORTON_RADIX_SORT, zero for the other sorts.
+    uint64_t get_num_flat_nodes() const { return _nodes.size(); }
+
+    template <class Archive>
+    void serialize(Archive &ar, const unsigned int version)
+    {
+        OctreeNode::serialize(ar, version);
+
+        if(version > 0)
+        {
+            ar &_morton_depth;
+            ar &_nodes;
+            ar &_first_child;
+            ar &_child_masks;
+        }
+    }
+
     static void save_tree(SparseOctree &octree, string output_path)
     {
         ofstream ofstream_tree(output_path);
@@ -194,7 +233,397 @@ class SparseOctree : public OctreeNode
         printf("\nEnd partitioning\n");
     }
 
+    // Morton codes of all points are computed and radix sorted once. Every node then corresponds to the range of points
+    // sharing its code prefix, so children are found by binary search instead of sorting per level. Nodes are stored
+    // in breadth-first order in one array, the children of a node follow each other in octant order. Unlike the
+    // comparison sorts, nodes are always regular subdivisions of the root, also without cubic nodes.
+    void partition_morton(const DenseCache &dense_cache)
+    {
+        printf("\nStart partitioning\n");
+
+        bool use_columns = dense_cache.get_points().empty() && dense_cache.get_columns().size() > 0;
+        const vec<DensePoint> &points = dense_cache.get_points();
+        const DenseColumns &columns = dense_cache.get_columns();
+        uint64_t num_points = use_columns ? columns.size() : points.size();
+
+        auto position_of = [&](uint64_t index) -> vec3f { return use_columns ? columns.get_position(index) : points[index].get_position(); };
+
+        // Denormals and NaNs are left out, like in identify_boundaries()
+        vec<uint32_t> indices;
+        indices.reserve(num_points);
+        for(uint64_t i = 0; i < num_points; i++)
+        {
+            vec3f position = position_of(i);
+            bool skip = false;
+            for(int axis = 0; axis < 3; axis++)
+            {
+                int category = std::fpclassify(position[axis]);
+                skip = skip || category == FP_SUBNORMAL || category == FP_NAN;
+            }
+            if(!skip)
+            {
+                indices.push_back((uint32_t)i);
+            }
+        }
+
+        vec3f min(FLT_MAX, FLT_MAX, FLT_MAX);
+        vec3f max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+#pragma omp parallel
+        {
+            vec3f local_min(FLT_MAX, FLT_MAX, FLT_MAX);
+            vec3f local_max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+#pragma omp for nowait
+            for(int64_t i = 0; i < (int64_t)indices.size(); i++)
+            {
+                vec3f position = position_of(indices[i]);
+                for(int axis = 0; axis < 3; axis++)
+                {
+                    local_min[axis] = std::min(local_min[axis], position[axis]);
+                    local_max[axis] = std::max(local_max[axis], position[axis]);
+                }
+            }
+
+#pragma omp critical
+            for(int axis = 0; axis < 3; axis++)
+            {
+                min[axis] = std::min(min[axis], local_min[axis]);
+                max[axis] = std::max(max[axis], local_max[axis]);
+            }
+        }
+
+        this->_min = min;
+        this->_max = max;
+        if(_cubic_nodes && !indices.empty())
+        {
+            vec3f dim = _max - _min;
+            float longest_axis = std::max(dim.x, std::max(dim.y, dim.z));
+            _max = _min + vec3f(longest_axis);
+        }
+
+        // 64 bit codes hold 21 levels
+        _morton_depth = std::min<uint8_t>(_max_depth, 21);
+
+        vec<uint64_t> codes(indices.size());
+#pragma omp parallel for
+        for(int64_t i = 0; i < (int64_t)indices.size(); i++)
+        {
+            codes[i] = morton_code(position_of(indices[i]));
+        }
+
+        radix_sort(codes, indices, 3 * _morton_depth);
+
+        build_flat_nodes(codes);
+        aggregate_flat_metadata(dense_cache, use_columns, indices);
+
+        this->_aggregate_metadata = _nodes[0]._aggregate_metadata;
+
+        printf("\nEnd partitioning\n");
+    }
+
   private:
+    // Cell coordinates of the position at the deepest level, interleaved to x, y, z per level from the root down.
+    uint64_t morton_code(const vec3f &position) const
+    {
+        uint64_t code = 0;
+        uint32_t cells = 1u << _morton_depth;
+
+        uint32_t coordinates[3];
+        for(int axis = 0; axis < 3; axis++)
+        {
+            float extent = _max[axis] - _min[axis];
+            float normalized = extent > 0.f ? (position[axis] - _min[axis]) / extent : 0.f;
+            coordinates[axis] = (uint32_t)std::min<double>(std::max<double>(normalized * cells, 0.0), cells - 1);
+        }
+
+        for(int level = _morton_depth - 1; level >= 0; level--)
+        {
+            code = (code << 3) | (((coordinates[0] >> level) & 1) << 2) | (((coordinates[1] >> level) & 1) << 1) | ((coordinates[2] >> level) & 1);
+        }
+
+        return code;
+    }
+
+    // Parallel least significant digit radix sort of the codes, indices are permuted along.
+    static void radix_sort(vec<uint64_t> &codes, vec<uint32_t> &indices, uint32_t num_bits)
+    {
+        const uint32_t digit_bits = 8;
+        const uint32_t num_buckets = 1 << digit_bits;
+        const int64_t num_elements = (int64_t)codes.size();
+
+        vec<uint64_t> sorted_codes(codes.size());
+        vec<uint32_t> sorted_indices(indices.size());
+
+        for(uint32_t shift = 0; shift < num_bits; shift += digit_bits)
+        {
+            vec<vec<uint64_t>> histograms;
+
+#pragma omp parallel
+            {
+#ifdef _OPENMP
+                int num_threads = omp_get_num_threads();
+                int thread = omp_get_thread_num();
+#else
+                int num_threads = 1;
+                int thread = 0;
+#endif
+#pragma omp single
+                histograms.assign(num_threads, vec<uint64_t>(num_buckets, 0));
+
+                // Every thread handles one contiguous block, which keeps the sort stable.
+                int64_t first = num_elements * thread / num_threads;
+                int64_t last = num_elements * (thread + 1) / num_threads;
+
+                vec<uint64_t> &histogram = histograms[thread];
+                for(int64_t i = first; i < last; i++)
+                {
+                    histogram[(codes[i] >> shift) & (num_buckets - 1)]++;
+                }
+
+#pragma omp barrier
+#pragma omp single
+                {
+                    uint64_t offset = 0;
+                    for(uint32_t bucket = 0; bucket < num_buckets; bucket++)
+                    {
+                        for(int t = 0; t < num_threads; t++)
+                        {
+                            uint64_t count = histograms[t][bucket];
+                            histograms[t][bucket] = offset;
+                            offset += count;
+                        }
+                    }
+                }
+
+                for(int64_t i = first; i < last; i++)
+                {
+                    uint64_t target = histogram[(codes[i] >> shift) & (num_buckets - 1)]++;
+                    sorted_codes[target] = codes[i];
+                    sorted_indices[target] = indices[i];
+                }
+            }
+
+            codes.swap(sorted_codes);
+            indices.swap(sorted_indices);
+        }
+    }
+
+    void build_flat_nodes(const vec<uint64_t> &codes)
+    {
+        _nodes.clear();
+        _first_child.clear();
+        _child_masks.clear();
+
+        // Range of sorted points and code prefix of each node, only needed while building
+        vec<pair<uint64_t, uint64_t>> ranges;
+        vec<uint64_t> prefixes;
+
+        OctreeNode root(0, _sort, _max_depth, _min_per_node, _cubic_nodes);
+        root.set_boundaries(_min, _max);
+        _nodes.push_back(root);
+        _first_child.push_back(0);
+        _child_masks.push_back(0);
+        ranges.push_back(pair<uint64_t, uint64_t>(0, codes.size()));
+        prefixes.push_back(0);
+
+        uint64_t level_begin = 0;
+        uint64_t level_end = 1;
+        uint8_t depth = 0;
+        vec3f extent = _max - _min;
+
+        while(level_begin < level_end && depth < _morton_depth)
+        {
+            uint64_t num_level_nodes = level_end - level_begin;
+            vec<arr<uint64_t, 9>> child_bounds(num_level_nodes);
+            vec<uint64_t> num_children(num_level_nodes + 1, 0);
+            uint32_t child_shift = 3 * (_morton_depth - depth - 1);
+
+#pragma omp parallel for schedule(dynamic, 64)
+            for(int64_t i = 0; i < (int64_t)num_level_nodes; i++)
+            {
+                uint64_t node = level_begin + i;
+                arr<uint64_t, 9> &bounds = child_bounds[i];
+                bounds[0] = ranges[node].first;
+                bounds[8] = ranges[node].second;
+                for(uint64_t octant = 1; octant < 8; octant++)
+                {
+                    uint64_t first_code = ((prefixes[node] << 3) | octant) << child_shift;
+                    bounds[octant] = std::lower_bound(codes.begin() + bounds[octant - 1], codes.begin() + bounds[8], first_code) - codes.begin();
+                }
+
+                uint8_t mask = 0;
+                for(uint32_t octant = 0; octant < 8; octant++)
+                {
+                    uint64_t size = bounds[octant + 1] - bounds[octant];
+                    if(size > 0 && size >= _min_per_node)
+                    {
+                        mask |= (uint8_t)(1 << octant);
+                    }
+                }
+                _child_masks[node] = mask;
+                num_children[i + 1] = std::bitset<8>(mask).count();
+            }
+
+            for(uint64_t i = 0; i < num_level_nodes; i++)
+            {
+                num_children[i + 1] += num_children[i];
+            }
+
+            uint64_t next_level_begin = _nodes.size();
+            uint64_t next_level_end = next_level_begin + num_children[num_level_nodes];
+
+            _nodes.resize(next_level_end, OctreeNode(depth + 1, _sort, _max_depth, _min_per_node, _cubic_nodes));
+            _first_child.resize(next_level_end, 0);
+            _child_masks.resize(next_level_end, 0);
+            ranges.resize(next_level_end);
+            prefixes.resize(next_level_end);
+
+            float cell_size = 1.f / (float)(1u << (depth + 1));
+
+#pragma omp parallel for schedule(dynamic, 64)
+            for(int64_t i = 0; i < (int64_t)num_level_nodes; i++)
+            {
+                uint64_t node = level_begin + i;
+                uint64_t child = next_level_begin + num_children[i];
+                _first_child[node] = (uint32_t)child;
+
+                for(uint32_t octant = 0; octant < 8; octant++)
+                {
+                    if(!(_child_masks[node] & (1 << octant)))
+                    {
+                        continue;
+                    }
+
+                    uint64_t prefix = (prefixes[node] << 3) | octant;
+                    ranges[child] = pair<uint64_t, uint64_t>(child_bounds[i][octant], child_bounds[i][octant + 1]);
+                    prefixes[child] = prefix;
+
+                    // Cell coordinates at the depth of the child, decoded from its prefix
+                    uint32_t coordinates[3] = {0, 0, 0};
+                    for(uint32_t level = 0; level <= depth; level++)
+                    {
+                        uint64_t digit = prefix >> (3 * level);
+                        coordinates[0] |= (uint32_t)((digit >> 2) & 1) << level;
+                        coordinates[1] |= (uint32_t)((digit >> 1) & 1) << level;
+                        coordinates[2] |= (uint32_t)(digit & 1) << level;
+                    }
+
+                    vec3f child_min, child_max;
+                    for(int axis = 0; axis < 3; axis++)
+                    {
+                        child_min[axis] = _min[axis] + extent[axis] * cell_size * coordinates[axis];
+                        child_max[axis] = _min[axis] + extent[axis] * cell_size * (coordinates[axis] + 1);
+                    }
+                    _nodes[child].set_boundaries(child_min, child_max);
+
+                    child++;
+                }
+            }
+
+            level_begin = next_level_begin;
+            level_end = next_level_end;
+            depth++;
+        }
+
+        _flat_ranges.swap(ranges);
+    }
+
+    // Metadata is aggregated where the comparison sorts aggregate it: at the root, at leaves and at nodes missing children.
+    void aggregate_flat_metadata(const DenseCache &dense_cache, bool use_columns, const vec<uint32_t> &indices)
+    {
+        const DenseColumns &columns = dense_cache.get_columns();
+
+#pragma omp parallel
+        {
+            // Image ids are small, so duplicates are detected by stamping the id with the node instead of sorting all of them.
+            vec<uint32_t> seen_stamps;
+            vec<uint32_t> not_seen_stamps;
+
+            auto collect = [](const uint32_t *first, const uint32_t *last, uint32_t stamp, vec<uint32_t> &stamps, vec<uint32_t> &images) {
+                for(const uint32_t *image = first; image != last; ++image)
+                {
+                    if(*image >= stamps.size())
+                    {
+                        stamps.resize((uint64_t)*image * 2 + 1, 0);
+                    }
+                    if(stamps[*image] != stamp)
+                    {
+                        stamps[*image] = stamp;
+                        images.push_back(*image);
+                    }
+                }
+            };
+
+#pragma omp for schedule(dynamic, 1)
+            for(int64_t node = 0; node < (int64_t)_nodes.size(); node++)
+            {
+                if(node != 0 && _child_masks[node] == 0xFF)
+                {
+                    continue;
+                }
+
+                uint32_t stamp = (uint32_t)node + 1;
+                double photometric_consistency = 0;
+                vec<uint32_t> seen;
+                vec<uint32_t> not_seen;
+
+                for(uint64_t i = _flat_ranges[node].first; i < _flat_ranges[node].second; i++)
+                {
+                    uint32_t index = indices[i];
+                    if(use_columns)
+                    {
+                        photometric_consistency += columns.photometric_consistencies[index];
+                        collect(columns.get_images_seen(index), columns.get_images_seen(index) + columns.get_num_images_seen(index), stamp, seen_stamps, seen);
+                        collect(columns.get_images_not_seen(index), columns.get_images_not_seen(index) + columns.get_num_images_not_seen(index), stamp, not_seen_stamps, not_seen);
+                    }
+                    else
+                    {
+                        const DenseMetaData &metadata = dense_cache.get_points_metadata()[index];
+                        photometric_consistency += metadata.get_photometric_consistency();
+                        collect(metadata.get_images_seen().data(), metadata.get_images_seen().data() + metadata.get_images_seen().size(), stamp, seen_stamps, seen);
+                        collect(metadata.get_images_not_seen().data(), metadata.get_images_not_seen().data() + metadata.get_images_not_seen().size(), stamp, not_seen_stamps, not_seen);
+                    }
+                }
+
+                std::sort(seen.begin(), seen.end());
+                std::sort(not_seen.begin(), not_seen.end());
+
+                uint64_t num_node_points = _flat_ranges[node].second - _flat_ranges[node].first;
+                DenseMetaData &aggregate = _nodes[node]._aggregate_metadata;
+                aggregate.set_photometric_consistency(num_node_points > 0 ? (float)(photometric_consistency / num_node_points) : 0.f);
+                aggregate.set_images_seen(std::move(seen));
+                aggregate.set_images_not_seen(std::move(not_seen));
+            }
+        }
+
+        _flat_ranges = vec<pair<uint64_t, uint64_t>>();
+    }
+
+    OctreeNode *lookup_flat_node_at_position(const vec3f &position)
+    {
+        uint64_t code = morton_code(position);
+        uint32_t node = 0;
+
+        for(uint32_t depth = 0; depth < _morton_depth && _child_masks[node] != 0; depth++)
+        {
+            uint32_t octant = (uint32_t)(code >> (3 * (_morton_depth - depth - 1))) & 7;
+            if(!(_child_masks[node] & (1 << octant)))
+            {
+                break;
+            }
+            node = _first_child[node] + (uint32_t)std::bitset<8>(_child_masks[node] & ((1u << octant) - 1)).count();
+        }
+
+        return &_nodes[node];
+    }
+
+    uint8_t _morton_depth = 0;
+    vec<OctreeNode> _nodes;
+    vec<uint32_t> _first_child;
+    vec<uint8_t> _child_masks;
+    vec<pair<uint64_t, uint64_t>> _flat_ranges;
+
     float compare_metadata(const DenseMetaData &data, const DenseMetaData &ref_data)
     {
         float information_loss = 0;
@@ -206,4 +635,8 @@ class SparseOctree : public OctreeNode
 };
 }
 }
+
+// Version 1 adds the flat nodes of the Morton build, version 0 trees are read as before.
+BOOST_CLASS_VERSION(lamure::prov::SparseOctree, 1)
+
 #endif // LAMURE_SPARSEOCTREE_H
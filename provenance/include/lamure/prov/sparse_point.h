@@ -46,6 +46,13 @@ class SparsePoint : public Point
 
             return is;
         }
+        void read_record(const char *data)
+        {
+            _camera_index = read_swapped<uint16_t>(data, true);
+            _occurence.x = read_swapped<float>(data + 2, true);
+            _occurence.y = read_swapped<float>(data + 6, true);
+        }
+        static const uint32_t RECORD_LENGTH = 10;
 
       private:
         uint16_t _camera_index;
@@ -86,6 +93,28 @@ class SparsePoint : public Point
 
         return is;
     }
+    void read_record(const char *data)
+    {
+        _index = read_swapped<uint32_t>(data, true);
+        data = read_essentials(data + 4);
+
+        uint16_t measurements_length = read_swapped<uint16_t>(data, true);
+        data += 2;
+
+        _measurements.resize(measurements_length);
+        for(uint16_t i = 0; i < measurements_length; i++)
+        {
+            _measurements[i].read_record(data);
+            data += Measurement::RECORD_LENGTH;
+        }
+    }
+    // Records are variable in length, the number of measurements follows the essentials.
+    static uint32_t record_length(const char *data)
+    {
+        uint16_t measurements_length = read_swapped<uint16_t>(data + 4 + ESSENTIALS_LENGTH, true);
+        return 4 + ESSENTIALS_LENGTH + 2 + measurements_length * Measurement::RECORD_LENGTH;
+    }
+    static const uint32_t MIN_RECORD_LENGTH = 4 + ESSENTIALS_LENGTH + 2;
 
     uint32_t get_index() const { return _index; }
 
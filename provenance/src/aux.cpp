@@ -8,6 +8,8 @@
 #include <lamure/prov/aux.h>
 
 #include <limits>
+#include <algorithm>
+#include <cassert>
 
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -21,14 +23,22 @@ namespace prov {
 
 aux::
 aux()
-: filename_("") {
+: filename_(""),
+  views_loaded_(true),
+  sparse_points_loaded_(true),
+  atlas_tiles_loaded_(true),
+  octree_loaded_(true) {
 
 
 } 
 
 aux::
 aux(const std::string& filename)
-: filename_("") {
+: filename_(""),
+  views_loaded_(true),
+  sparse_points_loaded_(true),
+  atlas_tiles_loaded_(true),
+  octree_loaded_(true) {
 
     std::string extension = filename.substr(filename.find_last_of(".") + 1);
 
@@ -47,14 +57,58 @@ load_aux_file(const std::string& filename) {
 
     filename_ = filename;
 
-    aux_stream aux_stream;
-    aux_stream.read_aux(filename, *this);
+    stream_ = std::make_shared<aux_stream>();
+    stream_->index_aux(filename);
+
+    views_loaded_ = false;
+    sparse_points_loaded_ = false;
+    atlas_tiles_loaded_ = false;
+    octree_loaded_ = false;
+}
+
+void aux::
+load_views() const {
+    if (!views_loaded_) {
+        views_loaded_ = true;
+        stream_->read_views(views_);
+    }
+}
+
+void aux::
+load_sparse_points() const {
+    if (!sparse_points_loaded_) {
+        sparse_points_loaded_ = true;
+        stream_->read_sparse_points(sparse_points_);
+    }
+}
+
+void aux::
+load_atlas_tiles() const {
+    if (!atlas_tiles_loaded_) {
+        atlas_tiles_loaded_ = true;
+        stream_->read_atlas_tiles(atlas_tiles_);
+    }
+}
+
+void aux::
+load_octree() const {
+    if (!octree_loaded_) {
+        octree_loaded_ = true;
+        octree_ = stream_->read_octree();
+    }
 }
 
 
 void aux::
 write_aux_file(const std::string& filename) {
-    
+
+    //everything has to be resident, the file may be overwritten
+    load_views();
+    load_sparse_points();
+    load_atlas_tiles();
+    load_octree();
+    stream_.reset();
+
     filename_ = filename;
 
     aux_stream aux_stream;
@@ -62,8 +116,29 @@ write_aux_file(const std::string& filename) {
 
 }
 
+const uint32_t aux::
+get_num_views() const {
+    load_views();
+    return views_.size();
+}
+
+const uint64_t aux::
+get_num_sparse_points() const {
+    if (!sparse_points_loaded_) {
+        return stream_->get_num_sparse_points();
+    }
+    return sparse_points_.size();
+}
+
+const uint32_t aux::
+get_num_atlas_tiles() const {
+    load_atlas_tiles();
+    return atlas_tiles_.size();
+}
+
 const aux::view& aux::
 get_view(const uint32_t view_id) const {
+    load_views();
     assert(view_id >= 0 && view_id < views_.size());
     return views_[view_id];
 }
@@ -71,39 +146,83 @@ get_view(const uint32_t view_id) const {
 
 const aux::sparse_point& aux::
 get_sparse_point(const uint64_t point_id) const {
+    load_sparse_points();
     assert(point_id >= 0 && point_id < sparse_points_.size());
     return sparse_points_[point_id];
 }
 
 const aux::atlas_tile& aux::
 get_atlas_tile(const uint32_t tile_id) const {
+    load_atlas_tiles();
     assert(tile_id >= 0 && tile_id < atlas_tiles_.size());
     return atlas_tiles_[tile_id];
 }
 
 void aux::
 add_view(const aux::view& view) {
+    load_views();
     views_.push_back(view);
 }
 
 void aux::
 add_sparse_point(const aux::sparse_point& point) {
+    load_sparse_points();
     sparse_points_.push_back(point);
 }
 
 void aux::
 add_atlas_tile(const aux::atlas_tile& tile) {
+    load_atlas_tiles();
     atlas_tiles_.push_back(tile);
 }
 
+std::vector<aux::sparse_point>& aux::
+get_sparse_points() {
+    load_sparse_points();
+    return sparse_points_;
+}
+
+
+void aux::
+for_each_sparse_chunk(uint64_t max_points,
+  const std::function<void(const sparse_chunk&)>& visit) const {
+
+    max_points = std::max(max_points, (uint64_t)1);
+    sparse_chunk chunk;
+
+    if (!sparse_points_loaded_) {
+        stream_->seek_sparse_points();
+        while (stream_->read_sparse_chunk(max_points, chunk) > 0) {
+            visit(chunk);
+        }
+        return;
+    }
+
+    for (uint64_t first = 0; first < sparse_points_.size(); first += max_points) {
+        uint64_t last = std::min(first + max_points, (uint64_t)sparse_points_.size());
+        chunk.first_point_id_ = first;
+        chunk.points_.clear();
+        chunk.features_.clear();
+        for (uint64_t i = first; i < last; ++i) {
+            const auto& point = sparse_points_[i];
+            chunk.points_.push_back(flat_sparse_point{point.pos_, point.r_, point.g_, point.b_, point.a_,
+                chunk.features_.size(), (uint32_t)point.features_.size()});
+            chunk.features_.insert(chunk.features_.end(), point.features_.begin(), point.features_.end());
+        }
+        visit(chunk);
+    }
+}
+
 
 void aux::set_octree(const std::shared_ptr<octree> _octree) {
+  octree_loaded_ = true;
   octree_ = _octree;
 }
 
 
 const std::shared_ptr<octree> aux::
 get_octree() const {
+  load_octree();
   return octree_;
 }
 
@@ -9,13 +9,19 @@
 
 #include <lamure/prov/octree.h>
 
+#include <algorithm>
+
 namespace lamure {
 namespace prov {
 
 aux_stream::
 aux_stream()
 : filename_(""),
-  num_segments_(0) {
+  num_segments_(0),
+  num_sparse_points_(0),
+  next_sparse_point_(0),
+  next_sparse_offset_(0),
+  sparse_segment_offset_(0) {
 
 
 }
@@ -119,6 +125,32 @@ write(aux_stream::aux_serializable& serializable) {
 
 void aux_stream::
 read_aux(const std::string& filename, aux& aux) {
+
+    index_aux(filename);
+
+    std::vector<aux::view> views;
+    read_views(views);
+    for (const auto& view : views) {
+      aux.add_view(view);
+    }
+
+    std::vector<aux::atlas_tile> tiles;
+    read_atlas_tiles(tiles);
+    for (const auto& tile : tiles) {
+      aux.add_atlas_tile(tile);
+    }
+
+    read_sparse_points(aux.get_sparse_points());
+
+    aux.set_octree(read_octree());
+
+    close_stream(false);
+
+}
+
+
+void aux_stream::
+index_aux(const std::string& filename) {
  
     open_stream(filename, aux_stream_type::AUX_STREAM_IN);
 
@@ -136,20 +168,17 @@ read_aux(const std::string& filename, aux& aux) {
     size_t filesize = (size_t)file_.tellg();
     file_.seekg(0, std::ios::beg);
 
-    num_segments_ = 0;
-
-    aux_sparse_seg sparse;
-    std::vector<aux_view_seg> views;
-    std::vector<aux_atlas_tile_seg> tiles;
-    aux_tree_seg tree;
-    uint32_t sparse_id = 0;
-    uint32_t camera_id = 0;
-    uint32_t tile_id = 0;
+    segments_.clear();
+    num_sparse_points_ = 0;
 
-    //go through entire stream and fetch the segments
+    //go through entire stream and index the segments, payloads are skipped
     while (true) {
         aux_sig sig;
         sig.deserialize(file_);
+        if (!file_.good()) {
+            throw std::runtime_error(
+                "lamure: aux_stream::Stream corrupt -- Unexpected end of file: " + filename_);
+        }
         if (sig.signature_[0] != 'A' ||
             sig.signature_[1] != 'U' ||
             sig.signature_[2] != 'X' ||
@@ -158,63 +187,27 @@ read_aux(const std::string& filename, aux& aux) {
                  "lamure: aux_stream::Invalid magic encountered: " + filename_);
         }
             
-        size_t anchor = (size_t)file_.tellg();
+        aux_segment segment;
+        memcpy(segment.signature_, sig.signature_, 8);
+        segment.offset_ = (size_t)file_.tellg();
+        segment.allocated_size_ = sig.allocated_size_;
+        segment.used_size_ = sig.used_size_;
 
         switch (sig.signature_[4]) {
-
-            case 'F': { //"AUXXFILE"
-                aux_file_seg seg;
-                seg.deserialize(file_);
+            case 'F': //"AUXXFILE"
+            case 'V': //"AUXXVIEW"
                 break;
-            }
             case 'S': { 
-                switch (sig.signature_[5]) {
-                    case 'P': { //"AUXXSPRS"
-                        sparse.deserialize(file_);
-                        ++sparse_id;
-                        break;
-                    }
-                    default: {
-                        throw std::runtime_error(
-                            "lamure: aux_stream::Stream corrupt -- Invalid segment encountered");
-                        break;
-                    }
-                }
-                break;
-            }
-            case 'V': { //"AUXXVIEW"
-                aux_view_seg view;
-                view.deserialize(file_);
-                views.push_back(view);
-                if (camera_id != view.camera_id_) {
-                  throw std::runtime_error(
-                    "lamure: aux_stream::Stream corrupt -- Invalid view order");
+                if (sig.signature_[5] != 'P') {
+                    throw std::runtime_error(
+                        "lamure: aux_stream::Stream corrupt -- Invalid segment encountered");
                 }
-                ++camera_id;
                 break;
             }
             case 'T': { 
-                switch (sig.signature_[5]) {
-                    case 'I': { //"AUXXTILE"
-                        aux_atlas_tile_seg tile;
-                        tile.deserialize(file_);
-                        tiles.push_back(tile);
-                        if (tile_id != tile.atlas_tile_id_) {
-                          throw std::runtime_error(
-                            "lamure: aux_stream::Stream corrupt -- Invalid tile order");
-                        }
-                        ++tile_id;
-                        break;
-                    }
-                    case 'R': {  //"AUXXTREE"
-                        tree.deserialize(file_);
-                        break;
-                    }
-                    default: {
-                        throw std::runtime_error(
-                            "lamure: aux_stream::Stream corrupt -- Invalid segment encountered");
-                        break;
-                    }
+                if (sig.signature_[5] != 'I' && sig.signature_[5] != 'R') {
+                    throw std::runtime_error(
+                        "lamure: aux_stream::Stream corrupt -- Invalid segment encountered");
                 }
                 break;
             }
@@ -225,8 +218,10 @@ read_aux(const std::string& filename, aux& aux) {
             }
         }
 
-        if (anchor + sig.allocated_size_ < filesize) {
-            file_.seekg(anchor + sig.allocated_size_, std::ios::beg);
+        segments_.push_back(segment);
+
+        if (segment.offset_ + sig.allocated_size_ < filesize) {
+            file_.seekg(segment.offset_ + sig.allocated_size_, std::ios::beg);
         }
         else {
             break;
@@ -234,39 +229,56 @@ read_aux(const std::string& filename, aux& aux) {
 
     }
 
-    close_stream(false);
-
-    if (sparse_id != 1) {
+    const auto sparse_segments = find_segments("AUXXSPRS");
+    if (sparse_segments.size() != 1) {
        throw std::runtime_error(
            "lamure: aux_stream::Stream corrupt -- Invalid number of sparse segments");
     }   
 
-    for (uint64_t i = 0; i < sparse.num_points_; ++i) {
-      aux::sparse_point p;
-      p.pos_ = scm::math::vec3f(sparse.points_[i].x_, sparse.points_[i].y_, sparse.points_[i].z_);
-      p.r_ = sparse.points_[i].r_;
-      p.g_ = sparse.points_[i].g_;
-      p.b_ = sparse.points_[i].b_;
-      p.a_ = (uint8_t)255;
+    //segment id and reserved fields precede the number of points
+    file_.seekg(sparse_segments[0]->offset_ + 6*sizeof(uint32_t), std::ios::beg);
+    file_.read((char*)&num_sparse_points_, 8);
+
+}
 
-      for (uint32_t j = 0; j < sparse.points_[i].num_features_; ++j) {
-        aux::feature f;
-        f.camera_id_ = sparse.points_[i].features_[j].camera_id_;
-        f.using_count_ = sparse.points_[i].features_[j].using_count_;
-        f.coords_ = scm::math::vec2f(
-          sparse.points_[i].features_[j].img_x_, 
-          sparse.points_[i].features_[j].img_y_);
-        f.error_ = scm::math::vec2f(
-          sparse.points_[i].features_[j].error_x_, 
-          sparse.points_[i].features_[j].error_y_);
-        p.features_.push_back(f);
-      }
 
-      aux.add_sparse_point(p);
+const aux_stream::aux_segment* aux_stream::
+find_segment(const char* signature) const {
+    for (const auto& segment : segments_) {
+        if (memcmp(segment.signature_, signature, 8) == 0) {
+            return &segment;
+        }
     }
+    return nullptr;
+}
+
+std::vector<const aux_stream::aux_segment*> aux_stream::
+find_segments(const char* signature) const {
+    std::vector<const aux_segment*> segments;
+    for (const auto& segment : segments_) {
+        if (memcmp(segment.signature_, signature, 8) == 0) {
+            segments.push_back(&segment);
+        }
+    }
+    return segments;
+}
+
+
+void aux_stream::
+read_views(std::vector<aux::view>& views) {
+
+    uint32_t camera_id = 0;
+
+    for (const auto segment : find_segments("AUXXVIEW")) {
+       aux_view_seg view;
+       file_.seekg(segment->offset_, std::ios::beg);
+       view.deserialize(file_);
+       if (camera_id != view.camera_id_) {
+         throw std::runtime_error(
+           "lamure: aux_stream::Stream corrupt -- Invalid view order");
+       }
+       ++camera_id;
 
-    
-    for (const auto& view : views) {
        aux::view v;
        v.camera_id_ = view.camera_id_;
        v.position_ = scm::math::vec3f(view.position_.x_, view.position_.y_, view.position_.z_);
@@ -282,18 +294,152 @@ read_aux(const std::string& filename, aux& aux) {
        v.atlas_tile_id_ = view.atlas_tile_id_;
        v.image_file_ = view.image_file_.string_;
 
-       aux.add_view(v);
-
-   
+       views.push_back(v);
     }
 
-    for (const auto& tile : tiles) {
+}
+
+
+void aux_stream::
+read_atlas_tiles(std::vector<aux::atlas_tile>& tiles) {
+
+    uint32_t tile_id = 0;
+
+    for (const auto segment : find_segments("AUXXTILE")) {
+      aux_atlas_tile_seg tile;
+      file_.seekg(segment->offset_, std::ios::beg);
+      tile.deserialize(file_);
+      if (tile_id != tile.atlas_tile_id_) {
+        throw std::runtime_error(
+          "lamure: aux_stream::Stream corrupt -- Invalid tile order");
+      }
+      ++tile_id;
+
       aux::atlas_tile t;
       t.atlas_tile_id_ = tile.atlas_tile_id_;
       t.uv_ = scm::math::vec2f(tile.uv_.x_, tile.uv_.y_);
       t.wh_ = scm::math::vec2f(tile.wh_.x_, tile.wh_.y_);
       
-      aux.add_atlas_tile(t);
+      tiles.push_back(t);
+    }
+
+}
+
+
+void aux_stream::
+read_sparse_points(std::vector<aux::sparse_point>& points) {
+
+    points.reserve(points.size() + num_sparse_points_);
+
+    seek_sparse_points();
+
+    aux::sparse_chunk chunk;
+    while (read_sparse_chunk(1 << 16, chunk) > 0) {
+      for (const auto& point : chunk.points_) {
+        aux::sparse_point p;
+        p.pos_ = point.pos_;
+        p.r_ = point.r_;
+        p.g_ = point.g_;
+        p.b_ = point.b_;
+        p.a_ = point.a_;
+        p.features_.assign(chunk.features_.begin() + point.features_offset_,
+          chunk.features_.begin() + point.features_offset_ + point.num_features_);
+        points.push_back(p);
+      }
+    }
+
+}
+
+
+void aux_stream::
+seek_sparse_points() {
+
+    const aux_segment* segment = find_segment("AUXXSPRS");
+    if (segment == nullptr) {
+       throw std::runtime_error(
+           "lamure: aux_stream::Stream corrupt -- Invalid number of sparse segments");
+    }
+
+    //points follow the 32 byte segment header
+    next_sparse_point_ = 0;
+    next_sparse_offset_ = segment->offset_ + 8*sizeof(uint32_t);
+
+}
+
+
+uint64_t aux_stream::
+read_sparse_chunk(uint64_t max_points, aux::sparse_chunk& chunk) {
+
+    chunk.first_point_id_ = next_sparse_point_;
+    chunk.points_.clear();
+    chunk.features_.clear();
+
+    uint64_t num_points = std::min(max_points, num_sparse_points_ - next_sparse_point_);
+    if (num_points == 0) {
+      return 0;
+    }
+
+    file_.clear();
+    file_.seekg(next_sparse_offset_, std::ios::beg);
+
+    //point records and features are read as a whole, see aux_sparse_seg
+    static_assert(sizeof(aux_feature) == 8*sizeof(uint32_t), "aux_feature must match its file layout");
+    std::vector<aux_feature> features;
+
+    chunk.points_.resize(num_points);
+    for (uint64_t i = 0; i < num_points; ++i) {
+      char record[8*sizeof(uint32_t)];
+      file_.read(record, sizeof(record));
+
+      auto& p = chunk.points_[i];
+      memcpy(&p.pos_.x, record, 4);
+      memcpy(&p.pos_.y, record + 4, 4);
+      memcpy(&p.pos_.z, record + 8, 4);
+      p.r_ = (uint8_t)record[12];
+      p.g_ = (uint8_t)record[13];
+      p.b_ = (uint8_t)record[14];
+      p.a_ = (uint8_t)255;
+
+      float num_features = 0.f;
+      memcpy(&num_features, record + 28, 4);
+      p.num_features_ = (uint32_t)num_features;
+      p.features_offset_ = chunk.features_.size();
+
+      features.resize(p.num_features_);
+      file_.read((char*)features.data(), p.num_features_*sizeof(aux_feature));
+
+      for (const auto& feature : features) {
+        aux::feature f;
+        f.camera_id_ = feature.camera_id_;
+        f.using_count_ = feature.using_count_;
+        f.coords_ = scm::math::vec2f(feature.img_x_, feature.img_y_);
+        f.error_ = scm::math::vec2f(feature.error_x_, feature.error_y_);
+        chunk.features_.push_back(f);
+      }
+    }
+
+    if (!file_.good()) {
+      throw std::runtime_error(
+        "lamure: aux_stream::Stream corrupt -- Unexpected end of sparse segment");
+    }
+
+    next_sparse_point_ += num_points;
+    next_sparse_offset_ = (size_t)file_.tellg();
+
+    return num_points;
+
+}
+
+
+std::shared_ptr<octree> aux_stream::
+read_octree() {
+
+    aux_tree_seg tree;
+    tree.depth_ = 0;
+    const aux_segment* segment = find_segment("AUXXTREE");
+    if (segment != nullptr) {
+      file_.seekg(segment->offset_, std::ios::beg);
+      tree.deserialize(file_);
     }
 
     std::shared_ptr<octree> ot = std::make_shared<octree>();
@@ -301,18 +447,43 @@ read_aux(const std::string& filename, aux& aux) {
     for (const auto& node : tree.nodes_) {
       octree_node n{node.idx_, node.child_mask_, node.child_idx_, 
         scm::math::vec3f(node.min_.x_, node.min_.y_, node.min_.z_),
-        scm::math::vec3f(node.max_.x_, node.max_.y_, node.max_.z_),
-        node.fotos_};
-      ot->add_node(n);
+        scm::math::vec3f(node.max_.x_, node.max_.y_, node.max_.z_)};
+      ot->add_node(n, node.fotos_);
     }
-    aux.set_octree(ot);
 
+    return ot;
 
 }
 
 void aux_stream::
 write_aux(const std::string& filename, aux& aux) {
 
+   begin_aux(filename);
+
+   for (uint32_t i = 0; i < aux.get_num_views(); ++i) {
+     write_view(aux.get_view(i));
+   }
+
+   for (uint32_t i = 0; i < aux.get_num_atlas_tiles(); ++i) {
+     write_atlas_tile(aux.get_atlas_tile(i));
+   }
+
+   begin_sparse_points();
+   aux.for_each_sparse_chunk(1 << 16, [&](const aux::sparse_chunk& chunk) {
+     write_sparse_points(chunk);
+   });
+   end_sparse_points();
+
+   write_octree(*aux.get_octree());
+
+   end_aux();
+
+}
+
+
+void aux_stream::
+begin_aux(const std::string& filename) {
+
    open_stream(filename, aux_stream_type::AUX_STREAM_OUT);
 
    if (type_ != AUX_STREAM_OUT) {
@@ -333,61 +504,94 @@ write_aux(const std::string& filename, aux& aux) {
 
    write(seg);
 
+}
 
-   for (uint32_t i = 0; i < aux.get_num_views(); ++i) {
-     const auto& view = aux.get_view(i);
-     aux_view_seg v;
-
-     v.segment_id_ = num_segments_++;
-     v.camera_id_ = view.camera_id_;
-     v.position_.x_ = view.position_.x;
-     v.position_.y_ = view.position_.y;
-     v.position_.z_ = view.position_.z;
-     v.reserved_0_ = 0;
-     
-     scm::math::quatf quat = scm::math::quatf::from_matrix(view.transform_);
-     v.orientation_.w_ = quat.w;
-     v.orientation_.x_ = quat.x;
-     v.orientation_.y_ = quat.y;
-     v.orientation_.z_ = quat.z;
-
-     v.focal_length_ = view.focal_length_;
-     v.distortion_ = view.distortion_;
-     v.reserved_1_ = 0;
-     v.reserved_2_ = 0;
-     v.reserved_3_ = 0;
-     v.reserved_4_ = 0;
-     v.reserved_5_ = 0;
-     v.reserved_6_ = 0;
-     v.image_width_ = view.image_width_;
-     v.image_height_ = view.image_height_;
-     v.atlas_tile_id_ = view.atlas_tile_id_;
-    
-     aux_string image_file;
-     image_file.string_ = view.image_file_;
-     image_file.length_ = view.image_file_.length();
-     v.image_file_ = image_file;
+
+void aux_stream::
+end_aux() {
+   close_stream(false);
+}
+
+
+void aux_stream::
+write_view(const aux::view& view) {
+
+   aux_view_seg v;
+
+   v.segment_id_ = num_segments_++;
+   v.camera_id_ = view.camera_id_;
+   v.position_.x_ = view.position_.x;
+   v.position_.y_ = view.position_.y;
+   v.position_.z_ = view.position_.z;
+   v.reserved_0_ = 0;
    
-     write(v);
+   scm::math::quatf quat = scm::math::quatf::from_matrix(view.transform_);
+   v.orientation_.w_ = quat.w;
+   v.orientation_.x_ = quat.x;
+   v.orientation_.y_ = quat.y;
+   v.orientation_.z_ = quat.z;
+
+   v.focal_length_ = view.focal_length_;
+   v.distortion_ = view.distortion_;
+   v.reserved_1_ = 0;
+   v.reserved_2_ = 0;
+   v.reserved_3_ = 0;
+   v.reserved_4_ = 0;
+   v.reserved_5_ = 0;
+   v.reserved_6_ = 0;
+   v.image_width_ = view.image_width_;
+   v.image_height_ = view.image_height_;
+   v.atlas_tile_id_ = view.atlas_tile_id_;
+   v.reserved_7_ = 0;
+   v.reserved_8_ = 0;
+   v.reserved_9_ = 0;
+  
+   aux_string image_file;
+   image_file.string_ = view.image_file_;
+   image_file.length_ = view.image_file_.length();
+   v.image_file_ = image_file;
+ 
+   write(v);
 
-   }
+}
 
-   for (uint32_t i = 0; i < aux.get_num_atlas_tiles(); ++i) {
-     const auto& tile = aux.get_atlas_tile(i);
-     aux_atlas_tile_seg t;
 
-     t.segment_id_ = num_segments_++;
-     t.atlas_tile_id_ = tile.atlas_tile_id_;
-     t.uv_.x_ = tile.uv_.x;
-     t.uv_.y_ = tile.uv_.y;
-     t.wh_.x_ = tile.wh_.x;
-     t.wh_.y_ = tile.wh_.y;
+void aux_stream::
+write_atlas_tile(const aux::atlas_tile& tile) {
+
+   aux_atlas_tile_seg t;
+
+   t.segment_id_ = num_segments_++;
+   t.atlas_tile_id_ = tile.atlas_tile_id_;
+   t.uv_.x_ = tile.uv_.x;
+   t.uv_.y_ = tile.uv_.y;
+   t.wh_.x_ = tile.wh_.x;
+   t.wh_.y_ = tile.wh_.y;
+
+   write(t);
+
+}
 
-     write(t);
 
+void aux_stream::
+begin_sparse_points() {
+
+   if (!file_.is_open()) {
+       throw std::runtime_error(
+           "lamure: aux_stream::Unable to serialize: " + filename_);
    }
-   
+
+   //signature and header are written again with the final sizes
+   sparse_segment_offset_ = (size_t)file_.tellp();
+   num_sparse_points_ = 0;
+
+   aux_sig sig;
    aux_sparse_seg sparse;
+   sparse.signature(sig.signature_);
+   sig.reserved_ = 0;
+   sig.allocated_size_ = 0;
+   sig.used_size_ = 0;
+   sig.serialize(file_);
 
    sparse.segment_id_ = num_segments_++;
    sparse.reserved_0_ = 0;
@@ -395,11 +599,20 @@ write_aux(const std::string& filename, aux& aux) {
    sparse.reserved_2_ = 0;
    sparse.reserved_3_ = 0;
    sparse.reserved_4_ = 0;
-   sparse.num_points_ = aux.get_num_sparse_points();
+   sparse.num_points_ = 0;
+   sparse.serialize(file_);
+
+}
+
+
+void aux_stream::
+write_sparse_points(const aux::sparse_chunk& chunk) {
 
-   for (uint64_t i = 0; i < sparse.num_points_; ++i) {
-     
-     const auto& point = aux.get_sparse_point(i);
+   //same layout as aux_sparse_seg, a chunk is written at once
+   std::vector<char> buffer;
+   buffer.reserve(chunk.points_.size()*8*sizeof(uint32_t) + chunk.features_.size()*sizeof(aux_feature));
+
+   for (const auto& point : chunk.points_) {
      aux_sparse_point p;
      p.x_ = point.pos_.x;
      p.y_ = point.pos_.y;
@@ -408,13 +621,24 @@ write_aux(const std::string& filename, aux& aux) {
      p.g_ = point.g_;
      p.b_ = point.b_;
      p.a_ = (uint8_t)255;
-     p.reserved_0_ = 0;
-     p.reserved_1_ = 0;
-     p.reserved_2_ = 0;
-     p.num_features_ = point.features_.size();
-     
-     for (uint32_t j = 0; j < p.num_features_; ++j) {
-       const auto& feature = point.features_[j];
+     p.num_features_ = point.num_features_;
+
+     char record[8*sizeof(uint32_t)];
+     memcpy(record, &p.x_, 4);
+     memcpy(record + 4, &p.y_, 4);
+     memcpy(record + 8, &p.z_, 4);
+     record[12] = (char)p.r_;
+     record[13] = (char)p.g_;
+     record[14] = (char)p.b_;
+     record[15] = (char)p.a_;
+     memcpy(record + 16, &p.reserved_0_, 4);
+     memcpy(record + 20, &p.reserved_1_, 4);
+     memcpy(record + 24, &p.reserved_2_, 4);
+     memcpy(record + 28, &p.num_features_, 4);
+     buffer.insert(buffer.end(), record, record + sizeof(record));
+
+     for (uint32_t j = 0; j < point.num_features_; ++j) {
+       const auto& feature = chunk.features_[point.features_offset_ + j];
        aux_feature f;
        f.camera_id_ = feature.camera_id_;
        f.using_count_ = feature.using_count_;
@@ -424,22 +648,55 @@ write_aux(const std::string& filename, aux& aux) {
        f.error_y_ = feature.error_.y;
        f.reserved_0_ = 0;
        f.reserved_1_ = 0;
-       p.features_.push_back(f);
-     }    
+       buffer.insert(buffer.end(), (const char*)&f, (const char*)&f + sizeof(aux_feature));
+     }
+   }
+
+   file_.write(buffer.data(), buffer.size());
+   num_sparse_points_ += chunk.points_.size();
+
+}
 
-     sparse.points_.push_back(p);
+
+void aux_stream::
+end_sparse_points() {
+
+   aux_sig sig;
+   size_t used_size = (size_t)file_.tellp() - sparse_segment_offset_ - sig.size();
+   size_t allocated_size = used_size;
+   while (allocated_size % 32 != 0) {
+     char c = 0;
+     file_.write(&c, 1);
+     ++allocated_size;
    }
+   size_t end = (size_t)file_.tellp();
+
+   aux_sparse_seg sparse;
+   sparse.signature(sig.signature_);
+   sig.reserved_ = 0;
+   sig.allocated_size_ = allocated_size;
+   sig.used_size_ = used_size;
+
+   file_.seekp(sparse_segment_offset_, std::ios::beg);
+   sig.serialize(file_);
+   file_.seekp(6*sizeof(uint32_t), std::ios::cur);
+   file_.write((char*)&num_sparse_points_, 8);
+   file_.seekp(end, std::ios::beg);
+
+}
 
-   write(sparse);
 
-   aux_tree_seg tree;
-   tree.segment_id_ = num_segments_++;
-   tree.reserved_0_ = 0;
-   tree.num_nodes_ = aux.get_octree()->get_num_nodes();
-   tree.depth_ = aux.get_octree()->get_depth();
-   tree.reserved_1_ = 0;
-   for (uint64_t i = 0; i < tree.num_nodes_; ++i) {
-     const auto& node = aux.get_octree()->get_node(i);
+void aux_stream::
+write_octree(const octree& tree) {
+
+   aux_tree_seg t;
+   t.segment_id_ = num_segments_++;
+   t.reserved_0_ = 0;
+   t.num_nodes_ = tree.get_num_nodes();
+   t.depth_ = tree.get_depth();
+   t.reserved_1_ = 0;
+   for (uint64_t i = 0; i < t.num_nodes_; ++i) {
+     const auto& node = tree.get_node(i);
      aux_tree_node n;
      n.child_mask_ = node.get_child_mask();
      n.child_idx_ = node.get_child_idx();
@@ -450,16 +707,15 @@ write_aux(const std::string& filename, aux& aux) {
      n.max_.y_ = node.get_max().y;
      n.max_.z_ = node.get_max().z;
      n.idx_ = node.get_idx();
-     n.num_fotos_ = node.get_fotos().size();
-     n.fotos_ = node.get_fotos();
-     tree.nodes_.push_back(n); 
+     const auto fotos = tree.get_fotos(i);
+     n.num_fotos_ = fotos.size();
+     n.fotos_.insert(fotos.begin(), fotos.end());
+     t.nodes_.push_back(n); 
    }
 
-   write(tree);
+   write(t);
 
-   std::cout << "Serialized " << tree.nodes_.size() << " octree nodes" << std::endl;
-
-   close_stream(false);
+   std::cout << "Serialized " << t.nodes_.size() << " octree nodes" << std::endl;
 
 }
 
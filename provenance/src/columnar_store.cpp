@@ -0,0 +1,342 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/prov/columnar_store.h>
+
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lamure {
+namespace prov
+{
+namespace
+{
+void write_section(ofstream &os, const ColumnarStore::Header &header, ColumnarStore::Section section, uint64_t byte_offset, const void *data, uint64_t length_in_bytes)
+{
+    if(length_in_bytes == 0)
+    {
+        return;
+    }
+
+    os.seekp(header.section_offsets[section] + byte_offset);
+    os.write(reinterpret_cast<const char *>(data), length_in_bytes);
+}
+
+// Extends the file to the end of the last section, which is shorter than declared if trailing sections are empty.
+void finish_file(ofstream &os, const ColumnarStore::Header &header, const string &file_name)
+{
+    uint64_t file_length = sizeof(ColumnarStore::Header);
+    for(uint32_t section = 0; section < ColumnarStore::NUM_SECTIONS; ++section)
+    {
+        file_length = std::max(file_length, header.section_offsets[section] + header.section_lengths[section]);
+    }
+
+    os.seekp(0, std::ios::end);
+    uint64_t current_length = (uint64_t)os.tellp();
+    if(current_length < file_length)
+    {
+        vec<char> padding(file_length - current_length, 0);
+        os.write(padding.data(), padding.size());
+    }
+
+    if(!os.good())
+    {
+        throw std::runtime_error("lamure: ColumnarStore::Unable to write file: " + file_name);
+    }
+}
+}
+
+const char ColumnarStore::MAGIC[8] = {'L', 'A', 'M', 'P', 'R', 'O', 'V', 'C'};
+
+ColumnarStore::ColumnarStore() : _data(nullptr), _size(0), _mapped(false) { memset(&_header, 0, sizeof(Header)); }
+
+ColumnarStore::~ColumnarStore() { close(); }
+
+void ColumnarStore::open(const string &file_name)
+{
+    close();
+
+    if(BYTE_ORDER == BIG_ENDIAN)
+    {
+        throw std::runtime_error("lamure: ColumnarStore::Columnar provenance files are little endian: " + file_name);
+    }
+
+#ifndef _WIN32
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if(fd >= 0)
+    {
+        struct stat info;
+        if(fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if(address != MAP_FAILED)
+            {
+                _data = (const char *)address;
+                _size = (uint64_t)info.st_size;
+                _mapped = true;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    if(!_mapped)
+    {
+        std::ifstream file(file_name, std::ios::in | std::ios::binary | std::ios::ate);
+        if(!file.is_open())
+        {
+            throw std::runtime_error("lamure: ColumnarStore::Unable to open file: " + file_name);
+        }
+        _size = (uint64_t)file.tellg();
+        file.seekg(0, std::ios::beg);
+        _buffer.resize(_size);
+        if(_size > 0 && !file.read(&_buffer[0], _size))
+        {
+            throw std::runtime_error("lamure: ColumnarStore::Unable to read file: " + file_name);
+        }
+        _data = _buffer.empty() ? nullptr : &_buffer[0];
+    }
+
+    if(_size < sizeof(Header) || memcmp(_data, MAGIC, 8) != 0)
+    {
+        close();
+        throw std::runtime_error("lamure: ColumnarStore::Invalid magic encountered: " + file_name);
+    }
+
+    memcpy(&_header, _data, sizeof(Header));
+
+    bool valid = _header.version == VERSION && _header.num_sections == NUM_SECTIONS;
+    for(uint32_t section = 0; valid && section < NUM_SECTIONS; ++section)
+    {
+        valid = _header.section_offsets[section] % SECTION_ALIGNMENT == 0 && _header.section_offsets[section] <= _size &&
+                _header.section_lengths[section] <= _size - _header.section_offsets[section];
+    }
+
+    valid = valid && _header.section_lengths[POSITIONS] == 3 * sizeof(float) * _header.num_points &&
+            _header.section_lengths[COLORS] == 3 * sizeof(float) * _header.num_points && _header.section_lengths[NORMALS] == 3 * sizeof(float) * _header.num_points &&
+            _header.section_lengths[PHOTOMETRIC_CONSISTENCIES] == sizeof(float) * _header.num_points &&
+            _header.section_lengths[IMAGES_SEEN_OFFSETS] == sizeof(uint64_t) * (_header.num_points + 1) &&
+            _header.section_lengths[IMAGES_NOT_SEEN_OFFSETS] == sizeof(uint64_t) * (_header.num_points + 1);
+
+    if(valid)
+    {
+        // Offsets are only checked at both ends, a point's range is clamped in the accessors.
+        span<uint64_t> seen_offsets = get_images_seen_offsets();
+        span<uint64_t> not_seen_offsets = get_images_not_seen_offsets();
+        valid = seen_offsets[0] == 0 && seen_offsets[_header.num_points] * sizeof(uint32_t) == _header.section_lengths[IMAGES_SEEN] && not_seen_offsets[0] == 0 &&
+                not_seen_offsets[_header.num_points] * sizeof(uint32_t) == _header.section_lengths[IMAGES_NOT_SEEN];
+    }
+
+    if(!valid)
+    {
+        close();
+        throw std::runtime_error("lamure: ColumnarStore::Invalid sections encountered: " + file_name);
+    }
+
+#ifndef _WIN32
+    if(_mapped)
+    {
+        madvise(const_cast<char *>(_data), (size_t)_size, MADV_WILLNEED);
+    }
+#endif
+}
+
+void ColumnarStore::close()
+{
+#ifndef _WIN32
+    if(_mapped && _data != nullptr)
+    {
+        munmap(const_cast<char *>(_data), (size_t)_size);
+    }
+#endif
+
+    _data = nullptr;
+    _size = 0;
+    _mapped = false;
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    memset(&_header, 0, sizeof(Header));
+}
+
+span<uint32_t> ColumnarStore::get_images_seen(uint64_t index) const
+{
+    span<uint64_t> offsets = get_images_seen_offsets();
+    span<uint32_t> ids = get_section<uint32_t>(IMAGES_SEEN);
+    uint64_t begin = std::min(offsets[index], ids.size());
+    uint64_t end = std::min(std::max(offsets[index + 1], begin), ids.size());
+    return span<uint32_t>(ids.data() + begin, end - begin);
+}
+
+span<uint32_t> ColumnarStore::get_images_not_seen(uint64_t index) const
+{
+    span<uint64_t> offsets = get_images_not_seen_offsets();
+    span<uint32_t> ids = get_section<uint32_t>(IMAGES_NOT_SEEN);
+    uint64_t begin = std::min(offsets[index], ids.size());
+    uint64_t end = std::min(std::max(offsets[index + 1], begin), ids.size());
+    return span<uint32_t>(ids.data() + begin, end - begin);
+}
+
+ColumnarStore::Header ColumnarStore::create_header(uint64_t num_points, uint64_t num_images_seen, uint64_t num_images_not_seen)
+{
+    Header header;
+    memset(&header, 0, sizeof(Header));
+    memcpy(header.magic, MAGIC, 8);
+    header.version = VERSION;
+    header.num_sections = NUM_SECTIONS;
+    header.num_points = num_points;
+
+    header.section_lengths[POSITIONS] = 3 * sizeof(float) * num_points;
+    header.section_lengths[COLORS] = 3 * sizeof(float) * num_points;
+    header.section_lengths[NORMALS] = 3 * sizeof(float) * num_points;
+    header.section_lengths[PHOTOMETRIC_CONSISTENCIES] = sizeof(float) * num_points;
+    header.section_lengths[IMAGES_SEEN_OFFSETS] = sizeof(uint64_t) * (num_points + 1);
+    header.section_lengths[IMAGES_NOT_SEEN_OFFSETS] = sizeof(uint64_t) * (num_points + 1);
+    header.section_lengths[IMAGES_SEEN] = sizeof(uint32_t) * num_images_seen;
+    header.section_lengths[IMAGES_NOT_SEEN] = sizeof(uint32_t) * num_images_not_seen;
+
+    uint64_t offset = sizeof(Header);
+    for(uint32_t section = 0; section < NUM_SECTIONS; ++section)
+    {
+        offset = (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+        header.section_offsets[section] = offset;
+        offset += header.section_lengths[section];
+    }
+
+    return header;
+}
+
+void ColumnarStore::write(const string &file_name, const DenseColumns &columns)
+{
+    if(BYTE_ORDER == BIG_ENDIAN)
+    {
+        throw std::runtime_error("lamure: ColumnarStore::Columnar provenance files are little endian: " + file_name);
+    }
+
+    ofstream os(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!os.is_open())
+    {
+        throw std::runtime_error("lamure: ColumnarStore::Unable to open file: " + file_name);
+    }
+
+    Header header = create_header(columns.size(), columns.images_seen.size(), columns.images_not_seen.size());
+    os.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    write_section(os, header, POSITIONS, 0, columns.positions.data(), header.section_lengths[POSITIONS]);
+    write_section(os, header, COLORS, 0, columns.colors.data(), header.section_lengths[COLORS]);
+    write_section(os, header, NORMALS, 0, columns.normals.data(), header.section_lengths[NORMALS]);
+    write_section(os, header, PHOTOMETRIC_CONSISTENCIES, 0, columns.photometric_consistencies.data(), header.section_lengths[PHOTOMETRIC_CONSISTENCIES]);
+
+    // Columns of zero points may come without offsets.
+    vec<uint64_t> empty_offsets(1, 0);
+    const vec<uint64_t> &seen_offsets = columns.images_seen_offsets.empty() ? empty_offsets : columns.images_seen_offsets;
+    const vec<uint64_t> &not_seen_offsets = columns.images_not_seen_offsets.empty() ? empty_offsets : columns.images_not_seen_offsets;
+    write_section(os, header, IMAGES_SEEN_OFFSETS, 0, seen_offsets.data(), header.section_lengths[IMAGES_SEEN_OFFSETS]);
+    write_section(os, header, IMAGES_NOT_SEEN_OFFSETS, 0, not_seen_offsets.data(), header.section_lengths[IMAGES_NOT_SEEN_OFFSETS]);
+    write_section(os, header, IMAGES_SEEN, 0, columns.images_seen.data(), header.section_lengths[IMAGES_SEEN]);
+    write_section(os, header, IMAGES_NOT_SEEN, 0, columns.images_not_seen.data(), header.section_lengths[IMAGES_NOT_SEEN]);
+
+    finish_file(os, header, file_name);
+}
+
+void ColumnarStore::convert(ifstream &is_prov, ifstream &is_meta, const string &file_name, uint64_t points_per_chunk)
+{
+    if(BYTE_ORDER == BIG_ENDIAN)
+    {
+        throw std::runtime_error("lamure: ColumnarStore::Columnar provenance files are little endian: " + file_name);
+    }
+
+    // BulkDecoder inherits the header checks of Readable.
+    struct HeaderReader : public BulkDecoder
+    {
+        static void read(ifstream &is) { read_header(is); }
+    };
+
+    HeaderReader::read(is_prov);
+    HeaderReader::read(is_meta);
+
+    uint32_t points_length = read_swapped<uint32_t>(BulkDecoder::read_block(is_prov, 4).data(), true);
+    uint32_t meta_data_length = read_swapped<uint32_t>(BulkDecoder::read_block(is_prov, 4).data(), true);
+
+    points_per_chunk = std::max<uint64_t>(points_per_chunk, 1);
+    std::streampos meta_start = is_meta.tellg();
+
+    // The id sections follow the fixed size sections, so the number of ids is counted in a first pass over the meta data.
+    uint64_t num_images_seen = 0;
+    uint64_t num_images_not_seen = 0;
+
+    for(uint64_t first = 0; first < points_length; first += points_per_chunk)
+    {
+        uint32_t chunk_length = (uint32_t)std::min<uint64_t>(points_per_chunk, points_length - first);
+        vec<char> meta_block = BulkDecoder::read_block(is_meta, (uint64_t)chunk_length * meta_data_length);
+
+        DenseColumns chunk;
+        BulkDecoder::decode_dense_metadata(meta_block, chunk_length, meta_data_length, chunk);
+        num_images_seen += chunk.images_seen.size();
+        num_images_not_seen += chunk.images_not_seen.size();
+    }
+
+    is_meta.clear();
+    is_meta.seekg(meta_start);
+
+    ofstream os(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!os.is_open())
+    {
+        throw std::runtime_error("lamure: ColumnarStore::Unable to open file: " + file_name);
+    }
+
+    Header header = create_header(points_length, num_images_seen, num_images_not_seen);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    uint64_t zero = 0;
+    write_section(os, header, IMAGES_SEEN_OFFSETS, 0, &zero, sizeof(uint64_t));
+    write_section(os, header, IMAGES_NOT_SEEN_OFFSETS, 0, &zero, sizeof(uint64_t));
+
+    uint64_t images_seen_base = 0;
+    uint64_t images_not_seen_base = 0;
+
+    for(uint64_t first = 0; first < points_length; first += points_per_chunk)
+    {
+        uint32_t chunk_length = (uint32_t)std::min<uint64_t>(points_per_chunk, points_length - first);
+
+        vec<char> point_block = BulkDecoder::read_block(is_prov, (uint64_t)chunk_length * DensePoint::RECORD_LENGTH);
+        vec<char> meta_block = BulkDecoder::read_block(is_meta, (uint64_t)chunk_length * meta_data_length);
+
+        DenseColumns chunk;
+        BulkDecoder::decode_dense_points(point_block, chunk_length, chunk);
+        BulkDecoder::decode_dense_metadata(meta_block, chunk_length, meta_data_length, chunk);
+
+        write_section(os, header, POSITIONS, 3 * sizeof(float) * first, chunk.positions.data(), 3 * sizeof(float) * chunk_length);
+        write_section(os, header, COLORS, 3 * sizeof(float) * first, chunk.colors.data(), 3 * sizeof(float) * chunk_length);
+        write_section(os, header, NORMALS, 3 * sizeof(float) * first, chunk.normals.data(), 3 * sizeof(float) * chunk_length);
+        write_section(os, header, PHOTOMETRIC_CONSISTENCIES, sizeof(float) * first, chunk.photometric_consistencies.data(), sizeof(float) * chunk_length);
+
+        // Offsets of the chunk are relative to its first point.
+        for(uint64_t i = 0; i <= chunk_length; ++i)
+        {
+            chunk.images_seen_offsets[i] += images_seen_base;
+            chunk.images_not_seen_offsets[i] += images_not_seen_base;
+        }
+
+        write_section(os, header, IMAGES_SEEN_OFFSETS, sizeof(uint64_t) * (first + 1), chunk.images_seen_offsets.data() + 1, sizeof(uint64_t) * chunk_length);
+        write_section(os, header, IMAGES_NOT_SEEN_OFFSETS, sizeof(uint64_t) * (first + 1), chunk.images_not_seen_offsets.data() + 1, sizeof(uint64_t) * chunk_length);
+        write_section(os, header, IMAGES_SEEN, sizeof(uint32_t) * images_seen_base, chunk.images_seen.data(), sizeof(uint32_t) * chunk.images_seen.size());
+        write_section(os, header, IMAGES_NOT_SEEN, sizeof(uint32_t) * images_not_seen_base, chunk.images_not_seen.data(), sizeof(uint32_t) * chunk.images_not_seen.size());
+
+        images_seen_base += chunk.images_seen.size();
+        images_not_seen_base += chunk.images_not_seen.size();
+    }
+
+    finish_file(os, header, file_name);
+}
+}
+}
@@ -11,8 +11,7 @@
 
 #include <limits>
 #include <vector>
-#include <stack>
-#include <map>
+#include <algorithm>
 
 
 namespace lamure {
@@ -35,14 +34,34 @@ octree::
 
 void octree::
 create(std::vector<aux::sparse_point>& _points) {
+  std::vector<scm::math::vec3f> positions(_points.size());
+  std::vector<uint64_t> camera_offsets(_points.size()+1, 0);
+  for (uint64_t i = 0; i < _points.size(); ++i) {
+    positions[i] = _points[i].pos_;
+    camera_offsets[i+1] = camera_offsets[i] + _points[i].features_.size();
+  }
+
+  std::vector<uint32_t> camera_ids(camera_offsets.back());
+  #pragma omp parallel for
+  for (int64_t i = 0; i < (int64_t)_points.size(); ++i) {
+    for (uint64_t j = 0; j < _points[i].features_.size(); ++j) {
+      camera_ids[camera_offsets[i]+j] = _points[i].features_[j].camera_id_;
+    }
+  }
+
+  create(positions, camera_offsets, camera_ids);
+}
+
+void octree::
+create(const std::vector<scm::math::vec3f>& _positions,
+  const std::vector<uint64_t>& _camera_offsets, const std::vector<uint32_t>& _camera_ids) {
   nodes_.clear(); 
+  fotos_.clear();
   depth_ = 0;
   min_num_points_per_node_ = 16;
   uint32_t max_depth = 12;
 
-  std::vector<aux::sparse_point> points = _points;
-
-  uint64_t num_points = points.size();
+  uint64_t num_points = _positions.size();
   if (num_points < min_num_points_per_node_) {
     std::cout << "Too few points " << std::endl; exit(0);
   }
@@ -50,14 +69,14 @@ create(std::vector<aux::sparse_point>& _points) {
   scm::math::vec3f tree_min(std::numeric_limits<float>::max());
   scm::math::vec3f tree_max(std::numeric_limits<float>::lowest());
 
-  for (const auto& point : points) {
-    tree_min.x = std::min(tree_min.x, point.pos_.x);
-    tree_min.y = std::min(tree_min.y, point.pos_.y);
-    tree_min.z = std::min(tree_min.z, point.pos_.z);
+  for (const auto& pos : _positions) {
+    tree_min.x = std::min(tree_min.x, pos.x);
+    tree_min.y = std::min(tree_min.y, pos.y);
+    tree_min.z = std::min(tree_min.z, pos.z);
 
-    tree_max.x = std::max(tree_max.x, point.pos_.x);
-    tree_max.y = std::max(tree_max.y, point.pos_.y);
-    tree_max.z = std::max(tree_max.z, point.pos_.z);
+    tree_max.x = std::max(tree_max.x, pos.x);
+    tree_max.y = std::max(tree_max.y, pos.y);
+    tree_max.z = std::max(tree_max.z, pos.z);
   }
 
   //make the bounding box a cube
@@ -67,303 +86,188 @@ create(std::vector<aux::sparse_point>& _points) {
   
   std::cout << "tree min " << tree_min.x << " " << tree_min.y << " " << tree_min.z << std::endl;
   std::cout << "tree max " << tree_max.x << " " << tree_max.y << " " << tree_max.z << std::endl;
-  
+
+  //morton key of every point at max_depth, three bits per level from the root down,
+  //ordered like the child index: x | y << 1 | z << 2
+  std::vector<std::pair<uint64_t, uint32_t>> keys(num_points);
+  #pragma omp parallel for
+  for (int64_t i = 0; i < (int64_t)num_points; ++i) {
+    uint32_t coords[3];
+    quantize(_positions[i], tree_min, tree_max, max_depth, coords);
+    uint64_t key = 0;
+    for (int32_t level = max_depth-1; level >= 0; --level) {
+      key = (key << 3) | (((coords[2] >> level) & 1) << 2) | (((coords[1] >> level) & 1) << 1) | ((coords[0] >> level) & 1);
+    }
+    keys[i] = std::make_pair(key, (uint32_t)i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  //split nodes level by level, every node covers a range of the sorted keys
   struct auxiliary_node {
-    uint32_t idx_;
-    uint32_t depth_;
     uint64_t begin_;
     uint64_t end_;
-    scm::math::vec3f min_;
-    scm::math::vec3f max_;
+    uint64_t prefix_;
   };
 
-  uint32_t num_nodes = 0;
-  std::stack<auxiliary_node> nodes_todo;
-  nodes_todo.push(
-    auxiliary_node{
-      num_nodes++, 0, 0, num_points, tree_min, tree_max
-    });
-
+  std::vector<auxiliary_node> ranges;
+  std::vector<uint64_t> level_begin;
+  ranges.push_back(auxiliary_node{0, num_points, 0});
+  nodes_.push_back(octree_node(0, 0, 0, tree_min, tree_max));
 
-  std::map<uint64_t, octree_node> node_idx_map;
+  uint64_t level_first = 0;
+  while (level_first < nodes_.size()) {
+    uint64_t level_last = nodes_.size();
+    level_begin.push_back(level_first);
 
-  while (!nodes_todo.empty()) {
-    auxiliary_node node = nodes_todo.top();
-    nodes_todo.pop();
+    for (uint64_t node_id = level_first; node_id < level_last; ++node_id) {
+      const auxiliary_node node = ranges[node_id];
 
-    depth_ = std::max(depth_, node.depth_);
-
-    //some termination criterion
-    if (node.depth_ >= max_depth || node.end_-node.begin_ <= min_num_points_per_node_) {
-      std::set<uint32_t> fotos;
-      for (uint64_t i = node.begin_; i < node.end_; ++i) {
-        const auto& sp = points[i];
-        for (const auto& f : sp.features_) {
-          fotos.insert(f.camera_id_);
-        }
-        if (node.min_.x <= sp.pos_.x && node.max_.x >= sp.pos_.x
-          && node.min_.y <= sp.pos_.y && node.max_.y >= sp.pos_.y
-          && node.min_.z <= sp.pos_.z && node.max_.z >= sp.pos_.z) {
-
-        }
-        else {
-          std::cout << "e";
-        }
+      //some termination criterion
+      if (depth_ >= max_depth || node.end_-node.begin_ <= min_num_points_per_node_) {
+        continue;
       }
-      node_idx_map[node.idx_] = octree_node(node.idx_, 0, 0, node.min_, node.max_, fotos);
-      continue;
-    }
-
-    auto min_vertex = node.min_;
-    auto max_vertex = node.max_;
-    auto mid_vertex = 0.5f*(min_vertex+max_vertex);
 
-    //sort all points between begin and end along x-axis, find midpoint
-    std::sort(&points[node.begin_], &points[node.end_], 
-      [](const aux::sparse_point& _l, const aux::sparse_point& _r) -> bool { 
-        return _l.pos_.x < _r.pos_.x; 
-      }
-    );
-    uint64_t mid_id_x = node.begin_;
-    for (uint64_t i = node.begin_; i < node.end_; ++i) {
-      if (points[i].pos_.x >= mid_vertex.x) { mid_id_x = i; break; }
-    }
-    
-    //sort all points between begin and end along y-axis, find midpoints
-    std::sort(&points[node.begin_], &points[mid_id_x], 
-      [](const aux::sparse_point& _l, const aux::sparse_point& _r) -> bool { 
-        return _l.pos_.y < _r.pos_.y; 
-      }
-    );
-    uint64_t mid_id_y0 = node.begin_;
-    for (uint64_t i = node.begin_; i < mid_id_x; ++i) {
-      if (points[i].pos_.y >= mid_vertex.y) { mid_id_y0 = i; break; }
-    }
+      uint32_t shift = 3*(max_depth-depth_-1);
+      uint32_t child_mask = 0;
+      uint64_t child_begin = node.begin_;
+      for (uint32_t i = 0; i < 8; ++i) {
+        uint64_t upper_key = ((node.prefix_ << 3) | i) + 1;
+        uint64_t child_end = std::lower_bound(keys.begin()+child_begin, keys.begin()+node.end_,
+          std::make_pair(upper_key << shift, (uint32_t)0)) - keys.begin();
+        if (child_end > child_begin) {
+          child_mask |= (1 << i);
+          if (nodes_[node_id].get_child_idx() == 0) {
+            nodes_[node_id].set_child_idx(nodes_.size());
+          }
 
-    std::sort(&points[mid_id_x], &points[node.end_], 
-      [](const aux::sparse_point& _l, const aux::sparse_point& _r) -> bool { 
-        return _l.pos_.y < _r.pos_.y; 
-      }
-    );
-    uint64_t mid_id_y1 = mid_id_x;
-    for (uint64_t i = mid_id_x; i < node.end_; ++i) {
-      if (points[i].pos_.y >= mid_vertex.y) { mid_id_y1 = i; break; }
-    }
+          //regular subdivision of the cubic root box
+          uint64_t cell = (node.prefix_ << 3) | i;
+          uint32_t cell_coords[3] = {0, 0, 0};
+          for (uint32_t level = 0; level <= depth_; ++level) {
+            uint32_t octant = (cell >> (3*(depth_-level))) & 7;
+            for (uint32_t axis = 0; axis < 3; ++axis) {
+              cell_coords[axis] = (cell_coords[axis] << 1) | ((octant >> axis) & 1);
+            }
+          }
+          float cell_size = longest_axis / (float)(1u << (depth_+1));
+          scm::math::vec3f cell_min = tree_min + cell_size * scm::math::vec3f(cell_coords[0], cell_coords[1], cell_coords[2]);
 
-    //sort all points between begin and end along z-axis, find midpoints
-    std::sort(&points[node.begin_], &points[mid_id_y0], 
-      [](const aux::sparse_point& _l, const aux::sparse_point& _r) -> bool { 
-        return _l.pos_.z < _r.pos_.z; 
+          ranges.push_back(auxiliary_node{child_begin, child_end, cell});
+          nodes_.push_back(octree_node(nodes_.size(), 0, 0, cell_min, cell_min + scm::math::vec3f(cell_size)));
+        }
+        child_begin = child_end;
       }
-    );
-    uint64_t mid_id_z0 = node.begin_;
-    for (uint64_t i = node.begin_; i < mid_id_y0; ++i) {
-      if (points[i].pos_.z >= mid_vertex.z) { mid_id_z0 = i; break; }
+      nodes_[node_id].set_child_mask(child_mask);
     }
 
-    std::sort(&points[mid_id_y0], &points[mid_id_x], 
-      [](const aux::sparse_point& _l, const aux::sparse_point& _r) -> bool { 
-        return _l.pos_.z < _r.pos_.z; 
-      }
-    );
-    uint64_t mid_id_z1 = mid_id_y0;
-    for (uint64_t i = mid_id_y0; i < mid_id_x; ++i) {
-      if (points[i].pos_.z >= mid_vertex.z) { mid_id_z1 = i; break; }
+    if (nodes_.size() > level_last) {
+      ++depth_;
     }
-    
-    std::sort(&points[mid_id_x], &points[mid_id_y1], 
-      [](const aux::sparse_point& _l, const aux::sparse_point& _r) -> bool { 
-        return _l.pos_.z < _r.pos_.z; 
-      }
-    );
-    uint64_t mid_id_z2 = mid_id_x;
-    for (uint64_t i = mid_id_x; i < mid_id_y1; ++i) {
-      if (points[i].pos_.z >= mid_vertex.z) { mid_id_z2 = i; break; }
-    }
-    
-    std::sort(&points[mid_id_y1], &points[node.end_], 
-      [](const aux::sparse_point& _l, const aux::sparse_point& _r) -> bool { 
-        return _l.pos_.z < _r.pos_.z; 
-      }
-    );
-    uint64_t mid_id_z3 = mid_id_y1;
-    for (uint64_t i = mid_id_y1; i < node.end_; ++i) {
-      if (points[i].pos_.z >= mid_vertex.z) { mid_id_z3 = i; break; }
-    }
-
-    struct range {
-      uint64_t begin_;
-      uint64_t end_;
-    };
-    std::vector<range> ranges;
-    ranges.push_back({node.begin_, mid_id_z0});
-    ranges.push_back({mid_id_x, mid_id_z2});
-    ranges.push_back({mid_id_y0, mid_id_z1});
-    ranges.push_back({mid_id_y1, mid_id_z3});
-    ranges.push_back({mid_id_z0, mid_id_y0});
-    ranges.push_back({mid_id_z2, mid_id_y1});
-    ranges.push_back({mid_id_z1, mid_id_x});
-    ranges.push_back({mid_id_z3, node.end_});
-
-    std::vector<auxiliary_node> children;
-    children.push_back(
-      auxiliary_node{
-        0, node.depth_+1,
-        node.begin_, mid_id_z0,
-        min_vertex, 
-        mid_vertex,
-      });
-    children.push_back(
-      auxiliary_node{
-        0, node.depth_+1, 
-        mid_id_x, mid_id_z2,
-        scm::math::vec3f(mid_vertex.x, min_vertex.y, min_vertex.z),
-        scm::math::vec3f(max_vertex.x, mid_vertex.y, mid_vertex.z)
-      });
-    children.push_back(
-      auxiliary_node{
-        0, node.depth_+1, 
-        mid_id_y0, mid_id_z1,
-        scm::math::vec3f(min_vertex.x, mid_vertex.y, min_vertex.z),
-        scm::math::vec3f(mid_vertex.x, max_vertex.y, mid_vertex.z)
-      });
-    children.push_back(
-      auxiliary_node{
-        0, node.depth_+1, 
-        mid_id_y1, mid_id_z3,
-        scm::math::vec3f(mid_vertex.x, mid_vertex.y, min_vertex.z),
-        scm::math::vec3f(max_vertex.x, max_vertex.y, mid_vertex.z)
-      });
-    children.push_back(
-      auxiliary_node{
-        0, node.depth_+1, 
-        mid_id_z0, mid_id_y0,
-        scm::math::vec3f(min_vertex.x, min_vertex.y, mid_vertex.z),
-        scm::math::vec3f(mid_vertex.x, mid_vertex.y, max_vertex.z)
-      });
-    children.push_back(
-      auxiliary_node{
-        0, node.depth_+1, 
-        mid_id_z2, mid_id_y1,
-        scm::math::vec3f(mid_vertex.x, min_vertex.y, mid_vertex.z),
-        scm::math::vec3f(max_vertex.x, mid_vertex.y, max_vertex.z)
-      });
-    children.push_back(
-      auxiliary_node{
-        0, node.depth_+1, 
-        mid_id_z1, mid_id_x,
-        scm::math::vec3f(min_vertex.x, mid_vertex.y, mid_vertex.z),
-        scm::math::vec3f(mid_vertex.x, max_vertex.y, max_vertex.z)
-      });
-    children.push_back(
-      auxiliary_node{
-        0, node.depth_+1, 
-        mid_id_z3, node.end_,
-        mid_vertex,
-        max_vertex,
-      });
-    
-    uint32_t child_mask = 0;
-    uint32_t child_idx = 0;
-
-    for (uint32_t i = 0; i < ranges.size(); ++i) {
-      const auto& range = ranges[i];
-      if (range.begin_ - range.end_ > 0) {
-        bool found = false;
-        uint32_t child_id = 0;
-        for (uint32_t j = 0; j < children.size(); ++j) {
-          auto& child = children[j];
-          const auto sp = points[range.begin_];
-          if (child.min_.x <= sp.pos_.x && child.max_.x >= sp.pos_.x
-            && child.min_.y <= sp.pos_.y && child.max_.y >= sp.pos_.y
-            && child.min_.z <= sp.pos_.z && child.max_.z >= sp.pos_.z) {
-            found = true;
-            child_id = j;
-          }
-        }
-        
-        if (found) {
-          auto& child = children[child_id];
-          child.begin_ = range.begin_;
-          child.end_ = range.end_;
-          child.idx_ = num_nodes;
-          std::cout << "node " << num_nodes << " " << child.end_ - child.begin_ << " points " << std::endl;
-          //std::cout << "node " << num_nodes << " min " << child.min_.x << " " << child.min_.y << " " << child.min_.z << std::endl;
-          //std::cout << "node " << num_nodes << " max " << child.max_.x << " " << child.max_.y << " " << child.max_.z << std::endl;
-          nodes_todo.push(child);
-          child_mask |= (1 << i);
-          child_idx = child_idx == 0 ? num_nodes : child_idx;
-          ++num_nodes;
-        }
-        else {
-            std::cout << "WARNINg! did not find range " << i << std::endl;
+    level_first = level_last;
+  }
+  level_begin.push_back(nodes_.size());
+
+  //collect fotos bottom up, inner nodes merge the sorted sets of their children
+  std::vector<std::vector<uint32_t>> node_fotos(nodes_.size());
+  for (int32_t level = (int32_t)level_begin.size()-2; level >= 0; --level) {
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int64_t node_id = level_begin[level]; node_id < (int64_t)level_begin[level+1]; ++node_id) {
+      const auto& node = nodes_[node_id];
+      auto& fotos = node_fotos[node_id];
+      if ((node.get_child_mask() & 0xff) == 0) {
+        for (uint64_t i = ranges[node_id].begin_; i < ranges[node_id].end_; ++i) {
+          uint32_t point_id = keys[i].second;
+          fotos.insert(fotos.end(), _camera_ids.begin() + _camera_offsets[point_id],
+            _camera_ids.begin() + _camera_offsets[point_id+1]);
         }
       }
-    }
-
-    std::set<uint32_t> fotos;
-    for (uint64_t i = node.begin_; i < node.end_; ++i) {
-      const auto& sp = points[i];
-      for (const auto& f : sp.features_) {
-        fotos.insert(f.camera_id_);
-      }
-      if (node.min_.x <= sp.pos_.x && node.max_.x >= sp.pos_.x
-        && node.min_.y <= sp.pos_.y && node.max_.y >= sp.pos_.y
-        && node.min_.z <= sp.pos_.z && node.max_.z >= sp.pos_.z) {
-
-      }
       else {
-        std::cout << "e";
+        uint64_t child_id = node.get_child_idx();
+        for (uint32_t i = 0; i < 8; ++i) {
+          if ((node.get_child_mask() & (1 << i)) > 0) {
+            fotos.insert(fotos.end(), node_fotos[child_id].begin(), node_fotos[child_id].end());
+            ++child_id;
+          }
+        }
       }
-
+      std::sort(fotos.begin(), fotos.end());
+      fotos.erase(std::unique(fotos.begin(), fotos.end()), fotos.end());
     }
+  }
 
-    node_idx_map[node.idx_] = octree_node(node.idx_, child_mask, child_idx, node.min_, node.max_, fotos);
+  uint64_t num_fotos = 0;
+  for (uint64_t node_id = 0; node_id < nodes_.size(); ++node_id) {
+    nodes_[node_id].set_fotos_offset(num_fotos);
+    nodes_[node_id].set_num_fotos(node_fotos[node_id].size());
+    num_fotos += node_fotos[node_id].size();
+  }
 
+  fotos_.resize(num_fotos);
+  #pragma omp parallel for
+  for (int64_t node_id = 0; node_id < (int64_t)nodes_.size(); ++node_id) {
+    std::copy(node_fotos[node_id].begin(), node_fotos[node_id].end(), fotos_.begin() + nodes_[node_id].get_fotos_offset());
   }
 
-  std::cout << "octree complete " << "depth: " << depth_ << " num nodes: " << num_nodes << std::endl;
+  std::cout << "octree complete " << "depth: " << depth_ << " num nodes: " << nodes_.size() << " num fotos: " << num_fotos << std::endl;
 
-  for (uint64_t node_id = 0; node_id < num_nodes; ++node_id) {
-    nodes_.push_back(node_idx_map[node_id]);
-  }
+}
 
+void octree::
+quantize(const scm::math::vec3f& _pos, const scm::math::vec3f& _min, const scm::math::vec3f& _max,
+  uint32_t _depth, uint32_t* _coords) {
+  double cells = (double)(1ull << _depth);
+  for (uint32_t axis = 0; axis < 3; ++axis) {
+    double extent = _max[axis] - _min[axis];
+    double normalized = extent > 0.0 ? (_pos[axis] - _min[axis]) / extent : 0.0;
+    _coords[axis] = (uint32_t)std::min(std::max(normalized * cells, 0.0), cells - 1.0);
+  }
 }
 
 uint64_t octree::
-query(const scm::math::vec3f& _point) {
+query(const scm::math::vec3f& _point) const {
 
   if (nodes_.empty()) return 0;
 
-  //locate the node that contains the point
+  //points outside of the root are not contained in any child
+  const auto& root = nodes_[0];
+  if (!(root.get_min().x <= _point.x && root.get_max().x > _point.x 
+    && root.get_min().y <= _point.y && root.get_max().y > _point.y 
+    && root.get_min().z <= _point.z && root.get_max().z > _point.z)) {
+    return 0;
+  }
+
+  //cell coordinates at the deepest level, their bits select the child on each level
+  uint32_t depth = std::min(depth_, (uint32_t)31);
+  uint32_t coords[3];
+  quantize(_point, root.get_min(), root.get_max(), depth, coords);
+
   uint64_t current_node_id = 0;
-  while ((nodes_[current_node_id].get_child_mask() & 0xff) > 0) {
-    bool found = false;
-    for (uint32_t i = 0; i < 8; ++i) {
-      if ((nodes_[current_node_id].get_child_mask() & (1 << i) & 0xff) > 0 ) {
-        uint64_t child_id = get_child_id(current_node_id, i);
-        const auto& node = nodes_[child_id];
-        if (node.get_min().x <= _point.x && node.get_max().x > _point.x 
-          && node.get_min().y <= _point.y && node.get_max().y > _point.y 
-          && node.get_min().z <= _point.z && node.get_max().z > _point.z) { 
-          current_node_id = child_id;
-          found = true;
-          break;
-        }
-      }
-    }
-    if (!found) {
-      //point is not contained in any children
-      //so this is the deepest child that contains it
-      //we're done.
+  for (uint32_t level = 0; level < depth; ++level) {
+    const auto& node = nodes_[current_node_id];
+    uint32_t child_mask = node.get_child_mask() & 0xff;
+    uint32_t shift = depth-level-1;
+    uint32_t octant = ((coords[0] >> shift) & 1) | (((coords[1] >> shift) & 1) << 1) | (((coords[2] >> shift) & 1) << 2);
+    if ((child_mask & (1 << octant)) == 0) {
+      //this is the deepest node that contains the point
       break;
     }
+    current_node_id = get_child_id(current_node_id, octant);
   }
   
   return current_node_id;
 
 }
 
+std::vector<uint64_t> octree::
+query(const span<scm::math::vec3f>& _positions) const {
+  std::vector<uint64_t> node_ids(_positions.size());
+  #pragma omp parallel for
+  for (int64_t i = 0; i < (int64_t)_positions.size(); ++i) {
+    node_ids[i] = query(_positions[i]);
+  }
+  return node_ids;
+}
+
 uint64_t octree::
 get_num_nodes() const {
   return nodes_.size();
@@ -371,14 +275,35 @@ get_num_nodes() const {
 
 
 const octree_node& octree::
-get_node(uint64_t _node_id) {
+get_node(uint64_t _node_id) const {
   return nodes_[_node_id];
 }
 
 
 void octree::
-add_node(const octree_node& _node) {
-  return nodes_.push_back(_node);
+add_node(const octree_node& _node, const std::set<uint32_t>& _fotos) {
+  nodes_.push_back(_node);
+  nodes_.back().set_fotos_offset(fotos_.size());
+  nodes_.back().set_num_fotos(_fotos.size());
+  fotos_.insert(fotos_.end(), _fotos.begin(), _fotos.end());
+}
+
+
+span<uint32_t> octree::
+get_fotos(uint64_t _node_id) const {
+  const auto& node = nodes_[_node_id];
+  return span<uint32_t>(fotos_.data() + node.get_fotos_offset(), node.get_num_fotos());
+}
+
+
+uint64_t octree::
+get_num_fotos() const {
+  return fotos_.size();
+}
+
+uint64_t octree::
+get_min_num_points() const {
+  return min_num_points_per_node_;
 }
 
 
@@ -394,7 +319,7 @@ set_depth(uint32_t _depth) {
 
 
 uint64_t octree::
-get_child_id(uint64_t _node_id, uint32_t _child_index) {
+get_child_id(uint64_t _node_id, uint32_t _child_index) const {
   uint32_t child_id = nodes_[_node_id].get_child_idx();
   for (uint32_t i = 0; i < _child_index; ++i) {
     if (((nodes_[_node_id].get_child_mask() & (1 << i)) & 0xff) > 0) {
@@ -66,6 +66,16 @@ public:
 	const view_cell* get_original_cell_at_position(const scm::math::vec3d& position, size_t* cell_index) const;
 	bool is_cell_at_index_original(const size_t& index) const;
 
+	// Index of the view cell (original or managing) an original cell is currently represented by.
+	size_t get_cell_index_of_original_cell(const size_t& original_index) const;
+	
+	// Indices of the original cells sharing a face with the given original cell.
+	std::vector<size_t> get_original_neighbour_indices(const size_t& original_index) const;
+
+	// Joins each group of view cells into a single managing view cell in one pass. Indices refer to the current cell indices,
+	// the error of each group replaces the error of the joined cells. Groups with less than two cells are ignored.
+	void join_cell_groups(const std::vector<std::vector<size_t>>& cell_index_groups, const std::vector<float>& group_errors);
+
 protected:
 	void create_grid(const size_t& number_cells_x, const size_t& number_cells_y, const size_t& number_cells_z, const double& cell_size, const scm::math::vec3d& position_center);
 
@@ -100,6 +110,9 @@ protected:
 	// If an original cell is not active, it was joined and is part of a managing vew cell. The key is the original view cell index, the value the index of the proper managing view cell.
 	std::map<size_t, size_t> original_index_to_cell_mapping_;
 
+	// Dense remap from original cell index to the index in cells_by_indices_ (active original or managing cell). Rebuilt by compute_index_access().
+	std::vector<size_t> original_index_to_cell_index_;
+
 	std::vector<node_t> ids_;
 
 	mutable std::mutex mutex_;
@@ -68,6 +68,9 @@ protected:
 	grid_octree_node* find_cell_by_position_recursive(grid_octree_node* node, const scm::math::vec3d& position) const;
 	const grid_octree_node* find_cell_by_position_recursive_const(const grid_octree_node* node, const scm::math::vec3d& position) const;
 
+	void compute_lookup_recursive(grid_octree_node* node, const size_t& lookup_index);
+	bool find_cell_index_by_position(const scm::math::vec3d& position, size_t& cell_index) const;
+
 	// Grid is managed as an octree, ech node manages its 8 children. Each node is accessed (in)directly via the root node.
 	grid_octree_node* root_node_;
 	std::vector<node_t> ids_;
@@ -76,6 +79,19 @@ protected:
 
 	// Used to improve performance of get_cell_at_index().
 	std::vector<view_cell*> cells_by_indices_;
+
+	// Pointer-free copy of the octree used to improve performance of get_cell_at_position().
+	// The 8 children of a node are stored consecutively, leaf nodes store the index of their view cell.
+	struct lookup_node
+	{
+		scm::math::vec3d position_center_;
+		size_t first_child_index_;		// 0 for leaf nodes, the root is never a child.
+		size_t cell_index_;
+	};
+
+	std::vector<lookup_node> lookup_nodes_;
+	scm::math::vec3d lookup_min_vertex_;
+	scm::math::vec3d lookup_max_vertex_;
 };
 
 }
@@ -0,0 +1,53 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_PVS_ID_HISTOGRAM_FLAT_H_
+#define LAMURE_PVS_ID_HISTOGRAM_FLAT_H_
+
+#include <cstdint>
+#include <vector>
+#include <map>
+
+#include <lamure/pvs/pvs.h>
+#include <lamure/types.h>
+
+namespace lamure
+{
+namespace pvs
+{
+
+// Counterpart to id_histogram using one counter per node of all models in a single array.
+// Bins are addressed by bin index (first bin of the model plus node ID), clearing only resets bins which were counted.
+class PVS_COMMON_DLL id_histogram_flat
+{
+public:
+	id_histogram_flat();
+	id_histogram_flat(const std::vector<node_t>& ids);
+	~id_histogram_flat();
+
+	void resize(const std::vector<node_t>& ids);
+	void clear();
+
+	size_t get_bin_index(const model_t& model_id, const node_t& node_id) const { return model_offsets_[model_id] + node_id; }
+	size_t get_num_bins() const { return counters_.size(); }
+
+	// Each value of the buffer is a bin index plus one, zero marks pixels without any node.
+	void create(const uint32_t* bin_buffer, const size_t& num_pixels);
+	void add(const size_t& bin_index, const size_t& count);
+
+	std::map<model_t, std::vector<node_t>> get_visible_nodes(const size_t& num_pixels, const float& visibility_threshold) const;
+
+private:
+	std::vector<size_t> model_offsets_;
+	std::vector<uint32_t> counters_;
+	std::vector<size_t> used_bins_;
+};
+
+}
+}
+
+#endif
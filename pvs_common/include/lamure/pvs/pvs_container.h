@@ -0,0 +1,76 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_PVS_PVS_CONTAINER_H
+#define LAMURE_PVS_PVS_CONTAINER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <lamure/pvs/pvs.h>
+#include <lamure/types.h>
+#include "lamure/pvs/view_cell.h"
+
+namespace lamure
+{
+namespace pvs
+{
+
+// Random access file format for the visibility of the compressed grids.
+//
+//   header         32 bytes
+//   offset table   (num_cells + 1) * uint64, file offset of every cell block, the last entry marks the end of the file
+//   cell blocks    one block per cell, each holding one bitset per model (ceil(num_nodes / 8) bytes, bit i = node i)
+//
+// A single cell is located with one read into the offset table and decoded on its own.
+// Files written by earlier versions start with the gzip block sizes directly and are still read by the grids.
+class PVS_COMMON_DLL pvs_container
+{
+public:
+	enum codec_type : uint32_t
+	{
+		CODEC_NONE = 0,
+		CODEC_LZ4 = 1
+	};
+
+	struct header
+	{
+		char magic_[8];
+		uint32_t version_;
+		uint32_t codec_;
+		uint64_t num_cells_;
+		uint64_t raw_cell_size_;
+	};
+
+	static bool is_pvs_container(const std::string& file_path);
+
+	// Cells are packed and compressed in parallel.
+	static void save_cells(const std::string& file_path, const std::vector<const view_cell*>& cells, const std::vector<node_t>& ids, const codec_type& codec = CODEC_LZ4);
+
+	// Cells are decoded in parallel, the cell order must match the one used for saving.
+	// Both loaders return false if the file does not match the ids and throw std::runtime_error on a corrupt or truncated offset table.
+	static bool load_cells(const std::string& file_path, const std::vector<view_cell*>& cells, const std::vector<node_t>& ids);
+
+	// No state is shared between calls, so different cells can be loaded from multiple threads.
+	static bool load_cell(const std::string& file_path, const size_t& cell_index, view_cell* cell, const std::vector<node_t>& ids);
+
+	static size_t get_raw_cell_size(const std::vector<node_t>& ids);
+	static void pack_cell(const view_cell* cell, const std::vector<node_t>& ids, char* raw_data);
+	static void unpack_cell(const char* raw_data, const std::vector<node_t>& ids, view_cell* cell);
+
+private:
+	static uint64_t get_table_end(const uint64_t& num_cells);
+	static uint64_t get_file_size(std::ifstream& file_in);
+	static bool read_header(std::ifstream& file_in, header& file_header);
+	static bool decode_block(const header& file_header, const std::vector<char>& block, std::vector<char>& raw_data);
+};
+
+}
+}
+
+#endif
@@ -8,15 +8,22 @@
 #ifndef LAMURE_PVS_PVS_DATABASE_H
 #define LAMURE_PVS_PVS_DATABASE_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
 #include <set>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <mutex>
-#include <queue>
 
 #include <lamure/pvs/pvs.h>
 #include "lamure/pvs/grid.h"
+#include "lamure/pvs/visibility_snapshot.h"
 #include <lamure/semaphore.h>
 
 namespace lamure
@@ -27,6 +34,19 @@ namespace pvs
 class PVS_COMMON_DLL pvs_database
 {
 public:
+	struct cell_cache_statistics
+	{
+		// Viewer cells whose visibility was already cached (hit) or had to be loaded after entering (miss).
+		size_t hits_;
+		size_t misses_;
+
+		size_t num_prefetched_cells_;
+		size_t num_evicted_cells_;
+
+		size_t num_cached_cells_;
+		size_t cached_size_in_bytes_;
+	};
+
 	virtual ~pvs_database();
 	static pvs_database* get_instance();
 
@@ -42,9 +62,22 @@ public:
 	virtual void set_viewer_position(const scm::math::vec3d& position);
 	virtual bool get_viewer_visibility(const model_t& model_id, const node_t node_id) const;
 
+	// Returns the visibility of the current viewer cell as read-only snapshot which stays valid while the caller holds it.
+	// A null pointer means everything is visible (PVS deactivated or no visibility data of the viewer cell available yet).
+	std::shared_ptr<const visibility_snapshot> get_viewer_visibility_snapshot() const;
+
 	void activate(const bool& act);
 	bool is_activated() const;
 
+	// Loaded cell visibility is kept in an LRU cache, cells leaving the cache are cleared. The neighbourhood of the viewer cell is never evicted.
+	void set_cell_cache_budget_in_mb(const size_t& budget_in_mb);
+
+	// Number of viewer position updates the movement is extrapolated to prefetch cells ahead of the viewer. 0 disables prefetching.
+	void set_prefetch_lookahead(const size_t& num_updates);
+
+	cell_cache_statistics get_cell_cache_statistics() const;
+	void reset_cell_cache_statistics();
+
 	const grid* get_visibility_grid() const;
 	const grid* get_bounding_grid() const;
 	void clear_visibility_grid();
@@ -55,9 +88,36 @@ protected:
 	static pvs_database* instance_;
 
 private:
+	struct loading_request
+	{
+		uint64_t cell_index_;
+		bool prefetch_;
+	};
+
+	struct cached_cell
+	{
+		std::list<size_t>::iterator lru_position_;
+
+		// Cells are pinned while a loading thread reads them for a snapshot.
+		size_t pin_count_;
+
+		// False while the visibility is read from file.
+		bool loaded_;
+	};
+
 	void loading_thread_loop();
 	void load_visibility_data_async(uint64_t cell_index);
-	std::queue<uint64_t> loading_queue_;
+	void prefetch_cells_ahead(const scm::math::vec3d& position, const size_t& viewer_cell_index);
+	void publish_viewer_snapshot(const view_cell* cell, const grid* cell_grid);
+
+	bool load_cached_cell(const size_t& cell_index, const bool& pin, bool* was_cached);
+	void unpin_cached_cells(const std::set<size_t>& cell_indices);
+	void evict_cached_cells();
+	void clear_cell_cache();
+
+	// Demand requests (viewer cell) are queued at the front, prefetch requests at the back.
+	std::deque<loading_request> loading_queue_;
+	std::unordered_set<uint64_t> queued_prefetch_cell_indices_;
 	semaphore semaphore_;
 
 	// Grid storing the major visibility data of the scene.
@@ -68,7 +128,10 @@ private:
 
 	// The PVS needs the current viewer position to properly answer visibility requests.
 	scm::math::vec3d position_viewer_;
-	const view_cell* viewer_cell_;
+	std::atomic<const view_cell*> viewer_cell_;
+
+	// Visibility of the viewer cell, replaced atomically (std::atomic_store) whenever the viewer cell or its data changes.
+	std::shared_ptr<const visibility_snapshot> viewer_snapshot_;
 
 	// If the PVS is not activated, it will always return true on visibility requests.
 	bool activated_;
@@ -78,15 +141,31 @@ private:
 	bool do_preload_;
 	bool shutdown_;
 	std::string pvs_file_path_;
+	// Only cells of a pvs container can be read concurrently, other files share state inside the grid.
+	bool pvs_file_is_container_;
 
 	scm::math::vec3d smallest_cell_size_;
-	std::set<size_t> previously_loaded_cell_indices_;
 
-	std::thread visibility_data_loading_thread_;
+	// Smoothed movement of the viewer per position update, used to predict the next cells.
+	scm::math::vec3d velocity_viewer_;
+	size_t prefetch_lookahead_;
+
+	// LRU cache of cells with loaded visibility. Front of the list is the most recently used cell.
+	std::unordered_map<size_t, cached_cell> cell_cache_;
+	std::list<size_t> cell_cache_lru_;
+	std::set<size_t> viewer_neighbourhood_cell_indices_;
+	size_t cell_size_in_bytes_;
+	size_t cell_cache_budget_in_bytes_;
+	cell_cache_statistics cell_cache_statistics_;
+	std::condition_variable cell_cache_condition_;
+
+	std::vector<std::thread> visibility_data_loading_threads_;
 
 	// Used to achieve thread safety.
 	mutable std::mutex mutex_;
 	mutable std::mutex loading_mutex_;
+	mutable std::mutex cell_cache_mutex_;
+	mutable std::mutex file_loading_mutex_;
 };
 
 }
@@ -0,0 +1,64 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_PVS_VISIBILITY_SNAPSHOT_H
+#define LAMURE_PVS_VISIBILITY_SNAPSHOT_H
+
+#include <cstdint>
+#include <vector>
+
+#include <lamure/pvs/pvs.h>
+#include <lamure/types.h>
+#include "lamure/pvs/view_cell.h"
+
+namespace lamure
+{
+namespace pvs
+{
+
+// Immutable copy of the visibility of one view cell. The nodes of all models are stored in one contiguous bitset,
+// the first bit of each model is precomputed, so a request is a single shift and mask.
+// Snapshots are never changed after construction and can be read from any thread while the cell itself is reloaded.
+class PVS_COMMON_DLL visibility_snapshot
+{
+public:
+	visibility_snapshot(const view_cell* cell, const std::vector<node_t>& ids);
+	~visibility_snapshot();
+
+	// The cell is only used to identify the snapshot, it is never accessed after construction.
+	const view_cell* get_cell() const { return cell_; }
+
+	model_t get_num_models() const { return (model_t)num_nodes_.size(); }
+	node_t get_num_nodes(const model_t& model_id) const { return num_nodes_[model_id]; }
+	size_t get_num_visible_nodes() const { return num_visible_nodes_; }
+
+	// Nodes unknown to the snapshot are invisible, like in view_cell_regular::get_visibility().
+	inline bool get_visibility(const model_t& model_id, const node_t& node_id) const
+	{
+		if(model_id >= num_nodes_.size() || node_id >= num_nodes_[model_id])
+		{
+			return false;
+		}
+
+		const uint64_t bit_index = model_offsets_[model_id] + node_id;
+		return ((bits_[bit_index >> 6] >> (bit_index & 63)) & 1) != 0;
+	}
+
+private:
+	const view_cell* cell_;
+
+	std::vector<node_t> num_nodes_;
+	std::vector<uint64_t> model_offsets_;
+	std::vector<uint64_t> bits_;
+
+	size_t num_visible_nodes_;
+};
+
+}
+}
+
+#endif
@@ -11,6 +11,8 @@
 #include <stdexcept>
 #include <string>
 #include <climits>
+#include <iterator>
+#include <limits>
 #include <iostream>
 
 namespace lamure
@@ -93,49 +95,18 @@ get_cell_at_position(const scm::math::vec3d& position, size_t* cell_index) const
 view_cell* grid_irregular::
 calculate_cell_at_position(const scm::math::vec3d& position, size_t* cell_index) const
 {
-	size_t general_index = 0;
+	// No lock required, the lookup table only changes if the grid layout changes (load, join).
+	size_t original_index = 0;
+	const view_cell* original_cell = this->get_original_cell_at_position(position, &original_index);
 
+	// This means the position is outside of the grid.
+	if(original_cell == nullptr)
 	{
-		std::lock_guard<std::mutex> lock(mutex_);
-
-		size_t original_index = 0;
-		const view_cell* original_cell = this->get_original_cell_at_position(position, &original_index);
-
-		// This means the position is outside of the grid.
-		if(original_cell == nullptr)
-		{
-			return nullptr;
-		}
-
-		if(cells_active_states_[original_index])
-		{
-			// Cell is not joined, so the cell must be among the indices for fast access.
-			for(size_t indexed_cell_index = 0; indexed_cell_index < cells_by_indices_.size(); ++indexed_cell_index)
-			{
-				if(original_cell == cells_by_indices_[indexed_cell_index])
-				{
-					general_index = indexed_cell_index;
-					break;
-				}
-			}
-		}
-		else
-		{
-			// Cell is joined, so it must be among the managing view cells.
-			size_t managed_index = original_index_to_cell_mapping_.at(original_index);
-			const view_cell* managed_cell = &managing_cells_[managed_index];
-
-			for(size_t indexed_cell_index = 0; indexed_cell_index < cells_by_indices_.size(); ++indexed_cell_index)
-			{
-				if(managed_cell == cells_by_indices_[indexed_cell_index])
-				{
-					general_index = indexed_cell_index;
-					break;
-				}
-			}
-		}
+		return nullptr;
 	}
 
+	size_t general_index = original_index_to_cell_index_[original_index];
+
 	// Optional second return value: the index of the view cell.
 	if(cell_index != nullptr)
 	{
@@ -519,10 +490,7 @@ create_grid(const size_t& number_cells_x, const size_t& number_cells_y, const si
 		}
 	}
 
-	for(size_t original_cell_index = 0; original_cell_index < original_cells_.size(); ++original_cell_index)
-	{
-		cells_by_indices_.push_back(&original_cells_[original_cell_index]);
-	}
+	compute_index_access();
 
 	number_cells_x_ = number_cells_x;
 	number_cells_y_ = number_cells_y;
@@ -549,19 +517,32 @@ void grid_irregular::
 compute_index_access()
 {
 	cells_by_indices_.clear();
+	original_index_to_cell_index_.resize(original_cells_.size());
 
 	for(size_t original_cell_index = 0; original_cell_index < original_cells_.size(); ++original_cell_index)
 	{
 		if(cells_active_states_[original_cell_index])
 		{
+			original_index_to_cell_index_[original_cell_index] = cells_by_indices_.size();
 			cells_by_indices_.push_back(&original_cells_[original_cell_index]);
 		}
 	}
 
+	size_t first_managing_index = cells_by_indices_.size();
+
 	for(size_t managing_cell_index = 0; managing_cell_index < managing_cells_.size(); ++managing_cell_index)
 	{
 		cells_by_indices_.push_back(&managing_cells_[managing_cell_index]);
 	}
+
+	// Joined original cells resolve to the index of their managing cell.
+	for(std::map<size_t, size_t>::const_iterator iter = original_index_to_cell_mapping_.begin(); iter != original_index_to_cell_mapping_.end(); ++iter)
+	{
+		if(!cells_active_states_[iter->first])
+		{
+			original_index_to_cell_index_[iter->first] = first_managing_index + iter->second;
+		}
+	}
 }
 
 size_t grid_irregular::
@@ -787,6 +768,12 @@ get_original_cell_at_position(const scm::math::vec3d& position, size_t* cell_ind
 
 	scm::math::vec3d distance = position - (position_center_ - half_size);
 
+	// Negative distances can't be converted to an unsigned index.
+	if(distance.x < 0.0 || distance.y < 0.0 || distance.z < 0.0)
+	{
+		return nullptr;
+	}
+
 	size_t index_x = (size_t)(distance.x / cell_size_);
 	size_t index_y = (size_t)(distance.y / cell_size_);
 	size_t index_z = (size_t)(distance.z / cell_size_);
@@ -816,6 +803,159 @@ is_cell_at_index_original(const size_t& index) const
 	return cells_by_indices_[index]->get_cell_type() == view_cell_regular::get_cell_identifier();
 }
 
+size_t grid_irregular::
+get_cell_index_of_original_cell(const size_t& original_index) const
+{
+	return original_index_to_cell_index_[original_index];
+}
+
+std::vector<size_t> grid_irregular::
+get_original_neighbour_indices(const size_t& original_index) const
+{
+	std::vector<size_t> neighbour_indices;
+
+	size_t index_x = original_index % number_cells_x_;
+	size_t index_y = (original_index / number_cells_x_) % number_cells_y_;
+	size_t index_z = original_index / (number_cells_x_ * number_cells_y_);
+
+	size_t layer_size = number_cells_x_ * number_cells_y_;
+
+	if(index_x > 0)
+	{
+		neighbour_indices.push_back(original_index - 1);
+	}
+	if(index_x + 1 < number_cells_x_)
+	{
+		neighbour_indices.push_back(original_index + 1);
+	}
+	if(index_y > 0)
+	{
+		neighbour_indices.push_back(original_index - number_cells_x_);
+	}
+	if(index_y + 1 < number_cells_y_)
+	{
+		neighbour_indices.push_back(original_index + number_cells_x_);
+	}
+	if(index_z > 0)
+	{
+		neighbour_indices.push_back(original_index - layer_size);
+	}
+	if(index_z + 1 < number_cells_z_)
+	{
+		neighbour_indices.push_back(original_index + layer_size);
+	}
+
+	return neighbour_indices;
+}
+
+void grid_irregular::
+join_cell_groups(const std::vector<std::vector<size_t>>& cell_index_groups, const std::vector<float>& group_errors)
+{
+	size_t first_managing_index = cells_by_indices_.size() - managing_cells_.size();
+
+	// Assign the current cells to their groups before any index changes.
+	std::vector<size_t> cell_index_to_group(cells_by_indices_.size(), std::numeric_limits<size_t>::max());
+	std::vector<bool> managing_cell_joined(managing_cells_.size(), false);
+
+	for(size_t group_index = 0; group_index < cell_index_groups.size(); ++group_index)
+	{
+		if(cell_index_groups[group_index].size() < 2)
+		{
+			continue;
+		}
+
+		for(size_t cell_index : cell_index_groups[group_index])
+		{
+			cell_index_to_group[cell_index] = group_index;
+
+			if(cell_index >= first_managing_index)
+			{
+				managing_cell_joined[cell_index - first_managing_index] = true;
+			}
+		}
+	}
+
+	// Create one managing cell per group, its visibility is the union of the visibility of the joined cells.
+	std::vector<view_cell_regular_managing> joined_cells;
+	std::vector<size_t> group_to_joined_index(cell_index_groups.size(), std::numeric_limits<size_t>::max());
+
+	for(size_t group_index = 0; group_index < cell_index_groups.size(); ++group_index)
+	{
+		if(cell_index_groups[group_index].size() < 2)
+		{
+			continue;
+		}
+
+		view_cell_regular_managing new_managing_cell;
+
+		for(model_t model_index = 0; model_index < ids_.size(); ++model_index)
+		{
+			boost::dynamic_bitset<> combined_visibility(this->get_num_nodes(model_index));
+
+			for(size_t cell_index : cell_index_groups[group_index])
+			{
+				boost::dynamic_bitset<> cell_visibility = ((view_cell_regular*)cells_by_indices_[cell_index])->get_bitset(model_index);
+				cell_visibility.resize(this->get_num_nodes(model_index));
+				combined_visibility |= cell_visibility;
+			}
+
+			new_managing_cell.set_bitset(model_index, combined_visibility);
+		}
+
+		new_managing_cell.set_error(group_errors[group_index]);
+
+		group_to_joined_index[group_index] = joined_cells.size();
+		joined_cells.push_back(std::move(new_managing_cell));
+	}
+
+	// Managing cells which were not joined are kept, the new ones are appended behind them.
+	std::vector<view_cell_regular_managing> remaining_managing_cells;
+	std::vector<size_t> managing_index_remapping(managing_cells_.size(), std::numeric_limits<size_t>::max());
+
+	for(size_t managing_index = 0; managing_index < managing_cells_.size(); ++managing_index)
+	{
+		if(!managing_cell_joined[managing_index])
+		{
+			managing_index_remapping[managing_index] = remaining_managing_cells.size();
+			remaining_managing_cells.push_back(std::move(managing_cells_[managing_index]));
+		}
+	}
+
+	size_t first_joined_index = remaining_managing_cells.size();
+	remaining_managing_cells.insert(remaining_managing_cells.end(), std::make_move_iterator(joined_cells.begin()), std::make_move_iterator(joined_cells.end()));
+
+	// Rewrite the mapping of all original cells.
+	for(size_t original_index = 0; original_index < original_cells_.size(); ++original_index)
+	{
+		size_t cell_index = original_index_to_cell_index_[original_index];
+		size_t group_index = cell_index_to_group[cell_index];
+
+		if(group_index != std::numeric_limits<size_t>::max())
+		{
+			size_t managing_index = first_joined_index + group_to_joined_index[group_index];
+			remaining_managing_cells[managing_index].add_cell(&original_cells_[original_index]);
+
+			if(cells_active_states_[original_index])
+			{
+				// Original view cells don't need to manage visibility data anymore.
+				original_cells_[original_index].clear_visibility_data();
+				cells_active_states_[original_index] = false;
+			}
+
+			original_index_to_cell_mapping_[original_index] = managing_index;
+		}
+		else if(!cells_active_states_[original_index])
+		{
+			original_index_to_cell_mapping_[original_index] = managing_index_remapping[cell_index - first_managing_index];
+		}
+	}
+
+	managing_cells_.swap(remaining_managing_cells);
+
+	// Keep indices for access up to date.
+	this->compute_index_access();
+}
+
 size_t grid_irregular::
 get_original_index_of_cell(const view_cell* cell) const
 {
@@ -6,6 +6,7 @@
 // http://www.uni-weimar.de/medien/vr
 
 #include "lamure/pvs/grid_irregular_compressed.h"
+#include "lamure/pvs/pvs_container.h"
 
 #include <fstream>
 #include <sstream>
@@ -59,79 +60,9 @@ save_visibility_to_file(const std::string& file_path) const
 {
 	std::lock_guard<std::mutex> lock(mutex_);
 
-	std::fstream file_out;
-	file_out.open(file_path, std::ios::out | std::ios::binary);
-
-	if(!file_out.is_open())
-	{
-		throw std::invalid_argument("invalid file path: " + file_path);
-	}
-
-	std::vector<std::string> compressed_data_blocks;
-
-	// Iterate over view cells.
-	for(size_t cell_index = 0; cell_index < cells_by_indices_.size(); ++cell_index)
-	{
-		std::string current_cell_data = "";
-
-		// Iterate over models in the scene.
-		for(lamure::model_t model_id = 0; model_id < ids_.size(); ++model_id)
-		{
-			node_t num_nodes = ids_.at(model_id);
-			char current_byte = 0x00;
-
-			size_t line_length = num_nodes / CHAR_BIT + (num_nodes % CHAR_BIT == 0 ? 0 : 1);
-			size_t character_counter = 0;
-			std::string current_line_data(line_length, 0x00);
-
-			// Iterate over nodes in the model.
-			for(lamure::node_t node_id = 0; node_id < num_nodes; ++node_id)
-			{
-				if(cells_by_indices_[cell_index]->get_visibility(model_id, node_id))
-				{
-					current_byte |= 1 << (node_id % CHAR_BIT);
-				}
-
-				// Flush character if either 8 bits are written or if the node id is the last one.
-				if((node_id + 1) % CHAR_BIT == 0 || node_id == (num_nodes - 1))
-				{
-					current_line_data[character_counter] = current_byte;
-					character_counter++;
-
-					current_byte = 0x00;
-				}
-			}
-
-			current_cell_data = current_cell_data + current_line_data;
-		}
-
-		// Compression of binary data using boost gzip.
-		std::stringstream stream_uncompressed, stream_compressed;
-		stream_uncompressed << current_cell_data;
-
-		boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
-		in.push(boost::iostreams::gzip_compressor());
-		in.push(stream_uncompressed);
-		boost::iostreams::copy(in, stream_compressed);
-
-		std::string output_string = stream_compressed.str();
-		compressed_data_blocks.push_back(output_string);
-	}
-
-	// Save sizes of compressed data blocks.
-	for(size_t current_block_index = 0; current_block_index < compressed_data_blocks.size(); ++current_block_index)
-	{
-		uint64_t current_block_size = compressed_data_blocks[current_block_index].size();
-		file_out.write(reinterpret_cast<char*>(&current_block_size), sizeof(current_block_size));
-	}
-
-	// Save compressed data blocks.
-	for(size_t current_block_index = 0; current_block_index < compressed_data_blocks.size(); ++current_block_index)
-	{
-		file_out.write(compressed_data_blocks[current_block_index].c_str(), compressed_data_blocks[current_block_index].length());
-	}
-
-	file_out.close();
+	// Visibility is written to the random access container, files of the previous gzip layout are still loaded.
+	std::vector<const view_cell*> cells(cells_by_indices_.begin(), cells_by_indices_.end());
+	pvs_container::save_cells(file_path, cells, ids_);
 }
 
 bool grid_irregular_compressed::
@@ -145,6 +76,12 @@ load_visibility_from_file(const std::string& file_path)
 {
 	std::lock_guard<std::mutex> lock(mutex_);
 
+	if(pvs_container::is_pvs_container(file_path))
+	{
+		std::vector<view_cell*> cells(cells_by_indices_.begin(), cells_by_indices_.end());
+		return pvs_container::load_cells(file_path, cells, ids_);
+	}
+
 	std::fstream file_in;
 	file_in.open(file_path, std::ios::in | std::ios::binary);
 
@@ -222,6 +159,19 @@ load_visibility_from_file(const std::string& file_path)
 bool grid_irregular_compressed::
 load_cell_visibility_from_file(const std::string& file_path, const size_t& cell_index)
 {
+	// Cells of the container are independent of each other, so they are loaded without holding the grid lock.
+	if(pvs_container::is_pvs_container(file_path))
+	{
+		view_cell* container_cell = cells_by_indices_[cell_index];
+
+		if(container_cell->contains_visibility_data())
+		{
+			return true;
+		}
+
+		return pvs_container::load_cell(file_path, cell_index, container_cell, ids_);
+	}
+
 	//std::lock_guard<std::mutex> lock(mutex_);
 
 	view_cell* current_cell = cells_by_indices_[cell_index];
@@ -81,18 +81,86 @@ create_grid(grid_octree_node* node, size_t depth)
 void grid_octree::
 compute_index_access()
 {
-	size_t num_cells = cell_count_recursive(root_node_);
-	
 	cells_by_indices_.clear();
-	cells_by_indices_.resize(num_cells);
+	lookup_nodes_.clear();
 
-	for(size_t cell_index = 0; cell_index < num_cells; ++cell_index)
+	if(root_node_ == nullptr)
+	{
+		return;
+	}
+
+	lookup_min_vertex_ = root_node_->get_position_center() - root_node_->get_size() * 0.5;
+	lookup_max_vertex_ = root_node_->get_position_center() + root_node_->get_size() * 0.5;
+
+	lookup_node root_lookup_node;
+	root_lookup_node.position_center_ = root_node_->get_position_center();
+	root_lookup_node.first_child_index_ = 0;
+	root_lookup_node.cell_index_ = 0;
+	lookup_nodes_.push_back(root_lookup_node);
+
+	// Depth first traversal visits the leaves in the same order as find_cell_by_index_recursive().
+	compute_lookup_recursive(root_node_, 0);
+}
+
+void grid_octree::
+compute_lookup_recursive(grid_octree_node* node, const size_t& lookup_index)
+{
+	if(!node->has_children())
+	{
+		lookup_nodes_[lookup_index].cell_index_ = cells_by_indices_.size();
+		cells_by_indices_.push_back(node);
+		return;
+	}
+
+	size_t first_child_index = lookup_nodes_.size();
+	lookup_nodes_[lookup_index].first_child_index_ = first_child_index;
+	lookup_nodes_.resize(first_child_index + 8);
+
+	for(size_t child_index = 0; child_index < 8; ++child_index)
+	{
+		lookup_node& child_lookup_node = lookup_nodes_[first_child_index + child_index];
+		child_lookup_node.position_center_ = node->get_child_at_index(child_index)->get_position_center();
+		child_lookup_node.first_child_index_ = 0;
+		child_lookup_node.cell_index_ = 0;
+	}
+
+	for(size_t child_index = 0; child_index < 8; ++child_index)
 	{
-		view_cell* cell_at_index = find_cell_by_index_recursive(root_node_, cell_index, 0);
-		cells_by_indices_[cell_index] = cell_at_index;
+		compute_lookup_recursive(node->get_child_at_index(child_index), first_child_index + child_index);
 	}
 }
 
+bool grid_octree::
+find_cell_index_by_position(const scm::math::vec3d& position, size_t& cell_index) const
+{
+	if(lookup_nodes_.empty() ||
+		position.x < lookup_min_vertex_.x || position.x > lookup_max_vertex_.x ||
+		position.y < lookup_min_vertex_.y || position.y > lookup_max_vertex_.y ||
+		position.z < lookup_min_vertex_.z || position.z > lookup_max_vertex_.z)
+	{
+		return false;
+	}
+
+	size_t lookup_index = 0;
+
+	while(lookup_nodes_[lookup_index].first_child_index_ != 0)
+	{
+		const lookup_node& current_node = lookup_nodes_[lookup_index];
+
+		// Child order as created by grid_octree_node::split(). On a shared border the child with the lower index wins,
+		// as in find_cell_by_position_recursive().
+		size_t child_index = 0;
+		child_index |= (position.x > current_node.position_center_.x) ? 1 : 0;
+		child_index |= (position.z < current_node.position_center_.z) ? 2 : 0;
+		child_index |= (position.y < current_node.position_center_.y) ? 4 : 0;
+
+		lookup_index = current_node.first_child_index_ + child_index;
+	}
+
+	cell_index = lookup_nodes_[lookup_index].cell_index_;
+	return true;
+}
+
 size_t grid_octree::
 get_cell_count() const
 {
@@ -189,33 +257,21 @@ find_cell_by_index_recursive_const(const grid_octree_node* node, const size_t& i
 const view_cell* grid_octree::
 get_cell_at_position(const scm::math::vec3d& position, size_t* cell_index) const
 {
-	std::lock_guard<std::mutex> lock(mutex_);
+	// No lock required, the lookup nodes only change if the grid layout changes (load, optimization).
+	size_t found_cell_index = 0;
 
-	vec3r min_vertex(root_node_->get_position_center() - root_node_->get_size() * 0.5);
-    vec3r max_vertex(root_node_->get_position_center() + root_node_->get_size() * 0.5);
-    bounding_box root_node_bb(min_vertex, max_vertex);
-
-    const view_cell* result_view_cell = nullptr;
+	if(!find_cell_index_by_position(position, found_cell_index))
+	{
+		return nullptr;
+	}
 
-    if(root_node_bb.contains(position))
-    {
-    	result_view_cell = this->find_cell_by_position_recursive_const(root_node_, position);
-
-    	// Look for the index of the view cell if required by caller.
-    	if(cell_index != nullptr)
-	    {
-	    	for(size_t tracked_cell_index = 0; tracked_cell_index < cells_by_indices_.size(); ++tracked_cell_index)
-	    	{
-	    		if(result_view_cell == cells_by_indices_[tracked_cell_index])
-	    		{
-	    			(*cell_index) = tracked_cell_index;
-	    			break;
-	    		}
-	    	}
-	    }
-    }
+	// Optional second return value: the index of the view cell.
+	if(cell_index != nullptr)
+	{
+		(*cell_index) = found_cell_index;
+	}
 
-	return result_view_cell;
+	return cells_by_indices_[found_cell_index];
 }
 
 grid_octree_node* grid_octree::
@@ -267,21 +323,12 @@ set_cell_visibility(const scm::math::vec3d& position, const model_t& model_id, c
 {
 	std::lock_guard<std::mutex> lock(mutex_);
 
-	vec3r min_vertex(root_node_->get_position_center() - root_node_->get_size() * 0.5);
-    vec3r max_vertex(root_node_->get_position_center() + root_node_->get_size() * 0.5);
-    bounding_box root_node_bb(min_vertex, max_vertex);
-
-    view_cell* result_view_cell = nullptr;
+	size_t found_cell_index = 0;
 
-    if(root_node_bb.contains(position))
-    {
-    	result_view_cell = find_cell_by_position_recursive(root_node_, position);
-    }
-
-    if(result_view_cell != nullptr)
-    {
-    	result_view_cell->set_visibility(model_id, node_id, visibility);
-    }
+	if(find_cell_index_by_position(position, found_cell_index))
+	{
+		cells_by_indices_[found_cell_index]->set_visibility(model_id, node_id, visibility);
+	}
 }
 
 
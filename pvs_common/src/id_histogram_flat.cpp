@@ -0,0 +1,109 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include "lamure/pvs/id_histogram_flat.h"
+
+#include <algorithm>
+
+namespace lamure
+{
+namespace pvs
+{
+
+id_histogram_flat::
+id_histogram_flat()
+{
+}
+
+id_histogram_flat::
+id_histogram_flat(const std::vector<node_t>& ids)
+{
+	resize(ids);
+}
+
+id_histogram_flat::
+~id_histogram_flat()
+{
+}
+
+void id_histogram_flat::
+resize(const std::vector<node_t>& ids)
+{
+	model_offsets_.clear();
+	size_t num_bins = 0;
+
+	for(node_t num_nodes : ids)
+	{
+		model_offsets_.push_back(num_bins);
+		num_bins += num_nodes;
+	}
+
+	counters_.assign(num_bins, 0);
+	used_bins_.clear();
+}
+
+void id_histogram_flat::
+clear()
+{
+	for(size_t bin_index : used_bins_)
+	{
+		counters_[bin_index] = 0;
+	}
+
+	used_bins_.clear();
+}
+
+void id_histogram_flat::
+create(const uint32_t* bin_buffer, const size_t& num_pixels)
+{
+	clear();
+
+	for(size_t pixel_index = 0; pixel_index < num_pixels; ++pixel_index)
+	{
+		uint32_t pixel_value = bin_buffer[pixel_index];
+
+		if(pixel_value != 0)
+		{
+			add(pixel_value - 1, 1);
+		}
+	}
+}
+
+void id_histogram_flat::
+add(const size_t& bin_index, const size_t& count)
+{
+	if(counters_[bin_index] == 0)
+	{
+		used_bins_.push_back(bin_index);
+	}
+
+	counters_[bin_index] += count;
+}
+
+std::map<model_t, std::vector<node_t>> id_histogram_flat::
+get_visible_nodes(const size_t& num_pixels, const float& visibility_threshold) const
+{
+	std::map<model_t, std::vector<node_t>> visible_nodes;
+
+	// Sorted bins keep node IDs of each model in ascending order, like the map based histogram.
+	std::vector<size_t> sorted_bins(used_bins_);
+	std::sort(sorted_bins.begin(), sorted_bins.end());
+
+	for(size_t bin_index : sorted_bins)
+	{
+		if(((float)counters_[bin_index] / (float)num_pixels) * 100.0f >= visibility_threshold)
+		{
+			model_t model_id = (model_t)(std::upper_bound(model_offsets_.begin(), model_offsets_.end(), bin_index) - model_offsets_.begin()) - 1;
+			visible_nodes[model_id].push_back((node_t)(bin_index - model_offsets_[model_id]));
+		}
+	}
+
+	return visible_nodes;
+}
+
+}
+}
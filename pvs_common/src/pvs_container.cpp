@@ -0,0 +1,385 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include "lamure/pvs/pvs_container.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#include <lamure/bvh_v3.h>
+
+namespace lamure
+{
+namespace pvs
+{
+
+namespace
+{
+
+const char container_magic[8] = {'L', 'A', 'M', 'U', 'R', 'E', 'P', 'V'};
+const uint32_t container_version = 1;
+
+static_assert(sizeof(pvs_container::header) == 32, "pvs_container::header must be 32 bytes");
+
+// Runs the jobs on all hardware threads, each thread pulls the next job index.
+void parallel_for(const size_t& num_jobs, const std::function<void(const size_t)>& job)
+{
+	size_t num_threads = std::max((size_t)1, std::min((size_t)std::thread::hardware_concurrency(), num_jobs));
+	std::atomic<size_t> next_job(0);
+
+	auto worker = [&]()
+	{
+		for(size_t job_index = next_job++; job_index < num_jobs; job_index = next_job++)
+		{
+			job(job_index);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for(size_t thread_index = 1; thread_index < num_threads; ++thread_index)
+	{
+		threads.push_back(std::thread(worker));
+	}
+
+	worker();
+
+	for(std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+}
+
+bool pvs_container::
+is_pvs_container(const std::string& file_path)
+{
+	std::ifstream file_in(file_path, std::ios::in | std::ios::binary);
+
+	if(!file_in.is_open())
+	{
+		return false;
+	}
+
+	char file_magic[8];
+	file_in.read(file_magic, sizeof(file_magic));
+
+	return file_in.good() && memcmp(file_magic, container_magic, sizeof(container_magic)) == 0;
+}
+
+size_t pvs_container::
+get_raw_cell_size(const std::vector<node_t>& ids)
+{
+	size_t raw_cell_size = 0;
+
+	for(model_t model_index = 0; model_index < ids.size(); ++model_index)
+	{
+		raw_cell_size += ids[model_index] / CHAR_BIT + (ids[model_index] % CHAR_BIT == 0 ? 0 : 1);
+	}
+
+	return raw_cell_size;
+}
+
+void pvs_container::
+pack_cell(const view_cell* cell, const std::vector<node_t>& ids, char* raw_data)
+{
+	memset(raw_data, 0, get_raw_cell_size(ids));
+
+	for(model_t model_index = 0; model_index < ids.size(); ++model_index)
+	{
+		node_t num_nodes = ids[model_index];
+
+		for(node_t node_id = 0; node_id < num_nodes; ++node_id)
+		{
+			if(cell->get_visibility(model_index, node_id))
+			{
+				raw_data[node_id / CHAR_BIT] |= (char)(1 << (node_id % CHAR_BIT));
+			}
+		}
+
+		raw_data += num_nodes / CHAR_BIT + (num_nodes % CHAR_BIT == 0 ? 0 : 1);
+	}
+}
+
+void pvs_container::
+unpack_cell(const char* raw_data, const std::vector<node_t>& ids, view_cell* cell)
+{
+	// Cells without data only need the visible nodes to be set.
+	bool set_invisible_nodes = cell->contains_visibility_data();
+
+	for(model_t model_index = 0; model_index < ids.size(); ++model_index)
+	{
+		node_t num_nodes = ids[model_index];
+
+		if(num_nodes == 0)
+		{
+			continue;
+		}
+
+		// Used to avoid continuing resize within visibility data.
+		cell->set_visibility(model_index, num_nodes - 1, false);
+
+		for(node_t node_id = 0; node_id < num_nodes; ++node_id)
+		{
+			char current_byte = raw_data[node_id / CHAR_BIT];
+
+			if(current_byte == 0x00 && !set_invisible_nodes)
+			{
+				// Skip the remaining nodes of the empty byte.
+				node_id += CHAR_BIT - 1 - (node_id % CHAR_BIT);
+				continue;
+			}
+
+			bool visible = ((current_byte >> (node_id % CHAR_BIT)) & 1) == 0x01;
+
+			if(visible || set_invisible_nodes)
+			{
+				cell->set_visibility(model_index, node_id, visible);
+			}
+		}
+
+		raw_data += num_nodes / CHAR_BIT + (num_nodes % CHAR_BIT == 0 ? 0 : 1);
+	}
+}
+
+void pvs_container::
+save_cells(const std::string& file_path, const std::vector<const view_cell*>& cells, const std::vector<node_t>& ids, const codec_type& codec)
+{
+	std::fstream file_out;
+	file_out.open(file_path, std::ios::out | std::ios::binary);
+
+	if(!file_out.is_open())
+	{
+		throw std::invalid_argument("invalid file path: " + file_path);
+	}
+
+	size_t raw_cell_size = get_raw_cell_size(ids);
+	std::vector<std::vector<char>> blocks(cells.size());
+
+	parallel_for(cells.size(), [&](const size_t cell_index)
+	{
+		std::vector<char> raw_data(raw_cell_size);
+		if(raw_cell_size > 0)
+		{
+			pack_cell(cells[cell_index], ids, &raw_data[0]);
+		}
+
+		if(codec == CODEC_LZ4)
+		{
+			lamure::bvh_v3::lz4_compress(raw_data.empty() ? nullptr : &raw_data[0], raw_data.size(), blocks[cell_index]);
+		}
+		else
+		{
+			blocks[cell_index].swap(raw_data);
+		}
+	});
+
+	header file_header;
+	memcpy(file_header.magic_, container_magic, sizeof(container_magic));
+	file_header.version_ = container_version;
+	file_header.codec_ = codec;
+	file_header.num_cells_ = cells.size();
+	file_header.raw_cell_size_ = raw_cell_size;
+
+	file_out.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+
+	// Offset table.
+	uint64_t offset = get_table_end(cells.size());
+	for(size_t cell_index = 0; cell_index <= cells.size(); ++cell_index)
+	{
+		file_out.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+
+		if(cell_index < cells.size())
+		{
+			offset += blocks[cell_index].size();
+		}
+	}
+
+	// Cell blocks.
+	for(size_t cell_index = 0; cell_index < cells.size(); ++cell_index)
+	{
+		if(!blocks[cell_index].empty())
+		{
+			file_out.write(&blocks[cell_index][0], blocks[cell_index].size());
+		}
+	}
+
+	file_out.close();
+}
+
+bool pvs_container::
+read_header(std::ifstream& file_in, header& file_header)
+{
+	file_in.read(reinterpret_cast<char*>(&file_header), sizeof(file_header));
+
+	return file_in.good() &&
+		memcmp(file_header.magic_, container_magic, sizeof(container_magic)) == 0 &&
+		file_header.version_ == container_version &&
+		(file_header.codec_ == CODEC_NONE || file_header.codec_ == CODEC_LZ4);
+}
+
+uint64_t pvs_container::
+get_table_end(const uint64_t& num_cells)
+{
+	return sizeof(header) + (num_cells + 1) * sizeof(uint64_t);
+}
+
+uint64_t pvs_container::
+get_file_size(std::ifstream& file_in)
+{
+	std::streampos position = file_in.tellg();
+	file_in.seekg(0, std::ios::end);
+	uint64_t file_size = file_in.tellg();
+	file_in.seekg(position);
+	return file_size;
+}
+
+bool pvs_container::
+decode_block(const header& file_header, const std::vector<char>& block, std::vector<char>& raw_data)
+{
+	raw_data.resize(file_header.raw_cell_size_);
+
+	if(file_header.codec_ == CODEC_NONE)
+	{
+		if(block.size() != raw_data.size())
+		{
+			return false;
+		}
+
+		std::copy(block.begin(), block.end(), raw_data.begin());
+		return true;
+	}
+
+	return lamure::bvh_v3::lz4_decompress(block.empty() ? nullptr : &block[0], block.size(), raw_data.empty() ? nullptr : &raw_data[0], raw_data.size());
+}
+
+bool pvs_container::
+load_cells(const std::string& file_path, const std::vector<view_cell*>& cells, const std::vector<node_t>& ids)
+{
+	std::ifstream file_in(file_path, std::ios::in | std::ios::binary);
+
+	header file_header;
+	if(!file_in.is_open() || !read_header(file_in, file_header) ||
+		file_header.num_cells_ != cells.size() || file_header.raw_cell_size_ != get_raw_cell_size(ids))
+	{
+		return false;
+	}
+
+	// The table has to fit into the file, which also keeps get_table_end from overflowing.
+	uint64_t file_size = get_file_size(file_in);
+	if(file_header.num_cells_ >= (file_size - sizeof(header)) / sizeof(uint64_t))
+	{
+		throw std::runtime_error("lamure: pvs_container::Truncated offset table in " + file_path);
+	}
+
+	std::vector<uint64_t> offsets(cells.size() + 1);
+	file_in.read(reinterpret_cast<char*>(&offsets[0]), offsets.size() * sizeof(uint64_t));
+
+	if(!file_in.good())
+	{
+		throw std::runtime_error("lamure: pvs_container::Truncated offset table in " + file_path);
+	}
+
+	// Blocks follow the offset table back to back.
+	if(offsets.front() != get_table_end(file_header.num_cells_) || offsets.back() > file_size ||
+		!std::is_sorted(offsets.begin(), offsets.end()))
+	{
+		throw std::runtime_error("lamure: pvs_container::Invalid offset table in " + file_path);
+	}
+
+	// Read all blocks at once, decoding is done in parallel.
+	uint64_t data_size = offsets.back() - offsets.front();
+	std::vector<char> data(data_size);
+	file_in.seekg(offsets.front());
+	if(data_size > 0)
+	{
+		file_in.read(&data[0], data_size);
+	}
+
+	if(!file_in.good())
+	{
+		return false;
+	}
+
+	std::atomic<bool> success(true);
+
+	parallel_for(cells.size(), [&](const size_t cell_index)
+	{
+		std::vector<char> block(data.begin() + (offsets[cell_index] - offsets.front()), data.begin() + (offsets[cell_index + 1] - offsets.front()));
+		std::vector<char> raw_data;
+
+		if(!decode_block(file_header, block, raw_data))
+		{
+			success = false;
+			return;
+		}
+
+		unpack_cell(raw_data.empty() ? nullptr : &raw_data[0], ids, cells[cell_index]);
+	});
+
+	return success;
+}
+
+bool pvs_container::
+load_cell(const std::string& file_path, const size_t& cell_index, view_cell* cell, const std::vector<node_t>& ids)
+{
+	std::ifstream file_in(file_path, std::ios::in | std::ios::binary);
+
+	header file_header;
+	if(!file_in.is_open() || !read_header(file_in, file_header) ||
+		cell_index >= file_header.num_cells_ || file_header.raw_cell_size_ != get_raw_cell_size(ids))
+	{
+		return false;
+	}
+
+	// The table has to fit into the file, which also keeps get_table_end from overflowing.
+	uint64_t file_size = get_file_size(file_in);
+	if(file_header.num_cells_ >= (file_size - sizeof(header)) / sizeof(uint64_t))
+	{
+		throw std::runtime_error("lamure: pvs_container::Truncated offset table in " + file_path);
+	}
+
+	// Start and end of the block are two consecutive entries of the offset table.
+	uint64_t offsets[2];
+	file_in.seekg(sizeof(header) + cell_index * sizeof(uint64_t));
+	file_in.read(reinterpret_cast<char*>(offsets), sizeof(offsets));
+
+	if(!file_in.good())
+	{
+		throw std::runtime_error("lamure: pvs_container::Truncated offset table in " + file_path);
+	}
+
+	if(offsets[0] < get_table_end(file_header.num_cells_) || offsets[1] < offsets[0] || offsets[1] > file_size)
+	{
+		throw std::runtime_error("lamure: pvs_container::Invalid offset table in " + file_path);
+	}
+
+	std::vector<char> block(offsets[1] - offsets[0]);
+	file_in.seekg(offsets[0]);
+	if(!block.empty())
+	{
+		file_in.read(&block[0], block.size());
+	}
+
+	std::vector<char> raw_data;
+	if(!file_in.good() || !decode_block(file_header, block, raw_data))
+	{
+		return false;
+	}
+
+	unpack_cell(raw_data.empty() ? nullptr : &raw_data[0], ids, cell);
+	return true;
+}
+
+}
+}
@@ -5,7 +5,10 @@
 // Faculty of Media, Bauhaus-Universitaet Weimar
 // http://www.uni-weimar.de/medien/vr
 
+#include <algorithm>
+#include <climits>
 #include <fstream>
+#include <stdexcept>
 #include <string>
 
 #include "lamure/pvs/pvs_database.h"
@@ -19,6 +22,7 @@
 #include "lamure/pvs/grid_irregular.h"
 #include "lamure/pvs/grid_irregular_compressed.h"
 #include "lamure/pvs/grid_bounding.h"
+#include "lamure/pvs/pvs_container.h"
 
 #include <iostream>
 
@@ -38,12 +42,28 @@ pvs_database()
 	activated_ = true;
 	do_preload_ = false;
 	shutdown_ = false;
+	pvs_file_is_container_ = false;
+
+	position_viewer_ = scm::math::vec3d(0.0, 0.0, 0.0);
+	velocity_viewer_ = scm::math::vec3d(0.0, 0.0, 0.0);
+	prefetch_lookahead_ = 30;
+
+	cell_size_in_bytes_ = 0;
+	cell_cache_budget_in_bytes_ = (size_t)256 * 1024 * 1024;
+	reset_cell_cache_statistics();
+	cell_cache_statistics_.num_cached_cells_ = 0;
+	cell_cache_statistics_.cached_size_in_bytes_ = 0;
 	
 	//configure semaphore
   semaphore_.set_min_signal_count(1);
   semaphore_.set_max_signal_count(std::numeric_limits<size_t>::max());
 	
-	visibility_data_loading_thread_ = std::thread(&pvs_database::loading_thread_loop, this);
+	// Demand requests of the viewer cell are not blocked by prefetch requests running on the other thread.
+	const size_t num_loading_threads = 2;
+	for(size_t thread_index = 0; thread_index < num_loading_threads; ++thread_index)
+	{
+		visibility_data_loading_threads_.push_back(std::thread(&pvs_database::loading_thread_loop, this));
+	}
 	
 }
 
@@ -53,9 +73,12 @@ pvs_database::
   shutdown_ = true;
   semaphore_.shutdown();
 
-	if(visibility_data_loading_thread_.joinable())
+	for(std::thread& loading_thread : visibility_data_loading_threads_)
 	{
-		visibility_data_loading_thread_.join();
+		if(loading_thread.joinable())
+		{
+			loading_thread.join();
+		}
 	}
 	
 	if(visibility_grid_ != nullptr)
@@ -130,6 +153,16 @@ load_pvs_from_file(const std::string& grid_file_path, const std::string& pvs_fil
 	}
 
 	pvs_file_path_ = pvs_file_path;
+	pvs_file_is_container_ = pvs_container::is_pvs_container(pvs_file_path);
+
+	// Cells store one bitset per model.
+	clear_cell_cache();
+	cell_size_in_bytes_ = 0;
+
+	for(model_t model_index = 0; model_index < visibility_grid_->get_num_models(); ++model_index)
+	{
+		cell_size_in_bytes_ += (visibility_grid_->get_num_nodes(model_index) + CHAR_BIT - 1) / CHAR_BIT;
+	}
 
 	// Try to load bounding data.
 	std::string bounding_pvs_file_path = pvs_file_path_;
@@ -310,18 +343,34 @@ loading_thread_loop() {
       break;
     }
     
-    int64_t cell_index = -1;
+    loading_request request;
+    bool has_request = false;
     if (loading_queue_.size() > 0) {
       loading_mutex_.lock();
       if (loading_queue_.size() > 0) {
-        cell_index = loading_queue_.front();
-        loading_queue_.pop();
+        request = loading_queue_.front();
+        loading_queue_.pop_front();
+        has_request = true;
+
+        if (request.prefetch_) {
+          queued_prefetch_cell_indices_.erase(request.cell_index_);
+        }
       }
       loading_mutex_.unlock();
     }
     
-    if (cell_index >= 0) {
-      load_visibility_data_async(cell_index);
+    if (has_request) {
+      if (request.prefetch_) {
+        bool was_cached = false;
+        if (load_cached_cell(request.cell_index_, false, &was_cached) && !was_cached) {
+          std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+          ++cell_cache_statistics_.num_prefetched_cells_;
+          evict_cached_cells();
+        }
+      }
+      else {
+        load_visibility_data_async(request.cell_index_);
+      }
     }
   }
 
@@ -336,6 +385,12 @@ set_viewer_position(const scm::math::vec3d& position)
 	{
 		if(position != position_viewer_)
 		{
+			// The first position is not a movement.
+			if(viewer_cell_ != nullptr)
+			{
+				velocity_viewer_ = velocity_viewer_ * 0.5 + (position - position_viewer_) * 0.5;
+			}
+
 			position_viewer_ = position;
 			size_t cell_index = 0;
 			const view_cell* view_cell_at_position = visibility_grid_->get_cell_at_position(position, &cell_index);
@@ -349,16 +404,30 @@ set_viewer_position(const scm::math::vec3d& position)
 					viewer_cell_ = view_cell_at_position;
 
 					// If the view cell changed and the visibility data is not preloaded, it should be loaded now.
+					// The loading threads publish the snapshot once the data is available.
 					if(!do_preload_)
 					{
+						std::atomic_store(&viewer_snapshot_, std::shared_ptr<const visibility_snapshot>());
 					
             loading_mutex_.lock();
-            loading_queue_.push(cell_index);
+            loading_request request;
+            request.cell_index_ = cell_index;
+            request.prefetch_ = false;
+            loading_queue_.push_front(request);
             //std::cout << "add cell " << cell_index << std::endl;
 						loading_mutex_.unlock();
 						semaphore_.signal(1);
 						
 					}
+					else
+					{
+						publish_viewer_snapshot(view_cell_at_position, visibility_grid_);
+					}
+				}
+
+				if(!do_preload_)
+				{
+					prefetch_cells_ahead(position, cell_index);
 				}
 			}
 			else
@@ -371,6 +440,9 @@ set_viewer_position(const scm::math::vec3d& position)
 					if(view_cell_at_position != viewer_cell_)
 					{
 						viewer_cell_ = view_cell_at_position;
+
+						// Bounding visibility is completely loaded and never changed by the loading threads.
+						publish_viewer_snapshot(view_cell_at_position, bounding_grid_);
 					}
 				}
 			}
@@ -378,6 +450,65 @@ set_viewer_position(const scm::math::vec3d& position)
 	}
 }
 
+void pvs_database::
+prefetch_cells_ahead(const scm::math::vec3d& position, const size_t& viewer_cell_index)
+{
+	if(prefetch_lookahead_ == 0)
+	{
+		return;
+	}
+
+	// Sample the extrapolated path in steps of half the smallest cell size, so no cell along the path is skipped.
+	double step_size = 0.5 * std::min(smallest_cell_size_.x, std::min(smallest_cell_size_.y, smallest_cell_size_.z));
+	double distance = scm::math::length(velocity_viewer_) * (double)prefetch_lookahead_;
+
+	if(step_size <= 0.0 || distance < step_size)
+	{
+		return;
+	}
+
+	const size_t max_num_steps = 64;
+	size_t num_steps = std::min(max_num_steps, (size_t)(distance / step_size));
+	scm::math::vec3d step = velocity_viewer_ * (distance / (double)num_steps / scm::math::length(velocity_viewer_));
+
+	size_t num_requests = 0;
+	size_t last_cell_index = viewer_cell_index;
+
+	{
+		std::lock_guard<std::mutex> lock(loading_mutex_);
+
+		for(size_t step_index = 1; step_index <= num_steps; ++step_index)
+		{
+			size_t cell_index = 0;
+			scm::math::vec3d predicted_position = position + step * (double)step_index;
+
+			if(visibility_grid_->get_cell_at_position(predicted_position, &cell_index) == nullptr)
+			{
+				break;
+			}
+
+			if(cell_index == last_cell_index || queued_prefetch_cell_indices_.count(cell_index) > 0)
+			{
+				continue;
+			}
+
+			last_cell_index = cell_index;
+
+			loading_request request;
+			request.cell_index_ = cell_index;
+			request.prefetch_ = true;
+			loading_queue_.push_back(request);
+			queued_prefetch_cell_indices_.insert(cell_index);
+			++num_requests;
+		}
+	}
+
+	if(num_requests > 0)
+	{
+		semaphore_.signal(num_requests);
+	}
+}
+
 void pvs_database::
 load_visibility_data_async(uint64_t cell_index)
 {
@@ -410,40 +541,246 @@ load_visibility_data_async(uint64_t cell_index)
 			}
 		}
 	}
-  
-  std::lock_guard<std::mutex> lock(mutex_);
 
-	// Load required visibility data which is not yet loaded.
+	// The new neighbourhood must not be evicted while the viewer stays in this cell.
+	{
+		std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+		viewer_neighbourhood_cell_indices_ = cell_indices_to_load;
+	}
+
+	// Load required visibility data which is not yet cached. Cells are pinned until the snapshot is taken.
+	std::set<size_t> pinned_cell_indices;
+	bool viewer_cell_was_cached = false;
+
 	for (std::set<size_t>::iterator iter = cell_indices_to_load.begin(); iter != cell_indices_to_load.end(); ++iter)
 	{
-		if(previously_loaded_cell_indices_.find(*iter) == previously_loaded_cell_indices_.end())
+		bool was_cached = false;
+
+		if(load_cached_cell(*iter, true, &was_cached))
+		{
+			pinned_cell_indices.insert(*iter);
+		}
+
+		if(*iter == cell_index)
+		{
+			viewer_cell_was_cached = was_cached;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+
+		if(viewer_cell_was_cached)
+		{
+			++cell_cache_statistics_.hits_;
+		}
+		else
+		{
+			++cell_cache_statistics_.misses_;
+		}
+	}
+
+	// Pinned cells are not modified by other threads, so the snapshot can be taken without further synchronization.
+	if(cell == viewer_cell_)
+	{
+		publish_viewer_snapshot(cell, visibility_grid_);
+	}
+
+	unpin_cached_cells(pinned_cell_indices);
+
+	std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+	evict_cached_cells();
+}
+
+bool pvs_database::
+load_cached_cell(const size_t& cell_index, const bool& pin, bool* was_cached)
+{
+	std::unique_lock<std::mutex> lock(cell_cache_mutex_);
+
+	std::unordered_map<size_t, cached_cell>::iterator iter = cell_cache_.find(cell_index);
+
+	// Another thread may be reading the same cell, wait for it instead of loading twice.
+	while(iter != cell_cache_.end() && !iter->second.loaded_)
+	{
+		cell_cache_condition_.wait(lock);
+		iter = cell_cache_.find(cell_index);
+	}
+
+	if(iter != cell_cache_.end())
+	{
+		// Cache hit, move cell to the front of the LRU list.
+		cell_cache_lru_.splice(cell_cache_lru_.begin(), cell_cache_lru_, iter->second.lru_position_);
+
+		if(pin)
+		{
+			++iter->second.pin_count_;
+		}
+
+		(*was_cached) = true;
+		return true;
+	}
+
+	(*was_cached) = false;
+
+	cached_cell& new_cell = cell_cache_[cell_index];
+	new_cell.pin_count_ = 0;
+	new_cell.loaded_ = false;
+
+	// Read without holding the cache lock, so cached cells stay accessible.
+	lock.unlock();
+	bool loaded = false;
+
+	try
+	{
+		if(pvs_file_is_container_)
+		{
+			loaded = visibility_grid_->load_cell_visibility_from_file(pvs_file_path_, cell_index);
+		}
+		else
+		{
+			std::lock_guard<std::mutex> file_lock(file_loading_mutex_);
+			loaded = visibility_grid_->load_cell_visibility_from_file(pvs_file_path_, cell_index);
+		}
+	}
+	catch(const std::exception& e)
+	{
+		// A corrupt file fails the request, the placeholder is removed below and waiting threads are woken up.
+		std::cerr << "lamure: pvs_database::Unable to load cell " << cell_index << ": " << e.what() << std::endl;
+		loaded = false;
+	}
+
+	lock.lock();
+
+	if(loaded)
+	{
+		cached_cell& loaded_cell = cell_cache_[cell_index];
+		cell_cache_lru_.push_front(cell_index);
+		loaded_cell.lru_position_ = cell_cache_lru_.begin();
+		loaded_cell.pin_count_ = pin ? 1 : 0;
+		loaded_cell.loaded_ = true;
+
+		cell_cache_statistics_.cached_size_in_bytes_ += cell_size_in_bytes_;
+	}
+	else
+	{
+		cell_cache_.erase(cell_index);
+	}
+
+	cell_cache_statistics_.num_cached_cells_ = cell_cache_lru_.size();
+	cell_cache_condition_.notify_all();
+
+	return loaded;
+}
+
+void pvs_database::
+unpin_cached_cells(const std::set<size_t>& cell_indices)
+{
+	std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+
+	for(std::set<size_t>::const_iterator iter = cell_indices.begin(); iter != cell_indices.end(); ++iter)
+	{
+		std::unordered_map<size_t, cached_cell>::iterator cache_iter = cell_cache_.find(*iter);
+
+		if(cache_iter != cell_cache_.end() && cache_iter->second.pin_count_ > 0)
+		{
+			--cache_iter->second.pin_count_;
+		}
+	}
+}
+
+void pvs_database::
+evict_cached_cells()
+{
+	// Expects cell_cache_mutex_ to be locked by the caller.
+	std::list<size_t>::iterator lru_iter = cell_cache_lru_.end();
+
+	while(cell_cache_statistics_.cached_size_in_bytes_ > cell_cache_budget_in_bytes_ && lru_iter != cell_cache_lru_.begin())
+	{
+		--lru_iter;
+		size_t cell_index = *lru_iter;
+		const cached_cell& current_cell = cell_cache_[cell_index];
+
+		// The neighbourhood of the viewer and cells in use are kept, even if the budget is exceeded.
+		if(current_cell.pin_count_ > 0 || viewer_neighbourhood_cell_indices_.count(cell_index) > 0)
 		{
-			visibility_grid_->load_cell_visibility_from_file(pvs_file_path_, *iter);
+			continue;
 		}
+
+		visibility_grid_->clear_cell_visibility(cell_index);
+
+		lru_iter = cell_cache_lru_.erase(lru_iter);
+		cell_cache_.erase(cell_index);
+
+		cell_cache_statistics_.cached_size_in_bytes_ -= cell_size_in_bytes_;
+		++cell_cache_statistics_.num_evicted_cells_;
 	}
 
-	// Release visibility data not within current neighbourhood.
-	for (std::set<size_t>::iterator iter = previously_loaded_cell_indices_.begin(); iter != previously_loaded_cell_indices_.end(); ++iter)
+	cell_cache_statistics_.num_cached_cells_ = cell_cache_lru_.size();
+}
+
+void pvs_database::
+clear_cell_cache()
+{
+	std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+
+	cell_cache_.clear();
+	cell_cache_lru_.clear();
+	viewer_neighbourhood_cell_indices_.clear();
+
+	cell_cache_statistics_.num_cached_cells_ = 0;
+	cell_cache_statistics_.cached_size_in_bytes_ = 0;
+}
+
+void pvs_database::
+publish_viewer_snapshot(const view_cell* cell, const grid* cell_grid)
+{
+	std::shared_ptr<const visibility_snapshot> snapshot;
+
+	if(cell != nullptr && cell_grid != nullptr && cell->contains_visibility_data())
 	{
-		if(cell_indices_to_load.find(*iter) == cell_indices_to_load.end())
+		std::vector<node_t> ids(cell_grid->get_num_models());
+		for(model_t model_index = 0; model_index < ids.size(); ++model_index)
 		{
-			visibility_grid_->clear_cell_visibility(*iter);
+			ids[model_index] = cell_grid->get_num_nodes(model_index);
 		}
+
+		snapshot = std::make_shared<const visibility_snapshot>(cell, ids);
+	}
+
+	std::atomic_store(&viewer_snapshot_, snapshot);
+}
+
+std::shared_ptr<const visibility_snapshot> pvs_database::
+get_viewer_visibility_snapshot() const
+{
+	if(!activated_)
+	{
+		return std::shared_ptr<const visibility_snapshot>();
+	}
+
+	std::shared_ptr<const visibility_snapshot> snapshot = std::atomic_load(&viewer_snapshot_);
+
+	// A snapshot published for a cell the viewer already left is outdated.
+	if(snapshot != nullptr && snapshot->get_cell() != viewer_cell_.load())
+	{
+		return std::shared_ptr<const visibility_snapshot>();
 	}
 
-	previously_loaded_cell_indices_ = std::set<size_t>(cell_indices_to_load);
+	return snapshot;
 }
 
 bool pvs_database::
 get_viewer_visibility(const model_t& model_id, const node_t node_id) const
 {
-	if(!activated_ || viewer_cell_ == nullptr || !viewer_cell_->contains_visibility_data())
+	std::shared_ptr<const visibility_snapshot> snapshot = get_viewer_visibility_snapshot();
+
+	if(snapshot == nullptr)
 	{
 		return true;
 	}
 	else
 	{
-		return viewer_cell_->get_visibility(model_id, node_id);
+		return snapshot->get_visibility(model_id, node_id);
 	}
 }
 
@@ -461,6 +798,40 @@ is_activated() const
 	return activated_;
 }
 
+void pvs_database::
+set_cell_cache_budget_in_mb(const size_t& budget_in_mb)
+{
+	std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+
+	cell_cache_budget_in_bytes_ = budget_in_mb * 1024 * 1024;
+	evict_cached_cells();
+}
+
+void pvs_database::
+set_prefetch_lookahead(const size_t& num_updates)
+{
+	prefetch_lookahead_ = num_updates;
+}
+
+pvs_database::cell_cache_statistics pvs_database::
+get_cell_cache_statistics() const
+{
+	std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+
+	return cell_cache_statistics_;
+}
+
+void pvs_database::
+reset_cell_cache_statistics()
+{
+	std::lock_guard<std::mutex> lock(cell_cache_mutex_);
+
+	cell_cache_statistics_.hits_ = 0;
+	cell_cache_statistics_.misses_ = 0;
+	cell_cache_statistics_.num_prefetched_cells_ = 0;
+	cell_cache_statistics_.num_evicted_cells_ = 0;
+}
+
 const grid* pvs_database::
 get_visibility_grid() const
 {
@@ -479,6 +850,8 @@ clear_visibility_grid()
 	std::lock_guard<std::mutex> lock(mutex_);
 
 	viewer_cell_ = nullptr;
+	std::atomic_store(&viewer_snapshot_, std::shared_ptr<const visibility_snapshot>());
+	clear_cell_cache();
 
 	delete visibility_grid_;
 	visibility_grid_ = nullptr;
@@ -0,0 +1,68 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group 
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include "lamure/pvs/visibility_snapshot.h"
+
+namespace lamure
+{
+namespace pvs
+{
+
+visibility_snapshot::
+visibility_snapshot(const view_cell* cell, const std::vector<node_t>& ids)
+{
+	cell_ = cell;
+	num_visible_nodes_ = 0;
+
+	num_nodes_ = ids;
+	model_offsets_.resize(ids.size());
+
+	uint64_t num_bits = 0;
+	for(model_t model_index = 0; model_index < ids.size(); ++model_index)
+	{
+		model_offsets_[model_index] = num_bits;
+		num_bits += ids[model_index];
+	}
+
+	bits_.resize((num_bits + 63) / 64 + 1, 0);
+
+	if(cell == nullptr)
+	{
+		return;
+	}
+
+	// One virtual call for the whole cell, so the hierarchical cell types are resolved properly.
+	std::map<model_t, std::vector<node_t>> visible_indices = cell->get_visible_indices();
+
+	for(std::map<model_t, std::vector<node_t>>::const_iterator iter = visible_indices.begin(); iter != visible_indices.end(); ++iter)
+	{
+		model_t model_id = iter->first;
+
+		if(model_id >= num_nodes_.size())
+		{
+			continue;
+		}
+
+		for(node_t node_id : iter->second)
+		{
+			if(node_id < num_nodes_[model_id])
+			{
+				uint64_t bit_index = model_offsets_[model_id] + node_id;
+				bits_[bit_index >> 6] |= (uint64_t)1 << (bit_index & 63);
+				++num_visible_nodes_;
+			}
+		}
+	}
+}
+
+visibility_snapshot::
+~visibility_snapshot()
+{
+}
+
+}
+}
@@ -16,12 +16,28 @@ namespace lamure
 namespace pvs
 {
 
+// Joins neighbouring view cells of an irregular grid if their visibility is similar enough.
+// Only cells sharing a face are compared. Each round evaluates the candidate pairs in parallel and
+// joins the most similar pairs first, after the first round only pairs involving a cell joined in the
+// previous round are evaluated again.
 class PVS_PREPROCESSING_DLL grid_optimizer_irregular
 {
 public:
+	grid_optimizer_irregular();
+
 	// Equality threshold is the allowed difference in percent used to consider two cells as equal.
 	// E.g. a value of 0.9 means the cells must contain 90% equal elements to be considered equal.
 	void optimize_grid(grid* input_grid, const float& equality_threshold);
+
+	// Number of MinHash values stored per cell to estimate similarity before the exact comparison (0 disables the pre-filter).
+	// Worth it for large grids with many nodes. Pairs whose estimated equality is below the threshold minus the tolerance are skipped,
+	// so a few joins may be missed compared to the exact test.
+	void set_minhash_signature_size(const size_t& signature_size);
+	void set_minhash_tolerance(const float& tolerance);
+
+private:
+	size_t minhash_signature_size_;
+	float minhash_tolerance_;
 };
 
 }
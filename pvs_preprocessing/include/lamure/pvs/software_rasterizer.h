@@ -0,0 +1,99 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_PVS_SOFTWARE_RASTERIZER_H
+#define LAMURE_PVS_SOFTWARE_RASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <lamure/pvs/pvs_preprocessing.h>
+#include <lamure/ren/dataset.h>
+
+#include <scm/core/math.h>
+
+namespace lamure
+{
+namespace pvs
+{
+
+// Renders surfel splats into an ID buffer on the CPU, used instead of the node visibility shaders if no OpenGL context is available.
+// Splats are transformed and sorted into screen tiles in parallel, afterwards each tile is rasterized with its own depth buffer
+// by a single thread. Like the shaders, splats are oriented discs whose depth grows towards their border.
+class PVS_PREPROCESSING_DLL software_rasterizer
+{
+public:
+	// Surfels of a node, the ID written for each covered pixel and the index of the model view matrix used to transform them.
+	struct splat_node
+	{
+		const lamure::ren::dataset::serialized_surfel* surfels_;
+		uint32_t num_surfels_;
+		uint32_t id_;
+		uint32_t transform_index_;
+	};
+
+	software_rasterizer(const int& width, const int& height, const int& tile_size);
+	~software_rasterizer();
+
+	void set_projection(const float& opening_angle, const float& aspect_ratio, const float& near_plane, const float& far_plane);
+	void set_radius_scale(const float& radius_scale);
+
+	// ID buffer contains the ID of the closest splat per pixel or zero if no splat covers the pixel.
+	void render(const std::vector<splat_node>& nodes, const std::vector<scm::math::mat4f>& model_view_matrices);
+
+	const std::vector<uint32_t>& get_id_buffer() const;
+	int get_width() const;
+	int get_height() const;
+
+private:
+	struct screen_splat
+	{
+		float center_x_;
+		float center_y_;
+
+		// Maps pixel offsets from the center to the splat parameters u and v.
+		float inverse_axes_[4];
+
+		float depth_;
+		float depth_u_;
+		float depth_v_;
+
+		int min_x_;
+		int min_y_;
+		int max_x_;
+		int max_y_;
+
+		uint32_t id_;
+	};
+
+	void bin_node(const splat_node& node, const scm::math::mat4f& model_view_matrix, std::vector<screen_splat>* bins);
+	void rasterize_tile(const size_t& tile_index);
+
+	int width_;
+	int height_;
+	int tile_size_;
+	int num_tiles_x_;
+	int num_tiles_y_;
+
+	float projection_scale_x_;
+	float projection_scale_y_;
+	float near_plane_;
+	float far_plane_;
+	float radius_scale_;
+
+	std::vector<float> depth_buffer_;
+	std::vector<uint32_t> id_buffer_;
+
+	// One list of splats per thread and tile, indexed by thread * tile count + tile.
+	std::vector<std::vector<screen_splat>> bins_;
+	size_t num_bin_threads_;
+};
+
+}
+}
+
+#endif
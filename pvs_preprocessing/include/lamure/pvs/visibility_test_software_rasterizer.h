@@ -0,0 +1,71 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef LAMURE_PVS_VISIBILITY_TEST_SOFTWARE_RASTERIZER_H
+#define LAMURE_PVS_VISIBILITY_TEST_SOFTWARE_RASTERIZER_H
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <lamure/pvs/pvs_preprocessing.h>
+#include "lamure/pvs/visibility_test.h"
+#include "lamure/pvs/software_rasterizer.h"
+#include "lamure/pvs/grid.h"
+
+#include <lamure/ren/lod_mapping.h>
+
+#include <scm/core/math.h>
+
+namespace lamure
+{
+namespace pvs
+{
+
+// Headless counterpart to visibility_test_id_histogram_renderer. Renders the six views of each grid cell with the
+// software rasterizer instead of OpenGL. Cuts are computed directly from the node error, surfels are read from
+// memory mapped .lod files. Neither an OpenGL context nor a window is required.
+class PVS_PREPROCESSING_DLL visibility_test_software_rasterizer : public visibility_test
+{
+public:
+	visibility_test_software_rasterizer();
+	virtual ~visibility_test_software_rasterizer();
+
+	virtual int initialize(int& argc, char** argv);
+	virtual void test_visibility(grid* visibility_grid);
+	virtual void shutdown();
+
+	virtual bounding_box get_scene_bounds() const;
+
+private:
+	// Adds the nodes of the cut of the model which are inside the frustum to the list, node IDs are offset by first_id.
+	// Also returns the number of nodes in the cut and their summed depth.
+	void compute_cut(const model_t& model_id, const scm::math::mat4f& model_view_matrix, const float& opening_angle, const float& near_plane, const uint32_t& first_id,
+					std::vector<software_rasterizer::splat_node>& nodes, size_t& num_cut_nodes, size_t& total_cut_depth) const;
+
+	void check_for_nodes_within_cells(grid* visibility_grid, const std::vector<std::vector<size_t>>& total_depths, const std::vector<std::vector<size_t>>& total_nums) const;
+	void emit_node_visibility(grid* visibility_grid) const;
+
+	int resolution_x_;
+	int resolution_y_;
+	int tile_size_;
+
+	float error_threshold_;
+	float visibility_threshold_;
+	float far_plane_;
+
+	std::vector<scm::math::mat4f> model_transformations_;
+	std::set<model_t> rendered_models_;
+	std::vector<std::unique_ptr<lamure::ren::lod_mapping>> lod_mappings_;
+
+	bounding_box scene_bounds_;
+};
+
+}
+}
+
+#endif
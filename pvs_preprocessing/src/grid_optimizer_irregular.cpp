@@ -1,91 +1,458 @@
 // Copyright (c) 2014 Bauhaus-Universitaet Weimar
 // This Software is distributed under the Modified BSD License, see license.txt.
 //
-// Virtual Reality and Visualization Research Group 
+// Virtual Reality and Visualization Research Group
 // Faculty of Media, Bauhaus-Universitaet Weimar
 // http://www.uni-weimar.de/medien/vr
 
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
-#include <queue>
+#include <iterator>
+#include <limits>
 #include <utility>
 
+#include <boost/dynamic_bitset.hpp>
+
 #include "lamure/pvs/grid_optimizer_irregular.h"
 #include "lamure/pvs/grid_irregular.h"
+#include "lamure/pvs/view_cell_regular_managing.h"
 
 namespace lamure
 {
 namespace pvs
 {
 
+namespace
+{
+
+typedef boost::dynamic_bitset<>::block_type block_type;
+
+const size_t bits_per_block = std::numeric_limits<block_type>::digits;
+const uint32_t empty_minhash_value = std::numeric_limits<uint32_t>::max();
+
+// A set of joined cells. The visibility of all models is stored in a single block buffer.
+struct cell_cluster
+{
+	std::vector<block_type> blocks_;
+	std::vector<uint32_t> signature_;
+	std::vector<size_t> neighbours_;
+	std::vector<size_t> members_;
+	size_t num_visible_nodes_;
+	float error_;
+};
+
+struct join_candidate
+{
+	float error_;
+	size_t first_;
+	size_t second_;
+
+	bool operator<(const join_candidate& other) const
+	{
+		if(error_ != other.error_)
+		{
+			return error_ < other.error_;
+		}
+		if(first_ != other.first_)
+		{
+			return first_ < other.first_;
+		}
+		return second_ < other.second_;
+	}
+};
+
+inline size_t count_bits(const block_type& block)
+{
+	return std::bitset<bits_per_block>(block).count();
+}
+
+size_t count_common_bits(const std::vector<block_type>& blocks_one, const std::vector<block_type>& blocks_two)
+{
+	size_t common_bits = 0;
+	const block_type* data_one = blocks_one.data();
+	const block_type* data_two = blocks_two.data();
+
+	for(size_t block_index = 0; block_index < blocks_one.size(); ++block_index)
+	{
+		common_bits += count_bits(data_one[block_index] & data_two[block_index]);
+	}
+
+	return common_bits;
+}
+
+uint64_t hash_node(uint64_t value)
+{
+	// splitmix64 finalizer
+	value += 0x9e3779b97f4a7c15ull;
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+	return value ^ (value >> 31);
+}
+
+// One permutation MinHash: every visible node is hashed once into one of the signature buckets, each bucket keeps its minimum.
+void compute_signature(const std::vector<block_type>& blocks, const size_t& signature_size, std::vector<uint32_t>& signature)
+{
+	signature.assign(signature_size, empty_minhash_value);
+
+	for(size_t block_index = 0; block_index < blocks.size(); ++block_index)
+	{
+		block_type block = blocks[block_index];
+
+		for(size_t bit_index = 0; block != 0; ++bit_index, block >>= 1)
+		{
+			if(block & 1)
+			{
+				uint64_t hash = hash_node((uint64_t)(block_index * bits_per_block + bit_index));
+				uint32_t& bucket = signature[hash % signature_size];
+				bucket = std::min(bucket, (uint32_t)(hash >> 32));
+			}
+		}
+	}
+}
+
+// Estimates the amount of common visible nodes from the Jaccard similarity of the signatures.
+double estimate_common_bits(const cell_cluster& cluster_one, const cell_cluster& cluster_two)
+{
+	size_t num_matches = 0;
+	size_t num_used_buckets = 0;
+
+	for(size_t bucket_index = 0; bucket_index < cluster_one.signature_.size(); ++bucket_index)
+	{
+		uint32_t value_one = cluster_one.signature_[bucket_index];
+		uint32_t value_two = cluster_two.signature_[bucket_index];
+
+		if(value_one == empty_minhash_value && value_two == empty_minhash_value)
+		{
+			continue;
+		}
+
+		++num_used_buckets;
+		num_matches += (value_one == value_two) ? 1 : 0;
+	}
+
+	if(num_used_buckets == 0)
+	{
+		return 0.0;
+	}
+
+	double jaccard = (double)num_matches / (double)num_used_buckets;
+	return jaccard * (double)(cluster_one.num_visible_nodes_ + cluster_two.num_visible_nodes_) / (1.0 + jaccard);
+}
+
+}
+
+grid_optimizer_irregular::
+grid_optimizer_irregular()
+{
+	minhash_signature_size_ = 0;
+	minhash_tolerance_ = 0.05f;
+}
+
+void grid_optimizer_irregular::
+set_minhash_signature_size(const size_t& signature_size)
+{
+	minhash_signature_size_ = signature_size;
+}
+
+void grid_optimizer_irregular::
+set_minhash_tolerance(const float& tolerance)
+{
+	minhash_tolerance_ = tolerance;
+}
+
 void grid_optimizer_irregular::
 optimize_grid(grid* input_grid, const float& equality_threshold)
 {
+	std::chrono::time_point<std::chrono::system_clock> start_time = std::chrono::system_clock::now();
+
 	grid_irregular* irr_grid = (grid_irregular*)input_grid;
 
-	for(long current_cell_index = 0; current_cell_index < irr_grid->get_cell_count(); ++current_cell_index)
+	const size_t num_cells = irr_grid->get_cell_count();
+	const size_t signature_size = minhash_signature_size_;
+
+	// Every model starts at a block boundary within the block buffer of a cell.
+	std::vector<size_t> model_block_offsets;
+	size_t num_blocks = 0;
+	size_t total_nodes = 0;
+
+	for(model_t model_index = 0; model_index < irr_grid->get_num_models(); ++model_index)
 	{
-		bool is_original_cell = irr_grid->is_cell_at_index_original(current_cell_index);
-		const view_cell* current_cell = irr_grid->get_cell_at_index(current_cell_index);
+		model_block_offsets.push_back(num_blocks);
+		num_blocks += (irr_grid->get_num_nodes(model_index) + bits_per_block - 1) / bits_per_block;
+		total_nodes += irr_grid->get_num_nodes(model_index);
+	}
 
-		std::priority_queue<std::pair<float, size_t>, std::vector<std::pair<float, size_t>>, std::greater<std::pair<float, size_t>>> merge_options;
+	if(num_cells < 2 || total_nodes == 0)
+	{
+		return;
+	}
 
-		for(long compare_cell_index = 0; compare_cell_index < irr_grid->get_cell_count(); ++compare_cell_index)
+	// Each current cell starts as its own cluster.
+	std::vector<cell_cluster> clusters(num_cells);
+	std::vector<size_t> cluster_of_cell(num_cells);
+	float steps_finished = 0.0f;
+
+	#pragma omp parallel for schedule(dynamic, 16)
+	for(size_t cell_index = 0; cell_index < num_cells; ++cell_index)
+	{
+		cell_cluster& cluster = clusters[cell_index];
+		const view_cell_regular* cell = (const view_cell_regular*)irr_grid->get_cell_at_index(cell_index);
+
+		cluster.blocks_.assign(num_blocks, 0);
+
+		for(model_t model_index = 0; model_index < irr_grid->get_num_models(); ++model_index)
+		{
+			boost::dynamic_bitset<> visibility = cell->get_bitset(model_index);
+			visibility.resize(irr_grid->get_num_nodes(model_index));
+			boost::to_block_range(visibility, cluster.blocks_.begin() + model_block_offsets[model_index]);
+		}
+
+		cluster.num_visible_nodes_ = 0;
+		for(block_type block : cluster.blocks_)
+		{
+			cluster.num_visible_nodes_ += count_bits(block);
+		}
+
+		if(signature_size > 0)
+		{
+			compute_signature(cluster.blocks_, signature_size, cluster.signature_);
+		}
+
+		cluster.members_.push_back(cell_index);
+		cluster.error_ = irr_grid->is_cell_at_index_original(cell_index) ? 0.0f : ((const view_cell_regular_managing*)cell)->get_error();
+		cluster_of_cell[cell_index] = cell_index;
+
+		#pragma omp critical
+		{
+			steps_finished++;
+			float current_percentage_done = (steps_finished / (float)num_cells) * 100.0f;
+			std::cout << "\rgrid optimization preparation in progress [" << current_percentage_done << "]       " << std::flush;
+		}
+	}
+
+	std::cout << std::endl;
+
+	// Cells are neighbours if any of their original cells share a face.
+	for(size_t original_index = 0; original_index < irr_grid->get_original_cell_count(); ++original_index)
+	{
+		size_t cell_index = irr_grid->get_cell_index_of_original_cell(original_index);
+		std::vector<size_t> neighbour_indices = irr_grid->get_original_neighbour_indices(original_index);
+
+		for(size_t neighbour_original_index : neighbour_indices)
 		{
-			if(compare_cell_index == current_cell_index)
+			size_t neighbour_cell_index = irr_grid->get_cell_index_of_original_cell(neighbour_original_index);
+
+			if(neighbour_cell_index != cell_index)
 			{
-				continue;
+				clusters[cell_index].neighbours_.push_back(neighbour_cell_index);
 			}
+		}
+	}
 
-			const view_cell* compare_cell = irr_grid->get_cell_at_index(compare_cell_index);
+	std::vector<size_t> changed_clusters(num_cells);
+	std::vector<bool> cluster_changed(num_cells, true);
+
+	for(size_t cell_index = 0; cell_index < num_cells; ++cell_index)
+	{
+		changed_clusters[cell_index] = cell_index;
+	}
+
+	size_t num_clusters = num_cells;
+	size_t num_rounds = 0;
+	size_t num_compared_pairs = 0;
+	size_t num_bound_skipped_pairs = 0;
+	size_t num_minhash_skipped_pairs = 0;
+
+	while(!changed_clusters.empty())
+	{
+		++num_rounds;
 
-			// Check equality.
-			size_t equality_counter = 0;
-			size_t total_nodes = 0;
+		// After a round every pair which could be joined had a joined partner. Therefore only pairs involving a changed cluster must be evaluated.
+		std::vector<join_candidate> candidates;
 
-			view_cell_regular* current_view_cell_regular = (view_cell_regular*)current_cell;
-			view_cell_regular* compare_view_cell_regular = (view_cell_regular*)compare_cell;
+		#pragma omp parallel
+		{
+			std::vector<join_candidate> local_candidates;
+			size_t local_compared_pairs = 0;
+			size_t local_bound_skipped_pairs = 0;
+			size_t local_minhash_skipped_pairs = 0;
 
-			for(model_t model_index = 0; model_index < irr_grid->get_num_models(); ++model_index)
+			#pragma omp for schedule(dynamic, 4)
+			for(size_t changed_index = 0; changed_index < changed_clusters.size(); ++changed_index)
 			{
-				boost::dynamic_bitset<> bitset_one = boost::dynamic_bitset<>(current_view_cell_regular->get_bitset(model_index));
-				bitset_one.resize(input_grid->get_num_nodes(model_index));
-				boost::dynamic_bitset<> bitset_two = boost::dynamic_bitset<>(compare_view_cell_regular->get_bitset(model_index));
-				bitset_two.resize(input_grid->get_num_nodes(model_index));
+				size_t cluster_index = changed_clusters[changed_index];
+				cell_cluster& cluster = clusters[cluster_index];
+
+				// Neighbours may have been joined since the list was built.
+				for(size_t& neighbour_index : cluster.neighbours_)
+				{
+					neighbour_index = cluster_of_cell[neighbour_index];
+				}
+
+				std::sort(cluster.neighbours_.begin(), cluster.neighbours_.end());
+				cluster.neighbours_.erase(std::unique(cluster.neighbours_.begin(), cluster.neighbours_.end()), cluster.neighbours_.end());
+				cluster.neighbours_.erase(std::remove(cluster.neighbours_.begin(), cluster.neighbours_.end(), cluster_index), cluster.neighbours_.end());
+
+				for(size_t neighbour_index : cluster.neighbours_)
+				{
+					// Pairs of two changed clusters are evaluated once.
+					if(cluster_changed[neighbour_index] && neighbour_index < cluster_index)
+					{
+						continue;
+					}
+
+					const cell_cluster& neighbour = clusters[neighbour_index];
+
+					// Errors accumulate over joins, see grid_irregular::join_cells.
+					double required_equality = (double)equality_threshold + (double)cluster.error_ + (double)neighbour.error_;
+					double required_common_bits = required_equality * (double)total_nodes;
+
+					if(required_equality > 1.0 ||
+						(double)std::min(cluster.num_visible_nodes_, neighbour.num_visible_nodes_) < required_common_bits)
+					{
+						++local_bound_skipped_pairs;
+						continue;
+					}
+
+					if(signature_size > 0 &&
+						estimate_common_bits(cluster, neighbour) < required_common_bits - (double)minhash_tolerance_ * (double)total_nodes)
+					{
+						++local_minhash_skipped_pairs;
+						continue;
+					}
+
+					++local_compared_pairs;
 
-				boost::dynamic_bitset<> common_bits = bitset_one & bitset_two;
+					size_t common_bits = count_common_bits(cluster.blocks_, neighbour.blocks_);
+					float equality = (float)common_bits / (float)total_nodes;
 
-				equality_counter += common_bits.count();
-				total_nodes += common_bits.size();
+					if((double)common_bits >= required_common_bits)
+					{
+						join_candidate candidate;
+						candidate.error_ = 1.0f - equality;
+						candidate.first_ = std::min(cluster_index, neighbour_index);
+						candidate.second_ = std::max(cluster_index, neighbour_index);
+						local_candidates.push_back(candidate);
+					}
+				}
 			}
 
-			float equality = (float)equality_counter / (float)total_nodes;
-			float error = 1.0f - equality;
+			#pragma omp critical
+			{
+				candidates.insert(candidates.end(), local_candidates.begin(), local_candidates.end());
+				num_compared_pairs += local_compared_pairs;
+				num_bound_skipped_pairs += local_bound_skipped_pairs;
+				num_minhash_skipped_pairs += local_minhash_skipped_pairs;
+			}
+		}
+
+		// Most similar pairs are joined first, each cluster takes part in at most one join per round.
+		std::sort(candidates.begin(), candidates.end());
+
+		std::fill(cluster_changed.begin(), cluster_changed.end(), false);
+		std::vector<join_candidate> joins;
 
-			// This test will already cancel some unecessary tests, yet a further threshold test will be done within join_cells.
-			if(equality >= equality_threshold)
+		for(const join_candidate& candidate : candidates)
+		{
+			if(!cluster_changed[candidate.first_] && !cluster_changed[candidate.second_])
 			{
-				merge_options.push(std::pair<float, size_t>(error, compare_cell_index));
+				cluster_changed[candidate.first_] = true;
+				cluster_changed[candidate.second_] = true;
+				joins.push_back(candidate);
 			}
 		}
 
-		// Merge view cells.
-		while(merge_options.size() > 0)
+		#pragma omp parallel for schedule(dynamic, 4)
+		for(size_t join_index = 0; join_index < joins.size(); ++join_index)
 		{
-			if(irr_grid->join_cells(current_cell_index, merge_options.top().second, merge_options.top().first, equality_threshold) && is_original_cell)
+			// The larger cluster keeps its index so fewer cells need to be remapped.
+			size_t target_index = joins[join_index].first_;
+			size_t source_index = joins[join_index].second_;
+
+			if(clusters[source_index].members_.size() > clusters[target_index].members_.size())
 			{
-				--current_cell_index;
-				break;
+				std::swap(target_index, source_index);
 			}
 
-			merge_options.pop();
+			cell_cluster& target = clusters[target_index];
+			cell_cluster& source = clusters[source_index];
+
+			target.num_visible_nodes_ = 0;
+			for(size_t block_index = 0; block_index < target.blocks_.size(); ++block_index)
+			{
+				target.blocks_[block_index] |= source.blocks_[block_index];
+				target.num_visible_nodes_ += count_bits(target.blocks_[block_index]);
+			}
+
+			for(size_t bucket_index = 0; bucket_index < target.signature_.size(); ++bucket_index)
+			{
+				target.signature_[bucket_index] = std::min(target.signature_[bucket_index], source.signature_[bucket_index]);
+			}
+
+			target.error_ += source.error_ + joins[join_index].error_;
+			target.neighbours_.insert(target.neighbours_.end(), source.neighbours_.begin(), source.neighbours_.end());
+
+			for(size_t member_index : source.members_)
+			{
+				cluster_of_cell[member_index] = target_index;
+			}
+			target.members_.insert(target.members_.end(), source.members_.begin(), source.members_.end());
+
+			std::vector<block_type>().swap(source.blocks_);
+			std::vector<uint32_t>().swap(source.signature_);
+			std::vector<size_t>().swap(source.neighbours_);
+			std::vector<size_t>().swap(source.members_);
+
+			joins[join_index].first_ = target_index;
+			joins[join_index].second_ = source_index;
 		}
 
-		double current_percentage_done = ((double)current_cell_index / (double)irr_grid->get_cell_count()) * 100.0;
-		std::cout << "\rgrid optimization in progress [" << current_percentage_done << "]       " << std::flush;
+		changed_clusters.clear();
+		std::fill(cluster_changed.begin(), cluster_changed.end(), false);
+
+		for(const join_candidate& join : joins)
+		{
+			changed_clusters.push_back(join.first_);
+			cluster_changed[join.first_] = true;
+		}
+
+		num_clusters -= joins.size();
+		std::cout << "\rgrid optimization in progress [round " << num_rounds << ", " << num_clusters << " cells]       " << std::flush;
+	}
+
+	std::cout << std::endl;
+
+	// Apply all joins to the grid at once.
+	std::vector<std::vector<size_t>> cell_index_groups;
+	std::vector<float> group_errors;
+
+	for(size_t cell_index = 0; cell_index < num_cells; ++cell_index)
+	{
+		if(clusters[cell_index].members_.size() > 1)
+		{
+			cell_index_groups.push_back(clusters[cell_index].members_);
+			group_errors.push_back(clusters[cell_index].error_);
+		}
 	}
 
-	std::cout << "\rgrid optimization in progress [100]       " << std::endl;
+	clusters.clear();
+	irr_grid->join_cell_groups(cell_index_groups, group_errors);
+
+	std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - start_time;
+
+	std::cout << "grid optimization: " << num_cells << " -> " << irr_grid->get_cell_count() << " cells in " << num_rounds << " rounds, "
+		<< num_compared_pairs << " pairs compared, " << num_bound_skipped_pairs << " skipped by size";
+
+	if(signature_size > 0)
+	{
+		std::cout << ", " << num_minhash_skipped_pairs << " skipped by MinHash";
+	}
+
+	std::cout << " (" << elapsed_seconds.count() << " s)" << std::endl;
 }
 
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,312 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include "lamure/pvs/software_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace lamure
+{
+namespace pvs
+{
+
+software_rasterizer::
+software_rasterizer(const int& width, const int& height, const int& tile_size)
+{
+	width_ = std::max(width, 1);
+	height_ = std::max(height, 1);
+	tile_size_ = std::max(tile_size, 1);
+	num_tiles_x_ = (width_ + tile_size_ - 1) / tile_size_;
+	num_tiles_y_ = (height_ + tile_size_ - 1) / tile_size_;
+
+	depth_buffer_.resize(width_ * height_);
+	id_buffer_.resize(width_ * height_);
+
+	radius_scale_ = 1.0f;
+	num_bin_threads_ = 0;
+
+	set_projection(90.0f, 1.0f, 0.01f, 1000.0f);
+}
+
+software_rasterizer::
+~software_rasterizer()
+{
+}
+
+void software_rasterizer::
+set_projection(const float& opening_angle, const float& aspect_ratio, const float& near_plane, const float& far_plane)
+{
+	// Same symmetric perspective as scm::math::perspective_matrix, the opening angle is the vertical field of view in degrees.
+	float focal_length = 1.0f / std::tan(opening_angle * 0.5f * 3.14159265358979f / 180.0f);
+
+	projection_scale_x_ = focal_length / aspect_ratio * 0.5f * (float)width_;
+	projection_scale_y_ = focal_length * 0.5f * (float)height_;
+	near_plane_ = near_plane;
+	far_plane_ = far_plane;
+}
+
+void software_rasterizer::
+set_radius_scale(const float& radius_scale)
+{
+	radius_scale_ = radius_scale;
+}
+
+void software_rasterizer::
+render(const std::vector<splat_node>& nodes, const std::vector<scm::math::mat4f>& model_view_matrices)
+{
+	size_t num_tiles = num_tiles_x_ * num_tiles_y_;
+
+#ifdef _OPENMP
+	size_t num_threads = omp_get_max_threads();
+#else
+	size_t num_threads = 1;
+#endif
+
+	if(num_bin_threads_ != num_threads)
+	{
+		bins_.clear();
+		bins_.resize(num_threads * num_tiles);
+		num_bin_threads_ = num_threads;
+	}
+
+	// Transform splats and sort them into the tiles they overlap.
+	#pragma omp parallel for schedule(dynamic, 16)
+	for(size_t node_index = 0; node_index < nodes.size(); ++node_index)
+	{
+	#ifdef _OPENMP
+		size_t thread_index = omp_get_thread_num();
+	#else
+		size_t thread_index = 0;
+	#endif
+
+		const splat_node& node = nodes[node_index];
+		bin_node(node, model_view_matrices[node.transform_index_], &bins_[thread_index * num_tiles]);
+	}
+
+	// Tiles are independent of each other, so each one is rasterized by a single thread without synchronization.
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(size_t tile_index = 0; tile_index < num_tiles; ++tile_index)
+	{
+		rasterize_tile(tile_index);
+	}
+}
+
+void software_rasterizer::
+bin_node(const splat_node& node, const scm::math::mat4f& model_view_matrix, std::vector<screen_splat>* bins)
+{
+	const float* mv = &model_view_matrix[0];
+
+	for(uint32_t surfel_index = 0; surfel_index < node.num_surfels_; ++surfel_index)
+	{
+		const lamure::ren::dataset::serialized_surfel& surfel = node.surfels_[surfel_index];
+
+		if(surfel.size <= std::numeric_limits<float>::min())
+		{
+			continue;
+		}
+
+		// Eye space position, the camera looks along the negative z-axis.
+		float eye_x = mv[0] * surfel.x + mv[4] * surfel.y + mv[8] * surfel.z + mv[12];
+		float eye_y = mv[1] * surfel.x + mv[5] * surfel.y + mv[9] * surfel.z + mv[13];
+		float eye_z = mv[2] * surfel.x + mv[6] * surfel.y + mv[10] * surfel.z + mv[14];
+		float depth = -eye_z;
+
+		if(depth <= near_plane_ || depth >= far_plane_)
+		{
+			continue;
+		}
+
+		// Tangent vectors as in compute_tangent_vectors.glsl.
+		float normal_length = std::sqrt(surfel.nx * surfel.nx + surfel.ny * surfel.ny + surfel.nz * surfel.nz);
+		if(normal_length <= 0.0f)
+		{
+			continue;
+		}
+
+		float nx = surfel.nx / normal_length;
+		float ny = surfel.ny / normal_length;
+		float nz = surfel.nz / normal_length;
+
+		float ux, uy, uz;
+		if(nz != 0.0f)
+		{
+			ux = 1.0f; uy = 1.0f; uz = (-nx - ny) / nz;
+		}
+		else if(ny != 0.0f)
+		{
+			ux = 1.0f; uy = (-nx - nz) / ny; uz = 1.0f;
+		}
+		else
+		{
+			ux = (-ny - nz) / nx; uy = 1.0f; uz = 1.0f;
+		}
+
+		float vx = ny * uz - nz * uy;
+		float vy = nz * ux - nx * uz;
+		float vz = nx * uy - ny * ux;
+
+		float radius = surfel.size * radius_scale_;
+		float u_scale = radius / std::sqrt(ux * ux + uy * uy + uz * uz);
+		float v_scale = radius / std::sqrt(vx * vx + vy * vy + vz * vz);
+		ux *= u_scale; uy *= u_scale; uz *= u_scale;
+		vx *= v_scale; vy *= v_scale; vz *= v_scale;
+
+		// Tangent vectors in eye space.
+		float eye_ux = mv[0] * ux + mv[4] * uy + mv[8] * uz;
+		float eye_uy = mv[1] * ux + mv[5] * uy + mv[9] * uz;
+		float eye_uz = mv[2] * ux + mv[6] * uy + mv[10] * uz;
+		float eye_vx = mv[0] * vx + mv[4] * vy + mv[8] * vz;
+		float eye_vy = mv[1] * vx + mv[5] * vy + mv[9] * vz;
+		float eye_vz = mv[2] * vx + mv[6] * vy + mv[10] * vz;
+
+		// The splat is projected with the derivative of the perspective division at its center.
+		float inverse_depth = 1.0f / depth;
+		float center_x = (eye_x * inverse_depth) * projection_scale_x_ + 0.5f * (float)width_;
+		float center_y = (eye_y * inverse_depth) * projection_scale_y_ + 0.5f * (float)height_;
+
+		float axis_u_x = (eye_ux + eye_x * eye_uz * inverse_depth) * inverse_depth * projection_scale_x_;
+		float axis_u_y = (eye_uy + eye_y * eye_uz * inverse_depth) * inverse_depth * projection_scale_y_;
+		float axis_v_x = (eye_vx + eye_x * eye_vz * inverse_depth) * inverse_depth * projection_scale_x_;
+		float axis_v_y = (eye_vy + eye_y * eye_vz * inverse_depth) * inverse_depth * projection_scale_y_;
+
+		float determinant = axis_u_x * axis_v_y - axis_u_y * axis_v_x;
+		if(std::abs(determinant) <= std::numeric_limits<float>::epsilon())
+		{
+			// Splat is seen edge-on.
+			continue;
+		}
+
+		float extent_x = std::sqrt(axis_u_x * axis_u_x + axis_v_x * axis_v_x);
+		float extent_y = std::sqrt(axis_u_y * axis_u_y + axis_v_y * axis_v_y);
+
+		// Pixels are sampled at their centers.
+		int min_x = std::max(0, (int)std::ceil(center_x - extent_x - 0.5f));
+		int min_y = std::max(0, (int)std::ceil(center_y - extent_y - 0.5f));
+		int max_x = std::min(width_ - 1, (int)std::floor(center_x + extent_x - 0.5f));
+		int max_y = std::min(height_ - 1, (int)std::floor(center_y + extent_y - 0.5f));
+
+		if(min_x > max_x || min_y > max_y)
+		{
+			continue;
+		}
+
+		screen_splat splat;
+		splat.center_x_ = center_x;
+		splat.center_y_ = center_y;
+		splat.inverse_axes_[0] = axis_v_y / determinant;
+		splat.inverse_axes_[1] = -axis_v_x / determinant;
+		splat.inverse_axes_[2] = -axis_u_y / determinant;
+		splat.inverse_axes_[3] = axis_u_x / determinant;
+		splat.depth_ = depth;
+		splat.depth_u_ = -eye_uz;
+		splat.depth_v_ = -eye_vz;
+		splat.min_x_ = min_x;
+		splat.min_y_ = min_y;
+		splat.max_x_ = max_x;
+		splat.max_y_ = max_y;
+		splat.id_ = node.id_;
+
+		for(int tile_y = min_y / tile_size_; tile_y <= max_y / tile_size_; ++tile_y)
+		{
+			for(int tile_x = min_x / tile_size_; tile_x <= max_x / tile_size_; ++tile_x)
+			{
+				bins[tile_y * num_tiles_x_ + tile_x].push_back(splat);
+			}
+		}
+	}
+}
+
+void software_rasterizer::
+rasterize_tile(const size_t& tile_index)
+{
+	int tile_min_x = (int)(tile_index % num_tiles_x_) * tile_size_;
+	int tile_min_y = (int)(tile_index / num_tiles_x_) * tile_size_;
+	int tile_max_x = std::min(tile_min_x + tile_size_, width_) - 1;
+	int tile_max_y = std::min(tile_min_y + tile_size_, height_) - 1;
+
+	for(int y = tile_min_y; y <= tile_max_y; ++y)
+	{
+		std::fill(depth_buffer_.begin() + y * width_ + tile_min_x, depth_buffer_.begin() + y * width_ + tile_max_x + 1, std::numeric_limits<float>::max());
+		std::fill(id_buffer_.begin() + y * width_ + tile_min_x, id_buffer_.begin() + y * width_ + tile_max_x + 1, 0);
+	}
+
+	size_t num_tiles = num_tiles_x_ * num_tiles_y_;
+
+	for(size_t thread_index = 0; thread_index < num_bin_threads_; ++thread_index)
+	{
+		std::vector<screen_splat>& bin = bins_[thread_index * num_tiles + tile_index];
+
+		for(const screen_splat& splat : bin)
+		{
+			int min_x = std::max(splat.min_x_, tile_min_x);
+			int min_y = std::max(splat.min_y_, tile_min_y);
+			int max_x = std::min(splat.max_x_, tile_max_x);
+			int max_y = std::min(splat.max_y_, tile_max_y);
+
+			for(int y = min_y; y <= max_y; ++y)
+			{
+				float offset_y = ((float)y + 0.5f) - splat.center_y_;
+
+				for(int x = min_x; x <= max_x; ++x)
+				{
+					float offset_x = ((float)x + 0.5f) - splat.center_x_;
+
+					float u = splat.inverse_axes_[0] * offset_x + splat.inverse_axes_[1] * offset_y;
+					float v = splat.inverse_axes_[2] * offset_x + splat.inverse_axes_[3] * offset_y;
+
+					if(u * u + v * v > 1.0f)
+					{
+						continue;
+					}
+
+					// Like the shaders, the depth is shifted back towards the border of the splat.
+					float depth_offset = u * splat.depth_u_ + v * splat.depth_v_;
+					float depth = splat.depth_ + depth_offset + 2.0f * std::abs(depth_offset);
+
+					size_t pixel_index = y * width_ + x;
+
+					// Ties are resolved by ID so the result does not depend on the order of the bins.
+					if(depth < depth_buffer_[pixel_index] ||
+						(depth == depth_buffer_[pixel_index] && splat.id_ < id_buffer_[pixel_index]))
+					{
+						depth_buffer_[pixel_index] = depth;
+						id_buffer_[pixel_index] = splat.id_;
+					}
+				}
+			}
+		}
+
+		bin.clear();
+	}
+}
+
+const std::vector<uint32_t>& software_rasterizer::
+get_id_buffer() const
+{
+	return id_buffer_;
+}
+
+int software_rasterizer::
+get_width() const
+{
+	return width_;
+}
+
+int software_rasterizer::
+get_height() const
+{
+	return height_;
+}
+
+}
+}
@@ -61,6 +61,7 @@ initialize(int& argc, char** argv)
     unsigned int num_steps = 11;
     double oversize_factor = 1.5;
     float optimization_threshold = 1.0f;
+    unsigned int optimization_minhash_size = 0;
 
 	po::options_description desc("Usage: " + exec_name + " [OPTION]... INPUT\n\n"
                                "Allowed Options");
@@ -80,6 +81,7 @@ initialize(int& argc, char** argv)
       ("gridsize", po::value<unsigned int>(&grid_size)->default_value(1), "specify size/depth of the grid used for the visibility test (depends on chosen grid type)")
       ("oversize", po::value<double>(&oversize_factor)->default_value(1.5), "factor the grid bounds will be scaled by, default is 1.5 (grid bounds will exceed scene bounds by factor of 1.5)")
       ("optithresh", po::value<float>(&optimization_threshold)->default_value(1.0f), "specify the threshold at which common data are converged. Default is 1.0, which means data must be 100 percent equal.")
+      ("optiminhash", po::value<unsigned int>(&optimization_minhash_size)->default_value(0), "specify the number of MinHash values per view cell used during optimization of irregular grids. Default is 0, which deactivates the pre-filter.")
       ("numsteps,n", po::value<unsigned int>(&num_steps)->default_value(11), "specify the number of intervals the occlusion values will be split into (visibility analysis only)");
       ;
 
@@ -0,0 +1,558 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include "lamure/pvs/visibility_test_software_rasterizer.h"
+#include "lamure/pvs/id_histogram_flat.h"
+#include "lamure/pvs/utils.h"
+
+#include <lamure/ren/config.h>
+#include <lamure/ren/model_database.h>
+#include <lamure/ren/bvh.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+
+namespace lamure
+{
+namespace pvs
+{
+
+visibility_test_software_rasterizer::
+visibility_test_software_rasterizer()
+{
+	resolution_x_ = 1024;
+	resolution_y_ = 1024;
+	tile_size_ = 64;
+
+	error_threshold_ = LAMURE_DEFAULT_THRESHOLD;
+	visibility_threshold_ = 0.0001f;
+	far_plane_ = 1000.0f;
+}
+
+visibility_test_software_rasterizer::
+~visibility_test_software_rasterizer()
+{
+	shutdown();
+}
+
+int visibility_test_software_rasterizer::
+initialize(int& argc, char** argv)
+{
+	namespace po = boost::program_options;
+	namespace fs = boost::filesystem;
+
+	const std::string exec_name = (argc > 0) ? fs::basename(argv[0]) : "";
+
+	std::string resource_file_path = "";
+
+	// These value are read, but not used. Yet ignoring them in the terminal parameters would lead to misinterpretation.
+	std::string pvs_output_file_path = "";
+	std::string visibility_test_type = "";
+	std::string grid_type = "";
+	unsigned int grid_size = 1;
+	unsigned int num_steps = 11;
+	double oversize_factor = 1.5;
+	float optimization_threshold = 1.0f;
+	unsigned int optimization_minhash_size = 0;
+
+	po::options_description desc("Usage: " + exec_name + " [OPTION]... INPUT\n\n"
+								"Allowed Options");
+	desc.add_options()
+	  ("help", "print help message")
+	  ("width,w", po::value<int>(&resolution_x_)->default_value(1024), "specify image width (default=1024)")
+	  ("height,h", po::value<int>(&resolution_y_)->default_value(1024), "specify image height (default=1024)")
+	  ("tilesize", po::value<int>(&tile_size_)->default_value(64), "specify edge length of the tiles rasterized by one thread (default=64)")
+	  ("resource-file,f", po::value<std::string>(&resource_file_path), "specify resource input-file")
+	// The following parameters are used by the main app only, yet must be identified nonetheless since otherwise they are dealt with as file paths.
+	  ("pvs-file,p", po::value<std::string>(&pvs_output_file_path), "specify output file of calculated pvs data")
+	  ("vistest", po::value<std::string>(&visibility_test_type)->default_value("sr"), "specify type of visibility test to be used")
+	  ("gridtype", po::value<std::string>(&grid_type)->default_value("octree"), "specify type of grid to store visibility data")
+	  ("gridsize", po::value<unsigned int>(&grid_size)->default_value(1), "specify size/depth of the grid used for the visibility test (depends on chosen grid type)")
+	  ("oversize", po::value<double>(&oversize_factor)->default_value(1.5), "factor the grid bounds will be scaled by, default is 1.5 (grid bounds will exceed scene bounds by factor of 1.5)")
+	  ("optithresh", po::value<float>(&optimization_threshold)->default_value(1.0f), "specify the threshold at which common data are converged. Default is 1.0, which means data must be 100 percent equal.")
+	  ("optiminhash", po::value<unsigned int>(&optimization_minhash_size)->default_value(0), "specify the number of MinHash values per view cell used during optimization of irregular grids. Default is 0, which deactivates the pre-filter.")
+	  ("numsteps,n", po::value<unsigned int>(&num_steps)->default_value(11), "specify the number of intervals the occlusion values will be split into (visibility analysis only)");
+
+	po::variables_map vm;
+
+	try
+	{
+		auto parsed_options = po::command_line_parser(argc, argv).options(desc).allow_unregistered().run();
+		po::store(parsed_options, vm);
+		po::notify(vm);
+
+		std::vector<std::string> to_pass_further = po::collect_unrecognized(parsed_options.options, po::include_positional);
+		bool no_input = !vm.count("input") && to_pass_further.empty();
+
+		if(resource_file_path == "")
+		{
+			if(vm.count("help") || no_input)
+			{
+				std::cout << desc;
+				return 0;
+			}
+		}
+
+		// no explicit input -> use unknown options
+		if(!vm.count("input") && resource_file_path == "")
+		{
+			resource_file_path = "auto_generated.rsc";
+			std::fstream ofstr(resource_file_path, std::ios::out);
+			if(ofstr.good())
+			{
+				for(auto argument : to_pass_further)
+				{
+					ofstr << argument << std::endl;
+				}
+			}
+			else
+			{
+				throw std::runtime_error("Cannot open file");
+			}
+			ofstr.close();
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cout << "Warning: No input file specified. \n" << desc;
+		return 0;
+	}
+
+	std::pair<std::vector<std::string>, std::vector<scm::math::mat4f>> model_attributes;
+	std::set<lamure::model_t> visible_set;
+	std::set<lamure::model_t> invisible_set;
+	model_attributes = read_model_string(resource_file_path, &visible_set, &invisible_set);
+
+	std::vector<std::string> const& model_filenames = model_attributes.first;
+	model_transformations_ = model_attributes.second;
+
+	lamure::ren::model_database* database = lamure::ren::model_database::get_instance();
+
+	float scene_diameter = far_plane_;
+
+	for(const std::string& filename : model_filenames)
+	{
+		lamure::model_t model_id = database->add_model(filename, std::to_string(lod_mappings_.size()));
+		const lamure::ren::bvh* bvh = database->get_model(model_id)->get_bvh();
+
+		// Same transformation as used by the histogram renderers.
+		model_transformations_[model_id] = model_transformations_[model_id] * scm::math::make_translation(bvh->get_translation());
+
+		const scm::gl::boxf& box_model_root = bvh->get_bounding_boxes()[0];
+		scene_diameter = std::max(scm::math::length(box_model_root.max_vertex() - box_model_root.min_vertex()), scene_diameter);
+
+		// Models in the invisible set are not rendered, see Renderer::render.
+		if(invisible_set.find(model_id) == invisible_set.end() || visible_set.find(model_id) != visible_set.end())
+		{
+			rendered_models_.insert(model_id);
+		}
+
+		// Surfels are read from the mapped file, the page cache takes care of loading and evicting them.
+		std::string bvh_filename = bvh->get_filename();
+		std::string base_name = bvh_filename.substr(0, bvh_filename.find_last_of(".") + 1);
+		std::string bvh_suffix = bvh_filename.substr(base_name.size()).substr(3);
+
+		lod_mappings_.push_back(std::unique_ptr<lamure::ren::lod_mapping>(new lamure::ren::lod_mapping()));
+		lod_mappings_.back()->open(base_name + "lod" + bvh_suffix);
+	}
+
+	far_plane_ = 2.0f * scene_diameter;
+
+	// Calculate bounding box of whole scene.
+	for(lamure::model_t model_id = 0; model_id < database->num_models(); ++model_id)
+	{
+		// Cast required from boxf to bounding_box.
+		const scm::gl::boxf& box_model_root = database->get_model(model_id)->get_bvh()->get_bounding_boxes()[0];
+		vec3r min_vertex(box_model_root.min_vertex() + database->get_model(model_id)->get_bvh()->get_translation());
+		vec3r max_vertex(box_model_root.max_vertex() + database->get_model(model_id)->get_bvh()->get_translation());
+		bounding_box model_root_box(min_vertex, max_vertex);
+
+		if(model_id == 0)
+		{
+			scene_bounds_ = bounding_box(model_root_box);
+		}
+		else
+		{
+			scene_bounds_.expand(model_root_box);
+		}
+	}
+
+	return 0;
+}
+
+void visibility_test_software_rasterizer::
+test_visibility(grid* visibility_grid)
+{
+	lamure::ren::model_database* database = lamure::ren::model_database::get_instance();
+	model_t num_models = database->num_models();
+
+	std::vector<node_t> ids(num_models);
+	for(model_t model_id = 0; model_id < num_models; ++model_id)
+	{
+		ids[model_id] = database->get_model(model_id)->get_bvh()->get_num_nodes();
+	}
+
+	id_histogram_flat histogram(ids);
+	software_rasterizer rasterizer(resolution_x_, resolution_y_, tile_size_);
+
+	std::vector<std::vector<size_t>> total_depth_rendered_nodes(num_models, std::vector<size_t>(visibility_grid->get_cell_count(), 0));
+	std::vector<std::vector<size_t>> total_num_rendered_nodes(num_models, std::vector<size_t>(visibility_grid->get_cell_count(), 0));
+
+	std::vector<scm::math::mat4f> model_view_matrices(num_models);
+	std::vector<software_rasterizer::splat_node> nodes;
+
+	double total_cut_time = 0.0;
+	double total_render_time = 0.0;
+	double total_histogram_evaluation_time = 0.0;
+
+	float opening_angle = 90.0f;
+	float aspect_ratio = 1.0f;
+
+	const size_t num_cells = visibility_grid->get_cell_count();
+
+	for(unsigned short direction_counter = 0; direction_counter < 6; ++direction_counter)
+	{
+		for(size_t cell_index = 0; cell_index < num_cells; ++cell_index)
+		{
+			const view_cell* current_cell = visibility_grid->get_cell_at_index(cell_index);
+
+			scm::math::vec3d look_dir;
+			scm::math::vec3d up_dir(0.0, 1.0, 0.0);
+			float near_plane = 0.01f;
+
+			switch(direction_counter)
+			{
+				case 0:
+					look_dir = scm::math::vec3d(1.0, 0.0, 0.0);
+					near_plane = current_cell->get_size().x * 0.5f;
+					break;
+				case 1:
+					look_dir = scm::math::vec3d(-1.0, 0.0, 0.0);
+					near_plane = current_cell->get_size().x * 0.5f;
+					break;
+				case 2:
+					look_dir = scm::math::vec3d(0.0, 1.0, 0.0);
+					up_dir = scm::math::vec3d(0.0, 0.0, 1.0);
+					near_plane = current_cell->get_size().y * 0.5f;
+					break;
+				case 3:
+					look_dir = scm::math::vec3d(0.0, -1.0, 0.0);
+					up_dir = scm::math::vec3d(0.0, 0.0, 1.0);
+					near_plane = current_cell->get_size().y * 0.5f;
+					break;
+				case 4:
+					look_dir = scm::math::vec3d(0.0, 0.0, 1.0);
+					near_plane = current_cell->get_size().z * 0.5f;
+					break;
+				case 5:
+					look_dir = scm::math::vec3d(0.0, 0.0, -1.0);
+					near_plane = current_cell->get_size().z * 0.5f;
+					break;
+				default:
+					break;
+			}
+
+			scm::math::mat4d view_matrix = scm::math::make_look_at_matrix(current_cell->get_position_center(), current_cell->get_position_center() + look_dir, up_dir);
+
+			std::chrono::time_point<std::chrono::system_clock> start_time = std::chrono::system_clock::now();
+
+			nodes.clear();
+			for(model_t model_id = 0; model_id < num_models; ++model_id)
+			{
+				model_view_matrices[model_id] = scm::math::mat4f(view_matrix * scm::math::mat4d(model_transformations_[model_id]));
+
+				size_t num_cut_nodes = 0;
+				size_t total_cut_depth = 0;
+				compute_cut(model_id, model_view_matrices[model_id], opening_angle, near_plane, (uint32_t)histogram.get_bin_index(model_id, 0) + 1,
+							nodes, num_cut_nodes, total_cut_depth);
+
+				// Collect data to calculate average depth of nodes per model.
+				total_depth_rendered_nodes[model_id][cell_index] += total_cut_depth;
+				total_num_rendered_nodes[model_id][cell_index] += num_cut_nodes;
+			}
+
+			std::chrono::time_point<std::chrono::system_clock> end_time = std::chrono::system_clock::now();
+			std::chrono::duration<double> elapsed_seconds = end_time - start_time;
+			total_cut_time += elapsed_seconds.count();
+			start_time = end_time;
+
+			rasterizer.set_projection(opening_angle, aspect_ratio, near_plane, far_plane_);
+			rasterizer.render(nodes, model_view_matrices);
+
+			end_time = std::chrono::system_clock::now();
+			elapsed_seconds = end_time - start_time;
+			total_render_time += elapsed_seconds.count();
+			start_time = end_time;
+
+			// Analyze histogram data of current rendered image.
+			size_t num_pixels = resolution_x_ * resolution_y_;
+			histogram.create(rasterizer.get_id_buffer().data(), num_pixels);
+			std::map<model_t, std::vector<node_t>> visible_ids = histogram.get_visible_nodes(num_pixels, visibility_threshold_);
+
+			for(std::map<model_t, std::vector<node_t>>::iterator iter = visible_ids.begin(); iter != visible_ids.end(); ++iter)
+			{
+				for(node_t node_id : iter->second)
+				{
+					visibility_grid->set_cell_visibility(cell_index, iter->first, node_id, true);
+				}
+			}
+
+			end_time = std::chrono::system_clock::now();
+			elapsed_seconds = end_time - start_time;
+			total_histogram_evaluation_time += elapsed_seconds.count();
+
+			if((cell_index + 1) % 8 == 0 || cell_index + 1 == num_cells)
+			{
+				// Calculate current rendering state so user gets visual feedback on the preprocessing progress.
+				float total_rendering_steps = num_cells * 6;
+				float current_rendering_step = (num_cells * direction_counter) + cell_index + 1;
+				float current_percentage_done = (current_rendering_step / total_rendering_steps) * 100.0f;
+				std::cout << "\rrendering in progress [" << current_percentage_done << "]       " << std::flush;
+			}
+		}
+	}
+
+	std::cout << std::endl;
+
+	std::chrono::time_point<std::chrono::system_clock> start_time = std::chrono::system_clock::now();
+
+	// Calculate which nodes are inside the view cells based on the average depth of the nodes inside the cuts during rendering.
+	std::cout << "start check for nodes inside grid cells..." << std::endl;
+	check_for_nodes_within_cells(visibility_grid, total_depth_rendered_nodes, total_num_rendered_nodes);
+	std::cout << "node check finished" << std::endl;
+
+	// Hardcoded heresy. This grid type applies visibility propagation at runtime.
+	if(visibility_grid->get_grid_type() != "octree_hierarchical_v3")
+	{
+		// Set visibility of LOD-trees based on rendered nodes.
+		std::cout << "start visibility propagation..." << std::endl;
+		emit_node_visibility(visibility_grid);
+		std::cout << "visibility propagation finished" << std::endl;
+	}
+
+	std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - start_time;
+
+	std::cout << "cut update: " << total_cut_time << " s, rendering: " << total_render_time << " s, histogram evaluation: " << total_histogram_evaluation_time
+		<< " s, node check and propagation: " << elapsed_seconds.count() << " s" << std::endl;
+}
+
+void visibility_test_software_rasterizer::
+compute_cut(const model_t& model_id, const scm::math::mat4f& model_view_matrix, const float& opening_angle, const float& near_plane, const uint32_t& first_id,
+			std::vector<software_rasterizer::splat_node>& nodes, size_t& num_cut_nodes, size_t& total_cut_depth) const
+{
+	lamure::ren::model_database* database = lamure::ren::model_database::get_instance();
+	const lamure::ren::bvh* bvh = database->get_model(model_id)->get_bvh();
+
+	const float* mv = &model_view_matrix[0];
+	const scm::math::mat4f& model_matrix = model_transformations_[model_id];
+
+	float radius_scaling = std::sqrt(model_matrix[0] * model_matrix[0] + model_matrix[1] * model_matrix[1] + model_matrix[2] * model_matrix[2]);
+	float tan_half_angle = std::tan(opening_angle * 0.5f * 3.14159265358979f / 180.0f);
+
+	bool is_rendered = rendered_models_.find(model_id) != rendered_models_.end() &&
+		bvh->get_primitive() == lamure::ren::bvh::primitive_type::POINTCLOUD &&
+		lod_mappings_[model_id]->is_file_open();
+
+	size_t node_size = database->get_node_size(model_id);
+	uint32_t num_surfels_per_node = bvh->get_primitives_per_node();
+
+	std::vector<node_t> pending_nodes(1, 0);
+
+	while(!pending_nodes.empty())
+	{
+		node_t node_id = pending_nodes.back();
+		pending_nodes.pop_back();
+
+		// A node is outside if all corners of its bounding box are outside of the same frustum plane.
+		const scm::gl::boxf& box = bvh->get_bounding_boxes()[node_id];
+		int outside_masks = 0x1F;
+
+		for(int corner_index = 0; corner_index < 8; ++corner_index)
+		{
+			float x = (corner_index & 1) ? box.max_vertex().x : box.min_vertex().x;
+			float y = (corner_index & 2) ? box.max_vertex().y : box.min_vertex().y;
+			float z = (corner_index & 4) ? box.max_vertex().z : box.min_vertex().z;
+
+			float eye_x = mv[0] * x + mv[4] * y + mv[8] * z + mv[12];
+			float eye_y = mv[1] * x + mv[5] * y + mv[9] * z + mv[13];
+			float depth = -(mv[2] * x + mv[6] * y + mv[10] * z + mv[14]);
+
+			int corner_mask = 0;
+			corner_mask |= (depth < near_plane) ? 0x01 : 0;
+			corner_mask |= (eye_x < -depth * tan_half_angle) ? 0x02 : 0;
+			corner_mask |= (eye_x > depth * tan_half_angle) ? 0x04 : 0;
+			corner_mask |= (eye_y < -depth * tan_half_angle) ? 0x08 : 0;
+			corner_mask |= (eye_y > depth * tan_half_angle) ? 0x10 : 0;
+
+			outside_masks &= corner_mask;
+		}
+
+		bool is_inside_frustum = (outside_masks == 0);
+
+		// Same error as cut_update_pool::calculate_node_error.
+		const scm::math::vec3f& centroid = bvh->get_centroids()[node_id];
+		float depth = -(mv[2] * centroid.x + mv[6] * centroid.y + mv[10] * centroid.z + mv[14]);
+		float representative_radius = bvh->get_avg_primitive_extent(node_id) * radius_scaling;
+		float error = std::abs(representative_radius * (float)resolution_y_ / (depth * tan_half_angle));
+
+		node_t first_child_id = bvh->get_child_id(node_id, 0);
+
+		// Nodes outside of the frustum are kept but not rendered.
+		if(is_inside_frustum && error > error_threshold_ && first_child_id < bvh->get_num_nodes())
+		{
+			for(uint32_t child_index = 0; child_index < bvh->get_fan_factor(); ++child_index)
+			{
+				node_t child_id = bvh->get_child_id(node_id, child_index);
+
+				if(child_id < bvh->get_num_nodes())
+				{
+					pending_nodes.push_back(child_id);
+				}
+			}
+
+			continue;
+		}
+
+		++num_cut_nodes;
+		total_cut_depth += bvh->get_depth_of_node(node_id);
+
+		if(is_inside_frustum && is_rendered)
+		{
+			software_rasterizer::splat_node node;
+			node.surfels_ = (const lamure::ren::dataset::serialized_surfel*)(lod_mappings_[model_id]->data() + bvh->get_file_index(node_id) * node_size);
+			node.num_surfels_ = num_surfels_per_node;
+			node.id_ = first_id + node_id;
+			node.transform_index_ = model_id;
+			nodes.push_back(node);
+		}
+	}
+}
+
+void visibility_test_software_rasterizer::
+check_for_nodes_within_cells(grid* visibility_grid, const std::vector<std::vector<size_t>>& total_depths, const std::vector<std::vector<size_t>>& total_nums) const
+{
+	lamure::ren::model_database* database = lamure::ren::model_database::get_instance();
+
+	for(model_t model_index = 0; model_index < database->num_models(); ++model_index)
+	{
+		const lamure::ren::bvh* bvh = database->get_model(model_index)->get_bvh();
+
+		for(size_t cell_index = 0; cell_index < visibility_grid->get_cell_count(); ++cell_index)
+		{
+			// Create bounding box of view cell.
+			const view_cell* current_cell = visibility_grid->get_cell_at_index(cell_index);
+
+			vec3r min_vertex(current_cell->get_position_center() - (current_cell->get_size() * 0.5f));
+			vec3r max_vertex(current_cell->get_position_center() + (current_cell->get_size() * 0.5f));
+			bounding_box cell_bounds(min_vertex, max_vertex);
+
+			if(total_nums[model_index][cell_index] == 0)
+			{
+				continue;
+			}
+
+			// We can get the first and last index of the nodes on a certain depth inside the bvh.
+			unsigned int average_depth = total_depths[model_index][cell_index] / total_nums[model_index][cell_index];
+
+			node_t start_index = bvh->get_first_node_id_of_depth(average_depth);
+			node_t end_index = start_index + bvh->get_length_of_depth(average_depth);
+
+			for(node_t node_index = start_index; node_index < end_index; ++node_index)
+			{
+				// Create bounding box of node.
+				scm::gl::boxf node_bounding_box = bvh->get_bounding_boxes()[node_index];
+				vec3r node_min_vertex = vec3r(node_bounding_box.min_vertex()) + bvh->get_translation();
+				vec3r node_max_vertex = vec3r(node_bounding_box.max_vertex()) + bvh->get_translation();
+				bounding_box node_bounds(node_min_vertex, node_max_vertex);
+
+				// check if the bounding boxes collide.
+				if(cell_bounds.intersects(node_bounds))
+				{
+					visibility_grid->set_cell_visibility(cell_index, model_index, node_index, true);
+				}
+			}
+		}
+	}
+}
+
+void visibility_test_software_rasterizer::
+emit_node_visibility(grid* visibility_grid) const
+{
+	lamure::ren::model_database* database = lamure::ren::model_database::get_instance();
+
+	// Advance node visibility downwards and upwards in the LOD-hierarchy.
+	// Since only a single LOD-level was rendered in the visibility test, this is necessary to produce a complete PVS.
+	#pragma omp parallel for schedule(dynamic, 1)
+	for(size_t cell_index = 0; cell_index < visibility_grid->get_cell_count(); ++cell_index)
+	{
+		const view_cell* current_cell = visibility_grid->get_cell_at_index(cell_index);
+		std::map<model_t, std::vector<node_t>> visible_indices = current_cell->get_visible_indices();
+
+		for(std::map<model_t, std::vector<node_t>>::const_iterator map_iter = visible_indices.begin(); map_iter != visible_indices.end(); ++map_iter)
+		{
+			model_t model_id = map_iter->first;
+			const lamure::ren::bvh* bvh = database->get_model(model_id)->get_bvh();
+
+			for(node_t visible_node_id : map_iter->second)
+			{
+				// Parents of a visible node are visible, too.
+				node_t parent_id = bvh->get_parent_id(visible_node_id);
+
+				while(parent_id != lamure::invalid_node_t && !current_cell->get_visibility(model_id, parent_id))
+				{
+					visibility_grid->set_cell_visibility(cell_index, model_id, parent_id, true);
+					parent_id = bvh->get_parent_id(parent_id);
+				}
+
+				// Children of a visible node are visible, too.
+				std::vector<node_t> pending_nodes(1, visible_node_id);
+
+				while(!pending_nodes.empty())
+				{
+					node_t node_id = pending_nodes.back();
+					pending_nodes.pop_back();
+
+					for(uint32_t child_index = 0; child_index < bvh->get_fan_factor(); ++child_index)
+					{
+						node_t child_id = bvh->get_child_id(node_id, child_index);
+
+						if(child_id < bvh->get_num_nodes() && !current_cell->get_visibility(model_id, child_id))
+						{
+							visibility_grid->set_cell_visibility(cell_index, model_id, child_id, true);
+							pending_nodes.push_back(child_id);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void visibility_test_software_rasterizer::
+shutdown()
+{
+	if(!lod_mappings_.empty())
+	{
+		lod_mappings_.clear();
+		delete lamure::ren::model_database::get_instance();
+	}
+}
+
+bounding_box visibility_test_software_rasterizer::
+get_scene_bounds() const
+{
+	return scene_bounds_;
+}
+
+}
+}
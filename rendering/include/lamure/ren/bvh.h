@@ -58,6 +58,7 @@ public:
     const uint32_t      get_size_of_primitive() const { return size_of_primitive_; }
     const vec3f         get_translation() const { return translation_; }
     const std::vector<scm::gl::boxf>& get_bounding_boxes() const { return bounding_boxes_; }
+    const std::vector<float>& get_avg_primitive_extents() const { return avg_primitive_extent_; }
     const std::vector<vec3f>& get_centroids() const { return centroids_; };
     const scm::gl::boxf& get_bounding_box(const node_t node_id) const; 
     const scm::math::vec3f& get_centroid(const node_t node_id) const;
@@ -65,6 +66,17 @@ public:
     const float         get_max_surfel_radius_deviation(const node_t node_id) const;
     const node_visibility get_visibility(const node_t node_id) const;
     const primitive_type get_primitive() const { return primitive_; }
+
+    //position of a node in the .lod and .prov files, nodes are stored
+    //in implicit bfs order unless the file carries a node layout
+    const node_t        get_file_index(const node_t node_id) const { return file_indices_.empty() ? node_id : file_indices_[node_id]; }
+    const bool          has_node_layout() const { return !file_indices_.empty(); }
+    const std::vector<node_t>& get_file_indices() const { return file_indices_; }
+
+    //error of the simplification that produced a node, written by the
+    //preprocessing and only carried along for file conversion
+    const float         get_reduction_error(const node_t node_id) const { return reduction_errors_.empty() ? 0.f : reduction_errors_[node_id]; }
+    const bool          has_reduction_errors() const { return !reduction_errors_.empty(); }
     
     void                set_num_nodes(const uint32_t num_nodes) { num_nodes_ = num_nodes; }
     void                set_fan_factor(const uint32_t fan_factor) { fan_factor_ = fan_factor; }
@@ -78,6 +90,8 @@ public:
     void                set_max_surfel_radius_deviation(const node_t node_id, const float max_radius_deviation);
     void                set_visibility(const node_t node_id, const node_visibility visibility);
     void                set_primitive(const primitive_type primitive) { primitive_ = primitive; };
+    void                set_file_indices(const std::vector<node_t>& file_indices) { file_indices_ = file_indices; };
+    void                set_reduction_errors(const std::vector<float>& reduction_errors) { reduction_errors_ = reduction_errors; };
 
     void                write_bvh_file(const std::string& filename);
 
@@ -85,6 +99,8 @@ protected:
 
     void                load_bvh_file(const std::string& filename);
 
+    friend class        bvh_stream;
+
 private:
 
     uint32_t            num_nodes_;
@@ -100,6 +116,9 @@ private:
     std::vector<float>  avg_primitive_extent_;
     std::vector<float>  max_primitive_extent_deviation_; //new for radius quantization
 
+    std::vector<node_t> file_indices_; //empty for bfs layout
+    std::vector<float>  reduction_errors_; //empty if the file had none
+
     std::string         filename_;
 
     vec3f               translation_;
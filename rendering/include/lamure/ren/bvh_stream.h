@@ -19,6 +19,7 @@
 #include <scm/gl_core/primitives/box.h>
 
 #include <lamure/ren/bvh.h>
+#include <lamure/bvh_v3.h>
 
 namespace lamure {
 namespace ren {
@@ -41,6 +42,8 @@ public:
 
     void read_bvh(const std::string& filename, bvh& bvh);
     void write_bvh(const std::string& filename, bvh& bvh);
+    //version 3 layout, see lamure/bvh_v3.h
+    void write_bvh_v3(const std::string& filename, bvh& bvh, const bool compress);
 
 
 protected:
@@ -442,6 +445,58 @@ protected:
     };
 
 
+    //maps every node id to its index in the .lod and .prov files
+    class bvh_node_layout_seg : public bvh_serializable {
+    public:
+        bvh_node_layout_seg()
+        : bvh_serializable() {};
+        ~bvh_node_layout_seg() {};
+
+        uint32_t segment_id_;
+        uint32_t num_nodes_;
+        uint64_t reserved_;
+        std::vector<uint32_t> file_indices_;
+
+    protected:
+        friend class bvh_stream;
+        const size_t size() const {
+            return 4*sizeof(uint32_t) + num_nodes_*sizeof(uint32_t);
+        };
+        void signature(char* signature) {
+            signature[0] = 'B';
+            signature[1] = 'V';
+            signature[2] = 'H';
+            signature[3] = 'X';
+            signature[4] = 'L';
+            signature[5] = 'A';
+            signature[6] = 'Y';
+            signature[7] = 'T';
+        }
+        void serialize(std::fstream& file) {
+            if (!file.is_open()) {
+               throw std::runtime_error(
+                   "PLOD: bvh_stream::Unable to serialize");
+            }
+            file.write((char*)&segment_id_, 4);
+            file.write((char*)&num_nodes_, 4);
+            file.write((char*)&reserved_, 8);
+            file.write((char*)&file_indices_[0], num_nodes_*sizeof(uint32_t));
+        }
+        void deserialize(std::fstream& file) {
+            if (!file.is_open()) {
+               throw std::runtime_error(
+                   "PLOD: bvh_stream::Unable to deserialize");
+            }
+            file.read((char*)&segment_id_, 4);
+            file.read((char*)&num_nodes_, 4);
+            file.read((char*)&reserved_, 8);
+            file_indices_.resize(num_nodes_);
+            file.read((char*)&file_indices_[0], num_nodes_*sizeof(uint32_t));
+        }
+
+    };
+
+
     class bvh_tree_extension_seg: public bvh_serializable
     {
     public:
@@ -537,6 +592,8 @@ protected:
     };
 
     
+    void read_bvh_v3(const std::string& filename, bvh& bvh);
+
     void open_stream(const std::string& bvh_filename,
                     const bvh_stream_type type);
     void close_stream(const bool remove_file);    
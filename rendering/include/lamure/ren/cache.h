@@ -49,6 +49,9 @@ public:
     void                release_node(const context_t context_id, const view_t view_id, const model_t model_id, const node_t node_id);
     const bool          release_node_invalidate(const context_t context_id, const view_t view_id, const model_t model_id, const node_t node_id);
 
+    void                set_node_priority(const model_t model_id, const node_t node_id, const float priority);
+    const replacement_policy_t replacement_policy() const { return index_->replacement_policy(); };
+
 protected:
                         cache(const slot_t num_slots);
 
@@ -12,6 +12,7 @@
 #include <lamure/utils.h>
 #include <lamure/ren/config.h>
 #include <lamure/ren/platform.h>
+#include <lamure/ren/cache_replacement_policy.h>
 
 #include <vector>
 #include <set>
@@ -27,7 +28,8 @@ namespace ren {
 class RENDERING_DLL cache_index
 {
 public:
-                        cache_index(const model_t num_models, const slot_t num_slots);
+                        cache_index(const model_t num_models, const slot_t num_slots,
+                                    const replacement_policy_t replacement_policy = replacement_policy_t::LRU);
     virtual             ~cache_index();
 
     const slot_t        num_slots() const { return num_slots_; };
@@ -41,10 +43,22 @@ public:
     const bool          is_node_indexed(const model_t model_id, const node_t node_id);
     const bool          is_node_aquired(const model_t model_id, const node_t node_id);
 
+    //collects all nodes that are aquired by at least one view
+    //in a single pass, slot ids are external
+    void                get_aquired_nodes(std::vector<model_t>& model_ids,
+                                          std::vector<node_t>& node_ids,
+                                          std::vector<slot_t>& slot_ids);
+
     void                aquire_slot(const view_t view_id, const model_t model_id, const node_t node_id);
     void                release_slot(const view_t view_id, const model_t model_id, const node_t node_id);
     const bool          release_slot_invalidate(const view_t view_id, const model_t model_id, const node_t node_id);
 
+    //retention priority of an indexed node, used by the
+    //screen-space error and distance replacement policies
+    void                set_priority(const model_t model_id, const node_t node_id, const float priority);
+
+    const replacement_policy_t replacement_policy() const { return replacement_policy_type_; };
+
 private:
 
     model_t             num_models_;
@@ -62,23 +76,57 @@ private:
             : model_id_(model_id),
             node_id_(node_id),
             prev_(prev),
-            next_(next) {};
+            next_(next),
+            views_(0),
+            priority_(0.f) {};
 
         cache_index_node()
             : model_id_(invalid_model_t),
             node_id_(invalid_node_t),
             prev_(invalid_slot_t),
-            next_(invalid_slot_t) {};
+            next_(invalid_slot_t),
+            views_(0),
+            priority_(0.f) {};
 
         model_t         model_id_;
         node_t          node_id_;
         slot_t          prev_;
         slot_t          next_;
-        std::set<view_t> views_;
+        uint64_t        views_;
+        float           priority_;
     };
 
+    //registers view_id at a slot, returns false if it was registered already.
+    //views own a bit in cache_index_node::views_ while they hold slots,
+    //views beyond the 64 bits are kept in overflow_views_
+    const bool          add_view(const slot_t slot_id, const view_t view_id);
+    //unregisters view_id from a slot, never registers a new view.
+    //returns false if the view was not registered at the slot
+    const bool          remove_view(const slot_t slot_id, const view_t view_id);
+    const bool          is_aquired(const slot_t slot_id) const;
+
+    //linked list maintenance, internal slot ids
+    void                link_head(const slot_t slot_id);
+    void                link_tail(const slot_t slot_id);
+    void                unlink(const slot_t slot_id);
+
     std::mutex          mutex_;
 
+    replacement_policy_t replacement_policy_type_;
+    cache_replacement_policy* replacement_policy_;
+    uint64_t            tick_;
+
+    struct view_record
+    {
+        //0 if the view lives in overflow_views_
+        uint64_t        bit_;
+        size_t          num_aquired_;
+    };
+
+    std::unordered_map<view_t, view_record> view_records_;
+    uint64_t            free_view_bits_;
+    std::unordered_map<slot_t, std::set<view_t>> overflow_views_;
+
     std::vector<cache_index_node> slots_;
     std::vector<std::map<node_t, slot_t>> maps_;
 };
@@ -0,0 +1,121 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_CACHE_REPLACEMENT_POLICY_H_
+#define REN_CACHE_REPLACEMENT_POLICY_H_
+
+#include <lamure/types.h>
+#include <lamure/ren/platform.h>
+
+#include <vector>
+#include <set>
+#include <string>
+
+namespace lamure {
+namespace ren {
+
+enum class replacement_policy_t
+{
+    LRU,                //evict least recently released slot (cache_index free list)
+    LRU_K,              //evict slot with oldest k-th most recent request
+    SCREEN_SPACE_ERROR, //evict slot with lowest screen-space error
+    DISTANCE            //evict slot farthest away from any camera
+};
+
+const std::string       replacement_policy_name(const replacement_policy_t policy);
+const bool              parse_replacement_policy(const std::string& name, replacement_policy_t& policy);
+
+//ranks the slots of a cache_index that hold a valid node
+//but are not aquired by any view. slot ids are cache_index internal ids.
+class RENDERING_DLL cache_replacement_policy
+{
+public:
+                        cache_replacement_policy(const slot_t num_slots);
+    virtual             ~cache_replacement_policy();
+
+    static cache_replacement_policy* create(const replacement_policy_t policy, const slot_t num_slots);
+
+    //slot became evictable
+    void                insert(const slot_t slot_id, const uint64_t tick, const float priority);
+    //slot is aquired, reserved or invalidated
+    void                remove(const slot_t slot_id);
+    //returns invalid_slot_t if no slot is evictable
+    const slot_t        select_victim() const;
+
+    //node in slot was aquired by a view
+    virtual void        touch(const slot_t slot_id, const uint64_t tick) {};
+    //slot was applied to a new node
+    virtual void        clear(const slot_t slot_id) {};
+
+    void                update_priority(const slot_t slot_id, const float priority);
+
+protected:
+    struct rank
+    {
+        rank() : primary_(0.0), secondary_(0), slot_id_(invalid_slot_t) {};
+        rank(const double primary, const uint64_t secondary, const slot_t slot_id)
+            : primary_(primary), secondary_(secondary), slot_id_(slot_id) {};
+
+        bool operator<(const rank& other) const {
+            if (primary_ != other.primary_) return primary_ < other.primary_;
+            if (secondary_ != other.secondary_) return secondary_ < other.secondary_;
+            return slot_id_ < other.slot_id_;
+        };
+
+        double          primary_;
+        uint64_t        secondary_;
+        slot_t          slot_id_;
+    };
+
+    //lowest rank is evicted first
+    virtual const rank  compute_rank(const slot_t slot_id, const uint64_t tick, const float priority) const = 0;
+
+private:
+    std::set<rank>      ranking_;
+    std::vector<rank>   ranks_;
+    std::vector<uint64_t> ticks_;
+    std::vector<bool>   ranked_;
+
+};
+
+class RENDERING_DLL lru_k_replacement_policy : public cache_replacement_policy
+{
+public:
+                        lru_k_replacement_policy(const slot_t num_slots, const uint32_t k);
+    virtual             ~lru_k_replacement_policy() {};
+
+    virtual void        touch(const slot_t slot_id, const uint64_t tick);
+    virtual void        clear(const slot_t slot_id);
+
+protected:
+    virtual const rank  compute_rank(const slot_t slot_id, const uint64_t tick, const float priority) const;
+
+private:
+    uint32_t            k_;
+
+    //ring buffer of the last k request ticks per slot
+    std::vector<uint64_t> history_;
+    std::vector<uint32_t> num_requests_;
+};
+
+//ranks by the priority reported via cache_index::set_priority,
+//i.e. the screen-space error or the negative camera distance
+class RENDERING_DLL priority_replacement_policy : public cache_replacement_policy
+{
+public:
+                        priority_replacement_policy(const slot_t num_slots) : cache_replacement_policy(num_slots) {};
+    virtual             ~priority_replacement_policy() {};
+
+protected:
+    virtual const rank  compute_rank(const slot_t slot_id, const uint64_t tick, const float priority) const;
+};
+
+
+} } // namespace lamure
+
+
+#endif // REN_CACHE_REPLACEMENT_POLICY_H_
@@ -84,6 +84,13 @@ namespace ren {
 //#define LAMURE_CUT_UPDATE_ENABLE_CACHE_MAINTENANCE
 #define LAMURE_CUT_UPDATE_CACHE_MAINTENANCE_COUNTER 500
 
+//------------------------------
+//for cache_index:
+//------------------------------
+
+//number of past requests tracked by the lru_k replacement policy
+#define LAMURE_CACHE_REPLACEMENT_LRU_K 2
+
 //------------------------------
 //for ooc_pool:
 //------------------------------
@@ -100,6 +107,18 @@ namespace ren {
 //------------------------------
 #define LAMURE_WYSIWYG_SPLAT_SCALE 1.3f
 
+//number of rays that traverse a bvh together (at most 32)
+#define LAMURE_RAY_PACKET_SIZE 16
+
+//levels of the per-packet traversal stack, deeper nodes are not descended
+#define LAMURE_RAY_SHORT_STACK_SIZE 64
+
+//rays per batch chunk, the ooc_cache lock is released between chunks
+#define LAMURE_RAY_BATCH_CHUNK_SIZE 65536
+
+//worker threads of the ray_pool, 0 selects one per hardware thread
+#define LAMURE_RAY_POOL_NUM_THREADS 0
+
 #ifdef LAMURE_CUT_UPDATE_ENABLE_CUT_UPDATE_EXPERIMENTAL_MODE
 #undef LAMURE_CUT_UPDATE_ENABLE_SPLIT_AGAIN_MODE
 #endif
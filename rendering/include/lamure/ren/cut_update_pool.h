@@ -24,6 +24,7 @@
 #include <lamure/ren/cut.h>
 #include <lamure/ren/cut_update_index.h>
 #include <lamure/ren/cut_update_queue.h>
+#include <lamure/ren/node_batch.h>
 #include <lamure/ren/gpu_cache.h>
 #include <lamure/ren/ooc_cache.h>
 
@@ -34,6 +35,18 @@ namespace ren
 class cut_update_pool
 {
   public:
+    struct statistics
+    {
+        statistics() : num_splits_(0), num_collapses_(0), ooc_cache_hits_(0), ooc_cache_misses_(0), gpu_cache_hits_(0), gpu_cache_misses_(0){};
+
+        size_t num_splits_;
+        size_t num_collapses_;
+        size_t ooc_cache_hits_;
+        size_t ooc_cache_misses_;
+        size_t gpu_cache_hits_;
+        size_t gpu_cache_misses_;
+    };
+
     cut_update_pool(const context_t context_id, const node_t upload_budget_in_nodes, const node_t render_budget_in_nodes, Data_Provenance const &data_provenance);
     cut_update_pool(const context_t context_id, const node_t upload_budget_in_nodes, const node_t render_budget_in_nodes);
     virtual ~cut_update_pool();
@@ -44,6 +57,9 @@ class cut_update_pool
     // void                    dispatch_cut_update(char* current_gpu_storage_A, char* current_gpu_storage_B);
     const bool is_running();
 
+    // counters of the most recently completed cut update
+    const statistics get_statistics();
+
   protected:
     void initialize(bool provenance = false);
     const bool prepare();
@@ -52,11 +68,14 @@ class cut_update_pool
     void collapse_node(const cut_update_index::action &item);
     void cut_update_split_again(const cut_update_index::action &split_action);
 
+    // true if no child would have to be collapsed right after a split
+    const bool is_split_predicted(const bvh *bvh, const node_batch &batch, const std::vector<node_t> &children, const float min_error_threshold);
     const bool is_all_nodes_in_cut(const model_t model_id, const std::vector<node_t> &node_ids, const std::set<node_t> &cut);
     const bool is_node_in_frustum(const view_t view_id, const model_t model_id, const node_t node_id, const scm::gl::frustum &frustum);
     const bool is_no_node_in_frustum(const view_t view_id, const model_t model_id, const std::vector<node_t> &node_ids, const scm::gl::frustum &frustum);
 
     const float calculate_node_error(const view_t view_id, const model_t model_id, const node_t node_id);
+    const float calculate_node_distance(const view_t view_id, const model_t model_id, const node_t node_id);
 
     /*virtual*/ void run();
     void shutdown();
@@ -131,6 +150,9 @@ class cut_update_pool
 
     semaphore master_semaphore_;
     bool master_dispatched_;
+
+    statistics statistics_;
+    statistics last_statistics_;
 };
 }
 } // namespace lamure
@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <fstream>
+#include <memory>
 #include <sstream>
 
 #include <lamure/utils.h>
@@ -17,6 +18,7 @@
 #include <lamure/ren/platform.h>
 #include <lamure/ren/bvh.h>
 #include <lamure/ren/config.h>
+#include <lamure/ren/provenance_index.h>
 #include <scm/gl_core/primitives/box.h>
 
 namespace lamure {
@@ -54,7 +56,7 @@ public:
     };
 
 
-                        dataset() {};
+                        dataset() : provenance_index_(nullptr) {};
                         dataset(const std::string& filename);
     virtual             ~dataset();
 
@@ -62,6 +64,14 @@ public:
     const scm::gl::boxf& aabb() const { return aabb_; };
     const bool          is_loaded() const { return is_loaded_; };
     const bvh*          get_bvh() const { return bvh_; };
+    // null if the model has no .pidx sidecar
+    const provenance_index* get_provenance_index() const { return provenance_index_; };
+
+    // the cut update does not refine nodes whose subtree can't satisfy all
+    // predicates, no predicates disable the filter
+    void                set_provenance_filter(const std::vector<provenance_index::predicate>& predicates);
+    // null if nothing is filtered
+    std::shared_ptr<const std::vector<bool>> get_provenance_skip_mask() const;
     
     void                set_transform(const scm::math::mat4f& transform) { transform_ = transform; };
     const scm::math::mat4f transform() const { return transform_; };
@@ -76,6 +86,8 @@ private:
     scm::gl::boxf       aabb_;
     bool                is_loaded_;
     bvh*                bvh_;
+    provenance_index*   provenance_index_;
+    std::shared_ptr<const std::vector<bool>> provenance_skip_mask_;
 
     scm::math::mat4f    transform_;
 
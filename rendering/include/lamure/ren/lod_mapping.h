@@ -0,0 +1,59 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_LOD_MAPPING_H_
+#define REN_LOD_MAPPING_H_
+
+#include <string>
+#include <vector>
+
+#include <lamure/ren/platform.h>
+#include <lamure/utils.h>
+#include <lamure/ren/config.h>
+
+namespace lamure {
+namespace ren
+{
+
+//read-only memory mapping of a .lod or .prov file.
+//all processes mapping the same file share the kernel page cache,
+//residency is queried with mincore instead of keeping private copies.
+//on windows the file is read into a private buffer instead
+class RENDERING_DLL lod_mapping
+{
+public:
+                        lod_mapping();
+                        lod_mapping(const lod_mapping&) = delete;
+                        lod_mapping& operator=(const lod_mapping&) = delete;
+    virtual             ~lod_mapping();
+
+    void                open(const std::string& file_name);
+    void                close();
+    const bool          is_file_open() const { return data_ != nullptr; };
+    const std::string&  file_name() const { return file_name_; };
+
+    char*               data() const { return data_; };
+    const size_t        size() const { return size_; };
+
+    //true if all pages of the range are in the page cache
+    static const bool   is_resident(const char* const begin, const size_t length_in_bytes);
+    //asynchronous readahead of the range
+    static void         will_need(const char* const begin, const size_t length_in_bytes);
+    //faults in every page of the range, blocks until resident
+    static void         touch(const char* const begin, const size_t length_in_bytes);
+
+private:
+    std::string         file_name_;
+    char*               data_;
+    size_t              size_;
+    bool                mapped_;
+    std::vector<char>   buffer_;
+};
+
+} } // namespace lamure
+
+#endif // REN_LOD_MAPPING_H_
@@ -9,6 +9,8 @@
 #define REN_MODEL_DATABASE_H_
 
 #include <unordered_map>
+#include <vector>
+#include <string>
 #include <mutex>
 
 #include <lamure/utils.h>
@@ -33,6 +35,8 @@ public:
     static model_database* get_instance();
 
     const model_t       add_model(const std::string& filepath, const std::string& model_key);
+    //loads the bvh files in parallel and signals a single system reset
+    const std::vector<model_t> add_models(const std::vector<std::string>& filepaths, const std::vector<std::string>& model_keys);
     dataset*            get_model(const model_t model_id);
     void                apply();
 
@@ -53,6 +57,8 @@ protected:
     static model_database* single_;
 
 private:
+    const model_t       register_model(dataset* model, const std::string& filepath, const std::string& model_key);
+
     static std::mutex   mutex_;
 
     std::unordered_map<model_t, dataset*> datasets_;
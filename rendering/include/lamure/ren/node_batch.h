@@ -0,0 +1,58 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_NODE_BATCH_H_
+#define REN_NODE_BATCH_H_
+
+#include <lamure/types.h>
+#include <lamure/ren/platform.h>
+#include <lamure/ren/bvh.h>
+
+#include <scm/core/math.h>
+
+#include <vector>
+
+namespace lamure {
+namespace ren {
+
+//evaluates frustum visibility and lod error for groups of nodes of one
+//model as seen from one view. all matrix work is done once on construction,
+//the per-node work reads straight from the bvh arrays (4 nodes per sse pass).
+class RENDERING_DLL node_batch
+{
+public:
+                        node_batch();
+                        node_batch(const scm::math::mat4f& model_matrix,
+                                   const scm::math::mat4f& view_matrix,
+                                   const scm::math::mat4f& projection_matrix,
+                                   const float near_plane,
+                                   const float height_divided_by_top_minus_bottom);
+
+    //same as cut_update_pool::calculate_node_error for every node
+    void                calculate_errors(const bvh* bvh, const std::vector<node_t>& node_ids, std::vector<float>& errors) const;
+    //true if the bounding box of the node is not entirely outside the frustum
+    void                cull(const bvh* bvh, const std::vector<node_t>& node_ids, std::vector<bool>& in_frustum) const;
+
+    const float         calculate_error(const bvh* bvh, const node_t node_id) const;
+    const bool          is_in_frustum(const bvh* bvh, const node_t node_id) const;
+
+private:
+    //third row of view * model, yields the view space depth of a centroid
+    float               depth_row_[4];
+    //2 * radius scaling * near plane * height_divided_by_top_minus_bottom
+    float               error_scale_;
+    //model space frustum planes (left, right, bottom, top, near, far),
+    //a point is inside if dot(plane.xyz, p) + plane.w >= 0
+    float               planes_[6][4];
+
+};
+
+
+} } // namespace lamure
+
+
+#endif // REN_NODE_BATCH_H_
@@ -40,6 +40,10 @@ class RENDERING_DLL ooc_cache : public cache
 
     const bool is_node_resident_and_aquired(const model_t model_id, const node_t node_id);
 
+    // data of all aquired nodes, collected with one pass over the index.
+    // the pointers stay valid as long as the caller holds lock()
+    void get_aquired_node_data(std::vector<model_t> &model_ids, std::vector<node_t> &node_ids, std::vector<char *> &data);
+
     void refresh();
 
     void lock_pool();
@@ -47,6 +51,9 @@ class RENDERING_DLL ooc_cache : public cache
 
     void begin_measure();
     void end_measure();
+    const size_t bytes_loaded();
+
+    const bool is_memory_mapped() const { return memory_mapped_; };
 
   protected:
     ooc_cache(const size_t num_slots);
@@ -57,8 +64,20 @@ class RENDERING_DLL ooc_cache : public cache
   private:
     static std::mutex mutex_;
 
+    void map_model_files(const bool provenance);
+    // nullptr if the node lies outside of the mapped file
+    char *node_data_mapped(const model_t model_id, const node_t node_id);
+    char *node_data_provenance_mapped(const model_t model_id, const node_t node_id);
+
     char *cache_data_;
     char *cache_data_provenance_;
+
+    // with policy::out_of_core_memory_mapped, node data is served
+    // from shared read-only mappings instead of cache_data_
+    bool memory_mapped_;
+    std::vector<lod_mapping *> lod_mappings_;
+    std::vector<lod_mapping *> provenance_mappings_;
+
     uint32_t maintenance_counter_;
     ooc_pool *pool_;
 };
@@ -29,6 +29,7 @@
 #include <lamure/ren/config.h>
 #include <lamure/ren/model_database.h>
 #include <lamure/ren/lod_stream.h>
+#include <lamure/ren/lod_mapping.h>
 #include <lamure/ren/cache_queue.h>
 #include <lamure/ren/cache_index.h>
 
@@ -38,11 +39,18 @@ namespace ren {
 class ooc_pool
 {
   public:
-    ooc_pool(const uint32_t num_loader_threads, const size_t size_of_slot_in_bytes);
-    ooc_pool(const uint32_t num_loader_threads, const size_t size_of_slot_in_bytes, const size_t size_of_slot_provenance_, Data_Provenance const &data_provenance);
+    // if memory_mapped is set, job slot memory points into read-only mappings
+    // of the .lod/.prov files and loading only faults in the pages
+    ooc_pool(const uint32_t num_loader_threads, const size_t size_of_slot_in_bytes, const bool memory_mapped = false);
+    ooc_pool(const uint32_t num_loader_threads, const size_t size_of_slot_in_bytes, const size_t size_of_slot_provenance_, Data_Provenance const &data_provenance,
+             const bool memory_mapped = false);
     /*virtual*/ ~ooc_pool();
 
     const uint32_t num_threads() const { return num_threads_; };
+    const bool is_memory_mapped() const { return memory_mapped_; };
+
+    static const std::string lod_file_name(const model_t model_id);
+    static const std::string provenance_file_name(const model_t model_id);
 
     bool acknowledge_request(cache_queue::job job);
     void acknowledge_update(const model_t model_id, const node_t node_id, int32_t priority);
@@ -57,6 +65,7 @@ class ooc_pool
 
     void begin_measure();
     void end_measure();
+    const size_t bytes_loaded();
 
   protected:
     void run();
@@ -73,6 +82,7 @@ class ooc_pool
     std::vector<std::thread> threads_;
 
     bool shutdown_;
+    bool memory_mapped_;
 
     size_t bytes_loaded_;
 
@@ -11,6 +11,7 @@
 #include <mutex>
 
 #include <lamure/ren/platform.h>
+#include <lamure/ren/cache_replacement_policy.h>
 #include <lamure/utils.h>
 #include <lamure/types.h>
 #include <lamure/memory.h>
@@ -33,12 +34,17 @@ public:
     void                set_render_budget_in_mb(const size_t render_budget) { render_budget_in_mb_ = render_budget; };
     void                set_out_of_core_budget_in_mb(const size_t out_of_core_budget) { out_of_core_budget_in_mb_ = out_of_core_budget; };
     void                set_size_of_provenance(const size_t size_of_provenance) { size_of_provenance_ = size_of_provenance; };
+    void                set_out_of_core_memory_mapped(const bool out_of_core_memory_mapped) { out_of_core_memory_mapped_ = out_of_core_memory_mapped; };
 
     const bool          reset_system() const { return reset_system_; };
     const size_t        max_upload_budget_in_mb() const { return max_upload_budget_in_mb_; };
     const size_t        render_budget_in_mb() const { return render_budget_in_mb_; };
     const size_t        out_of_core_budget_in_mb() const { return out_of_core_budget_in_mb_; };
     const size_t        size_of_provenance() const { return size_of_provenance_; };
+    const bool          out_of_core_memory_mapped() const { return out_of_core_memory_mapped_; };
+
+    void                set_cache_replacement_policy(const replacement_policy_t replacement_policy) { cache_replacement_policy_ = replacement_policy; };
+    const replacement_policy_t cache_replacement_policy() const { return cache_replacement_policy_; };
 
     const int32_t       window_width() const { return window_width_; };
     const int32_t       window_height() const { return window_height_; };
@@ -63,6 +69,9 @@ private:
     size_t              out_of_core_budget_in_mb_;
 
     size_t              size_of_provenance_;
+    bool                out_of_core_memory_mapped_;
+
+    replacement_policy_t cache_replacement_policy_;
 
     int32_t             window_width_;
     int32_t             window_height_;
@@ -0,0 +1,93 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_PROVENANCE_INDEX_H_
+#define REN_PROVENANCE_INDEX_H_
+
+#include <string>
+#include <vector>
+
+#include <lamure/types.h>
+#include <lamure/ren/platform.h>
+
+namespace lamure {
+namespace ren
+{
+
+// Per-node summaries of the provenance attributes, read from the .pidx
+// sidecar written by the preprocessing. Attributes are the float values of a
+// provenance record in file order.
+class RENDERING_DLL provenance_index
+{
+public:
+    // keeps surfels whose attribute value lies in [min_, max_], use
+    // -/+ std::numeric_limits<float>::max() for open bounds
+    struct predicate
+    {
+        uint32_t attribute_;
+        float min_;
+        float max_;
+    };
+
+    struct summary
+    {
+        float min_;
+        float max_;
+        uint32_t count_;
+        // bit per histogram bin holding at least one value
+        uint32_t occupied_bins_;
+    };
+
+    static const uint32_t magic = 0x58444950u; // "PIDX"
+    static const uint32_t version = 1;
+    static const uint32_t max_num_bins = 32;
+
+                        provenance_index();
+                        provenance_index(const provenance_index&) = delete;
+                        provenance_index& operator=(const provenance_index&) = delete;
+    virtual             ~provenance_index() {};
+
+    // returns false if the file is missing or can't be used
+    bool                load(const std::string& file_name);
+
+    const bool          is_loaded() const { return num_nodes_ != 0; };
+    const uint32_t      num_nodes() const { return num_nodes_; };
+    const uint32_t      num_attributes() const { return num_attributes_; };
+    const uint32_t      num_bins() const { return num_bins_; };
+
+    const float         get_range_min(const uint32_t attribute) const { return ranges_[2 * attribute]; };
+    const float         get_range_max(const uint32_t attribute) const { return ranges_[2 * attribute + 1]; };
+    const summary&      get_summary(const node_t node_id, const uint32_t attribute) const;
+    const summary&      get_subtree_summary(const node_t node_id, const uint32_t attribute) const;
+    const uint32_t*     get_histogram(const node_t node_id, const uint32_t attribute) const;
+
+    // true if no surfel of the node itself satisfies all predicates
+    const bool          can_skip_node(const node_t node_id, const std::vector<predicate>& predicates) const;
+    // true if no surfel of the node or any of its descendants satisfies all predicates
+    const bool          can_skip_subtree(const node_t node_id, const std::vector<predicate>& predicates) const;
+    // can_skip_subtree for all nodes
+    void                get_skippable_nodes(const std::vector<predicate>& predicates, std::vector<bool>& skippable) const;
+
+    static uint32_t     bin_index(const float value, const float range_min, const float range_max, const uint32_t num_bins);
+
+private:
+    const bool          can_skip(const summary* summaries, const std::vector<predicate>& predicates) const;
+
+    uint32_t            num_nodes_;
+    uint32_t            fan_factor_;
+    uint32_t            num_attributes_;
+    uint32_t            num_bins_;
+
+    std::vector<float>  ranges_;
+    std::vector<summary> summaries_;
+    std::vector<summary> subtree_summaries_;
+    std::vector<uint32_t> histograms_;
+};
+
+} } // namespace lamure
+
+#endif // REN_PROVENANCE_INDEX_H_
@@ -14,6 +14,7 @@
 #include <queue>
 #include <stack>
 #include <thread>
+#include <vector>
 
 #include <lamure/ren/bvh.h>
 #include <lamure/ren/dataset.h>
@@ -35,6 +36,8 @@ namespace ren
 {
 class RENDERING_DLL ray
 {
+    friend class ray_packet;
+
   public:
     // this is for splat-based picking
     struct intersection
@@ -101,48 +104,31 @@ class RENDERING_DLL ray
     //(single model, BVH-based)
     const bool intersect_model_bvh(const model_t model_id, const scm::math::mat4f &model_transform, const float aabb_scale, intersection_bvh &intersection);
 
+    // this is a batch query for many independent rays, e.g. line of sight tests,
+    //(all models, splat-based, no plane fit, works without a rendering context)
+    // intersections[i] and hits[i] receive the result of rays[i]. neighbouring
+    // rays are traversed together, so coherent rays should be adjacent.
+    // returns the number of rays that hit
+    static const size_t intersect_batch(const std::vector<ray> &rays, const unsigned int max_depth, const unsigned int surfel_skip, const bool is_wysiwyg,
+                                        std::vector<intersection> &intersections, std::vector<uint8_t> &hits);
+
   protected:
     const bool intersect_model_unsafe(const model_t model_id, const scm::math::mat4f &model_transform, const float aabb_scale, const unsigned int max_depth, const unsigned int surfel_skip,
                                       const bool is_wysiwyg, intersection &intersection);
     static const bool intersect_aabb(const scm::gl::boxf &bb, const scm::math::vec3f &ray_origin, const scm::math::vec3f &ray_direction, scm::math::vec2f &t);
     static const bool intersect_surfel(const dataset::serialized_surfel &surfel, const scm::math::vec3f &ray_origin, const scm::math::vec3f &ray_direction, float &t);
 
+    // intersects every surfel_skip-th surfel of one node, updates the intersection
+    // whenever a surfel with lower error is hit
+    const bool intersect_surfels(const dataset::serialized_surfel *surfels, const uint32_t num_surfels, const unsigned int surfel_skip, const scm::math::mat4f &model_transform,
+                                 const scm::math::mat4f &inverse_model_transform, const scm::math::vec3f &object_ray_origin, const scm::math::vec3f &object_ray_direction,
+                                 const float object_to_world_scale, const bool is_wysiwyg, intersection &intersection) const;
+
   private:
     scm::math::vec3f origin_;
     scm::math::vec3f direction_;
     float max_distance_;
 };
-
-class ray_queue
-{
-  public:
-    struct ray_job
-    {
-        ray ray_;
-        int id_;
-
-        ray_job() : ray_(scm::math::vec3f::zero(), scm::math::vec3f::zero(), -1.f), id_(-1) {}
-
-        ray_job(unsigned int id, const ray &ray) : ray_(ray), id_(id) {}
-    };
-
-    ray_queue();
-    ~ray_queue();
-
-    void push_job(const ray_job &job);
-    const ray_job pop_job();
-
-    void wait();
-    void relaunch();
-    const bool is_shutdown();
-    const unsigned int num_jobs();
-
-  private:
-    std::queue<ray_job> queue_;
-    std::mutex mutex_;
-    semaphore semaphore_;
-    bool is_shutdown_;
-};
 }
 }
 
@@ -0,0 +1,91 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_RAY_PACKET_H_
+#define REN_RAY_PACKET_H_
+
+#include <lamure/types.h>
+#include <lamure/ren/config.h>
+#include <lamure/ren/platform.h>
+#include <lamure/ren/ray.h>
+
+#include <scm/core/math.h>
+
+#include <vector>
+
+namespace lamure {
+namespace ren {
+
+//residency of all nodes at one point in time. it is captured once per query
+//while the caller holds ooc_cache::lock(), afterwards every lookup is an array
+//read instead of a query to the locked cache index.
+class RENDERING_DLL residency_snapshot
+{
+public:
+                        residency_snapshot();
+
+    //caller must hold ooc_cache::lock() from capture() until the last lookup
+    void                capture();
+
+    const char*         node_data(const model_t model_id, const node_t node_id) const {
+                            if (model_id >= node_data_.size() || node_id >= node_data_[model_id].size()) {
+                                return nullptr;
+                            }
+                            return node_data_[model_id][node_id];
+                        };
+    const bool          is_resident(const model_t model_id, const node_t node_id) const {
+                            return node_data(model_id, node_id) != nullptr;
+                        };
+
+    const size_t        num_resident_nodes() const { return model_ids_.size(); };
+
+private:
+    //per model and node, nullptr if the node was not aquired
+    std::vector<std::vector<const char*>> node_data_;
+
+    //nodes set by the last capture, so the tables are reset in O(resident)
+    std::vector<model_t> model_ids_;
+    std::vector<node_t> node_ids_;
+    std::vector<char*>  data_;
+};
+
+//a bundle of up to LAMURE_RAY_PACKET_SIZE rays that descends the bvh of a
+//model together. each bounding box is tested against all active rays of the
+//packet at once (4 rays per sse pass), surfels are intersected per ray.
+//the traversal keeps one fixed-size stack level per tree depth and does not
+//allocate.
+class RENDERING_DLL ray_packet
+{
+public:
+    typedef uint32_t    mask_t;
+
+                        ray_packet(const ray* rays, const size_t num_rays);
+
+    const size_t        num_rays() const { return num_rays_; };
+
+    //per ray the same result as ray::intersect_model, intersections holds one
+    //entry per ray and is only updated for hits with lower error.
+    //returns a mask with the bits of all rays that hit the model
+    const mask_t        intersect_model(const residency_snapshot& residency,
+                                        const model_t model_id,
+                                        const scm::math::mat4f& model_transform,
+                                        const unsigned int max_depth,
+                                        const unsigned int surfel_skip,
+                                        const bool is_wysiwyg,
+                                        ray::intersection* intersections) const;
+
+private:
+    const ray*          rays_;
+    size_t              num_rays_;
+
+};
+
+
+} } // namespace lamure
+
+
+#endif // REN_RAY_PACKET_H_
@@ -0,0 +1,78 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#ifndef REN_RAY_POOL_H_
+#define REN_RAY_POOL_H_
+
+#include <lamure/types.h>
+#include <lamure/ren/config.h>
+#include <lamure/ren/platform.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lamure {
+namespace ren {
+
+//persistent worker threads for ray queries. the threads are started once
+//and sleep between queries, so a pick does not pay for thread creation.
+class RENDERING_DLL ray_pool
+{
+public:
+                        ray_pool(const ray_pool&) = delete;
+                        ray_pool& operator=(const ray_pool&) = delete;
+    virtual             ~ray_pool();
+
+    static ray_pool*    get_instance();
+
+    //number of threads working on a query, including the caller
+    const uint32_t      num_threads() const { return (uint32_t)threads_.size() + 1; };
+
+    //calls job(i) for every i in [0, num_jobs) and returns when all
+    //jobs are done. the calling thread takes part, queries are serialized.
+    //the first exception thrown by a job is rethrown here
+    void                run(const size_t num_jobs, const std::function<void(const size_t)>& job);
+
+protected:
+                        ray_pool(const uint32_t num_threads);
+
+    static bool         is_instanced_;
+    static ray_pool*    single_;
+
+private:
+    static std::mutex   mutex_;
+
+    void                run_worker();
+    void                work();
+
+    std::vector<std::thread> threads_;
+
+    std::mutex          run_mutex_;
+    std::mutex          job_mutex_;
+    std::condition_variable job_signal_;
+    std::condition_variable done_signal_;
+
+    const std::function<void(const size_t)>* job_;
+    size_t              num_jobs_;
+    std::atomic<size_t> next_job_;
+    uint32_t            num_busy_;
+    uint64_t            generation_;
+    bool                shutdown_;
+
+    std::exception_ptr  exception_;
+};
+
+
+} } // namespace lamure
+
+
+#endif // REN_RAY_POOL_H_
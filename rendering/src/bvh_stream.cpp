@@ -10,6 +10,25 @@
 namespace lamure {
 namespace ren {
 
+namespace {
+
+//a node layout has to map every node to its own slot of the .lod file
+bool is_valid_node_layout(const std::vector<node_t>& file_indices, const size_t num_nodes) {
+    if (file_indices.size() != num_nodes) {
+        return false;
+    }
+    std::vector<bool> used(num_nodes, false);
+    for (const node_t file_index : file_indices) {
+        if (file_index >= num_nodes || used[file_index]) {
+            return false;
+        }
+        used[file_index] = true;
+    }
+    return true;
+}
+
+}
+
 bvh_stream::
 bvh_stream()
 : filename_(""),
@@ -117,6 +136,11 @@ write(bvh_stream::bvh_serializable& serializable) {
 
 void bvh_stream::
 read_bvh(const std::string& filename, bvh& bvh) {
+
+    if (bvh_v3::is_bvh_v3(filename)) {
+        read_bvh_v3(filename, bvh);
+        return;
+    }
  
     open_stream(filename, bvh_stream_type::BVH_STREAM_IN);
 
@@ -129,53 +153,75 @@ read_bvh(const std::string& filename, bvh& bvh) {
             "lamure: bvh_stream::Failed to read bvh from: " + filename_);
     }
    
-    //scan stream
+    //fetch the entire stream with a single read
     file_.seekg(0, std::ios::end);
     size_t filesize = (size_t)file_.tellg();
     file_.seekg(0, std::ios::beg);
 
+    std::vector<char> buffer(filesize);
+    if (filesize > 0) {
+        file_.read(&buffer[0], filesize);
+    }
+    if (!file_.good()) {
+        throw std::runtime_error(
+            "lamure: bvh_stream::Failed to read bvh from: " + filename_);
+    }
+
+    close_stream(false);
+
     num_segments_ = 0;
 
-    bvh_tree_seg tree;
-    bvh_tree_extension_seg tree_ext;
-    std::vector<bvh_node_seg> nodes;
-    std::vector<bvh_node_extension_seg> nodes_ext;
+    const size_t sig_size = bvh_sig().size();
+
+    size_t tree_offset = 0;
+    size_t layout_offset = 0;
+    size_t layout_size = 0;
+    std::vector<size_t> node_offsets;
     uint32_t tree_id = 0;
     uint32_t tree_ext_id = 0;
-    uint32_t node_id = 0;
     uint32_t node_ext_id = 0;
-
-
-    //go through entire stream and fetch the segments
-    while (true) {
-        bvh_sig sig;
-        sig.deserialize(file_);
-        if (sig.signature_[0] != 'B' ||
-            sig.signature_[1] != 'V' ||
-            sig.signature_[2] != 'H' ||
-            sig.signature_[3] != 'X') {
+    uint32_t layout_id = 0;
+
+    //go through entire buffer and locate the segments
+    size_t offset = 0;
+    while (offset + sig_size <= filesize) {
+        const char* sig = &buffer[offset];
+        if (sig[0] != 'B' ||
+            sig[1] != 'V' ||
+            sig[2] != 'H' ||
+            sig[3] != 'X') {
              throw std::runtime_error(
                  "lamure: bvh_stream::Invalid magic encountered: " + filename_);
         }
-            
-        size_t anchor = (size_t)file_.tellg();
 
-        switch (sig.signature_[4]) {
+        uint64_t allocated_size = 0;
+        uint64_t used_size = 0;
+        memcpy((char*)&allocated_size, sig + 16, 8);
+        memcpy((char*)&used_size, sig + 24, 8);
+
+        size_t anchor = offset + sig_size;
+        if (used_size > allocated_size || anchor + used_size > filesize) {
+            throw std::runtime_error(
+                "lamure: bvh_stream::Stream corrupt -- Truncated segment encountered");
+        }
+
+        switch (sig[4]) {
 
             case 'F': { //"BVHXFILE"
-                bvh_file_seg seg;
-                seg.deserialize(file_);
                 break;
             }
             case 'T': { 
-                switch (sig.signature_[5]) {
+                switch (sig[5]) {
                     case 'R': { //"BVHXTREE"
-                        tree.deserialize(file_);
+                        if (used_size < 15*sizeof(uint32_t)) {
+                            throw std::runtime_error(
+                                "lamure: bvh_stream::Stream corrupt -- Truncated tree segment");
+                        }
+                        tree_offset = anchor;
                         ++tree_id;
                         break;
                     }
                     case 'E': { //"BVHXTEXT"
-                        tree_ext.deserialize(file_);
                         ++tree_ext_id;
                         break;                     
                     }
@@ -188,23 +234,30 @@ read_bvh(const std::string& filename, bvh& bvh) {
                 break;
             }
             case 'N': { 
-                switch (sig.signature_[5]) {
+                switch (sig[5]) {
                     case 'O': { //"BVHXNODE"
-                        bvh_node_seg node;
-                        node.deserialize(file_);
-                        nodes.push_back(node);
-                        if (node_id != node.node_id_) {
+                        //see bvh_node_seg, all 16 fields are decoded below
+                        if (used_size < 16*sizeof(float)) {
+                            throw std::runtime_error(
+                                "lamure: bvh_stream::Stream corrupt -- Truncated node segment");
+                        }
+                        uint32_t node_id = 0;
+                        memcpy((char*)&node_id, &buffer[anchor + 4], 4);
+                        if (node_offsets.size() != node_id) {
                             throw std::runtime_error(
                                 "lamure: bvh_stream::Stream corrupt -- Invalid node order");
                         }
-                        ++node_id;
+                        node_offsets.push_back(anchor);
                         break;
                     }
                     case 'E': { //"BVHXNEXT"
-                        bvh_node_extension_seg node_ext;
-                        node_ext.deserialize(file_);
-                        nodes_ext.push_back(node_ext);
-                        if (node_ext_id != node_ext.node_id_) {
+                        if (used_size < 2*sizeof(uint32_t)) {
+                            throw std::runtime_error(
+                                "lamure: bvh_stream::Stream corrupt -- Truncated node extension");
+                        }
+                        uint32_t node_id = 0;
+                        memcpy((char*)&node_id, &buffer[anchor + 4], 4);
+                        if (node_ext_id != node_id) {
                             throw std::runtime_error(
                                 "lamure: bvh_stream::Stream corrupt -- Invalid node extension order");
                         }
@@ -219,6 +272,12 @@ read_bvh(const std::string& filename, bvh& bvh) {
                 }
                 break;
             }
+            case 'L': { //"BVHXLAYT"
+                layout_offset = anchor;
+                layout_size = used_size;
+                ++layout_id;
+                break;
+            }
             default: {
                 throw std::runtime_error(
                     "lamure: bvh_stream::file corrupt -- Invalid segment encountered");
@@ -226,17 +285,10 @@ read_bvh(const std::string& filename, bvh& bvh) {
             }
         }
 
-        if (anchor + sig.allocated_size_ < filesize) {
-            file_.seekg(anchor + sig.allocated_size_, std::ios::beg);
-        }
-        else {
-            break;
-        }
+        offset = anchor + allocated_size;
 
     }
 
-    close_stream(false);
-
     if (tree_id != 1) {
        throw std::runtime_error(
            "lamure: bvh_stream::Stream corrupt -- Invalid number of bvh segments");
@@ -247,40 +299,75 @@ read_bvh(const std::string& filename, bvh& bvh) {
            "lamure: bvh_stream::Stream corrupt -- Invalid number of bvh extensions");
     }    
 
+    if (layout_id > 1) {
+       throw std::runtime_error(
+           "lamure: bvh_stream::Stream corrupt -- Invalid number of node layouts");
+    }
+
     //Note: this is the rendering library version of the file reader!
 
-    bvh.set_depth(tree.depth_);
-    bvh.set_num_nodes(tree.num_nodes_);
-    bvh.set_fan_factor(tree.fan_factor_);
-    bvh.set_primitives_per_node(tree.max_surfels_per_node_);
-    bvh.set_size_of_primitive(tree.serialized_surfel_size_);
-    bvh.set_primitive((bvh::primitive_type)tree.primitive_);
-    scm::math::vec3f translation(tree.translation_.x_,
-                                tree.translation_.y_,
-                                tree.translation_.z_);
-    bvh.set_translation(translation);
-
-    if (bvh.get_num_nodes() != node_id) {
+    uint32_t tree_fields[8];
+    memcpy((char*)tree_fields, &buffer[tree_offset], 8*sizeof(uint32_t));
+    float translation[3];
+    memcpy((char*)translation, &buffer[tree_offset + 12*sizeof(uint32_t)], 3*sizeof(float));
+
+    bvh.set_depth(tree_fields[1]);
+    bvh.set_num_nodes(tree_fields[2]);
+    bvh.set_fan_factor(tree_fields[3]);
+    bvh.set_primitives_per_node(tree_fields[4]);
+    bvh.set_size_of_primitive(tree_fields[5]);
+    bvh.set_primitive((bvh::primitive_type)tree_fields[6]);
+    bvh.set_translation(scm::math::vec3f(translation[0], translation[1], translation[2]));
+
+    const uint32_t num_nodes = bvh.get_num_nodes();
+
+    if (num_nodes != node_offsets.size()) {
        throw std::runtime_error(
            "lamure: bvh_stream::Stream corrupt -- Ivalid number of node segments");
     }
 
-    for (const auto& node : nodes) {
-       scm::math::vec3f centroid(node.centroid_.x_,
-                                 node.centroid_.y_,
-                                 node.centroid_.z_);
-       bvh.set_centroid(node.node_id_, centroid);
-       bvh.set_avg_primitive_extent(node.node_id_, node.avg_surfel_radius_);
-       bvh.set_max_surfel_radius_deviation(node.node_id_, node.max_surfel_radius_deviation_);
-       bvh.set_visibility(node.node_id_, (bvh::node_visibility)node.visibility_);
-       scm::math::vec3f box_min(node.bounding_box_.min_.x_,
-                                node.bounding_box_.min_.y_,
-                                node.bounding_box_.min_.z_);
-       scm::math::vec3f box_max(node.bounding_box_.max_.x_,
-                                node.bounding_box_.max_.y_,
-                                node.bounding_box_.max_.z_);
-       bvh.set_bounding_box(node.node_id_, scm::gl::boxf(box_min, box_max));
-   
+    //decode the node segments straight into the attribute arrays of the bvh
+    bvh.centroids_.resize(num_nodes);
+    bvh.avg_primitive_extent_.resize(num_nodes);
+    bvh.max_primitive_extent_deviation_.resize(num_nodes);
+    bvh.visibility_.resize(num_nodes);
+    bvh.bounding_boxes_.resize(num_nodes);
+    bvh.reduction_errors_.resize(num_nodes);
+
+    for (uint32_t node_id = 0; node_id < num_nodes; ++node_id) {
+        //see bvh_node_seg for the field order
+        float fields[16];
+        memcpy((char*)fields, &buffer[node_offsets[node_id]], 16*sizeof(float));
+        uint32_t visibility = 0;
+        memcpy((char*)&visibility, (char*)&fields[8], 4);
+
+        bvh.centroids_[node_id] = scm::math::vec3f(fields[2], fields[3], fields[4]);
+        bvh.reduction_errors_[node_id] = fields[6];
+        bvh.avg_primitive_extent_[node_id] = fields[7];
+        bvh.visibility_[node_id] = (bvh::node_visibility)visibility;
+        bvh.max_primitive_extent_deviation_[node_id] = fields[9];
+        bvh.bounding_boxes_[node_id] = scm::gl::boxf(scm::math::vec3f(fields[10], fields[11], fields[12]),
+                                                     scm::math::vec3f(fields[13], fields[14], fields[15]));
+    }
+
+    if (layout_id == 1) {
+       uint32_t layout_num_nodes = 0;
+       if (layout_size >= 16) {
+          memcpy((char*)&layout_num_nodes, &buffer[layout_offset + 4], 4);
+       }
+       if (layout_num_nodes != num_nodes || 16 + num_nodes*sizeof(uint32_t) > layout_size) {
+          throw std::runtime_error(
+              "lamure: bvh_stream::Stream corrupt -- Invalid node layout");
+       }
+       std::vector<node_t> file_indices(num_nodes);
+       if (num_nodes > 0) {
+          memcpy((char*)&file_indices[0], &buffer[layout_offset + 16], num_nodes*sizeof(uint32_t));
+       }
+       if (!is_valid_node_layout(file_indices, num_nodes)) {
+          throw std::runtime_error(
+              "lamure: bvh_stream::Stream corrupt -- Invalid node layout");
+       }
+       bvh.set_file_indices(file_indices);
     }
 
 }
@@ -338,7 +425,7 @@ write_bvh(const std::string& filename, bvh& bvh) {
        node.centroid_.y_ = centroid.y;
        node.centroid_.z_ = centroid.z;
        node.depth_ = bvh.get_depth_of_node(node_id);
-       node.reduction_error_ = 0.f;
+       node.reduction_error_ = bvh.get_reduction_error(node_id);
        node.avg_surfel_radius_ = bvh.get_avg_primitive_extent(node_id);
        node.visibility_ = (bvh_node_visibility)bvh.get_visibility(node_id);
        node.max_surfel_radius_deviation_ = bvh.get_max_surfel_radius_deviation(node_id);
@@ -353,11 +440,174 @@ write_bvh(const std::string& filename, bvh& bvh) {
        write(node);
    }
 
+   if (bvh.has_node_layout()) {
+       bvh_node_layout_seg layout;
+       layout.segment_id_ = num_segments_++;
+       layout.num_nodes_ = bvh.get_num_nodes();
+       layout.reserved_ = 0;
+       layout.file_indices_.assign(bvh.get_file_indices().begin(), bvh.get_file_indices().end());
+
+       write(layout);
+   }
+
    close_stream(false);
 
 }
 
+void bvh_stream::
+read_bvh_v3(const std::string& filename, bvh& bvh) {
+
+    bvh_v3::reader reader;
+    reader.open(filename);
 
+    const bvh_v3::header& header = reader.get_header();
 
-} } // namespace lamure
+    if (header.state_ != BVH_STATE_SERIALIZED) {
+        throw std::runtime_error(
+            "lamure: bvh_stream::Tree is not serialized: " + filename);
+    }
+
+    bvh.set_depth(header.depth_);
+    bvh.set_num_nodes(header.num_nodes_);
+    bvh.set_fan_factor(header.fan_factor_);
+    bvh.set_primitives_per_node(header.primitives_per_node_);
+    bvh.set_size_of_primitive(header.size_of_primitive_);
+    bvh.set_primitive((bvh::primitive_type)header.primitive_);
+    bvh.set_translation(scm::math::vec3f(header.translation_[0],
+                                         header.translation_[1],
+                                         header.translation_[2]));
+
+    const size_t num_nodes = header.num_nodes_;
+
+    auto fetch = [&](const bvh_v3::section_type type, const size_t element_size) -> const char* {
+        const char* data = reader.section_data(type);
+        if (data == nullptr || reader.section_size(type) != num_nodes * element_size) {
+            throw std::runtime_error(
+                "lamure: bvh_stream::Stream corrupt -- Missing or invalid section: " + filename);
+        }
+        return data;
+    };
+
+    const float* boxes = (const float*)fetch(bvh_v3::SECTION_BOUNDING_BOXES, 6*sizeof(float));
+    const float* centroids = (const float*)fetch(bvh_v3::SECTION_CENTROIDS, 3*sizeof(float));
+    const char* extents = fetch(bvh_v3::SECTION_AVG_PRIMITIVE_EXTENTS, sizeof(float));
+    const char* deviations = fetch(bvh_v3::SECTION_MAX_EXTENT_DEVIATIONS, sizeof(float));
+
+    const char* visibility = reader.section_data(bvh_v3::SECTION_VISIBILITY);
+    if (visibility == nullptr || reader.section_size(bvh_v3::SECTION_VISIBILITY) != (num_nodes + 7) / 8) {
+        throw std::runtime_error(
+            "lamure: bvh_stream::Stream corrupt -- Missing or invalid section: " + filename);
+    }
+
+    bvh.bounding_boxes_.resize(num_nodes);
+    bvh.centroids_.resize(num_nodes);
+    bvh.avg_primitive_extent_.resize(num_nodes);
+    bvh.max_primitive_extent_deviation_.resize(num_nodes);
+    bvh.visibility_.resize(num_nodes);
+
+    if (num_nodes > 0) {
+        memcpy((char*)&bvh.avg_primitive_extent_[0], extents, num_nodes*sizeof(float));
+        memcpy((char*)&bvh.max_primitive_extent_deviation_[0], deviations, num_nodes*sizeof(float));
+    }
+
+    for (size_t node_id = 0; node_id < num_nodes; ++node_id) {
+        const float* box = boxes + 6*node_id;
+        const float* centroid = centroids + 3*node_id;
+        bvh.bounding_boxes_[node_id] = scm::gl::boxf(scm::math::vec3f(box[0], box[1], box[2]),
+                                                     scm::math::vec3f(box[3], box[4], box[5]));
+        bvh.centroids_[node_id] = scm::math::vec3f(centroid[0], centroid[1], centroid[2]);
+        bvh.visibility_[node_id] = ((visibility[node_id / 8] >> (node_id % 8)) & 1) ?
+                                   bvh::node_visibility::NODE_INVISIBLE : bvh::node_visibility::NODE_VISIBLE;
+    }
+
+    if (reader.has_section(bvh_v3::SECTION_NODE_LAYOUT)) {
+        std::vector<node_t> file_indices(num_nodes);
+        if (num_nodes > 0) {
+            memcpy((char*)&file_indices[0], fetch(bvh_v3::SECTION_NODE_LAYOUT, sizeof(uint32_t)), num_nodes*sizeof(uint32_t));
+        }
+        if (!is_valid_node_layout(file_indices, num_nodes)) {
+            throw std::runtime_error(
+                "lamure: bvh_stream::Stream corrupt -- Invalid node layout: " + filename);
+        }
+        bvh.set_file_indices(file_indices);
+    }
+
+    bvh.reduction_errors_.clear();
+    if (reader.has_section(bvh_v3::SECTION_REDUCTION_ERRORS)) {
+        bvh.reduction_errors_.resize(num_nodes);
+        if (num_nodes > 0) {
+            memcpy((char*)&bvh.reduction_errors_[0], fetch(bvh_v3::SECTION_REDUCTION_ERRORS, sizeof(float)), num_nodes*sizeof(float));
+        }
+    }
+
+}
+
+void bvh_stream::
+write_bvh_v3(const std::string& filename, bvh& bvh, const bool compress) {
+
+    //Note: This is the rendering library version of the file writer!
+
+    bvh_v3::header header;
+    bvh_v3::init_header(header);
+    header.num_nodes_ = bvh.get_num_nodes();
+    header.depth_ = bvh.get_depth();
+    header.fan_factor_ = bvh.get_fan_factor();
+    header.primitives_per_node_ = bvh.get_primitives_per_node();
+    header.size_of_primitive_ = bvh.get_size_of_primitive();
+    header.primitive_ = (uint32_t)bvh.get_primitive();
+    header.state_ = BVH_STATE_SERIALIZED;
+    header.translation_[0] = bvh.get_translation().x;
+    header.translation_[1] = bvh.get_translation().y;
+    header.translation_[2] = bvh.get_translation().z;
+
+    const size_t num_nodes = bvh.get_num_nodes();
+
+    std::vector<float> boxes(6*num_nodes);
+    std::vector<float> centroids(3*num_nodes);
+    std::vector<float> extents(num_nodes);
+    std::vector<float> deviations(num_nodes);
+    std::vector<uint8_t> visibility((num_nodes + 7) / 8, 0);
+
+    for (uint32_t node_id = 0; node_id < num_nodes; ++node_id) {
+        const scm::gl::boxf& box = bvh.get_bounding_box(node_id);
+        const scm::math::vec3f& centroid = bvh.get_centroid(node_id);
+        for (int axis = 0; axis < 3; ++axis) {
+            boxes[6*node_id + axis] = box.min_vertex()[axis];
+            boxes[6*node_id + 3 + axis] = box.max_vertex()[axis];
+            centroids[3*node_id + axis] = centroid[axis];
+        }
+        extents[node_id] = bvh.get_avg_primitive_extent(node_id);
+        deviations[node_id] = bvh.get_max_surfel_radius_deviation(node_id);
+        if (bvh.get_visibility(node_id) == bvh::node_visibility::NODE_INVISIBLE) {
+            visibility[node_id / 8] |= (uint8_t)(1 << (node_id % 8));
+        }
+    }
+
+    bvh_v3::codec_type codec = compress ? bvh_v3::CODEC_LZ4 : bvh_v3::CODEC_NONE;
 
+    bvh_v3::writer writer(header);
+    writer.add_section(bvh_v3::SECTION_BOUNDING_BOXES, sizeof(float), boxes.data(), boxes.size()*sizeof(float), codec);
+    writer.add_section(bvh_v3::SECTION_CENTROIDS, sizeof(float), centroids.data(), centroids.size()*sizeof(float), codec);
+    writer.add_section(bvh_v3::SECTION_AVG_PRIMITIVE_EXTENTS, sizeof(float), extents.data(), extents.size()*sizeof(float), codec);
+    writer.add_section(bvh_v3::SECTION_MAX_EXTENT_DEVIATIONS, sizeof(float), deviations.data(), deviations.size()*sizeof(float), codec);
+    writer.add_section(bvh_v3::SECTION_VISIBILITY, 1, visibility.data(), visibility.size(), codec);
+
+    if (bvh.has_reduction_errors()) {
+        std::vector<float> errors(num_nodes);
+        for (uint32_t node_id = 0; node_id < num_nodes; ++node_id) {
+            errors[node_id] = bvh.get_reduction_error(node_id);
+        }
+        writer.add_section(bvh_v3::SECTION_REDUCTION_ERRORS, sizeof(float), errors.data(), errors.size()*sizeof(float), codec);
+    }
+
+    if (bvh.has_node_layout()) {
+        const std::vector<node_t>& file_indices = bvh.get_file_indices();
+        writer.add_section(bvh_v3::SECTION_NODE_LAYOUT, sizeof(uint32_t), file_indices.data(), file_indices.size()*sizeof(node_t), codec);
+    }
+
+    writer.write(filename);
+
+}
+
+
+} } // namespace lamure
@@ -20,7 +20,8 @@ cache(const slot_t num_slots)
     model_database* database = model_database::get_instance();
 
     slot_size_ = database->get_slot_size();
-    index_ = new cache_index(database->num_models(), num_slots_);
+    policy *policy = policy::get_instance();
+    index_ = new cache_index(database->num_models(), num_slots_, policy->cache_replacement_policy());
 }
 
 cache::
@@ -73,6 +74,11 @@ release_node_invalidate(const context_t context_id, const view_t view_id, const
     return false;
 }
 
+void cache::
+set_node_priority(const model_t model_id, const node_t node_id, const float priority) {
+    index_->set_priority(model_id, node_id, priority);
+}
+
 void cache::
 lock() {
     mutex_.lock();
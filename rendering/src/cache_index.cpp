@@ -7,6 +7,8 @@
 
 #include <lamure/ren/cache_index.h>
 
+#include <stdexcept>
+
 
 namespace lamure
 {
@@ -15,8 +17,9 @@ namespace ren
 {
 
 cache_index::
-cache_index(const model_t num_models, const slot_t num_slots)
-    : num_models_(num_models), num_slots_(num_slots), num_free_slots_(num_slots) {
+cache_index(const model_t num_models, const slot_t num_slots, const replacement_policy_t replacement_policy)
+    : num_models_(num_models), num_slots_(num_slots), num_free_slots_(num_slots),
+    replacement_policy_type_(replacement_policy), replacement_policy_(nullptr), tick_(0), free_view_bits_(~((uint64_t)0)) {
     assert(num_slots > 0);
 
     try {
@@ -28,6 +31,8 @@ cache_index(const model_t num_models, const slot_t num_slots)
       slots_[num_slots_ + 1].next_ = invalid_slot_t;
 
       maps_.resize(num_models_);
+
+      replacement_policy_ = cache_replacement_policy::create(replacement_policy_type_, num_slots_ + 2);
     }
     catch (...) {
     }
@@ -35,7 +40,118 @@ cache_index(const model_t num_models, const slot_t num_slots)
 
 cache_index::
 ~cache_index() {
+    if (replacement_policy_ != nullptr) {
+        delete replacement_policy_;
+        replacement_policy_ = nullptr;
+    }
+}
+
+const bool cache_index::
+add_view(const slot_t slot_id, const view_t view_id) {
+    auto it = view_records_.find(view_id);
+    if (it == view_records_.end()) {
+        view_record record;
+        record.bit_ = free_view_bits_ & (~free_view_bits_ + 1);
+        record.num_aquired_ = 0;
+        free_view_bits_ &= ~record.bit_;
+        it = view_records_.insert(std::make_pair(view_id, record)).first;
+    }
+
+    view_record& record = it->second;
+    if (record.bit_ != 0) {
+        if (slots_[slot_id].views_ & record.bit_) {
+            return false;
+        }
+        slots_[slot_id].views_ |= record.bit_;
+    }
+    else if (!overflow_views_[slot_id].insert(view_id).second) {
+        return false;
+    }
+
+    ++record.num_aquired_;
+    return true;
+}
+
+const bool cache_index::
+remove_view(const slot_t slot_id, const view_t view_id) {
+    auto it = view_records_.find(view_id);
+    if (it == view_records_.end()) {
+        return false;
+    }
+
+    view_record& record = it->second;
+    if (record.bit_ != 0) {
+        if (!(slots_[slot_id].views_ & record.bit_)) {
+            return false;
+        }
+        slots_[slot_id].views_ &= ~record.bit_;
+    }
+    else {
+        auto overflow_it = overflow_views_.find(slot_id);
+        if (overflow_it == overflow_views_.end() || overflow_it->second.erase(view_id) == 0) {
+            return false;
+        }
+        if (overflow_it->second.empty()) {
+            overflow_views_.erase(overflow_it);
+        }
+    }
+
+    //recycle the bit once the view holds no slot anymore
+    if (--record.num_aquired_ == 0) {
+        free_view_bits_ |= record.bit_;
+        view_records_.erase(it);
+    }
+    return true;
+}
+
+const bool cache_index::
+is_aquired(const slot_t slot_id) const {
+    return slots_[slot_id].views_ != 0 ||
+        (!overflow_views_.empty() && overflow_views_.find(slot_id) != overflow_views_.end());
+}
+
+void cache_index::
+link_head(const slot_t slot_id) {
+    cache_index_node& node = slots_[slot_id];
 
+    node.prev_ = 0;
+    node.next_ = slots_[0].next_;
+
+    slots_[slots_[0].next_].prev_ = slot_id;
+    slots_[0].next_ = slot_id;
+}
+
+void cache_index::
+link_tail(const slot_t slot_id) {
+    cache_index_node& node = slots_[slot_id];
+
+    node.prev_ = slots_[num_slots_+1].prev_;
+    node.next_ = num_slots_+1;
+
+    slots_[slots_[num_slots_+1].prev_].next_ = slot_id;
+    slots_[num_slots_+1].prev_ = slot_id;
+
+    if (replacement_policy_ != nullptr && node.node_id_ != invalid_node_t) {
+        replacement_policy_->insert(slot_id, ++tick_, node.priority_);
+    }
+}
+
+void cache_index::
+unlink(const slot_t slot_id) {
+    cache_index_node& node = slots_[slot_id];
+
+    assert(node.prev_ != invalid_slot_t);
+    assert(node.next_ != invalid_slot_t);
+
+    slots_[node.prev_].next_ = node.next_;
+    slots_[node.next_].prev_ = node.prev_;
+
+    node.prev_ = invalid_slot_t;
+    node.next_ = invalid_slot_t;
+
+    if (replacement_policy_ != nullptr) {
+        replacement_policy_->remove(slot_id);
+    }
 }
 
 const slot_t cache_index::
@@ -56,20 +172,21 @@ reserve_slot() {
     assert(slot_id != invalid_slot_t);
     assert(slot_id < num_slots_+1);
 
-    cache_index_node& node = slots_[slot_id];
+    //empty slots are always kept at the head. once the head holds a node,
+    //the replacement policy decides which of the unaquired nodes to evict
+    if (replacement_policy_ != nullptr && slots_[slot_id].node_id_ != invalid_node_t) {
+        slot_t victim_id = replacement_policy_->select_victim();
+        if (victim_id != invalid_slot_t) {
+            slot_id = victim_id;
+        }
+    }
 
-    //assert slot was in linked list
-    assert(node.prev_ != invalid_slot_t);
-    assert(node.next_ != invalid_slot_t);
+    cache_index_node& node = slots_[slot_id];
 
     //remove node from linked list
-    slots_[node.prev_].next_ = node.next_;
-    slots_[node.next_].prev_ = node.prev_;
-
-    node.prev_ = invalid_slot_t;
-    node.next_ = invalid_slot_t;
+    unlink(slot_id);
 
-    assert(node.views_.empty());
+    assert(!is_aquired(slot_id));
 
     if (node.node_id_ != invalid_node_t) {
         maps_[node.model_id_].erase(node.node_id_);
@@ -77,6 +194,7 @@ reserve_slot() {
 
     node.node_id_ = invalid_node_t;
     node.model_id_ = invalid_model_t;
+    node.priority_ = 0.f;
 
     if (num_free_slots_ > 0) {
         --num_free_slots_;
@@ -96,18 +214,18 @@ apply_slot(const slot_t slot_id, const model_t model_id, const node_t node_id) {
     assert(node.next_ == invalid_slot_t);
     assert(node.node_id_ == invalid_node_t);
     assert(node.model_id_ == invalid_model_t);
-    assert(node.views_.empty());
+    assert(!is_aquired(slot_id+1));
     assert(maps_[model_id].find(node_id) == maps_[model_id].end());
 
     node.node_id_ = node_id;
     node.model_id_ = model_id;
 
-    //insert node at tail
-    node.prev_ = slots_[num_slots_+1].prev_;
-    node.next_ = num_slots_+1;
+    if (replacement_policy_ != nullptr) {
+        replacement_policy_->clear(slot_id+1);
+    }
 
-    slots_[slots_[num_slots_+1].prev_].next_ = slot_id+1;
-    slots_[num_slots_+1].prev_ = slot_id+1;
+    //insert node at tail
+    link_tail(slot_id+1);
 
     maps_[model_id][node_id] = slot_id+1;
 
@@ -128,14 +246,7 @@ unreserve_slot(const slot_t slot_id) {
     assert(node.next_ == invalid_slot_t);
 
     //assert slot was not aquired by any views
-    assert(node.views_.empty());
-
-    //insert to head
-    node.prev_ = 0;
-    node.next_ = slots_[0].next_;
-
-    slots_[slots_[0].next_].prev_ = slot_id+1;
-    slots_[0].next_ = slot_id+1;
+    assert(!is_aquired(slot_id+1));
 
     //section below is not really necessary,
     //but let's keep it for sanity
@@ -147,9 +258,12 @@ unreserve_slot(const slot_t slot_id) {
         node.node_id_ = invalid_node_t;
         node.model_id_ = invalid_model_t;
 
-        node.views_.clear();
+        node.views_ = 0;
     }
 
+    //insert to head
+    link_head(slot_id+1);
+
     if (num_free_slots_ < num_slots_) {
         ++num_free_slots_;
     }
@@ -169,7 +283,7 @@ get_slot(const model_t model_id, const node_t node_id) {
     
     //this raises if attempting to access a slot that was not aquired
     //and, thus, is in danger of being overriden very soon
-    assert(!slots_[slot_id].views_.empty());
+    assert(is_aquired(slot_id));
 
     //assert slot was removed from linked list
     assert(slots_[slot_id].prev_ == invalid_slot_t);
@@ -195,10 +309,26 @@ is_node_aquired(const model_t model_id, const node_t node_id) {
       return false;
     }
 
-    slot_t slot_id = it->second;
-    cache_index_node& node = slots_[slot_id];
+    return is_aquired(it->second);
+}
 
-    return !node.views_.empty();
+void cache_index::
+get_aquired_nodes(std::vector<model_t>& model_ids, std::vector<node_t>& node_ids, std::vector<slot_t>& slot_ids) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    model_ids.clear();
+    node_ids.clear();
+    slot_ids.clear();
+
+    for (slot_t slot_id = 1; slot_id <= num_slots_; ++slot_id) {
+        const cache_index_node& node = slots_[slot_id];
+
+        if (node.node_id_ != invalid_node_t && is_aquired(slot_id)) {
+            model_ids.push_back(node.model_id_);
+            node_ids.push_back(node.node_id_);
+            slot_ids.push_back(slot_id-1);
+        }
+    }
 }
 
 void cache_index::
@@ -214,20 +344,16 @@ aquire_slot(const view_t view_id, const model_t model_id, const node_t node_id)
     slot_t slot_id = it->second;
     cache_index_node& node = slots_[slot_id];
 
-    if (node.views_.find(view_id) == node.views_.end()) {
-        node.views_.insert(view_id);
+    if (add_view(slot_id, view_id)) {
+
+        if (replacement_policy_ != nullptr) {
+            replacement_policy_->touch(slot_id, ++tick_);
+        }
 
         //if slot was not removed from linked list
         if (node.prev_ != invalid_slot_t || node.next_ != invalid_slot_t) {
-            assert(node.prev_ != invalid_slot_t);
-            assert(node.next_ != invalid_slot_t);
-
             //remove node from linked list
-            slots_[node.prev_].next_ = node.next_;
-            slots_[node.next_].prev_ = node.prev_;
-
-            node.prev_ = invalid_slot_t;
-            node.next_ = invalid_slot_t;
+            unlink(slot_id);
 
             if (num_free_slots_ > 0) {
                 --num_free_slots_;
@@ -251,18 +377,13 @@ release_slot(const view_t view_id, const model_t model_id, const node_t node_id)
     slot_t slot_id = it->second;
     cache_index_node& node = slots_[slot_id];
 
-    if (node.views_.find(view_id) != node.views_.end()) {
-        node.views_.erase(view_id);
+    if (remove_view(slot_id, view_id)) {
 
-        if (node.views_.empty()) {
+        if (!is_aquired(slot_id)) {
             //if slot was removed from linked list
             if (node.prev_ == invalid_slot_t && node.next_ == invalid_slot_t) {
                 //insert node at tail
-                node.prev_ = slots_[num_slots_+1].prev_;
-                node.next_ = num_slots_+1;
-
-                slots_[slots_[num_slots_+1].prev_].next_ = slot_id;
-                slots_[num_slots_+1].prev_ = slot_id;
+                link_tail(slot_id);
 
                 if (num_free_slots_ < num_slots_) {
                     ++num_free_slots_;
@@ -292,23 +413,11 @@ release_slot_invalidate(const view_t view_id, const model_t model_id, const node
     slot_t slot_id = it->second;
     cache_index_node& node = slots_[slot_id];
 
-    if (node.views_.find(view_id) != node.views_.end()) {
-        node.views_.erase(view_id);
+    if (remove_view(slot_id, view_id)) {
 
-        if (node.views_.empty()) {
+        if (!is_aquired(slot_id)) {
             //if slot was removed from linked list
             if (node.prev_ == invalid_slot_t && node.next_ == invalid_slot_t) {
-                //insert to head
-                node.prev_ = 0;
-                node.next_ = slots_[0].next_;
-
-                slots_[slots_[0].next_].prev_ = slot_id;
-                slots_[0].next_ = slot_id;
-
-                if (num_free_slots_ < num_slots_) {
-                    ++num_free_slots_;
-                }
-
                 //invalidate slot
                 if (node.node_id_ != invalid_node_t) {
                     maps_[node.model_id_].erase(node.node_id_);
@@ -316,6 +425,14 @@ release_slot_invalidate(const view_t view_id, const model_t model_id, const node
 
                 node.node_id_ = invalid_node_t;
                 node.model_id_ = invalid_model_t;
+                node.priority_ = 0.f;
+
+                //insert to head
+                link_head(slot_id);
+
+                if (num_free_slots_ < num_slots_) {
+                    ++num_free_slots_;
+                }
 
 
                 return true;
@@ -329,6 +446,26 @@ release_slot_invalidate(const view_t view_id, const model_t model_id, const node
     return false;
 }
 
+void cache_index::
+set_priority(const model_t model_id, const node_t node_id, const float priority) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto it = maps_[model_id].find(node_id);
+    if (it == maps_[model_id].end()) {
+        return;
+    }
+
+    slot_t slot_id = it->second;
+    cache_index_node& node = slots_[slot_id];
+
+    node.priority_ = priority;
+
+    //re-rank if the slot is currently evictable
+    if (replacement_policy_ != nullptr && node.prev_ != invalid_slot_t) {
+        replacement_policy_->update_priority(slot_id, priority);
+    }
+}
+
 
 } // namespace ren
 
@@ -0,0 +1,161 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/cache_replacement_policy.h>
+#include <lamure/ren/config.h>
+
+#include <cassert>
+
+
+namespace lamure
+{
+
+namespace ren
+{
+
+const std::string
+replacement_policy_name(const replacement_policy_t policy) {
+    switch (policy) {
+        case replacement_policy_t::LRU: return "lru";
+        case replacement_policy_t::LRU_K: return "lru_k";
+        case replacement_policy_t::SCREEN_SPACE_ERROR: return "error";
+        case replacement_policy_t::DISTANCE: return "distance";
+    }
+    return "unknown";
+}
+
+const bool
+parse_replacement_policy(const std::string& name, replacement_policy_t& policy) {
+    for (const auto candidate : {replacement_policy_t::LRU,
+                                 replacement_policy_t::LRU_K,
+                                 replacement_policy_t::SCREEN_SPACE_ERROR,
+                                 replacement_policy_t::DISTANCE}) {
+        if (replacement_policy_name(candidate) == name) {
+            policy = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+cache_replacement_policy::
+cache_replacement_policy(const slot_t num_slots)
+    : ranks_(num_slots), ticks_(num_slots, 0), ranked_(num_slots, false) {
+
+}
+
+cache_replacement_policy::
+~cache_replacement_policy() {
+
+}
+
+cache_replacement_policy* cache_replacement_policy::
+create(const replacement_policy_t policy, const slot_t num_slots) {
+    switch (policy) {
+        case replacement_policy_t::LRU_K:
+            return new lru_k_replacement_policy(num_slots, LAMURE_CACHE_REPLACEMENT_LRU_K);
+        case replacement_policy_t::SCREEN_SPACE_ERROR:
+        case replacement_policy_t::DISTANCE:
+            return new priority_replacement_policy(num_slots);
+        default:
+            //lru is served by the cache_index free list itself
+            return nullptr;
+    }
+}
+
+void cache_replacement_policy::
+insert(const slot_t slot_id, const uint64_t tick, const float priority) {
+    assert(slot_id < ranked_.size());
+
+    if (ranked_[slot_id]) {
+        ranking_.erase(ranks_[slot_id]);
+    }
+
+    ticks_[slot_id] = tick;
+    ranks_[slot_id] = compute_rank(slot_id, tick, priority);
+    ranking_.insert(ranks_[slot_id]);
+    ranked_[slot_id] = true;
+}
+
+void cache_replacement_policy::
+remove(const slot_t slot_id) {
+    assert(slot_id < ranked_.size());
+
+    if (ranked_[slot_id]) {
+        ranking_.erase(ranks_[slot_id]);
+        ranked_[slot_id] = false;
+    }
+}
+
+const slot_t cache_replacement_policy::
+select_victim() const {
+    if (ranking_.empty()) {
+        return invalid_slot_t;
+    }
+    return ranking_.begin()->slot_id_;
+}
+
+void cache_replacement_policy::
+update_priority(const slot_t slot_id, const float priority) {
+    assert(slot_id < ranked_.size());
+
+    if (ranked_[slot_id]) {
+        ranking_.erase(ranks_[slot_id]);
+        ranks_[slot_id] = compute_rank(slot_id, ticks_[slot_id], priority);
+        ranking_.insert(ranks_[slot_id]);
+    }
+}
+
+lru_k_replacement_policy::
+lru_k_replacement_policy(const slot_t num_slots, const uint32_t k)
+    : cache_replacement_policy(num_slots),
+    k_(k > 0 ? k : 1),
+    history_(num_slots * (k > 0 ? k : 1), 0),
+    num_requests_(num_slots, 0) {
+
+}
+
+void lru_k_replacement_policy::
+touch(const slot_t slot_id, const uint64_t tick) {
+    history_[slot_id * k_ + (num_requests_[slot_id] % k_)] = tick;
+    ++num_requests_[slot_id];
+}
+
+void lru_k_replacement_policy::
+clear(const slot_t slot_id) {
+    num_requests_[slot_id] = 0;
+}
+
+const cache_replacement_policy::rank lru_k_replacement_policy::
+compute_rank(const slot_t slot_id, const uint64_t tick, const float priority) const {
+    const uint32_t num_requests = num_requests_[slot_id];
+
+    if (num_requests == 0) {
+        return rank(0.0, tick, slot_id);
+    }
+
+    //most recent request breaks ties
+    uint64_t last = history_[slot_id * k_ + ((num_requests - 1) % k_)];
+
+    //slots with less than k requests have an infinite backward k-distance
+    if (num_requests < k_) {
+        return rank(0.0, last, slot_id);
+    }
+
+    uint64_t kth = history_[slot_id * k_ + (num_requests % k_)];
+    return rank((double)kth, last, slot_id);
+}
+
+const cache_replacement_policy::rank priority_replacement_policy::
+compute_rank(const slot_t slot_id, const uint64_t tick, const float priority) const {
+    return rank((double)priority, tick, slot_id);
+}
+
+
+} // namespace ren
+
+} // namespace lamure
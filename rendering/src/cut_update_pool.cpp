@@ -135,6 +135,12 @@ const bool cut_update_pool::is_running()
     return master_dispatched_;
 }
 
+const cut_update_pool::statistics cut_update_pool::get_statistics()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_statistics_;
+}
+
 void cut_update_pool::dispatch_cut_update(char *current_gpu_storage_A, char *current_gpu_storage_B, char *current_gpu_storage_A_provenance, char *current_gpu_storage_B_provenance)
 {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -313,9 +319,12 @@ const bool cut_update_pool::prepare()
 
 void cut_update_pool::cut_master()
 {
+    statistics_ = statistics();
+
     if(!prepare())
     {
         std::lock_guard<std::mutex> lock(mutex_);
+        last_statistics_ = statistics_;
         master_dispatched_ = false;
         return;
     }
@@ -454,6 +463,7 @@ void cut_update_pool::cut_master()
 
         {
             std::lock_guard<std::mutex> lock(mutex_);
+            last_statistics_ = statistics_;
             master_dispatched_ = false;
         }
     }
@@ -463,7 +473,9 @@ void cut_update_pool::cut_master()
 void cut_update_pool::
 cut_analysis(view_t view_id, model_t model_id) {
 
-    lamure::pvs::pvs_database* pvs = lamure::pvs::pvs_database::get_instance();
+    // read-only visibility of the viewer cell for the whole analysis, null if everything is visible
+    std::shared_ptr<const lamure::pvs::visibility_snapshot> pvs_snapshot = lamure::pvs::pvs_database::get_instance()->get_viewer_visibility_snapshot();
+    const lamure::pvs::visibility_snapshot* pvs = pvs_snapshot.get();
 
     assert(view_id != invalid_view_t);
     assert(model_id != invalid_model_t);
@@ -474,7 +486,7 @@ cut_analysis(view_t view_id, model_t model_id) {
 #ifdef LAMURE_CUT_UPDATE_ENABLE_MODEL_TIMEOUT
     size_t freshness;
 #endif
-    scm::gl::frustum frustum;
+    node_batch batch;
 
     {
         std::lock_guard<std::mutex> lock(mutex_);
@@ -482,9 +494,17 @@ cut_analysis(view_t view_id, model_t model_id) {
 #ifdef LAMURE_CUT_UPDATE_ENABLE_MODEL_TIMEOUT
         freshness = model_freshness_[model_id];
 #endif
-        frustum = user_cameras_[view_id].get_frustum_by_model(model_matrix);
+        const camera &user_camera = user_cameras_[view_id];
+        batch = node_batch(model_matrix, user_camera.get_view_matrix(), user_camera.get_projection_matrix(),
+                           user_camera.near_plane_value(), height_divided_by_top_minus_bottoms_[view_id]);
     }
 
+    const bvh *bvh = model_database::get_instance()->get_model(model_id)->get_bvh();
+
+    // nodes whose subtree can't pass the provenance filter are treated like nodes invisible per PVS, null if nothing is filtered
+    std::shared_ptr<const std::vector<bool>> provenance_skip_mask = model_database::get_instance()->get_model(model_id)->get_provenance_skip_mask();
+    const std::vector<bool>* skip = provenance_skip_mask.get();
+
     // perform cut analysis
     std::set<node_t> old_cut = index_->get_previous_cut(view_id, model_id);
 
@@ -521,17 +541,17 @@ cut_analysis(view_t view_id, model_t model_id) {
         if (node_id > 0 && node_id < index_->num_nodes(model_id))
         {
             parent_id = index_->get_parent_id(model_id, node_id);
-            parent_error = calculate_node_error(view_id, model_id, parent_id);
+            parent_error = batch.calculate_error(bvh, parent_id);
 
             index_->get_all_siblings(model_id, node_id, siblings);
 
             all_siblings_in_cut = is_all_nodes_in_cut(model_id, siblings, old_cut);
-            no_sibling_in_frustum = !is_node_in_frustum(view_id, model_id, parent_id, frustum);
+            no_sibling_in_frustum = !batch.is_in_frustum(bvh, parent_id);
 
-            // Check if no sibling is visible via PVS.
+            // Check if no sibling is visible via PVS and passes the provenance filter.
             for(node_t sibling_id : siblings)
             {
-                if(pvs->get_viewer_visibility(model_id, sibling_id))
+                if((pvs == nullptr || pvs->get_visibility(model_id, sibling_id)) && (skip == nullptr || !(*skip)[sibling_id]))
                 {
                     no_sibling_visible_in_pvs = false;
                     break;
@@ -541,30 +561,15 @@ cut_analysis(view_t view_id, model_t model_id) {
 
         if (!all_siblings_in_cut)
         {
-            float node_error = calculate_node_error(view_id, model_id, node_id);
-            bool node_in_frustum = is_node_in_frustum(view_id, model_id, node_id, frustum);
+            float node_error = batch.calculate_error(bvh, node_id);
+            bool node_in_frustum = batch.is_in_frustum(bvh, node_id);
 
-            if (node_in_frustum && node_error > max_error_threshold && pvs->get_viewer_visibility(model_id, node_id))
+            if (node_in_frustum && node_error > max_error_threshold && (pvs == nullptr || pvs->get_visibility(model_id, node_id)) && (skip == nullptr || !(*skip)[node_id]))
             {
                 //only split if the predicted error of children does not require collapsing
-                bool split = true;
                 std::vector<node_t> children;
                 index_->get_all_children(model_id, node_id, children);
-                for (const auto& child_id : children)
-                {
-                    if (child_id == invalid_node_t)
-                    {
-                        split = false;
-                        break;
-                    }
-
-                    float child_error = calculate_node_error(view_id, model_id, child_id);
-                    if(child_error < min_error_threshold)
-                    {
-                        split = false;
-                        break;
-                    }
-                }
+                bool split = is_split_predicted(bvh, batch, children, min_error_threshold);
 
                 if (!split || freshness_timeout)
                 {
@@ -593,7 +598,7 @@ cut_analysis(view_t view_id, model_t model_id) {
             }
             else if(no_sibling_visible_in_pvs)
             {
-                // Parent is invisible from current view point per PVS.
+                // Parent is invisible from current view point per PVS or filtered by provenance.
                 index_->push_action(cut_update_index::action(cut_update_index::queue_t::MUST_COLLAPSE, view_id, model_id, parent_id, parent_error), false);
             }
             else
@@ -615,33 +620,24 @@ cut_analysis(view_t view_id, model_t model_id) {
 
                 std::vector<bool> keep_sibling;
 
-                for (const auto& sibling_id : siblings)
+                std::vector<float> sibling_errors;
+                std::vector<bool> siblings_in_frustum;
+                batch.calculate_errors(bvh, siblings, sibling_errors);
+                batch.cull(bvh, siblings, siblings_in_frustum);
+
+                for (size_t sibling_idx = 0; sibling_idx < siblings.size(); ++sibling_idx)
                 {
-                    float sibling_error = calculate_node_error(view_id, model_id, sibling_id);
-                    bool sibling_in_frustum = is_node_in_frustum(view_id, model_id, sibling_id, frustum);
+                    node_t sibling_id = siblings[sibling_idx];
+                    float sibling_error = sibling_errors[sibling_idx];
+                    bool sibling_in_frustum = siblings_in_frustum[sibling_idx];
 
-                    if (sibling_error > max_error_threshold && sibling_in_frustum && pvs->get_viewer_visibility(model_id, sibling_id))
+                    if (sibling_error > max_error_threshold && sibling_in_frustum && (pvs == nullptr || pvs->get_visibility(model_id, sibling_id)) &&
+                        (skip == nullptr || !(*skip)[sibling_id]))
                     {
                         //only split if the predicted error of children does not require collapsing
-                        bool split = true;
                         std::vector<node_t> children;
                         index_->get_all_children(model_id, sibling_id, children);
-                        for (const auto& child_id : children)
-                        {
-                            if (child_id == invalid_node_t)
-                            {
-                                split = false;
-                                break;
-                            }
-
-                            float child_error = calculate_node_error(view_id, model_id, child_id);
-
-                            if (child_error < min_error_threshold)
-                            {
-                                split = false;
-                                break;
-                            }
-                        }
+                        bool split = is_split_predicted(bvh, batch, children, min_error_threshold);
 
                         if (!split)
                         {
@@ -707,11 +703,14 @@ void cut_update_pool::cut_update_split_again(const cut_update_index::action &spl
     float min_error_threshold = model_thresholds_[split_action.model_id_] - 0.1f;
     float max_error_threshold = model_thresholds_[split_action.model_id_] + 0.1f;
 
+    std::shared_ptr<const std::vector<bool>> provenance_skip_mask = model_database::get_instance()->get_model(split_action.model_id_)->get_provenance_skip_mask();
+    const std::vector<bool>* skip = provenance_skip_mask.get();
+
     for(const auto &candidate_id : candidates)
     {
         float node_error = calculate_node_error(split_action.view_id_, split_action.model_id_, candidate_id);
 
-        if(node_error > max_error_threshold)
+        if(node_error > max_error_threshold && (skip == nullptr || !(*skip)[candidate_id]))
         {
             // only split if the predicted error of children does not require collapsing
             bool split = true;
@@ -793,6 +792,10 @@ void cut_update_pool::cut_update()
             {
                 index_->pop_front_action(cut_update_index::queue_t::MUST_SPLIT);
 
+                ++statistics_.num_splits_;
+                statistics_.ooc_cache_hits_ += child_ids.size();
+                statistics_.gpu_cache_hits_ += child_ids.size();
+
                 for(const auto &child_id : child_ids)
                 {
                     gpu_cache_->aquire_node(context_id_, must_split_action.view_id_, must_split_action.model_id_, child_id);
@@ -1252,6 +1255,8 @@ void cut_update_pool::split_node(const cut_update_index::action &action)
     {
         if(!ooc_cache->is_node_resident(action.model_id_, child_id))
         {
+            ++statistics_.ooc_cache_misses_;
+
             if(all_children_fit_in_ooc_cache)
             {
                 // load child from harddisk
@@ -1262,6 +1267,10 @@ void cut_update_pool::split_node(const cut_update_index::action &action)
             }
             all_children_available = false;
         }
+        else
+        {
+            ++statistics_.ooc_cache_hits_;
+        }
     }
 
     if(all_children_available)
@@ -1270,6 +1279,8 @@ void cut_update_pool::split_node(const cut_update_index::action &action)
         {
             if(!gpu_cache_->is_node_resident(action.model_id_, child_id))
             {
+                ++statistics_.gpu_cache_misses_;
+
                 if(all_children_fit_in_gpu_cache)
                 {
                     // transfer child to gpu
@@ -1292,11 +1303,17 @@ void cut_update_pool::split_node(const cut_update_index::action &action)
                     all_children_available = false;
                 }
             }
+            else
+            {
+                ++statistics_.gpu_cache_hits_;
+            }
         }
     }
 
     if(all_children_available)
     {
+        ++statistics_.num_splits_;
+
         for(const auto &child_id : child_ids)
         {
             gpu_cache_->aquire_node(context_id_, action.view_id_, action.model_id_, child_id);
@@ -1329,15 +1346,56 @@ void cut_update_pool::collapse_node(const cut_update_index::action &action)
 
     ooc_cache *ooc_cache = ooc_cache::get_instance(_data_provenance);
 
+    const replacement_policy_t replacement_policy = gpu_cache_->replacement_policy();
+
     for(const auto &child_id : child_ids)
     {
+        // tell the caches how valuable the released children are
+        if(replacement_policy == replacement_policy_t::SCREEN_SPACE_ERROR || replacement_policy == replacement_policy_t::DISTANCE)
+        {
+            float priority = action.error_;
+            if(replacement_policy == replacement_policy_t::DISTANCE)
+            {
+                priority = -calculate_node_distance(action.view_id_, action.model_id_, child_id);
+            }
+
+            gpu_cache_->set_node_priority(action.model_id_, child_id, priority);
+            ooc_cache->set_node_priority(action.model_id_, child_id, priority);
+        }
+
         gpu_cache_->release_node(context_id_, action.view_id_, action.model_id_, child_id);
         ooc_cache->release_node(context_id_, action.view_id_, action.model_id_, child_id);
     }
 
+    ++statistics_.num_collapses_;
+
     index_->approve_action(action);
 }
 
+const bool cut_update_pool::is_split_predicted(const bvh *bvh, const node_batch &batch, const std::vector<node_t> &children, const float min_error_threshold)
+{
+    for(const auto &child_id : children)
+    {
+        if(child_id == invalid_node_t)
+        {
+            return false;
+        }
+    }
+
+    std::vector<float> child_errors;
+    batch.calculate_errors(bvh, children, child_errors);
+
+    for(const auto child_error : child_errors)
+    {
+        if(child_error < min_error_threshold)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 const bool cut_update_pool::is_all_nodes_in_cut(const model_t model_id, const std::vector<node_t> &node_ids, const std::set<node_t> &cut)
 {
     for(node_t i = 0; i < node_ids.size(); ++i)
@@ -1422,6 +1480,18 @@ const float cut_update_pool::calculate_node_error(const view_t view_id, const mo
     return error;
 }
 
+const float cut_update_pool::calculate_node_distance(const view_t view_id, const model_t model_id, const node_t node_id)
+{
+    model_database *database = model_database::get_instance();
+    auto bvh = database->get_model(model_id)->get_bvh();
+
+    const scm::math::mat4f &model_matrix = model_transforms_[model_id];
+    const scm::math::mat4f &view_matrix = user_cameras_[view_id].get_view_matrix();
+
+    scm::math::vec3f view_position = view_matrix * model_matrix * bvh->get_centroids()[node_id];
+    return scm::math::length(view_position);
+}
+
 } // namespace ren
 
 } // namespace lamure
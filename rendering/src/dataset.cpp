@@ -20,6 +20,7 @@ dataset(const std::string& filename)
 : model_id_(invalid_model_t),
   is_loaded_(false),
   bvh_(nullptr),
+  provenance_index_(nullptr),
   transform_(scm::math::mat4f::identity()) {
     load(filename);
 }
@@ -30,6 +31,10 @@ dataset::
         delete bvh_;
         bvh_ = nullptr;
     }
+    if (provenance_index_ != nullptr) {
+        delete provenance_index_;
+        provenance_index_ = nullptr;
+    }
 }
 
 void dataset::
@@ -40,6 +45,16 @@ load(const std::string& filename) {
     if (extension.compare("bvhqz") == 0 || extension.compare("bvh") == 0) {
         bvh_ = new bvh(filename);
         is_loaded_ = true;
+
+        if (extension.compare("bvh") == 0) {
+            provenance_index* index = new provenance_index();
+            if (index->load(filename.substr(0, filename.size() - 3) + "pidx") && index->num_nodes() == bvh_->get_num_nodes()) {
+                provenance_index_ = index;
+            }
+            else {
+                delete index;
+            }
+        }
     }
     else {
         throw std::runtime_error(
@@ -48,6 +63,22 @@ load(const std::string& filename) {
     
 }
 
+void dataset::
+set_provenance_filter(const std::vector<provenance_index::predicate>& predicates) {
+    std::shared_ptr<const std::vector<bool>> skip_mask;
+    if (provenance_index_ != nullptr && !predicates.empty()) {
+        auto mask = std::make_shared<std::vector<bool>>();
+        provenance_index_->get_skippable_nodes(predicates, *mask);
+        skip_mask = mask;
+    }
+    std::atomic_store(&provenance_skip_mask_, skip_mask);
+}
+
+std::shared_ptr<const std::vector<bool>> dataset::
+get_provenance_skip_mask() const {
+    return std::atomic_load(&provenance_skip_mask_);
+}
+
 
 } // namespace ren
 
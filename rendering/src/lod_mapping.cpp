@@ -0,0 +1,207 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/lod_mapping.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace lamure
+{
+namespace ren
+{
+namespace
+{
+const size_t page_size()
+{
+#ifndef _WIN32
+    static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+#else
+    static const size_t size = 4096;
+#endif
+    return size;
+}
+
+//expands [begin, begin+length) to page boundaries
+void page_range(const char* const begin, const size_t length_in_bytes, char*& page_begin, size_t& page_length)
+{
+    uintptr_t address = (uintptr_t)begin;
+    uintptr_t first = address & ~(uintptr_t)(page_size() - 1);
+    uintptr_t last = address + length_in_bytes;
+
+    page_begin = (char*)first;
+    page_length = (size_t)(last - first);
+}
+}
+
+lod_mapping::lod_mapping() : data_(nullptr), size_(0), mapped_(false) {}
+
+lod_mapping::~lod_mapping()
+{
+    try
+    {
+        close();
+    }
+    catch(...)
+    {
+    }
+}
+
+void lod_mapping::open(const std::string &file_name)
+{
+    close();
+
+    file_name_ = file_name;
+
+#ifndef _WIN32
+    int fd = ::open(file_name_.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        throw std::runtime_error("lamure: lod_mapping::Unable to open file: " + file_name_);
+    }
+
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("lamure: lod_mapping::Unable to stat file: " + file_name_);
+    }
+
+    void *mapping = mmap(nullptr, (size_t)file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+
+    if(mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("lamure: lod_mapping::Unable to map file: " + file_name_);
+    }
+
+    // nodes are requested in cut order, not sequentially
+    madvise(mapping, (size_t)file_stat.st_size, MADV_RANDOM);
+
+    data_ = (char *)mapping;
+    size_ = (size_t)file_stat.st_size;
+    mapped_ = true;
+#else
+    // no shared mapping, the file is read into a private buffer
+    std::ifstream file(file_name_, std::ios::in | std::ios::binary | std::ios::ate);
+    if(!file.is_open())
+    {
+        throw std::runtime_error("lamure: lod_mapping::Unable to open file: " + file_name_);
+    }
+
+    size_t file_size = (size_t)file.tellg();
+    if(file_size == 0)
+    {
+        throw std::runtime_error("lamure: lod_mapping::Unable to stat file: " + file_name_);
+    }
+
+    buffer_.resize(file_size);
+    file.seekg(0, std::ios::beg);
+    if(!file.read(buffer_.data(), file_size))
+    {
+        buffer_.clear();
+        throw std::runtime_error("lamure: lod_mapping::Unable to read file: " + file_name_);
+    }
+
+    data_ = buffer_.data();
+    size_ = file_size;
+#endif
+}
+
+void lod_mapping::close()
+{
+    if(data_ != nullptr)
+    {
+#ifndef _WIN32
+        if(mapped_)
+        {
+            munmap(data_, size_);
+        }
+#endif
+        buffer_.clear();
+        buffer_.shrink_to_fit();
+
+        data_ = nullptr;
+        mapped_ = false;
+        size_ = 0;
+        file_name_ = "";
+    }
+}
+
+const bool lod_mapping::is_resident(const char *const begin, const size_t length_in_bytes)
+{
+    if(length_in_bytes == 0)
+    {
+        return true;
+    }
+
+#ifndef _WIN32
+    char *page_begin;
+    size_t page_length;
+    page_range(begin, length_in_bytes, page_begin, page_length);
+
+    std::vector<unsigned char> residency((page_length + page_size() - 1) / page_size());
+    if(mincore(page_begin, page_length, residency.data()) != 0)
+    {
+        return false;
+    }
+
+    for(const auto page : residency)
+    {
+        if(!(page & 1))
+        {
+            return false;
+        }
+    }
+#endif
+
+    return true;
+}
+
+void lod_mapping::will_need(const char *const begin, const size_t length_in_bytes)
+{
+#ifndef _WIN32
+    char *page_begin;
+    size_t page_length;
+    page_range(begin, length_in_bytes, page_begin, page_length);
+
+    madvise(page_begin, page_length, MADV_WILLNEED);
+#endif
+}
+
+void lod_mapping::touch(const char *const begin, const size_t length_in_bytes)
+{
+    if(length_in_bytes == 0)
+    {
+        return;
+    }
+
+    char *page_begin;
+    size_t page_length;
+    page_range(begin, length_in_bytes, page_begin, page_length);
+
+    volatile char sink = 0;
+    for(size_t offset = 0; offset < page_length; offset += page_size())
+    {
+        sink += page_begin[offset];
+    }
+    (void)sink;
+}
+
+} // namespace ren
+
+} // namespace lamure
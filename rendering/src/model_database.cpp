@@ -8,6 +8,12 @@
 #include <lamure/ren/model_database.h>
 #include <lamure/ren/controller.h>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <unordered_set>
+
 namespace lamure
 {
 
@@ -79,6 +85,99 @@ add_model(const std::string& filepath, const std::string& model_key) {
 
     dataset* model = new dataset(filepath);
 
+    model_t model_id = register_model(model, filepath, model_key);
+
+    controller::get_instance()->signal_system_reset();
+
+    return model_id;
+
+}
+
+const std::vector<model_t> model_database::
+add_models(const std::vector<std::string>& filepaths, const std::vector<std::string>& model_keys) {
+
+    if (filepaths.size() != model_keys.size()) {
+        throw std::runtime_error(
+            "lamure: model_database::Number of model files and model keys differ");
+    }
+
+    const size_t num_models = filepaths.size();
+
+    std::vector<dataset*> models(num_models, nullptr);
+    std::vector<std::exception_ptr> errors(num_models);
+
+    //only the first occurrence of a key that is not present yet is loaded
+    std::vector<size_t> models_to_load;
+    std::unordered_set<std::string> keys_to_load;
+    for (size_t i = 0; i < num_models; ++i) {
+        if (!controller::get_instance()->is_model_present(model_keys[i]) &&
+            keys_to_load.insert(model_keys[i]).second) {
+            models_to_load.push_back(i);
+        }
+    }
+
+    //loading the bvh files is independent, registration below is not
+    std::atomic<size_t> next_model(0);
+    auto load_models = [&]() {
+        size_t k = 0;
+        while ((k = next_model++) < models_to_load.size()) {
+            const size_t i = models_to_load[k];
+            try {
+                models[i] = new dataset(filepaths[i]);
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    size_t num_threads = std::min((size_t)std::max(std::thread::hardware_concurrency(), 1u), models_to_load.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) {
+        threads.push_back(std::thread(load_models));
+    }
+    load_models();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < num_models; ++i) {
+        if (errors[i]) {
+            for (auto model : models) {
+                delete model;
+            }
+            std::rethrow_exception(errors[i]);
+        }
+    }
+
+    //models are registered in input order, so ids are the same as with add_model
+    std::vector<model_t> model_ids(num_models, invalid_model_t);
+    bool reset = false;
+
+    for (size_t i = 0; i < num_models; ++i) {
+        if (controller::get_instance()->is_model_present(model_keys[i])) {
+            //key was already present or appears twice in this batch
+            delete models[i];
+            models[i] = nullptr;
+            model_ids[i] = controller::get_instance()->deduce_model_id(model_keys[i]);
+            continue;
+        }
+        model_ids[i] = register_model(models[i], filepaths[i], model_keys[i]);
+        models[i] = nullptr;
+        reset = true;
+    }
+
+    if (reset) {
+        controller::get_instance()->signal_system_reset();
+    }
+
+    return model_ids;
+
+}
+
+const model_t model_database::
+register_model(dataset* model, const std::string& filepath, const std::string& model_key) {
+
     if (model->is_loaded()) {
         const bvh* bvh = model->get_bvh();
 
@@ -115,8 +214,6 @@ add_model(const std::string& filepath, const std::string& model_key) {
 
             num_datasets_ = num_datasets_pending_;
             primitives_per_node_ = primitives_per_node_pending_;
-
-            controller::get_instance()->signal_system_reset();
         }
 
         switch (bvh->get_primitive()) {
@@ -0,0 +1,194 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/node_batch.h>
+
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define LAMURE_NODE_BATCH_ENABLE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace lamure
+{
+
+namespace ren
+{
+
+node_batch::
+node_batch()
+: error_scale_(0.f) {
+    for (int i = 0; i < 4; ++i) {
+        depth_row_[i] = 0.f;
+    }
+    for (int p = 0; p < 6; ++p) {
+        for (int i = 0; i < 4; ++i) {
+            planes_[p][i] = 0.f;
+        }
+    }
+}
+
+node_batch::
+node_batch(const scm::math::mat4f& model_matrix,
+           const scm::math::mat4f& view_matrix,
+           const scm::math::mat4f& projection_matrix,
+           const float near_plane,
+           const float height_divided_by_top_minus_bottom) {
+
+    //matrices are column major, element (row, col) is at [col * 4 + row]
+    scm::math::mat4f view_model = view_matrix * model_matrix;
+    scm::math::mat4f clip = projection_matrix * view_model;
+
+    for (int col = 0; col < 4; ++col) {
+        depth_row_[col] = view_model[col * 4 + 2];
+    }
+
+    float radius_scaling = std::sqrt(model_matrix[0] * model_matrix[0]
+                                   + model_matrix[1] * model_matrix[1]
+                                   + model_matrix[2] * model_matrix[2]);
+
+    error_scale_ = 2.f * radius_scaling * near_plane * height_divided_by_top_minus_bottom;
+
+    //extract planes from the rows of the clip matrix
+    for (int axis = 0; axis < 3; ++axis) {
+        for (int col = 0; col < 4; ++col) {
+            float w = clip[col * 4 + 3];
+            float a = clip[col * 4 + axis];
+            planes_[axis * 2 + 0][col] = w + a;
+            planes_[axis * 2 + 1][col] = w - a;
+        }
+    }
+}
+
+const float node_batch::
+calculate_error(const bvh* bvh, const node_t node_id) const {
+    const vec3f& centroid = bvh->get_centroids()[node_id];
+    float depth = (depth_row_[0] * centroid.x + depth_row_[1] * centroid.y) + (depth_row_[2] * centroid.z + depth_row_[3]);
+    return std::abs(error_scale_ * bvh->get_avg_primitive_extents()[node_id] / depth);
+}
+
+const bool node_batch::
+is_in_frustum(const bvh* bvh, const node_t node_id) const {
+    const scm::gl::boxf& box = bvh->get_bounding_boxes()[node_id];
+    const scm::math::vec3f& min_vertex = box.min_vertex();
+    const scm::math::vec3f& max_vertex = box.max_vertex();
+
+    for (int p = 0; p < 6; ++p) {
+        const float* plane = planes_[p];
+
+        //the box corner farthest along the plane normal
+        float x = plane[0] >= 0.f ? max_vertex.x : min_vertex.x;
+        float y = plane[1] >= 0.f ? max_vertex.y : min_vertex.y;
+        float z = plane[2] >= 0.f ? max_vertex.z : min_vertex.z;
+
+        if ((plane[0] * x + plane[1] * y) + (plane[2] * z + plane[3]) < 0.f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void node_batch::
+calculate_errors(const bvh* bvh, const std::vector<node_t>& node_ids, std::vector<float>& errors) const {
+    const size_t num_nodes = node_ids.size();
+    errors.resize(num_nodes);
+
+    size_t i = 0;
+
+#ifdef LAMURE_NODE_BATCH_ENABLE_SSE
+    const std::vector<vec3f>& centroids = bvh->get_centroids();
+    const std::vector<float>& extents = bvh->get_avg_primitive_extents();
+
+    const __m128 row_x = _mm_set1_ps(depth_row_[0]);
+    const __m128 row_y = _mm_set1_ps(depth_row_[1]);
+    const __m128 row_z = _mm_set1_ps(depth_row_[2]);
+    const __m128 row_w = _mm_set1_ps(depth_row_[3]);
+    const __m128 scale = _mm_set1_ps(error_scale_);
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+
+    for (; i + 4 <= num_nodes; i += 4) {
+        const vec3f& c0 = centroids[node_ids[i + 0]];
+        const vec3f& c1 = centroids[node_ids[i + 1]];
+        const vec3f& c2 = centroids[node_ids[i + 2]];
+        const vec3f& c3 = centroids[node_ids[i + 3]];
+
+        __m128 x = _mm_set_ps(c3.x, c2.x, c1.x, c0.x);
+        __m128 y = _mm_set_ps(c3.y, c2.y, c1.y, c0.y);
+        __m128 z = _mm_set_ps(c3.z, c2.z, c1.z, c0.z);
+        __m128 extent = _mm_set_ps(extents[node_ids[i + 3]], extents[node_ids[i + 2]],
+                                   extents[node_ids[i + 1]], extents[node_ids[i + 0]]);
+
+        __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row_x, x), _mm_mul_ps(row_y, y)),
+                                  _mm_add_ps(_mm_mul_ps(row_z, z), row_w));
+
+        __m128 error = _mm_div_ps(_mm_mul_ps(scale, extent), depth);
+        _mm_storeu_ps(&errors[i], _mm_andnot_ps(sign_mask, error));
+    }
+#endif
+
+    for (; i < num_nodes; ++i) {
+        errors[i] = calculate_error(bvh, node_ids[i]);
+    }
+}
+
+void node_batch::
+cull(const bvh* bvh, const std::vector<node_t>& node_ids, std::vector<bool>& in_frustum) const {
+    const size_t num_nodes = node_ids.size();
+    in_frustum.resize(num_nodes);
+
+    size_t i = 0;
+
+#ifdef LAMURE_NODE_BATCH_ENABLE_SSE
+    const std::vector<scm::gl::boxf>& boxes = bvh->get_bounding_boxes();
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= num_nodes; i += 4) {
+        const scm::gl::boxf& b0 = boxes[node_ids[i + 0]];
+        const scm::gl::boxf& b1 = boxes[node_ids[i + 1]];
+        const scm::gl::boxf& b2 = boxes[node_ids[i + 2]];
+        const scm::gl::boxf& b3 = boxes[node_ids[i + 3]];
+
+        __m128 min_x = _mm_set_ps(b3.min_vertex().x, b2.min_vertex().x, b1.min_vertex().x, b0.min_vertex().x);
+        __m128 min_y = _mm_set_ps(b3.min_vertex().y, b2.min_vertex().y, b1.min_vertex().y, b0.min_vertex().y);
+        __m128 min_z = _mm_set_ps(b3.min_vertex().z, b2.min_vertex().z, b1.min_vertex().z, b0.min_vertex().z);
+        __m128 max_x = _mm_set_ps(b3.max_vertex().x, b2.max_vertex().x, b1.max_vertex().x, b0.max_vertex().x);
+        __m128 max_y = _mm_set_ps(b3.max_vertex().y, b2.max_vertex().y, b1.max_vertex().y, b0.max_vertex().y);
+        __m128 max_z = _mm_set_ps(b3.max_vertex().z, b2.max_vertex().z, b1.max_vertex().z, b0.max_vertex().z);
+
+        __m128 outside = _mm_setzero_ps();
+
+        for (int p = 0; p < 6; ++p) {
+            const float* plane = planes_[p];
+
+            __m128 x = plane[0] >= 0.f ? max_x : min_x;
+            __m128 y = plane[1] >= 0.f ? max_y : min_y;
+            __m128 z = plane[2] >= 0.f ? max_z : min_z;
+
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), x), _mm_mul_ps(_mm_set1_ps(plane[1]), y)),
+                                         _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), z), _mm_set1_ps(plane[3])));
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+        }
+
+        int outside_mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; ++lane) {
+            in_frustum[i + lane] = !((outside_mask >> lane) & 1);
+        }
+    }
+#endif
+
+    for (; i < num_nodes; ++i) {
+        in_frustum[i] = is_in_frustum(bvh, node_ids[i]);
+    }
+}
+
+
+} // namespace ren
+
+} // namespace lamure
@@ -15,27 +15,43 @@ std::mutex ooc_cache::mutex_;
 bool ooc_cache::is_instanced_ = false;
 ooc_cache *ooc_cache::single_ = nullptr;
 
-ooc_cache::ooc_cache(const slot_t num_slots, Data_Provenance const &data_provenance) : cache(num_slots), maintenance_counter_(0)
+ooc_cache::ooc_cache(const slot_t num_slots, Data_Provenance const &data_provenance)
+    : cache(num_slots), cache_data_(nullptr), cache_data_provenance_(nullptr), memory_mapped_(policy::get_instance()->out_of_core_memory_mapped()), maintenance_counter_(0)
 {
     model_database *database = model_database::get_instance();
 
     size_t slot_size_provenance = database->get_primitives_per_node() * data_provenance.get_size_in_bytes();
 
-    cache_data_ = new char[num_slots * database->get_slot_size()];
-    cache_data_provenance_ = new char[num_slots * slot_size_provenance];
-    pool_ = new ooc_pool(LAMURE_CUT_UPDATE_NUM_LOADING_THREADS, database->get_slot_size(), slot_size_provenance, data_provenance);
+    if(memory_mapped_)
+    {
+        map_model_files(true);
+    }
+    else
+    {
+        cache_data_ = new char[num_slots * database->get_slot_size()];
+        cache_data_provenance_ = new char[num_slots * slot_size_provenance];
+    }
+    pool_ = new ooc_pool(LAMURE_CUT_UPDATE_NUM_LOADING_THREADS, database->get_slot_size(), slot_size_provenance, data_provenance, memory_mapped_);
 
 #ifdef LAMURE_ENABLE_INFO
     std::cout << "lamure: ooc-cache init (WITH PROVENANCE)" << std::endl;
 #endif
 }
 
-ooc_cache::ooc_cache(const slot_t num_slots) : cache(num_slots), maintenance_counter_(0)
+ooc_cache::ooc_cache(const slot_t num_slots)
+    : cache(num_slots), cache_data_(nullptr), cache_data_provenance_(nullptr), memory_mapped_(policy::get_instance()->out_of_core_memory_mapped()), maintenance_counter_(0)
 {
     model_database *database = model_database::get_instance();
 
-    cache_data_ = new char[num_slots * database->get_slot_size()];
-    pool_ = new ooc_pool(LAMURE_CUT_UPDATE_NUM_LOADING_THREADS, database->get_slot_size());
+    if(memory_mapped_)
+    {
+        map_model_files(false);
+    }
+    else
+    {
+        cache_data_ = new char[num_slots * database->get_slot_size()];
+    }
+    pool_ = new ooc_pool(LAMURE_CUT_UPDATE_NUM_LOADING_THREADS, database->get_slot_size(), memory_mapped_);
 
 #ifdef LAMURE_ENABLE_INFO
     std::cout << "lamure: ooc-cache init (WITHOUT PROVENANCE)" << std::endl;
@@ -66,6 +82,18 @@ ooc_cache::~ooc_cache()
         cache_data_provenance_ = nullptr;
     }
 
+    for(auto mapping : lod_mappings_)
+    {
+        delete mapping;
+    }
+    lod_mappings_.clear();
+
+    for(auto mapping : provenance_mappings_)
+    {
+        delete mapping;
+    }
+    provenance_mappings_.clear();
+
 #ifdef LAMURE_ENABLE_INFO
     std::cout << "lamure: ooc-cache shutdown" << std::endl;
 #endif
@@ -97,6 +125,11 @@ ooc_cache *ooc_cache::get_instance(Data_Provenance const &data_provenance)
                 std::cout << "##### Total free memory (" << ram_free_in_bytes / (1024 * 1024) << " MB) will be used for the out of core budget #####" << std::endl;
                 out_of_core_budget_in_bytes = ram_free_in_bytes;
             }
+            else if(policy->out_of_core_memory_mapped())
+            {
+                // mapped pages live in the shared page cache and are reclaimed by the kernel
+                std::cout << "##### " << policy->out_of_core_budget_in_mb() << " MB of shared mappings will be used for the out of core budget #####" << std::endl;
+            }
             else if(ram_free_in_bytes < out_of_core_budget_in_bytes)
             {
                 std::cout << "##### The specified out of core budget is too large! " << ram_free_in_bytes / (1024 * 1024) << " MB will be used for the out of core budget #####" << std::endl;
@@ -152,6 +185,11 @@ ooc_cache *ooc_cache::get_instance()
                 std::cout << "##### Total free memory (" << ram_free_in_bytes / (1024 * 1024) << " MB) will be used for the out of core budget #####" << std::endl;
                 out_of_core_budget_in_bytes = ram_free_in_bytes;
             }
+            else if(policy->out_of_core_memory_mapped())
+            {
+                // mapped pages live in the shared page cache and are reclaimed by the kernel
+                std::cout << "##### " << policy->out_of_core_budget_in_mb() << " MB of shared mappings will be used for the out of core budget #####" << std::endl;
+            }
             else if(ram_free_in_bytes < out_of_core_budget_in_bytes)
             {
                 std::cout << "##### The specified out of core budget is too large! " << ram_free_in_bytes / (1024 * 1024) << " MB will be used for the out of core budget #####" << std::endl;
@@ -192,8 +230,28 @@ void ooc_cache::register_node(const model_t model_id, const node_t node_id, cons
         Data_Provenance data_provenance;
         model_database *database = model_database::get_instance();
         slot_t slot_id = index_->reserve_slot();
-        cache_queue::job job(model_id, node_id, slot_id, priority, cache_data_ + slot_id * slot_size(),
-                             cache_data_provenance_ + slot_id * database->get_primitives_per_node() * data_provenance.get_size_in_bytes());
+
+        char *slot_mem = nullptr;
+        char *slot_mem_provenance = nullptr;
+        if(memory_mapped_)
+        {
+            slot_mem = node_data_mapped(model_id, node_id);
+            slot_mem_provenance = node_data_provenance_mapped(model_id, node_id);
+
+            // the node lies outside of the mapped files, the request is dropped
+            if(slot_mem == nullptr || (!provenance_mappings_.empty() && slot_mem_provenance == nullptr))
+            {
+                index_->unreserve_slot(slot_id);
+                break;
+            }
+        }
+        else
+        {
+            slot_mem = cache_data_ + slot_id * slot_size();
+            slot_mem_provenance = cache_data_provenance_ + slot_id * database->get_primitives_per_node() * data_provenance.get_size_in_bytes();
+        }
+
+        cache_queue::job job(model_id, node_id, slot_id, priority, slot_mem, slot_mem_provenance);
         if(!pool_->acknowledge_request(job))
         {
             index_->unreserve_slot(slot_id);
@@ -216,20 +274,103 @@ void ooc_cache::register_node(const model_t model_id, const node_t node_id, cons
 }
 
 char *ooc_cache::node_data(const model_t model_id, const node_t node_id) { 
+    if(memory_mapped_)
+    {
+        // the slot only pins the node, its data stays in the mapping
+        index_->get_slot(model_id, node_id);
+        return node_data_mapped(model_id, node_id);
+    }
     return cache_data_ + index_->get_slot(model_id, node_id) * slot_size(); 
 }
 
 char *ooc_cache::node_data_provenance(const model_t model_id, const node_t node_id)
 {
+    if(memory_mapped_)
+    {
+        index_->get_slot(model_id, node_id);
+        return node_data_provenance_mapped(model_id, node_id);
+    }
+
     model_database *database = model_database::get_instance();
     Data_Provenance data_provenance;
     return cache_data_provenance_ + index_->get_slot(model_id, node_id) * database->get_primitives_per_node() * data_provenance.get_size_in_bytes();
 }
 
+char *ooc_cache::node_data_mapped(const model_t model_id, const node_t node_id)
+{
+    model_database *database = model_database::get_instance();
+    node_t file_index = database->get_model(model_id)->get_bvh()->get_file_index(node_id);
+    size_t node_size = database->get_node_size(model_id);
+    size_t offset_in_bytes = file_index * node_size;
+
+    if(offset_in_bytes > lod_mappings_[model_id]->size() || node_size > lod_mappings_[model_id]->size() - offset_in_bytes)
+    {
+        return nullptr;
+    }
+
+    return lod_mappings_[model_id]->data() + offset_in_bytes;
+}
+
+char *ooc_cache::node_data_provenance_mapped(const model_t model_id, const node_t node_id)
+{
+    if(provenance_mappings_.empty())
+    {
+        return nullptr;
+    }
+
+    model_database *database = model_database::get_instance();
+    Data_Provenance data_provenance;
+    node_t file_index = database->get_model(model_id)->get_bvh()->get_file_index(node_id);
+    size_t node_size = database->get_primitives_per_node(model_id) * data_provenance.get_size_in_bytes();
+    size_t offset_in_bytes = file_index * node_size;
+
+    if(offset_in_bytes > provenance_mappings_[model_id]->size() || node_size > provenance_mappings_[model_id]->size() - offset_in_bytes)
+    {
+        return nullptr;
+    }
+
+    return provenance_mappings_[model_id]->data() + offset_in_bytes;
+}
+
+void ooc_cache::map_model_files(const bool provenance)
+{
+    model_database *database = model_database::get_instance();
+
+    for(model_t model_id = 0; model_id < database->num_models(); ++model_id)
+    {
+        lod_mapping *mapping = new lod_mapping();
+        mapping->open(ooc_pool::lod_file_name(model_id));
+        lod_mappings_.push_back(mapping);
+
+        if(provenance)
+        {
+            lod_mapping *mapping_provenance = new lod_mapping();
+            mapping_provenance->open(ooc_pool::provenance_file_name(model_id));
+            provenance_mappings_.push_back(mapping_provenance);
+        }
+    }
+
+#ifdef LAMURE_ENABLE_INFO
+    std::cout << "lamure: ooc-cache serves " << lod_mappings_.size() << " models from shared mappings" << std::endl;
+#endif
+}
+
 const bool ooc_cache::is_node_resident_and_aquired(const model_t model_id, const node_t node_id) { 
     return index_->is_node_aquired(model_id, node_id); 
 }
 
+void ooc_cache::get_aquired_node_data(std::vector<model_t> &model_ids, std::vector<node_t> &node_ids, std::vector<char *> &data)
+{
+    std::vector<slot_t> slot_ids;
+    index_->get_aquired_nodes(model_ids, node_ids, slot_ids);
+
+    data.resize(slot_ids.size());
+    for(size_t i = 0; i < slot_ids.size(); ++i)
+    {
+        data[i] = memory_mapped_ ? node_data_mapped(model_ids[i], node_ids[i]) : cache_data_ + slot_ids[i] * slot_size();
+    }
+}
+
 void ooc_cache::refresh()
 {
     pool_->lock();
@@ -263,6 +404,8 @@ void ooc_cache::begin_measure() { pool_->begin_measure(); }
 
 void ooc_cache::end_measure() { pool_->end_measure(); }
 
+const size_t ooc_cache::bytes_loaded() { return pool_->bytes_loaded(); }
+
 } // namespace ren
 
 } // namespace lamure
@@ -11,7 +11,8 @@ namespace lamure
 {
 namespace ren
 {
-ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_bytes) : locked_(false), size_of_slot_(size_of_slot_in_bytes), num_threads_(num_threads), shutdown_(false), bytes_loaded_(0)
+ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_bytes, const bool memory_mapped)
+    : locked_(false), size_of_slot_(size_of_slot_in_bytes), num_threads_(num_threads), shutdown_(false), memory_mapped_(memory_mapped), bytes_loaded_(0)
 {
     assert(num_threads_ > 0);
 
@@ -29,8 +30,10 @@ ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_byte
     }
 }
 
-ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_bytes, const size_t size_of_slot_provenance, Data_Provenance const &data_provenance)
-    : locked_(false), size_of_slot_(size_of_slot_in_bytes), size_of_slot_provenance_(size_of_slot_provenance), num_threads_(num_threads), shutdown_(false), bytes_loaded_(0)
+ooc_pool::ooc_pool(const uint32_t num_threads, const size_t size_of_slot_in_bytes, const size_t size_of_slot_provenance, Data_Provenance const &data_provenance,
+                   const bool memory_mapped)
+    : locked_(false), size_of_slot_(size_of_slot_in_bytes), size_of_slot_provenance_(size_of_slot_provenance), num_threads_(num_threads), shutdown_(false),
+      memory_mapped_(memory_mapped), bytes_loaded_(0)
 {
     assert(num_threads_ > 0);
 
@@ -97,6 +100,12 @@ void ooc_pool::end_measure()
     std::cout << "megabytes loaded: " << bytes_loaded_ / 1024 / 1024 << std::endl;
 }
 
+const size_t ooc_pool::bytes_loaded()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_loaded_;
+}
+
 void ooc_pool::run()
 {
     model_database *database = model_database::get_instance();
@@ -106,20 +115,11 @@ void ooc_pool::run()
     std::vector<std::string> provenance_files;
 
     for (model_t model_id = 0; model_id < num_models; ++model_id) {
-        
-        std::string bvh_filename = database->get_model(model_id)->get_bvh()->get_filename();        
-        std::string base_name = bvh_filename.substr(0, bvh_filename.find_last_of(".") + 1);
-        std::string file_extension = bvh_filename.substr(base_name.size());
-        std::string bvh_suffix = file_extension.substr(3);
-        std::string lod_file_name = base_name + "lod" + bvh_suffix;
-        std::string provenance_file_name = bvh_filename.substr(0, bvh_filename.size() - 3) + "prov";
-
-
-        lod_files.push_back(lod_file_name);
+        lod_files.push_back(lod_file_name(model_id));
 
         if(_data_provenance.get_size_in_bytes() > 0)
         {
-            provenance_files.push_back(provenance_file_name);
+            provenance_files.push_back(provenance_file_name(model_id));
         }
     }
 
@@ -145,7 +145,38 @@ void ooc_pool::run()
             // assert(job.slot_mem_provenance_ != nullptr);
 
             size_t stride_in_bytes = database->get_node_size(job.model_id_);
-            size_t offset_in_bytes = job.node_id_ * stride_in_bytes;
+            node_t file_index = database->get_model(job.model_id_)->get_bvh()->get_file_index(job.node_id_);
+            size_t offset_in_bytes = file_index * stride_in_bytes;
+
+            if(memory_mapped_)
+            {
+                // pages another process already brought in are not loaded again
+                size_t bytes_faulted = 0;
+
+                if(!lod_mapping::is_resident(job.slot_mem_, stride_in_bytes))
+                {
+                    lod_mapping::will_need(job.slot_mem_, stride_in_bytes);
+                    lod_mapping::touch(job.slot_mem_, stride_in_bytes);
+                    bytes_faulted += stride_in_bytes;
+                }
+
+                if(_data_provenance.get_size_in_bytes() > 0)
+                {
+                    size_t stride_in_bytes_provenance = database->get_primitives_per_node(job.model_id_) * _data_provenance.get_size_in_bytes();
+
+                    if(!lod_mapping::is_resident(job.slot_mem_provenance_, stride_in_bytes_provenance))
+                    {
+                        lod_mapping::will_need(job.slot_mem_provenance_, stride_in_bytes_provenance);
+                        lod_mapping::touch(job.slot_mem_provenance_, stride_in_bytes_provenance);
+                        bytes_faulted += stride_in_bytes_provenance;
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                bytes_loaded_ += bytes_faulted;
+                history_.push_back(job);
+                continue;
+            }
 
             lod_stream access;
             access.open(lod_files[job.model_id_]);
@@ -164,7 +195,7 @@ void ooc_pool::run()
                 access_provenance.open(provenance_files[job.model_id_]);
                 size_t stride_in_bytes_provenance = database->get_primitives_per_node(job.model_id_) * _data_provenance.get_size_in_bytes();
                 bytes_loaded_ += stride_in_bytes_provenance;
-                size_t offset_in_bytes_provenance = job.node_id_ * stride_in_bytes_provenance;
+                size_t offset_in_bytes_provenance = file_index * stride_in_bytes_provenance;
                 access_provenance.read(local_cache_provenance, offset_in_bytes_provenance, stride_in_bytes_provenance);
                 access_provenance.close();
                 memcpy(job.slot_mem_provenance_, local_cache_provenance, stride_in_bytes_provenance);
@@ -190,6 +221,25 @@ void ooc_pool::run()
     }
 }
 
+const std::string ooc_pool::lod_file_name(const model_t model_id)
+{
+    model_database *database = model_database::get_instance();
+
+    std::string bvh_filename = database->get_model(model_id)->get_bvh()->get_filename();
+    std::string base_name = bvh_filename.substr(0, bvh_filename.find_last_of(".") + 1);
+    std::string file_extension = bvh_filename.substr(base_name.size());
+    std::string bvh_suffix = file_extension.substr(3);
+    return base_name + "lod" + bvh_suffix;
+}
+
+const std::string ooc_pool::provenance_file_name(const model_t model_id)
+{
+    model_database *database = model_database::get_instance();
+
+    std::string bvh_filename = database->get_model(model_id)->get_bvh()->get_filename();
+    return bvh_filename.substr(0, bvh_filename.size() - 3) + "prov";
+}
+
 void ooc_pool::resolve_cache_history(cache_index *index)
 {
     assert(locked_);
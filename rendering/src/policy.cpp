@@ -26,6 +26,8 @@ policy()
   render_budget_in_mb_(LAMURE_DEFAULT_VIDEO_MEMORY_BUDGET),
   out_of_core_budget_in_mb_(LAMURE_DEFAULT_MAIN_MEMORY_BUDGET),
   size_of_provenance_(LAMURE_DEFAULT_SIZE_OF_PROVENANCE),
+  out_of_core_memory_mapped_(false),
+  cache_replacement_policy_(replacement_policy_t::LRU),
   window_width_(800),
   window_height_(600) {
 
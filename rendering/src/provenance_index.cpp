@@ -0,0 +1,174 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/provenance_index.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace lamure {
+namespace ren {
+
+provenance_index::
+provenance_index()
+: num_nodes_(0),
+  fan_factor_(0),
+  num_attributes_(0),
+  num_bins_(0) {
+
+}
+
+bool provenance_index::
+load(const std::string& file_name) {
+    num_nodes_ = 0;
+
+    std::ifstream is(file_name, std::ios::in | std::ios::binary);
+    if (!is.is_open()) {
+        return false;
+    }
+
+    uint32_t header[6];
+    is.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!is || header[0] != magic || header[1] != version ||
+        header[3] == 0 || header[4] == 0 || header[5] == 0 || header[5] > max_num_bins) {
+        return false;
+    }
+
+    const uint32_t num_nodes = header[2];
+    fan_factor_ = header[3];
+    num_attributes_ = header[4];
+    num_bins_ = header[5];
+
+    ranges_.resize(2 * num_attributes_);
+    is.read(reinterpret_cast<char*>(ranges_.data()), ranges_.size() * sizeof(float));
+
+    const size_t record_size = 3 + num_bins_;
+    std::vector<uint32_t> records(size_t(num_nodes) * num_attributes_ * record_size);
+    is.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(uint32_t));
+    if (!is) {
+        return false;
+    }
+
+    summaries_.resize(size_t(num_nodes) * num_attributes_);
+    histograms_.resize(summaries_.size() * num_bins_);
+
+    for (size_t i = 0; i < summaries_.size(); ++i) {
+        const uint32_t* record = records.data() + i * record_size;
+        summary& s = summaries_[i];
+        std::memcpy(&s.min_, &record[0], sizeof(float));
+        std::memcpy(&s.max_, &record[1], sizeof(float));
+        s.count_ = record[2];
+        s.occupied_bins_ = 0;
+        for (uint32_t b = 0; b < num_bins_; ++b) {
+            histograms_[i * num_bins_ + b] = record[3 + b];
+            if (record[3 + b] != 0) {
+                s.occupied_bins_ |= 1u << b;
+            }
+        }
+    }
+
+    // children have higher ids than their parents, so one backward pass
+    // accumulates whole subtrees
+    subtree_summaries_ = summaries_;
+    for (size_t node_id = num_nodes; node_id-- > 1;) {
+        const size_t parent_id = (node_id - 1) / fan_factor_;
+        for (uint32_t a = 0; a < num_attributes_; ++a) {
+            const summary& child = subtree_summaries_[node_id * num_attributes_ + a];
+            summary& parent = subtree_summaries_[parent_id * num_attributes_ + a];
+            if (child.count_ == 0) {
+                continue;
+            }
+            parent.min_ = parent.count_ == 0 ? child.min_ : std::min(parent.min_, child.min_);
+            parent.max_ = parent.count_ == 0 ? child.max_ : std::max(parent.max_, child.max_);
+            parent.count_ += child.count_;
+            parent.occupied_bins_ |= child.occupied_bins_;
+        }
+    }
+
+    num_nodes_ = num_nodes;
+    return true;
+}
+
+const provenance_index::summary& provenance_index::
+get_summary(const node_t node_id, const uint32_t attribute) const {
+    return summaries_[size_t(node_id) * num_attributes_ + attribute];
+}
+
+const provenance_index::summary& provenance_index::
+get_subtree_summary(const node_t node_id, const uint32_t attribute) const {
+    return subtree_summaries_[size_t(node_id) * num_attributes_ + attribute];
+}
+
+const uint32_t* provenance_index::
+get_histogram(const node_t node_id, const uint32_t attribute) const {
+    return histograms_.data() + (size_t(node_id) * num_attributes_ + attribute) * num_bins_;
+}
+
+const bool provenance_index::
+can_skip_node(const node_t node_id, const std::vector<predicate>& predicates) const {
+    return node_id < num_nodes_ && can_skip(&summaries_[size_t(node_id) * num_attributes_], predicates);
+}
+
+const bool provenance_index::
+can_skip_subtree(const node_t node_id, const std::vector<predicate>& predicates) const {
+    return node_id < num_nodes_ && can_skip(&subtree_summaries_[size_t(node_id) * num_attributes_], predicates);
+}
+
+void provenance_index::
+get_skippable_nodes(const std::vector<predicate>& predicates, std::vector<bool>& skippable) const {
+    skippable.assign(num_nodes_, false);
+    for (node_t node_id = 0; node_id < num_nodes_; ++node_id) {
+        skippable[node_id] = can_skip_subtree(node_id, predicates);
+    }
+}
+
+const bool provenance_index::
+can_skip(const summary* summaries, const std::vector<predicate>& predicates) const {
+    for (const auto& p : predicates) {
+        if (p.attribute_ >= num_attributes_) {
+            continue;
+        }
+
+        const summary& s = summaries[p.attribute_];
+        if (s.count_ == 0 || p.max_ < s.min_ || p.min_ > s.max_) {
+            return true;
+        }
+
+        // values in [min_, max_] fall into the bins between those of the bounds
+        const float range_min = get_range_min(p.attribute_);
+        const float range_max = get_range_max(p.attribute_);
+        const uint32_t first_bin = bin_index(std::max(p.min_, range_min), range_min, range_max, num_bins_);
+        const uint32_t last_bin = bin_index(std::min(p.max_, range_max), range_min, range_max, num_bins_);
+        const uint32_t upper = last_bin + 1 < 32 ? (1u << (last_bin + 1)) - 1 : ~0u;
+        const uint32_t bins = upper & ~((1u << first_bin) - 1);
+        if ((s.occupied_bins_ & bins) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t provenance_index::
+bin_index(const float value, const float range_min, const float range_max, const uint32_t num_bins) {
+    // same arithmetic as the preprocessing
+    if (!(range_max > range_min)) {
+        return 0;
+    }
+
+    const float bin = (value - range_min) / (range_max - range_min) * float(num_bins);
+    if (!(bin > 0.f)) {
+        return 0;
+    }
+    if (bin >= float(num_bins)) {
+        return num_bins - 1;
+    }
+    return uint32_t(bin);
+}
+
+} } // namespace lamure
@@ -6,11 +6,27 @@
 // http://www.uni-weimar.de/medien/vr
 
 #include <lamure/ren/ray.h>
+#include <lamure/ren/ray_packet.h>
+#include <lamure/ren/ray_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
 
 namespace lamure
 {
 namespace ren
 {
+namespace
+{
+// shared by all queries, which are serialized by the ooc_cache lock
+residency_snapshot &shared_residency()
+{
+    static residency_snapshot residency;
+    return residency;
+}
+}
+
 ray::ray() : origin_(scm::math::vec3f::zero()), direction_(scm::math::vec3f::one()), max_distance_(-1.f) {}
 
 ray::ray(const scm::math::vec3f &origin, const scm::math::vec3f &direction, const float max_distance) : origin_(origin), direction_(direction), max_distance_(max_distance) {}
@@ -23,7 +39,9 @@ const bool ray::intersect(const float aabb_scale, scm::math::vec3f &ray_up_vecto
     scm::math::vec3f up_vector = scm::math::normalize(ray_up_vector);
     scm::math::vec3f right_vector = scm::math::normalize(scm::math::cross(up_vector, direction_));
 
-    std::srand(255);
+    // fixed seed, so the same pick always casts the same bundle
+    std::mt19937 generator(255);
+    std::uniform_real_distribution<float> distribution(0.f, 1.f);
 
     std::vector<ray> rays;
 
@@ -39,7 +57,7 @@ const bool ray::intersect(const float aabb_scale, scm::math::vec3f &ray_up_vecto
     {
         if(num_rays < 255)
         {
-            float angle = 2 * 3.1415926535f * (std::rand() / (float)RAND_MAX);
+            float angle = 2 * 3.1415926535f * distribution(generator);
 
             scm::math::mat2f rot;
             rot.m00 = std::cos(angle);
@@ -47,7 +65,7 @@ const bool ray::intersect(const float aabb_scale, scm::math::vec3f &ray_up_vecto
             rot.m02 = -std::sin(angle);
             rot.m03 = rot.m00;
 
-            float r = (std::rand() / (float)RAND_MAX) * bundle_radius;
+            float r = distribution(generator) * bundle_radius;
 
             scm::math::vec2f p0 = rot * scm::math::vec2f(r, 0.f);
             scm::math::vec2f p1 = rot * scm::math::vec2f(-r, 0.f);
@@ -76,56 +94,35 @@ const bool ray::intersect(const float aabb_scale, scm::math::vec3f &ray_up_vecto
     ooc_cache->lock();
     ooc_cache->refresh();
 
-    ray_queue job_queue;
-    for(unsigned int i = 0; i < num_rays; ++i)
-    {
-        job_queue.push_job(ray_queue::ray_job(i, rays[i]));
-    }
-
-    unsigned int num_threads = 16;
+    // one snapshot of the resident nodes for the whole query,
+    // valid as long as the cache lock is held
+    residency_snapshot &residency = shared_residency();
+    residency.capture();
 
-    std::vector<std::thread> threads;
-    for(unsigned int i = 0; i < num_threads; ++i)
-    {
-        threads.push_back(std::thread([&] {
+    const size_t num_packets = (num_rays + LAMURE_RAY_PACKET_SIZE - 1) / LAMURE_RAY_PACKET_SIZE;
 
-            while(true)
-            {
-                job_queue.wait();
-
-                if(job_queue.is_shutdown())
-                {
-                    break;
-                }
+    ray_pool::get_instance()->run(num_packets, [&](const size_t packet_id) {
+        size_t first_ray = packet_id * LAMURE_RAY_PACKET_SIZE;
+        ray_packet packet(&rays[first_ray], std::min((size_t)LAMURE_RAY_PACKET_SIZE, (size_t)num_rays - first_ray));
 
-                ray_queue::ray_job job = job_queue.pop_job();
+        // intersections persist over all models, each model only
+        // replaces hits of lower error
+        ray::intersection temp[LAMURE_RAY_PACKET_SIZE];
+        for(model_t model_id = 0; model_id < database->num_models(); ++model_id)
+        {
+            const scm::math::mat4f &model_transform = database->get_model(model_id)->transform();
+            ray_packet::mask_t hits = packet.intersect_model(residency, model_id, model_transform, max_depth, surfel_skip, false, temp);
 
-                if(job.id_ >= 0)
+            for(size_t i = 0; i < packet.num_rays(); ++i)
+            {
+                if(((hits >> i) & 1) && temp[i].error_ < best_errors[first_ray + i])
                 {
-                    ray &ray = rays[job.id_];
-                    ray::intersection temp;
-                    for(model_t model_id = 0; model_id < database->num_models(); ++model_id)
-                    {
-                        const scm::math::mat4f &model_transform = database->get_model(model_id)->transform();
-                        if(ray.intersect_model_unsafe(model_id, model_transform, aabb_scale, max_depth, surfel_skip, false, temp))
-                        {
-                            if(temp.error_ < best_errors[job.id_])
-                            {
-                                best_errors[job.id_] = temp.error_;
-                                intersections[job.id_] = temp;
-                            }
-                        }
-                    }
+                    best_errors[first_ray + i] = temp[i].error_;
+                    intersections[first_ray + i] = temp[i];
                 }
             }
-
-        }));
-    }
-
-    for(auto &thread : threads)
-    {
-        thread.join();
-    }
+        }
+    });
 
     unsigned int num_rays_hit = 0;
     for(const auto &error : best_errors)
@@ -235,6 +232,70 @@ const bool ray::intersect_model(const model_t model_id, const scm::math::mat4f &
     return result;
 }
 
+const size_t ray::intersect_batch(const std::vector<ray> &rays, const unsigned int max_depth, const unsigned int surfel_skip, const bool is_wysiwyg,
+                                   std::vector<ray::intersection> &intersections, std::vector<uint8_t> &hits)
+{
+    intersections.assign(rays.size(), ray::intersection());
+    hits.assign(rays.size(), 0);
+
+    model_database *database = model_database::get_instance();
+    ooc_cache *ooc_cache = ooc_cache::get_instance();
+    ray_pool *pool = ray_pool::get_instance();
+
+    std::vector<scm::math::mat4f> model_transforms;
+    for(model_t model_id = 0; model_id < database->num_models(); ++model_id)
+    {
+        model_transforms.push_back(database->get_model(model_id)->transform());
+    }
+
+    size_t num_hits = 0;
+
+    // the lock is released between chunks, so the cut update can
+    // continue while long batches are processed
+    for(size_t chunk_begin = 0; chunk_begin < rays.size(); chunk_begin += LAMURE_RAY_BATCH_CHUNK_SIZE)
+    {
+        size_t chunk_end = std::min(chunk_begin + LAMURE_RAY_BATCH_CHUNK_SIZE, rays.size());
+        size_t num_packets = (chunk_end - chunk_begin + LAMURE_RAY_PACKET_SIZE - 1) / LAMURE_RAY_PACKET_SIZE;
+
+        ooc_cache->lock();
+        ooc_cache->refresh();
+
+        residency_snapshot &residency = shared_residency();
+        residency.capture();
+
+        std::atomic<size_t> num_chunk_hits(0);
+
+        pool->run(num_packets, [&](const size_t packet_id) {
+            size_t first_ray = chunk_begin + packet_id * LAMURE_RAY_PACKET_SIZE;
+            ray_packet packet(&rays[first_ray], std::min((size_t)LAMURE_RAY_PACKET_SIZE, chunk_end - first_ray));
+
+            ray_packet::mask_t packet_hits = 0;
+            for(model_t model_id = 0; model_id < (model_t)model_transforms.size(); ++model_id)
+            {
+                packet_hits |= packet.intersect_model(residency, model_id, model_transforms[model_id], max_depth, surfel_skip, is_wysiwyg, &intersections[first_ray]);
+            }
+
+            size_t num_packet_hits = 0;
+            for(size_t i = 0; i < packet.num_rays(); ++i)
+            {
+                if((packet_hits >> i) & 1)
+                {
+                    hits[first_ray + i] = 1;
+                    ++num_packet_hits;
+                }
+            }
+
+            num_chunk_hits += num_packet_hits;
+        });
+
+        ooc_cache->unlock();
+
+        num_hits += num_chunk_hits;
+    }
+
+    return num_hits;
+}
+
 const bool ray::intersect_model_unsafe(const model_t model_id, const scm::math::mat4f &model_transform, const float aabb_scale, const unsigned int max_depth, const unsigned int surfel_skip,
                                        bool is_wysiwyg, ray::intersection &intersection)
 {
@@ -276,8 +337,6 @@ const bool ray::intersect_model_unsafe(const model_t model_id, const scm::math::
     unsigned int valid_max_depth = max_depth == 0 ? 255 : max_depth;
     unsigned int valid_surfel_skip = surfel_skip == 0 ? 1 : surfel_skip;
 
-    float max_intersection_error = 6.f;
-
     while(!candidates.empty())
     {
         node_t current_parent_id = candidates.top();
@@ -401,63 +460,10 @@ const bool ray::intersect_model_unsafe(const model_t model_id, const scm::math::
                 float object_to_world_scale = max_distance_ / object_ray_max_distance;
 
                 dataset::serialized_surfel *surfels = (dataset::serialized_surfel *)ooc_cache->node_data(model_id, node_id);
-                for(unsigned int k = 0; k < num_surfels_per_node; k += valid_surfel_skip)
+                if(intersect_surfels(surfels, num_surfels_per_node, valid_surfel_skip, model_transform, inverse_model_transform, object_ray_origin, object_ray_direction,
+                                     object_to_world_scale, is_wysiwyg, intersection))
                 {
-                    dataset::serialized_surfel &surfel = surfels[k];
-
-                    if(surfel.size >= std::numeric_limits<float>::min())
-                    {
-                        float ts = -1.f;
-                        if(intersect_surfel(surfel, object_ray_origin, object_ray_direction, ts))
-                        {
-                            if(ts != ts || ts <= 0.f)
-                            {
-                                continue;
-                            }
-
-                            scm::math::vec3f splat_plane_intersection = origin_ + direction_ * ts * object_to_world_scale;
-                            scm::math::vec3f splat_position = model_transform * scm::math::vec3f(surfel.x, surfel.y, surfel.z);
-                            float splat_plane_distance = scm::math::length(splat_position - splat_plane_intersection);
-
-                            if(scm::math::length(splat_position - origin_) < max_distance_)
-                            {
-                                if(surfel.size <= std::numeric_limits<float>::min())
-                                {
-                                    continue;
-                                }
-
-                                if(is_wysiwyg)
-                                {
-                                    if(splat_plane_distance > object_to_world_scale * surfel.size * LAMURE_WYSIWYG_SPLAT_SCALE)
-                                    {
-                                        continue;
-                                    }
-                                }
-
-                                float intersection_distance = scm::math::length(splat_plane_intersection - origin_);
-                                float error = 0.01f * intersection_distance + splat_plane_distance;
-                                // float error = splat_plane_distance;
-
-                                if(error < intersection.error_ && error < max_intersection_error)
-                                {
-                                    intersection.error_ = error;
-                                    intersection.error_raw_ = splat_plane_distance;
-
-                                    has_hit = true;
-                                    intersection.distance_ = intersection_distance;
-                                    intersection.position_ = splat_plane_intersection;
-
-                                    scm::math::mat4f normal_transform = scm::math::transpose(inverse_model_transform);
-                                    scm::math::vec3f plane_normal = normal_transform * scm::math::vec3f(surfel.nx, surfel.ny, surfel.nz);
-                                    intersection.normal_ = scm::math::normalize(plane_normal);
-                                    if(scm::math::dot(intersection.normal_, direction_) > 0.f)
-                                    {
-                                        intersection.normal_ *= -1.f;
-                                    }
-                                }
-                            }
-                        }
-                    }
+                    has_hit = true;
                 }
             }
         }
@@ -470,63 +476,10 @@ const bool ray::intersect_model_unsafe(const model_t model_id, const scm::math::
             float object_to_world_scale = max_distance_ / object_ray_max_distance;
 
             dataset::serialized_surfel *surfels = (dataset::serialized_surfel *)ooc_cache->node_data(model_id, node_id);
-            for(unsigned int k = 0; k < num_surfels_per_node; k += valid_surfel_skip)
+            if(intersect_surfels(surfels, num_surfels_per_node, valid_surfel_skip, model_transform, inverse_model_transform, object_ray_origin, object_ray_direction,
+                                 object_to_world_scale, is_wysiwyg, intersection))
             {
-                dataset::serialized_surfel &surfel = surfels[k];
-
-                if(surfel.size >= std::numeric_limits<float>::min())
-                {
-                    float ts = -1.f;
-                    if(intersect_surfel(surfel, object_ray_origin, object_ray_direction, ts))
-                    {
-                        if(ts != ts || ts <= 0.f)
-                        {
-                            continue;
-                        }
-
-                        scm::math::vec3f splat_plane_intersection = origin_ + direction_ * ts * object_to_world_scale;
-                        scm::math::vec3f splat_position = model_transform * scm::math::vec3f(surfel.x, surfel.y, surfel.z);
-                        float splat_plane_distance = scm::math::length(splat_position - splat_plane_intersection);
-
-                        if(scm::math::length(splat_position - origin_) < max_distance_)
-                        {
-                            if(surfel.size <= std::numeric_limits<float>::min())
-                            {
-                                continue;
-                            }
-
-                            if(is_wysiwyg)
-                            {
-                                if(splat_plane_distance > object_to_world_scale * surfel.size * LAMURE_WYSIWYG_SPLAT_SCALE)
-                                {
-                                    continue;
-                                }
-                            }
-
-                            float intersection_distance = scm::math::length(splat_plane_intersection - origin_);
-                            float error = 0.01f * intersection_distance + splat_plane_distance;
-                            // float error = splat_plane_distance;
-
-                            if(error < intersection.error_ && error < max_intersection_error)
-                            {
-                                intersection.error_ = error;
-                                intersection.error_raw_ = splat_plane_distance;
-
-                                has_hit = true;
-                                intersection.distance_ = intersection_distance;
-                                intersection.position_ = splat_plane_intersection;
-
-                                scm::math::mat4f normal_transform = scm::math::transpose(inverse_model_transform);
-                                scm::math::vec3f plane_normal = normal_transform * scm::math::vec3f(surfel.nx, surfel.ny, surfel.nz);
-                                intersection.normal_ = scm::math::normalize(plane_normal);
-                                if(scm::math::dot(intersection.normal_, direction_) > 0.f)
-                                {
-                                    intersection.normal_ *= -1.f;
-                                }
-                            }
-                        }
-                    }
-                }
+                has_hit = true;
             }
         }
     }
@@ -799,48 +752,73 @@ const bool ray::intersect_surfel(const dataset::serialized_surfel &surfel, const
     return false;
 }
 
-ray_queue::ray_queue() : is_shutdown_(false)
+const bool ray::intersect_surfels(const dataset::serialized_surfel *surfels, const uint32_t num_surfels, const unsigned int surfel_skip, const scm::math::mat4f &model_transform,
+                                  const scm::math::mat4f &inverse_model_transform, const scm::math::vec3f &object_ray_origin, const scm::math::vec3f &object_ray_direction,
+                                  const float object_to_world_scale, const bool is_wysiwyg, ray::intersection &intersection) const
 {
-    semaphore_.set_min_signal_count(1);
-    semaphore_.set_max_signal_count(std::numeric_limits<float>::max());
-}
-
-ray_queue::~ray_queue() {}
+    float max_intersection_error = 6.f;
+    bool has_hit = false;
 
-void ray_queue::wait() { semaphore_.wait(); }
+    for(unsigned int k = 0; k < num_surfels; k += surfel_skip)
+    {
+        const dataset::serialized_surfel &surfel = surfels[k];
 
-const bool ray_queue::is_shutdown() { return is_shutdown_; }
+        if(surfel.size >= std::numeric_limits<float>::min())
+        {
+            float ts = -1.f;
+            if(intersect_surfel(surfel, object_ray_origin, object_ray_direction, ts))
+            {
+                if(ts != ts || ts <= 0.f)
+                {
+                    continue;
+                }
 
-void ray_queue::relaunch() { is_shutdown_ = false; }
+                scm::math::vec3f splat_plane_intersection = origin_ + direction_ * ts * object_to_world_scale;
+                scm::math::vec3f splat_position = model_transform * scm::math::vec3f(surfel.x, surfel.y, surfel.z);
+                float splat_plane_distance = scm::math::length(splat_position - splat_plane_intersection);
 
-const unsigned int ray_queue::num_jobs() { return (unsigned int)queue_.size(); }
+                if(scm::math::length(splat_position - origin_) < max_distance_)
+                {
+                    if(surfel.size <= std::numeric_limits<float>::min())
+                    {
+                        continue;
+                    }
 
-void ray_queue::push_job(const ray_queue::ray_job &job)
-{
-    std::lock_guard<std::mutex> lock(mutex_);
-    queue_.push(job);
-    semaphore_.signal(1);
-}
+                    if(is_wysiwyg)
+                    {
+                        if(splat_plane_distance > object_to_world_scale * surfel.size * LAMURE_WYSIWYG_SPLAT_SCALE)
+                        {
+                            continue;
+                        }
+                    }
 
-const ray_queue::ray_job ray_queue::pop_job()
-{
-    std::lock_guard<std::mutex> lock(mutex_);
+                    float intersection_distance = scm::math::length(splat_plane_intersection - origin_);
+                    float error = 0.01f * intersection_distance + splat_plane_distance;
+                    // float error = splat_plane_distance;
 
-    ray_job job;
+                    if(error < intersection.error_ && error < max_intersection_error)
+                    {
+                        intersection.error_ = error;
+                        intersection.error_raw_ = splat_plane_distance;
 
-    if(!queue_.empty())
-    {
-        job = queue_.front();
-        queue_.pop();
-    }
+                        has_hit = true;
+                        intersection.distance_ = intersection_distance;
+                        intersection.position_ = splat_plane_intersection;
 
-    if(queue_.empty())
-    {
-        is_shutdown_ = true;
-        semaphore_.shutdown();
+                        scm::math::mat4f normal_transform = scm::math::transpose(inverse_model_transform);
+                        scm::math::vec3f plane_normal = normal_transform * scm::math::vec3f(surfel.nx, surfel.ny, surfel.nz);
+                        intersection.normal_ = scm::math::normalize(plane_normal);
+                        if(scm::math::dot(intersection.normal_, direction_) > 0.f)
+                        {
+                            intersection.normal_ *= -1.f;
+                        }
+                    }
+                }
+            }
+        }
     }
 
-    return job;
+    return has_hit;
 }
 }
 }
@@ -0,0 +1,334 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/ray_packet.h>
+#include <lamure/ren/model_database.h>
+#include <lamure/ren/ooc_cache.h>
+
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define LAMURE_RAY_PACKET_ENABLE_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace lamure
+{
+
+namespace ren
+{
+
+static_assert(LAMURE_RAY_PACKET_SIZE > 0 && LAMURE_RAY_PACKET_SIZE <= 32,
+              "LAMURE_RAY_PACKET_SIZE must fit into a ray_packet::mask_t");
+
+namespace
+{
+
+//packet size rounded up to full sse registers
+const size_t num_lanes = (LAMURE_RAY_PACKET_SIZE + 3) & ~3;
+
+//the rays of a packet in object space of one model, as structure of arrays.
+//unused lanes are zero and never part of an active mask
+struct object_rays
+{
+    alignas(16) float origin_x_[num_lanes];
+    alignas(16) float origin_y_[num_lanes];
+    alignas(16) float origin_z_[num_lanes];
+    alignas(16) float inv_direction_x_[num_lanes];
+    alignas(16) float inv_direction_y_[num_lanes];
+    alignas(16) float inv_direction_z_[num_lanes];
+    alignas(16) float max_distance_[num_lanes];
+
+    scm::math::vec3f origin_[LAMURE_RAY_PACKET_SIZE];
+    scm::math::vec3f direction_[LAMURE_RAY_PACKET_SIZE];
+    float object_to_world_scale_[LAMURE_RAY_PACKET_SIZE];
+};
+
+//same test as ray::intersect_aabb for every active ray. with check_distance,
+//boxes that start beyond the maximum distance of a ray are rejected as well
+ray_packet::mask_t intersect_box(const object_rays& rays, const scm::gl::boxf& box,
+                                 const ray_packet::mask_t active, const bool check_distance) {
+    const scm::math::vec3f& box_min = box.min_vertex();
+    const scm::math::vec3f& box_max = box.max_vertex();
+
+    ray_packet::mask_t hits = 0;
+
+#ifdef LAMURE_RAY_PACKET_ENABLE_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 min_x = _mm_set1_ps(box_min.x);
+    const __m128 min_y = _mm_set1_ps(box_min.y);
+    const __m128 min_z = _mm_set1_ps(box_min.z);
+    const __m128 max_x = _mm_set1_ps(box_max.x);
+    const __m128 max_y = _mm_set1_ps(box_max.y);
+    const __m128 max_z = _mm_set1_ps(box_max.z);
+
+    for (size_t lane = 0; lane < num_lanes; lane += 4) {
+        if (((active >> lane) & 0xF) == 0) {
+            continue;
+        }
+
+        __m128 origin_x = _mm_load_ps(&rays.origin_x_[lane]);
+        __m128 origin_y = _mm_load_ps(&rays.origin_y_[lane]);
+        __m128 origin_z = _mm_load_ps(&rays.origin_z_[lane]);
+        __m128 inv_x = _mm_load_ps(&rays.inv_direction_x_[lane]);
+        __m128 inv_y = _mm_load_ps(&rays.inv_direction_y_[lane]);
+        __m128 inv_z = _mm_load_ps(&rays.inv_direction_z_[lane]);
+
+        __m128 t1_x = _mm_mul_ps(_mm_sub_ps(min_x, origin_x), inv_x);
+        __m128 t1_y = _mm_mul_ps(_mm_sub_ps(min_y, origin_y), inv_y);
+        __m128 t1_z = _mm_mul_ps(_mm_sub_ps(min_z, origin_z), inv_z);
+        __m128 t2_x = _mm_mul_ps(_mm_sub_ps(max_x, origin_x), inv_x);
+        __m128 t2_y = _mm_mul_ps(_mm_sub_ps(max_y, origin_y), inv_y);
+        __m128 t2_z = _mm_mul_ps(_mm_sub_ps(max_z, origin_z), inv_z);
+
+        __m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1_x, t2_x), _mm_min_ps(t1_y, t2_y)), _mm_min_ps(t1_z, t2_z));
+        __m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1_x, t2_x), _mm_max_ps(t1_y, t2_y)), _mm_max_ps(t1_z, t2_z));
+
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(tmax, zero), _mm_cmpge_ps(tmax, tmin));
+        if (check_distance) {
+            hit = _mm_and_ps(hit, _mm_cmple_ps(tmin, _mm_load_ps(&rays.max_distance_[lane])));
+        }
+
+        hits |= (ray_packet::mask_t)_mm_movemask_ps(hit) << lane;
+    }
+#else
+    for (size_t lane = 0; lane < num_lanes; ++lane) {
+        if (!((active >> lane) & 1)) {
+            continue;
+        }
+
+        float t1_x = (box_min.x - rays.origin_x_[lane]) * rays.inv_direction_x_[lane];
+        float t1_y = (box_min.y - rays.origin_y_[lane]) * rays.inv_direction_y_[lane];
+        float t1_z = (box_min.z - rays.origin_z_[lane]) * rays.inv_direction_z_[lane];
+        float t2_x = (box_max.x - rays.origin_x_[lane]) * rays.inv_direction_x_[lane];
+        float t2_y = (box_max.y - rays.origin_y_[lane]) * rays.inv_direction_y_[lane];
+        float t2_z = (box_max.z - rays.origin_z_[lane]) * rays.inv_direction_z_[lane];
+
+        float tmin = std::max(std::max(std::min(t1_x, t2_x), std::min(t1_y, t2_y)), std::min(t1_z, t2_z));
+        float tmax = std::min(std::min(std::max(t1_x, t2_x), std::max(t1_y, t2_y)), std::max(t1_z, t2_z));
+
+        if (tmax >= 0.f && tmax >= tmin && (!check_distance || tmin <= rays.max_distance_[lane])) {
+            hits |= (ray_packet::mask_t)1 << lane;
+        }
+    }
+#endif
+
+    return hits & active;
+}
+
+}
+
+residency_snapshot::
+residency_snapshot() {
+
+}
+
+void residency_snapshot::
+capture() {
+    //reset the entries of the previous capture only
+    for (size_t i = 0; i < model_ids_.size(); ++i) {
+        node_data_[model_ids_[i]][node_ids_[i]] = nullptr;
+    }
+
+    model_database* database = model_database::get_instance();
+    ooc_cache* ooc_cache = ooc_cache::get_instance();
+
+    if (node_data_.size() < database->num_models()) {
+        node_data_.resize(database->num_models());
+    }
+
+    for (model_t model_id = 0; model_id < database->num_models(); ++model_id) {
+        node_t num_nodes = database->get_model(model_id)->get_bvh()->get_num_nodes();
+        if (node_data_[model_id].size() < num_nodes) {
+            node_data_[model_id].resize(num_nodes, nullptr);
+        }
+    }
+
+    ooc_cache->get_aquired_node_data(model_ids_, node_ids_, data_);
+
+    for (size_t i = 0; i < model_ids_.size(); ++i) {
+        node_data_[model_ids_[i]][node_ids_[i]] = data_[i];
+    }
+}
+
+ray_packet::
+ray_packet(const ray* rays, const size_t num_rays)
+: rays_(rays), num_rays_(std::min(num_rays, (size_t)LAMURE_RAY_PACKET_SIZE)) {
+
+}
+
+const ray_packet::mask_t ray_packet::
+intersect_model(const residency_snapshot& residency,
+                const model_t model_id,
+                const scm::math::mat4f& model_transform,
+                const unsigned int max_depth,
+                const unsigned int surfel_skip,
+                const bool is_wysiwyg,
+                ray::intersection* intersections) const {
+
+    model_database* database = model_database::get_instance();
+    if (model_id >= database->num_models() || num_rays_ == 0) {
+        return 0;
+    }
+
+    const bvh* tree = database->get_model(model_id)->get_bvh();
+    if (tree->get_primitive() != bvh::primitive_type::POINTCLOUD) {
+        return 0;
+    }
+
+    //check if model has started loading, otherwise we cant do nothin
+    if (!residency.is_resident(model_id, 0)) {
+        return 0;
+    }
+
+    const uint32_t fan_factor = tree->get_fan_factor();
+    const node_t num_nodes = tree->get_num_nodes();
+    const uint32_t num_surfels_per_node = database->get_primitives_per_node();
+    const std::vector<scm::gl::boxf>& bounding_boxes = tree->get_bounding_boxes();
+
+    const unsigned int valid_max_depth = max_depth == 0 ? 255 : max_depth;
+    const unsigned int valid_surfel_skip = surfel_skip == 0 ? 1 : surfel_skip;
+
+    const scm::math::mat4f inverse_model_transform = scm::math::inverse(model_transform);
+
+    object_rays object;
+    for (size_t lane = 0; lane < num_lanes; ++lane) {
+        object.origin_x_[lane] = object.origin_y_[lane] = object.origin_z_[lane] = 0.f;
+        object.inv_direction_x_[lane] = object.inv_direction_y_[lane] = object.inv_direction_z_[lane] = 0.f;
+        object.max_distance_[lane] = 0.f;
+    }
+
+    for (size_t i = 0; i < num_rays_; ++i) {
+        const ray& ray = rays_[i];
+
+        scm::math::vec3f object_ray_origin = inverse_model_transform * ray.origin_;
+        scm::math::vec3f object_ray_aux = inverse_model_transform * (ray.origin_ + ray.direction_ * ray.max_distance_);
+        scm::math::vec3f object_ray_direction = object_ray_aux - object_ray_origin;
+        float object_ray_max_distance = scm::math::length(object_ray_direction);
+        object_ray_direction = scm::math::normalize(object_ray_direction);
+
+        object.origin_[i] = object_ray_origin;
+        object.direction_[i] = object_ray_direction;
+        object.object_to_world_scale_[i] = ray.max_distance_ / object_ray_max_distance;
+
+        object.origin_x_[i] = object_ray_origin.x;
+        object.origin_y_[i] = object_ray_origin.y;
+        object.origin_z_[i] = object_ray_origin.z;
+        object.inv_direction_x_[i] = 1.f / object_ray_direction.x;
+        object.inv_direction_y_[i] = 1.f / object_ray_direction.y;
+        object.inv_direction_z_[i] = 1.f / object_ray_direction.z;
+        object.max_distance_[i] = object_ray_max_distance;
+    }
+
+    const mask_t all_rays = num_rays_ == 32 ? ~(mask_t)0 : (((mask_t)1 << num_rays_) - 1);
+    mask_t hits = 0;
+
+    auto intersect_node_surfels = [&](const node_t node_id, const mask_t active) {
+        const dataset::serialized_surfel* surfels = (const dataset::serialized_surfel*)residency.node_data(model_id, node_id);
+
+        for (size_t i = 0; i < num_rays_; ++i) {
+            if (!((active >> i) & 1)) {
+                continue;
+            }
+
+            if (rays_[i].intersect_surfels(surfels, num_surfels_per_node, valid_surfel_skip, model_transform, inverse_model_transform,
+                                           object.origin_[i], object.direction_[i], object.object_to_world_scale_[i], is_wysiwyg, intersections[i])) {
+                hits |= (mask_t)1 << i;
+            }
+        }
+    };
+
+    //short stack, one level per tree depth. each level holds a parent, the
+    //next child to visit and the rays that reached the parent
+    struct level
+    {
+        node_t parent_id_;
+        uint32_t next_child_;
+        mask_t rays_;
+        bool no_child_available_;
+    };
+
+    level levels[LAMURE_RAY_SHORT_STACK_SIZE];
+    int32_t top = 0;
+    levels[0] = {0, 0, all_rays, true};
+
+    while (top >= 0) {
+        level& current = levels[top];
+
+        if (current.next_child_ >= fan_factor) {
+            //fix: no node other than root in ram
+            if (current.no_child_available_ && current.parent_id_ == 0) {
+                mask_t root_rays = current.rays_ & ~hits;
+                if (root_rays != 0) {
+                    intersect_node_surfels(0, root_rays);
+                }
+            }
+            --top;
+            continue;
+        }
+
+        node_t node_id = tree->get_child_id(current.parent_id_, current.next_child_++);
+
+        if (node_id == invalid_node_t || node_id >= num_nodes) {
+            continue;
+        }
+
+        if (!residency.is_resident(model_id, node_id)) {
+            continue;
+        }
+
+        current.no_child_available_ = false;
+
+        mask_t node_rays = intersect_box(object, bounding_boxes[node_id], current.rays_, true);
+        if (node_rays == 0) {
+            continue;
+        }
+
+        bool all_children_in_memory = true;
+        for (uint32_t k = 0; k < fan_factor; ++k) {
+            node_t child_id = tree->get_child_id(node_id, k);
+            if (child_id == invalid_node_t || child_id >= num_nodes || !residency.is_resident(model_id, child_id)) {
+                all_children_in_memory = false;
+                break;
+            }
+        }
+
+        //rays that hit any child descend, the others stop at this node
+        mask_t splat_rays = node_rays;
+        mask_t child_rays = 0;
+
+        if (all_children_in_memory && top + 1 < LAMURE_RAY_SHORT_STACK_SIZE) {
+            for (uint32_t k = 0; k < fan_factor && child_rays != node_rays; ++k) {
+                node_t child_id = tree->get_child_id(node_id, k);
+                child_rays |= intersect_box(object, bounding_boxes[child_id], node_rays & ~child_rays, false);
+            }
+
+            if (child_rays != 0 && tree->get_depth_of_node(node_id) + 1 < valid_max_depth) {
+                splat_rays &= ~child_rays;
+            }
+            else {
+                child_rays = 0;
+            }
+        }
+
+        if (splat_rays != 0 && tree->get_visibility(node_id) != bvh::node_visibility::NODE_INVISIBLE) {
+            intersect_node_surfels(node_id, splat_rays);
+        }
+
+        if (child_rays != 0) {
+            ++top;
+            levels[top] = {node_id, 0, child_rays, true};
+        }
+    }
+
+    return hits;
+}
+
+
+} // namespace ren
+
+} // namespace lamure
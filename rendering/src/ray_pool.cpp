@@ -0,0 +1,157 @@
+// Copyright (c) 2014 Bauhaus-Universitaet Weimar
+// This Software is distributed under the Modified BSD License, see license.txt.
+//
+// Virtual Reality and Visualization Research Group
+// Faculty of Media, Bauhaus-Universitaet Weimar
+// http://www.uni-weimar.de/medien/vr
+
+#include <lamure/ren/ray_pool.h>
+
+#include <algorithm>
+
+namespace lamure
+{
+
+namespace ren
+{
+
+std::mutex ray_pool::mutex_;
+bool ray_pool::is_instanced_ = false;
+ray_pool* ray_pool::single_ = nullptr;
+
+ray_pool::
+ray_pool(const uint32_t num_threads)
+: job_(nullptr),
+  num_jobs_(0),
+  next_job_(0),
+  num_busy_(0),
+  generation_(0),
+  shutdown_(false) {
+
+    //the caller of run() is the remaining thread
+    for (uint32_t i = 1; i < num_threads; ++i) {
+        threads_.push_back(std::thread(&ray_pool::run_worker, this));
+    }
+}
+
+ray_pool::
+~ray_pool() {
+    {
+        std::lock_guard<std::mutex> lock(job_mutex_);
+        shutdown_ = true;
+    }
+    job_signal_.notify_all();
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_instanced_ = false;
+    single_ = nullptr;
+}
+
+ray_pool* ray_pool::
+get_instance() {
+    if (!is_instanced_) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!is_instanced_) {
+            uint32_t num_threads = LAMURE_RAY_POOL_NUM_THREADS;
+            if (num_threads == 0) {
+                num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+
+            single_ = new ray_pool(num_threads);
+            is_instanced_ = true;
+        }
+    }
+
+    return single_;
+}
+
+void ray_pool::
+run(const size_t num_jobs, const std::function<void(const size_t)>& job) {
+    if (num_jobs == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+
+    {
+        std::lock_guard<std::mutex> lock(job_mutex_);
+        job_ = &job;
+        num_jobs_ = num_jobs;
+        next_job_ = 0;
+        num_busy_ = (uint32_t)threads_.size();
+        exception_ = nullptr;
+        ++generation_;
+    }
+
+    job_signal_.notify_all();
+
+    work();
+
+    std::exception_ptr exception;
+
+    {
+        std::unique_lock<std::mutex> lock(job_mutex_);
+        done_signal_.wait(lock, [&]{ return num_busy_ == 0; });
+        job_ = nullptr;
+        exception = exception_;
+        exception_ = nullptr;
+    }
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void ray_pool::
+run_worker() {
+    uint64_t generation = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(job_mutex_);
+            job_signal_.wait(lock, [&]{ return shutdown_ || generation_ != generation; });
+
+            if (shutdown_) {
+                break;
+            }
+
+            generation = generation_;
+        }
+
+        work();
+
+        std::lock_guard<std::mutex> lock(job_mutex_);
+        if (--num_busy_ == 0) {
+            done_signal_.notify_one();
+        }
+    }
+}
+
+void ray_pool::
+work() {
+    size_t job_id;
+    while ((job_id = next_job_++) < num_jobs_) {
+        try {
+            (*job_)(job_id);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(job_mutex_);
+            if (!exception_) {
+                exception_ = std::current_exception();
+            }
+        }
+    }
+}
+
+
+} // namespace ren
+
+} // namespace lamure